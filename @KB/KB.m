@@ -86,6 +86,11 @@ classdef KB < handle
         m_is_sparse = false 
         % Handle to sat solver
         m_sat_solver = @c_sat_solve
+        % Solver handle holding the compiled clauses used by
+        % atomProbsFromWMC, empty if none
+        m_wmc_solver = []
+        % The logic matrix compiled into m_wmc_solver
+        m_wmc_logic_mat = []
     end
     
     methods (Access = public)
@@ -94,6 +99,12 @@ classdef KB < handle
             kb.initializeMaps();
         end
         
+        function delete(kb)
+            if ~isempty(kb.m_wmc_solver)
+                sat_delete(kb.m_wmc_solver);
+            end
+        end
+        
         [s, v] = runSATSolver(kb, rtn_all_models)
         
         showKB(kb)
@@ -1,11 +1,21 @@
-function [atom_probs] = atomProbsFromMonteCarlo(kb, num_trials)
+function [atom_probs] = atomProbsFromMonteCarlo(kb, num_trials, num_samples)
 %ATOMPROBSFROMMONTECARLO Summary of this function goes here
 %   Detailed explanation goes here
+%   Each trial averages atoms over num_samples models (1 if absent)
+%   drawn near uniformly by sat_sample, rather than over all models.
+%   With num_samples 0, all models are enumerated by the solver of kb.
+%   Atoms fixed by the clauses of probability 1 (see fixedAtoms) are
+%   not sampled: they count 1 or 0 in every satisfiable trial.
+    if nargin < 3
+        num_samples = 1;
+    end
     clause_probs = kb.m_clause_probs;
     num_clauses = length(clause_probs);
     atom_probs = zeros(1, kb.m_num_atoms);
     %num_trials = 10;
     num_models = 0;
+    fixed = kb.fixedAtoms();
+    free_atoms = setdiff(1:kb.m_num_atoms, abs(fixed));
     f = waitbar(0,'Please wait...');
 %     WaitMessage = parfor_wait(num_trials, 'Waitbar', true);
     tic
@@ -23,7 +33,23 @@ function [atom_probs] = atomProbsFromMonteCarlo(kb, num_trials)
            kbc.negateClause(n);
        end
 %        [s, model, ~] = kbc.askClause({});
-         [s, models] = kbc.py_sat_solve(kbc, true);
+       if num_samples > 0
+           h = sat_new;
+           sat_add(h, kbc.m_logic_mat);
+           if isempty(free_atoms)
+               s = sat_solve_assuming(h);
+               sampled = zeros(s, 0);
+           else
+               sampled = sat_sample(h, num_samples, free_atoms);
+               s = ~isempty(sampled);
+           end
+           sat_delete(h);
+           models = -ones(size(sampled,1), kb.m_num_atoms);
+           models(:, free_atoms) = sampled;
+           models(:, fixed(fixed > 0)) = 1;
+       else
+           [s, models] = kbc.runSATSolver(true);
+       end
        % If the kb is satisfiable, count
        if s 
             num_models = num_models + size(models,1);
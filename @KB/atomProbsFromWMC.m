@@ -0,0 +1,57 @@
+function [atom_probs] = atomProbsFromWMC(kb)
+%ATOMPROBSFROMWMC Exact atom probabilities by weighted model counting
+%   As in atomProbsFromMonteCarlo, clause k is kept with probability
+%   kb.m_clause_probs(k) and negated otherwise.  Each clause gets a
+%   selector variable, true exactly when the clause holds, weighted by
+%   the clause probability.  Atoms are weighted by kb.m_atom_probs if
+%   set, and uniformly otherwise.  atom_probs(i) is then the
+%   probability of atom i over the models of all kept/negated clause
+%   combinations, each model weighted by the probability of its
+%   combination.  Unlike atomProbsFromMonteCarlo, combinations with
+%   more models weigh more, and there is no sampling noise.
+%   The encoding is compiled once, and kept until m_logic_mat changes:
+%   new clause or atom probabilities only take time linear in the
+%   compiled encoding.
+% On input:
+%     kb (instance of KB): knowledge base
+% On output:
+%     atom_probs (1xn): probability of each atom, zeros if no
+%     combination is satisfiable
+% Call:
+%    atom_probs = kb.atomProbsFromWMC();
+    num_atoms = kb.m_num_atoms;
+    num_clauses = size(kb.m_logic_mat, 1);
+    clause_probs = kb.m_clause_probs;
+    if isempty(clause_probs)
+        clause_probs = ones(1, num_clauses);
+    end
+    atom_probs = kb.m_atom_probs;
+    if length(atom_probs) ~= num_atoms
+        atom_probs = 0.5*ones(1, num_atoms);
+    end
+    if isempty(kb.m_wmc_solver) || ...
+            ~isequal(kb.m_wmc_logic_mat, kb.m_logic_mat)
+        % selector s of a clause: ~s or clause, and s or ~l for each
+        % literal
+        [r, c, v] = find(kb.m_logic_mat);
+        r = r(:); c = c(:); v = v(:);
+        num_lits = length(r);
+        sel = num_atoms + (1:num_clauses)';
+        rows = [r; (1:num_clauses)'; num_clauses + (1:num_lits)'; ...
+            num_clauses + (1:num_lits)'];
+        cols = [c; sel; c; sel(r)];
+        vals = [v; -ones(num_clauses, 1); -v; ones(num_lits, 1)];
+        sel_mat = sparse(rows, cols, vals, num_clauses + num_lits, ...
+            num_atoms + num_clauses);
+        if ~isempty(kb.m_wmc_solver)
+            sat_delete(kb.m_wmc_solver);
+        end
+        kb.m_wmc_solver = sat_new;
+        sat_add(kb.m_wmc_solver, sel_mat);
+        sat_compile(kb.m_wmc_solver);
+        kb.m_wmc_logic_mat = kb.m_logic_mat;
+    end
+    weights = [atom_probs(:)', clause_probs(:)'];
+    [~, probs] = sat_compiled_count(kb.m_wmc_solver, weights);
+    atom_probs = probs(1:num_atoms);
+end
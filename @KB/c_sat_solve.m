@@ -1,12 +1,19 @@
 function [satisfiable, models] = c_sat_solve(kb, rtn_all_models)
 %C_SAT_SOLVE Summary of this function goes here
 %   Detailed explanation goes here
+    if nargin < 2
+        rtn_all_models = false;
+    end
+    if rtn_all_models
+        h = sat_new;
+        sat_add(h, kb.m_logic_mat);
+        [n, models] = sat_models(h);
+        sat_delete(h);
+        satisfiable = n > 0;
+        return;
+    end
     sat_init;
     [satisfiable, model] = sat_solve(kb.m_logic_mat);
     sat_done;
     models = [model];
-    if rtn_all_models
-        warning('The c-sat library does not support returning all models');
-    end
 end
-
@@ -0,0 +1,28 @@
+function [fixed] = fixedAtoms(kb)
+%FIXEDATOMS Atoms with the same truth value in every model
+%   Only clauses of probability 1 (all clauses if kb.m_clause_probs is
+%   empty) are considered, since the others may be negated, as in
+%   atomProbsFromMonteCarlo.  An atom fixed by these is then fixed in
+%   every satisfiable combination of kept/negated clauses, i.e. its
+%   probability is exactly 0 or 1, and it needs no sampling.
+% On input:
+%     kb (instance of KB): knowledge base
+% On output:
+%     fixed (kx1): literals true in every model, i (-i) for atom i
+%     always true (false), empty if none or if the clauses are
+%     unsatisfiable
+% Call:
+%    fixed = kb.fixedAtoms();
+    hard = kb.m_logic_mat;
+    if ~isempty(kb.m_clause_probs)
+        hard = hard(kb.m_clause_probs >= 1, :);
+    end
+    if isempty(hard)
+        fixed = zeros(0, 1);
+        return;
+    end
+    h = sat_new;
+    sat_add(h, hard);
+    fixed = sat_backbone(h);
+    sat_delete(h);
+end
@@ -0,0 +1,46 @@
+function [rows] = unsatClauses(kb, method)
+%UNSATCLAUSES Small set of clauses explaining why the KB is unsatisfiable
+%   Each clause of kb.m_logic_mat gets a selector variable, and the
+%   solver looks for a subset of selectors, i.e. of clauses, still
+%   unsatisfiable.  All is done on a single solver, under assumptions,
+%   rather than re-solving from scratch with each clause deleted.
+% On input:
+%     kb (instance of KB): knowledge base
+%     method (string): 'deletion' (default) or 'quickxplain' for a
+%     minimal subset: removing any of its clauses makes it
+%     satisfiable.  QuickXplain is usually faster for small subsets.
+%     'core' for a subset found by a single solve, not necessarily
+%     minimal
+% On output:
+%     rows (kx1): sorted row indices of kb.m_logic_mat, empty if the KB
+%     is satisfiable
+% Call:
+%    rows = kb.unsatClauses();
+%    rows = kb.unsatClauses('quickxplain');
+    if nargin < 2
+        method = 'deletion';
+    end
+    switch method
+        case 'deletion'
+            o = 0;
+        case 'core'
+            o = 1;
+        case 'quickxplain'
+            o = 2;
+        otherwise
+            error('unknown method %s', method);
+    end
+    [num_clauses, num_atoms] = size(kb.m_logic_mat);
+    rows = zeros(0, 1);
+    if num_clauses == 0
+        return;
+    end
+    h = sat_new;
+    sat_add(h, [sparse(kb.m_logic_mat), -speye(num_clauses)]);
+    [s, rows] = sat_mus(h, num_atoms + (1:num_clauses), o);
+    sat_delete(h);
+    if s
+        rows = zeros(0, 1);
+    end
+    rows = sort(rows);
+end
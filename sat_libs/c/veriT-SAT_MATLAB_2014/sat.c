@@ -9,28 +9,779 @@
 
     INPUT : 
     - M  : clauses dense matrix  (NbClausesxNbVar)
- 
+
     OUTPUT : 
      - s : satisfaisability boolean 
      - var : variables vector containing a solution (NbVar) 
+
+   Solver handles, to keep a solver (and its learnt clauses) across
+   calls until it is released :
+
+    h = sat(3)                   creates a solver, h is its handle
+    sat(4,h,M)                   adds the clauses of M, as sat(1,M)
+    [s,var] = sat(5,h)           solves
+    [s,var,core] = sat(6,h,A)    solves assuming the literals of A,
+                                 i.e. i (-i) for variable i true (false).
+                                 If unsat, core is the subset of A
+                                 responsible (empty if the clauses alone
+                                 are unsat)
+    var = sat(7,h)               model found by the last solve
+    sat(8,h)                     releases the solver
+    [n,models] = sat(9,h,max,P)  enumerates up to max models (all if 0
+                                 or absent), one per row.  With a vector
+                                 P of variables, models are projected
+                                 on these (columns of models).  Each
+                                 model is excluded from the solver,
+                                 calling again gives the next ones
+    c = sat(10,h,W,A)            weighted count of the models satisfying
+                                 the literals of A (none if absent).  W
+                                 is a vector of probabilities of
+                                 variables being true, or a 2xNbVar
+                                 matrix of weights of positive (first
+                                 row) and negative literals.  Without W
+                                 (or empty), c is the number of models
+    n = sat(11,h)                compiles the clauses into a circuit,
+                                 kept with the solver, of n edges
+    [c,p] = sat(12,h,W,A)        as sat(10), but in time linear in the
+                                 circuit, p(i) being the probability
+                                 of variable i being true in the
+                                 counted models
+    sat(13,h,file)               writes the circuit to a file
+    h = sat(14,file)             creates a solver, without clauses,
+                                 with the circuit read from a file
+    V = sat(15,h,k,P)            draws k models near uniformly, one per
+                                 row.  With a vector P of variables,
+                                 models are projected on these, each
+                                 projection being about as likely.
+                                 Fewer rows are returned only if the
+                                 sampler fails
+    V = sat(16,h,k,W)            draws k models from the circuit, with
+                                 probability proportional to their
+                                 weight, with W as for sat(10)
+    [B,s] = sat(17,h,P)          backbone, i.e. literals true in every
+                                 model, on the variables of P (all if
+                                 absent), as for A in sat(6).  s is 0
+                                 (and B empty) if the clauses are unsat
+    [s,C] = sat(18,h,A,o)        if the clauses are unsat assuming the
+                                 literals of A (s is 0), C are the
+                                 positions in A of a minimal subset of
+                                 them still unsat (empty if the clauses
+                                 alone are).  o is 0 (or absent) for a
+                                 minimization by deletion, 1 for just
+                                 a core, 2 for QuickXplain
+    [s,var,c] = sat(19,h,A,W,o)  model of least cost, c being the total
+                                 weight of the literals of A it
+                                 falsifies, W holding their weights,
+                                 nonnegative integers (1 if absent or
+                                 empty).  s is 0 (var empty and c Inf)
+                                 if the clauses are unsat.  o is 0 (or
+                                 absent) for a core-guided search, 1
+                                 for a linear one
+    sat(20,h,M,k)                adds the constraints that at most k(i)
+                                 literals of row i of M are true, k
+                                 being a scalar or a value per row
+                                 (nonnegative integers)
+    sat(21,h,M)                  adds the constraints that exactly one
+                                 literal of each row of M is true
   */
 
-void mexFunction(int nlhs, mxArray *plhs[], int nrhs,const mxArray *prhs[])
+typedef struct {
+  SAT_Tsolver * S;   /* NULL once released */
+  mwSize NbVar;      /* number of columns seen in clause matrices */
+  SAT_Tnnf * nnf;    /* compiled clauses, NULL if none */
+} Thandle;
+
+static Thandle * handles = NULL;
+static mwSize handles_n = 0;
+
+/* releases all solvers, when the MEX file is cleared */
+static void handles_free(void)
+{
+  mwIndex i;
+  for (i = 0; i < handles_n; i++)
+    if (handles[i].S)
+      {
+        SAT_delete(handles[i].S);
+        SAT_nnf_delete(handles[i].nnf);
+      }
+  free(handles);
+  handles = NULL;
+  handles_n = 0;
+}
+
+static mwIndex handle_new(void)
+{
+  mwIndex i;
+  if (!handles)
+    mexAtExit(handles_free);
+  for (i = 0; i < handles_n && handles[i].S; i++) ;
+  if (i == handles_n)
+    {
+      Thandle * tmp = (Thandle*) realloc(handles, (handles_n + 1) * sizeof(Thandle));
+      if (!tmp)
+        mexErrMsgIdAndTxt("sat:memory","\n\r out of memory");
+      handles = tmp;
+      handles_n++;
+    }
+  handles[i].S = SAT_new();
+  handles[i].NbVar = 0;
+  handles[i].nnf = NULL;
+  return i + 1;
+}
+
+static Thandle * handle_get(const mxArray * A)
+{
+  double h;
+  if (!mxIsDouble(A) || mxGetNumberOfElements(A) != 1)
+    mexErrMsgIdAndTxt("sat:handle","\n\r solver handle expected");
+  h = mxGetScalar(A);
+  if (h < 1 || h > handles_n || h != (double) (mwIndex) h ||
+      !handles[(mwIndex) h - 1].S)
+    mexErrMsgIdAndTxt("sat:handle","\n\r invalid solver handle");
+  return handles + (mwIndex) h - 1;
+}
+
+/* adds the clauses of matrix A: dense with a clause per row, or sparse
+   with a clause per column.  Returns the number of variables (columns)
+   Indices are given to the solver as size_t, i.e. mwIndex with
+   -largeArrayDims.  If K is not NULL, the rows are rather cardinality
+   constraints, at most K[i] literals of row i being true */
+static mwSize clauses_add(SAT_Tsolver * S, const mxArray * A,
+                          const unsigned * K)
 {
-   
   mwSize NbClauses,
-         NbVar,
-	 un=1;
+         NbVar;
 
   mwIndex i,
           j,
-          c,
-	  k,
-	  accu;
-  double *M,
-          val;
-  
-  SAT_Tlit * clause;
+          k;
+  double *M;
+
+  if (mxIsSparse(A)) {
+    NbVar = mxGetM(A);
+    NbClauses = mxGetN(A);
+  } else {
+    NbClauses =  mxGetM(A);
+    NbVar = mxGetN(A);
+  }
+
+  M = mxGetPr(A);
+
+  /* adding variables */
+  SAT_var_new_id_r(S, (unsigned) NbVar);
+
+  if (!mxIsSparse(A)) { /* Not sparsed matrix*/
+    /* rows to compressed form, scanning M in memory order: the
+       number of literals per clause first, then the literals */
+    mwIndex *start = (mwIndex*) mxCalloc(NbClauses + 1, sizeof(mwIndex));
+    mwIndex *index;
+    double *value;
+    for (j = 0; j < NbVar; j++)
+      for (i = 0; i < NbClauses; i++)
+        if (M[i+j*NbClauses])
+          start[i+1]++;
+    for (i = 0; i < NbClauses; i++)
+      start[i+1] += start[i];
+    index = (mwIndex*) mxMalloc((start[NbClauses] + 1) * sizeof(mwIndex));
+    value = (double*) mxMalloc((start[NbClauses] + 1) * sizeof(double));
+    for (j = 0; j < NbVar; j++)
+      for (i = 0; i < NbClauses; i++)
+        if (M[i+j*NbClauses]) {
+          k = start[i]++;
+          index[k] = j;
+          value[k] = M[i+j*NbClauses];
+        }
+    /* start[i] is now the end of clause i */
+    for (i = NbClauses; i > 0; i--)
+      start[i] = start[i-1];
+    start[0] = 0;
+    if (K)
+      SAT_cards_load_csc_r(S, (unsigned) NbClauses, (const size_t *) start,
+                           (const size_t *) index, value, K);
+    else
+      SAT_clauses_load_csc_r(S, (unsigned) NbClauses, (const size_t *) start,
+                             (const size_t *) index, value);
+    mxFree(start);
+    mxFree(index);
+    mxFree(value);
+  } else { /* Sparse matrix*/
+    /* a clause per column is the layout of the solver */
+    if (K)
+      SAT_cards_load_csc_r(S, (unsigned) NbClauses,
+                           (const size_t *) mxGetJc(A),
+                           (const size_t *) mxGetIr(A), M, K);
+    else
+      SAT_clauses_load_csc_r(S, (unsigned) NbClauses,
+                             (const size_t *) mxGetJc(A),
+                             (const size_t *) mxGetIr(A), M);
+  }
+  return NbVar;
+}
+
+/* adds to handle h the constraints that at most K(i) literals of row
+   i of A are true, K being a scalar or a value per row, or exactly one
+   if K is NULL */
+static void handle_cards(Thandle * h, const mxArray * A, const mxArray * K)
+{
+  mwSize n = mxIsSparse(A) ? mxGetN(A) : mxGetM(A), NbVar;
+  mwIndex i;
+  unsigned * k;
+  if (K && (!mxIsDouble(K) || mxIsSparse(K) ||
+            (mxGetNumberOfElements(K) != 1 && mxGetNumberOfElements(K) != n)))
+    mexErrMsgIdAndTxt("sat:card","\n\r a bound, or a bound per row, expected");
+  k = (unsigned*) mxMalloc((n + 1) * sizeof(unsigned));
+  for (i = 0; i < n; i++)
+    {
+      double v = K ? mxGetPr(K)[mxGetNumberOfElements(K) == 1 ? 0 : i] : 1;
+      if (v < 0 || v > 1e9 || v != (double) (unsigned) v)
+        mexErrMsgIdAndTxt("sat:card","\n\r nonnegative integer bounds expected");
+      k[i] = (unsigned) v;
+    }
+  /* exactly one is at least one, and at most one */
+  if (!K)
+    clauses_add(h->S, A, NULL);
+  NbVar = clauses_add(h->S, A, k);
+  if (NbVar > h->NbVar)
+    h->NbVar = NbVar;
+  mxFree(k);
+}
+
+/* model as a vector of 1 (true) and -1 (false) */
+static mxArray * model_get(SAT_Tsolver * S, mwSize NbVar)
+{
+  mwIndex i;
+  mxArray * V = mxCreateDoubleMatrix(NbVar, 1, mxREAL);
+  for (i = 0; i < NbVar; i++)
+    *(mxGetPr(V) + i) = (SAT_var_value_r(S, i+1) == SAT_VAL_FALSE ? -1 : 1);
+  return V;
+}
+
+/* literals of A, i.e. i (-i) for variable i true (false), with
+   variables up to NbVar, to be released with mxFree */
+static SAT_Tlit * lits_get(mwSize NbVar, const mxArray * A, mwSize * n)
+{
+  SAT_Tlit * lits;
+  double * P = mxGetPr(A);
+  mwIndex i;
+  if (!mxIsDouble(A) || mxIsSparse(A))
+    mexErrMsgIdAndTxt("sat:assumptions","\n\r dense vector of literals expected");
+  *n = mxGetNumberOfElements(A);
+  lits = (SAT_Tlit*) mxMalloc((*n ? *n : 1) * sizeof(SAT_Tlit));
+  for (i = 0; i < *n; i++)
+    {
+      double v = P[i] < 0 ? -P[i] : P[i];
+      if (v < 1 || v > NbVar || v != (double) (mwIndex) v)
+        mexErrMsgIdAndTxt("sat:assumptions","\n\r unknown variable in assumptions");
+      lits[i] = SAT_lit((SAT_Tvar) v, (P[i] > 0 ? 1 : 0));
+    }
+  return lits;
+}
+
+/* solves with handle h, assuming the literals in A if not NULL */
+static void handle_solve(int nlhs, mxArray *plhs[], Thandle * h,
+                         const mxArray * A)
+{
+  SAT_Tstatus status;
+  SAT_Tlit * lits = NULL;
+  mwSize n = 0;
+  mwIndex i;
+  if (A)
+    {
+      lits = lits_get(h->NbVar, A, &n);
+      status = SAT_solve_assuming_r(h->S, (unsigned) n, lits);
+    }
+  else
+    status = SAT_solve_r(h->S);
+  if (status != SAT_STATUS_SAT && status != SAT_STATUS_UNSAT)
+    mexErrMsgIdAndTxt("sat_solver","\n\r strange behaviour");
+  plhs[0] = mxCreateDoubleScalar(status == SAT_STATUS_SAT ? 1 : 0);
+  if (nlhs >= 2)
+    plhs[1] = status == SAT_STATUS_SAT ? model_get(h->S, h->NbVar) :
+      mxCreateDoubleMatrix(0, 1, mxREAL);
+  if (nlhs >= 3)
+    {
+      SAT_Tlit * core = NULL;
+      unsigned core_n = 0;
+      if (status == SAT_STATUS_UNSAT && A)
+        SAT_assumptions_core_r(h->S, &core, &core_n);
+      plhs[2] = mxCreateDoubleMatrix(core_n, 1, mxREAL);
+      for (i = 0; i < core_n; i++)
+        *(mxGetPr(plhs[2]) + i) = SAT_lit_pol(core[i]) ?
+          (double) SAT_lit_var(core[i]) : -(double) SAT_lit_var(core[i]);
+      free(core);
+    }
+  mxFree(lits);
+}
+
+/* models found by SAT_models: values of the variables in var, the
+   models being one after the other */
+typedef struct {
+  double * values;
+  mwSize size;
+  mwSize n;
+  mwSize NbVar;
+  SAT_Tvar * var;
+} Tmodels;
+
+static bool model_add(SAT_Tsolver * S, void * data)
+{
+  Tmodels * models = (Tmodels *) data;
+  mwIndex i;
+  if (models->n + models->NbVar > models->size)
+    {
+      models->size = 2 * models->size + models->NbVar;
+      models->values = (double*) mxRealloc(models->values, models->size * sizeof(double));
+    }
+  for (i = 0; i < models->NbVar; i++)
+    models->values[models->n++] =
+      (SAT_var_value_r(S, models->var[i]) == SAT_VAL_FALSE ? -1 : 1);
+  return true;
+}
+
+/* variables of the projection P, all NbVar ones if P is NULL or
+   empty, to be released with mxFree */
+static SAT_Tvar * vars_get(mwSize NbVar, const mxArray * P, mwSize * n)
+{
+  SAT_Tvar * var;
+  mwIndex i;
+  *n = P && !mxIsEmpty(P) ? mxGetNumberOfElements(P) : NbVar;
+  var = (SAT_Tvar*) mxMalloc((*n + 1) * sizeof(SAT_Tvar));
+  for (i = 0; i < *n; i++)
+    {
+      double v = P && !mxIsEmpty(P) ? mxGetPr(P)[i] : (double) (i+1);
+      if (v < 1 || v > NbVar || v != (double) (mwIndex) v)
+        mexErrMsgIdAndTxt("sat:models","\n\r unknown variable in projection");
+      var[i] = (SAT_Tvar) v;
+    }
+  return var;
+}
+
+/* enumerates models with handle h, as a matrix with a model per row */
+static void handle_models(int nlhs, mxArray *plhs[], Thandle * h,
+                          const mxArray * Max, const mxArray * P)
+{
+  Tmodels models;
+  unsigned long max = 0, nb;
+  mwIndex i, j;
+  if (Max && !mxIsEmpty(Max) && mxIsFinite(mxGetScalar(Max)))
+    max = (unsigned long) mxGetScalar(Max);
+  models.values = NULL;
+  models.size = models.n = 0;
+  models.var = vars_get(h->NbVar, P, &models.NbVar);
+  nb = SAT_models_r(h->S, P && !mxIsEmpty(P) ? (unsigned) models.NbVar : 0,
+                    models.var, max, model_add, &models);
+  plhs[0] = mxCreateDoubleScalar((double) nb);
+  if (nlhs >= 2)
+    {
+      plhs[1] = mxCreateDoubleMatrix(nb, models.NbVar, mxREAL);
+      for (i = 0; i < nb; i++)
+        for (j = 0; j < models.NbVar; j++)
+          *(mxGetPr(plhs[1]) + i + j*nb) = models.values[i*models.NbVar + j];
+    }
+  mxFree(models.values);
+  mxFree(models.var);
+}
+
+/* weights of the literals of NbVar variables, indexed by literal, to
+   be released with mxFree.  W holds the probabilities of variables
+   being true, or the weights of their positive (first row) and
+   negative (second row) literals, and is NULL or empty for weights 1,
+   in which case NULL is returned unless all is true */
+static double * weights_get(mwSize NbVar, const mxArray * W, bool all)
+{
+  double * weight;
+  mwIndex i;
+  if (!W || mxIsEmpty(W))
+    {
+      if (!all)
+        return NULL;
+      weight = (double*) mxMalloc(2 * (NbVar + 1) * sizeof(double));
+      for (i = 0; i < 2 * (NbVar + 1); i++)
+        weight[i] = 1;
+      return weight;
+    }
+  {
+    double * w = mxGetPr(W);
+    bool rows = mxGetM(W) == 2 && mxGetN(W) == NbVar;
+    if (!mxIsDouble(W) || mxIsSparse(W) ||
+        (!rows && mxGetNumberOfElements(W) != NbVar))
+      mexErrMsgIdAndTxt("sat:count","\n\r a weight per variable, or per literal, expected");
+    weight = (double*) mxMalloc(2 * (NbVar + 1) * sizeof(double));
+    weight[0] = weight[1] = 1;
+    for (i = 0; i < NbVar; i++)
+      {
+        weight[SAT_lit((SAT_Tvar) (i+1), 1)] = rows ? w[2*i] : w[i];
+        weight[SAT_lit((SAT_Tvar) (i+1), 0)] = rows ? w[2*i+1] : 1 - w[i];
+      }
+  }
+  return weight;
+}
+
+/* weighted count of the models with handle h satisfying the literals
+   in A if not NULL, with weights W as for weights_get */
+static void handle_count(mxArray *plhs[], Thandle * h, const mxArray * W,
+                         const mxArray * A)
+{
+  SAT_Tlit * lits = NULL;
+  double * weight = weights_get(h->NbVar, W, false);
+  mwSize n = 0;
+  if (A)
+    lits = lits_get(h->NbVar, A, &n);
+  plhs[0] = mxCreateDoubleScalar(SAT_count_r(h->S, weight, (unsigned) n, lits));
+  mxFree(lits);
+  mxFree(weight);
+}
+
+/* as handle_count, on the circuit of handle h, and the probabilities
+   of variables being true in the counted models.  Literals of A are
+   enforced by setting the weights of their negations to 0 */
+static void handle_nnf_count(int nlhs, mxArray *plhs[], Thandle * h,
+                             const mxArray * W, const mxArray * A)
+{
+  SAT_Tlit * lits = NULL;
+  double * weight, * marginal, count;
+  mwSize n = 0, NbVar;
+  mwIndex i;
+  if (!h->nnf)
+    mexErrMsgIdAndTxt("sat:compile","\n\r no circuit, compile first");
+  NbVar = SAT_nnf_var_n(h->nnf);
+  weight = weights_get(NbVar, W, true);
+  if (A)
+    lits = lits_get(NbVar, A, &n);
+  for (i = 0; i < n; i++)
+    weight[lits[i] ^ 1] = 0;
+  if (nlhs < 2)
+    plhs[0] = mxCreateDoubleScalar(SAT_nnf_count(h->nnf, weight));
+  else
+    {
+      marginal = (double*) mxMalloc(2 * (NbVar + 1) * sizeof(double));
+      count = SAT_nnf_marginals(h->nnf, weight, marginal);
+      plhs[0] = mxCreateDoubleScalar(count);
+      plhs[1] = mxCreateDoubleMatrix(1, NbVar, mxREAL);
+      if (count != 0)
+        for (i = 0; i < NbVar; i++)
+          mxGetPr(plhs[1])[i] =
+            marginal[SAT_lit((SAT_Tvar) (i+1), 1)] / count;
+      mxFree(marginal);
+    }
+  mxFree(lits);
+  mxFree(weight);
+}
+
+/* number of models to draw, from K */
+static unsigned samples_get(const mxArray * K)
+{
+  double k = mxGetScalar(K);
+  if (!mxIsDouble(K) || mxGetNumberOfElements(K) != 1 || k < 0 ||
+      k != (double) (unsigned) k)
+    mexErrMsgIdAndTxt("sat:sample","\n\r number of models expected");
+  return (unsigned) k;
+}
+
+/* matrix of n models of NbVar variables, one per row, with the
+   values of sample */
+static mxArray * samples_matrix(const SAT_Tvalue * sample, mwSize n,
+                                mwSize NbVar)
+{
+  mxArray * V = mxCreateDoubleMatrix(n, NbVar, mxREAL);
+  mwIndex i, j;
+  for (i = 0; i < n; i++)
+    for (j = 0; j < NbVar; j++)
+      *(mxGetPr(V) + i + j*n) =
+        (sample[i*NbVar + j] == SAT_VAL_FALSE ? -1 : 1);
+  return V;
+}
+
+/* draws k models near uniformly with handle h, projected on P */
+static void handle_sample(mxArray *plhs[], Thandle * h, const mxArray * K,
+                          const mxArray * P)
+{
+  unsigned k = samples_get(K), drawn;
+  mwSize n;
+  SAT_Tvar * var = vars_get(h->NbVar, P, &n);
+  SAT_Tvalue * sample =
+    (SAT_Tvalue*) mxMalloc((k * n + 1) * sizeof(SAT_Tvalue));
+  drawn = SAT_sample_r(h->S, (unsigned) n, var, k, sample);
+  plhs[0] = samples_matrix(sample, drawn, n);
+  mxFree(sample);
+  mxFree(var);
+}
+
+/* draws k models from the circuit of handle h, with weights W as for
+   weights_get */
+static void handle_nnf_sample(mxArray *plhs[], Thandle * h,
+                              const mxArray * K, const mxArray * W)
+{
+  unsigned k = samples_get(K), drawn;
+  mwSize NbVar;
+  double * weight;
+  SAT_Tvalue * sample;
+  if (!h->nnf)
+    mexErrMsgIdAndTxt("sat:compile","\n\r no circuit, compile first");
+  NbVar = SAT_nnf_var_n(h->nnf);
+  weight = weights_get(NbVar, W, true);
+  sample = (SAT_Tvalue*) mxMalloc((k * NbVar + 1) * sizeof(SAT_Tvalue));
+  drawn = SAT_nnf_sample(h->nnf, weight, k, sample,
+                         &SAT_state(h->S)->params.seed);
+  plhs[0] = samples_matrix(sample, drawn, NbVar);
+  mxFree(sample);
+  mxFree(weight);
+}
+
+/* backbone of the clauses of handle h, on the variables of P */
+static void handle_backbone(int nlhs, mxArray *plhs[], Thandle * h,
+                            const mxArray * P)
+{
+  SAT_Tlit * lits = NULL;
+  unsigned lits_n = 0;
+  SAT_Tstatus status;
+  mwSize n;
+  mwIndex i;
+  SAT_Tvar * var = vars_get(h->NbVar, P, &n);
+  status = SAT_backbone_r(h->S, (unsigned) n, var, &lits, &lits_n);
+  if (status != SAT_STATUS_SAT && status != SAT_STATUS_UNSAT)
+    mexErrMsgIdAndTxt("sat_solver","\n\r strange behaviour");
+  plhs[0] = mxCreateDoubleMatrix(lits_n, 1, mxREAL);
+  for (i = 0; i < lits_n; i++)
+    *(mxGetPr(plhs[0]) + i) = SAT_lit_pol(lits[i]) ?
+      (double) SAT_lit_var(lits[i]) : -(double) SAT_lit_var(lits[i]);
+  if (nlhs >= 2)
+    plhs[1] = mxCreateDoubleScalar(status == SAT_STATUS_SAT ? 1 : 0);
+  free(lits);
+  mxFree(var);
+}
+
+/* minimal subset of the literals of A inconsistent with the clauses of
+   handle h, as positions in A, with options O of SAT_mus */
+static void handle_mus(int nlhs, mxArray *plhs[], Thandle * h,
+                       const mxArray * A, const mxArray * O)
+{
+  SAT_Tlit * lits, * mus = NULL;
+  unsigned mus_n = 0, options = 0;
+  mwIndex * pos, i;
+  mwSize n;
+  SAT_Tstatus status;
+  if (O && !mxIsEmpty(O))
+    {
+      double o = mxGetScalar(O);
+      if (o != 0 && o != 1 && o != 2)
+        mexErrMsgIdAndTxt("sat:mus","\n\r option 0, 1 or 2 expected");
+      options = o == 1 ? SAT_MUS_CORE : o == 2 ? SAT_MUS_QUICKXPLAIN : 0;
+    }
+  lits = lits_get(h->NbVar, A, &n);
+  status = SAT_mus_r(h->S, (unsigned) n, lits, &mus, &mus_n, options);
+  if (status != SAT_STATUS_SAT && status != SAT_STATUS_UNSAT)
+    mexErrMsgIdAndTxt("sat_solver","\n\r strange behaviour");
+  plhs[0] = mxCreateDoubleScalar(status == SAT_STATUS_SAT ? 1 : 0);
+  if (nlhs >= 2)
+    {
+      /* position of the first occurrence of each literal */
+      pos = (mwIndex*) mxCalloc(2 * (h->NbVar + 1), sizeof(mwIndex));
+      for (i = n; i-- > 0; )
+        pos[lits[i]] = i + 1;
+      plhs[1] = mxCreateDoubleMatrix(mus_n, 1, mxREAL);
+      for (i = 0; i < mus_n; i++)
+        *(mxGetPr(plhs[1]) + i) = (double) pos[mus[i]];
+      mxFree(pos);
+    }
+  free(mus);
+  mxFree(lits);
+}
+
+/* model of least cost with handle h, the cost being the total weight
+   of the literals of A it falsifies, with weights W (1 if NULL or
+   empty) and options O of SAT_maxsat */
+static void handle_maxsat(int nlhs, mxArray *plhs[], Thandle * h,
+                          const mxArray * A, const mxArray * W,
+                          const mxArray * O)
+{
+  SAT_Tlit * lits;
+  unsigned long * weight, cost = 0;
+  unsigned options = 0;
+  mwSize n;
+  mwIndex i;
+  SAT_Tstatus status;
+  if (O && !mxIsEmpty(O))
+    {
+      double o = mxGetScalar(O);
+      if (o != 0 && o != 1)
+        mexErrMsgIdAndTxt("sat:maxsat","\n\r option 0 or 1 expected");
+      options = o == 1 ? SAT_MAXSAT_LINEAR : 0;
+    }
+  lits = lits_get(h->NbVar, A, &n);
+  if (W && !mxIsEmpty(W) &&
+      (!mxIsDouble(W) || mxIsSparse(W) || mxGetNumberOfElements(W) != n))
+    mexErrMsgIdAndTxt("sat:maxsat","\n\r a weight per literal expected");
+  weight = (unsigned long*) mxMalloc((n + 1) * sizeof(unsigned long));
+  for (i = 0; i < n; i++)
+    {
+      double w = W && !mxIsEmpty(W) ? mxGetPr(W)[i] : 1;
+      if (w < 0 || w > 1e15 || w != (double) (unsigned long) w)
+        mexErrMsgIdAndTxt("sat:maxsat","\n\r nonnegative integer weights expected");
+      weight[i] = (unsigned long) w;
+    }
+  status = SAT_maxsat_r(h->S, (unsigned) n, lits, weight, &cost, options);
+  if (status != SAT_STATUS_SAT && status != SAT_STATUS_UNSAT)
+    mexErrMsgIdAndTxt("sat_solver","\n\r strange behaviour");
+  plhs[0] = mxCreateDoubleScalar(status == SAT_STATUS_SAT ? 1 : 0);
+  if (nlhs >= 2)
+    plhs[1] = status == SAT_STATUS_SAT ? model_get(h->S, h->NbVar) :
+      mxCreateDoubleMatrix(0, 1, mxREAL);
+  if (nlhs >= 3)
+    plhs[2] = mxCreateDoubleScalar(status == SAT_STATUS_SAT ?
+                                   (double) cost : mxGetInf());
+  mxFree(weight);
+  mxFree(lits);
+}
+
+/* file name of A, to be released with mxFree */
+static char * file_get(const mxArray * A)
+{
+  char * file = mxIsChar(A) ? mxArrayToString(A) : NULL;
+  if (!file)
+    mexErrMsgIdAndTxt("sat:file","\n\r file name expected");
+  return file;
+}
+
+/* commands on solver handles, i.e. sat(3) to sat(21) */
+static void handle_command(int cmd, int nlhs, mxArray *plhs[], int nrhs,
+                           const mxArray *prhs[])
+{
+  Thandle * h;
+  if (cmd == 3)
+    {
+      plhs[0] = mxCreateDoubleScalar((double) handle_new());
+      return;
+    }
+  if (cmd == 14)
+    {
+      char * file;
+      SAT_Tnnf * nnf;
+      if (nrhs != 2)
+        mexErrMsgIdAndTxt("sat:rhs","\n\r file name expected");
+      file = file_get(prhs[1]);
+      nnf = SAT_nnf_load(file);
+      mxFree(file);
+      if (!nnf)
+        mexErrMsgIdAndTxt("sat:file","\n\r cannot read circuit");
+      plhs[0] = mxCreateDoubleScalar((double) handle_new());
+      h = handles + (mwIndex) mxGetScalar(plhs[0]) - 1;
+      h->nnf = nnf;
+      h->NbVar = SAT_nnf_var_n(nnf);
+      SAT_var_new_id_r(h->S, (unsigned) h->NbVar);
+      return;
+    }
+  if (nrhs < 2)
+    mexErrMsgIdAndTxt("sat:rhs","\n\r solver handle expected");
+  h = handle_get(prhs[1]);
+  switch (cmd)
+    {
+    case 4:
+      if (nrhs != 3)
+        mexErrMsgIdAndTxt("sat:rhs","\n\r clause matrix expected");
+      {
+        mwSize NbVar = clauses_add(h->S, prhs[2], NULL);
+        if (NbVar > h->NbVar)
+          h->NbVar = NbVar;
+      }
+      break;
+    case 5:
+      handle_solve(nlhs, plhs, h, NULL);
+      break;
+    case 6:
+      if (nrhs != 3)
+        mexErrMsgIdAndTxt("sat:rhs","\n\r assumptions expected");
+      handle_solve(nlhs, plhs, h, prhs[2]);
+      break;
+    case 7:
+      if (SAT_state(h->S)->status != SAT_STATUS_SAT)
+        mexErrMsgIdAndTxt("sat:model","\n\r no model, solve first");
+      plhs[0] = model_get(h->S, h->NbVar);
+      break;
+    case 8:
+      SAT_delete(h->S);
+      SAT_nnf_delete(h->nnf);
+      h->S = NULL;
+      h->nnf = NULL;
+      break;
+    case 9:
+      handle_models(nlhs, plhs, h, nrhs > 2 ? prhs[2] : NULL,
+                    nrhs > 3 ? prhs[3] : NULL);
+      break;
+    case 10:
+      handle_count(plhs, h, nrhs > 2 ? prhs[2] : NULL,
+                   nrhs > 3 ? prhs[3] : NULL);
+      break;
+    case 11:
+      SAT_nnf_delete(h->nnf);
+      h->nnf = SAT_compile_r(h->S);
+      plhs[0] = mxCreateDoubleScalar((double) SAT_nnf_size(h->nnf));
+      break;
+    case 12:
+      handle_nnf_count(nlhs, plhs, h, nrhs > 2 ? prhs[2] : NULL,
+                       nrhs > 3 ? prhs[3] : NULL);
+      break;
+    case 13:
+      if (nrhs != 3)
+        mexErrMsgIdAndTxt("sat:rhs","\n\r file name expected");
+      if (!h->nnf)
+        mexErrMsgIdAndTxt("sat:compile","\n\r no circuit, compile first");
+      {
+        char * file = file_get(prhs[2]);
+        bool ok = SAT_nnf_save(h->nnf, file);
+        mxFree(file);
+        if (!ok)
+          mexErrMsgIdAndTxt("sat:file","\n\r cannot write circuit");
+      }
+      break;
+    case 15:
+      if (nrhs < 3)
+        mexErrMsgIdAndTxt("sat:rhs","\n\r number of models expected");
+      handle_sample(plhs, h, prhs[2], nrhs > 3 ? prhs[3] : NULL);
+      break;
+    case 16:
+      if (nrhs < 3)
+        mexErrMsgIdAndTxt("sat:rhs","\n\r number of models expected");
+      handle_nnf_sample(plhs, h, prhs[2], nrhs > 3 ? prhs[3] : NULL);
+      break;
+    case 17:
+      handle_backbone(nlhs, plhs, h, nrhs > 2 ? prhs[2] : NULL);
+      break;
+    case 18:
+      if (nrhs < 3)
+        mexErrMsgIdAndTxt("sat:rhs","\n\r assumptions expected");
+      handle_mus(nlhs, plhs, h, prhs[2], nrhs > 3 ? prhs[3] : NULL);
+      break;
+    case 19:
+      if (nrhs < 3)
+        mexErrMsgIdAndTxt("sat:rhs","\n\r soft literals expected");
+      handle_maxsat(nlhs, plhs, h, prhs[2], nrhs > 3 ? prhs[3] : NULL,
+                    nrhs > 4 ? prhs[4] : NULL);
+      break;
+    case 20:
+      if (nrhs != 4)
+        mexErrMsgIdAndTxt("sat:rhs","\n\r constraint matrix and bounds expected");
+      handle_cards(h, prhs[2], prhs[3]);
+      break;
+    case 21:
+      if (nrhs != 3)
+        mexErrMsgIdAndTxt("sat:rhs","\n\r constraint matrix expected");
+      handle_cards(h, prhs[2], NULL);
+      break;
+    default:
+      mexErrMsgIdAndTxt("sat","\n\r unknown function");
+    }
+}
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs,const mxArray *prhs[])
+{
+
+  mwSize NbVar,
+	 un=1;
+
+  mwIndex i;
+  double *M;
+
   SAT_Tstatus status;
 
   if (nrhs < 1)
@@ -48,83 +799,35 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs,const mxArray *prhs[])
       SAT_done();
       return;
     }
+  else if (M[0] >= 3)
+    {
+      handle_command((int) M[0], nlhs, plhs, nrhs, prhs);
+      return;
+    }
 
   if (nrhs != 2 ) {
       mexErrMsgIdAndTxt("sat_solver:rhs","\n\r wrong number of arguments : one expected");
   }
-  
+
   if ((nlhs != 1 ) && (nlhs != 2 )) {
       mexErrMsgIdAndTxt("sat_solver:lhs","\n\r wrong number of outputs : one or two expected");
   }
-  
+
   /* The first argument must be a 3xNbP matrix.
      If sparse matrix the function expect a transposed matrix.
   */
-  if (mxIsSparse(prhs[1])) {    
-    NbVar = mxGetM(prhs[1]);
-    NbClauses = mxGetN(prhs[1]);
-  } else {
-    NbClauses =  mxGetM(prhs[1]);
-    NbVar = mxGetN(prhs[1]);
-  }
+  NbVar = mxIsSparse(prhs[1]) ? mxGetM(prhs[1]) : mxGetN(prhs[1]);
 
-  M = mxGetPr(prhs[1]);
-  
   /* first return value : boolean indicating satisfaisability  */
   plhs[0] = mxCreateDoubleMatrix(un, un, mxREAL);
   if (nlhs == 2) {
      plhs[1] = mxCreateDoubleMatrix(NbVar, un, mxREAL);
   }
-  
-  /* adding variables */
-  for(i = 0; i < NbVar; ++i) {
-    SAT_var_new_id(i+1);
-  }
 
-  if (!mxIsSparse(prhs[1])) { /* Not sparsed matrix*/
-    /* adding clauses */
-    for (i= 0; i < NbClauses ; ++i) {
-      /* counting the number of variables present
-       in the clause i */
-      accu = 0;
-      for (j = 0; j < NbVar; j++) { 
-        accu += (M[i+j*NbClauses] ? 1 : 0);  
-      }
-      clause = (SAT_Tlit*) malloc(accu * sizeof(SAT_Tlit));
-      k = 0;
-      for (j = 0; j < NbVar; j++) { 
-        val = M[i+j*NbClauses];
-	if ( val ) {
-	   clause[k] = SAT_lit(j+1,  (val == 1 ? 1 : 0));    
-           k++;
-        }
-      }
-      SAT_clause_new(accu, clause); 
-    }
-  } else { /* Sparse matrix*/
-    /* Get sparse matrix representation */
-    mwIndex *jc = mxGetJc(prhs[1]);
-    mwIndex *ir = mxGetIr(prhs[1]);
-    /* adding clauses */
-    for (c = 0, k = 0; k <= mxGetNzmax(prhs[1]); ) { 
-      if ( k == jc[c+1])
-        { /* the end of clause c has been reached */
-          /* count the number of variables present in the clause c */
-          accu = jc[c+1] - jc[c];
-          clause = (SAT_Tlit*) malloc(accu * sizeof(SAT_Tlit));
-          for (i = 0, j = jc[c]; j < jc[c+1]; i++, j++)
-            clause[i] = SAT_lit(ir[i+jc[c]]+1,  (M[i+jc[c]] == 1 ? 1 : 0));    
-        /* define the clause and reset the number of variables in the next clause */
-        SAT_clause_new(accu, clause);
-        c++;
-      }
-    else
-      k++;
-    }
-  }
-  
+  clauses_add(SAT_default, prhs[1], NULL);
+
   status = SAT_solve();
-  
+
   if (status == SAT_STATUS_SAT)
     {
       //mexPrintf("satis\n");
@@ -141,6 +844,5 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs,const mxArray *prhs[])
   else {
       mexErrMsgIdAndTxt("sat_solver","\n\r strange behaviour");
   }
-  
-}
 
+}
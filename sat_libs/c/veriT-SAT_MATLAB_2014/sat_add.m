@@ -0,0 +1,7 @@
+function []= sat_add(h,M)
+if (issparse(M))
+  sat(4,h,M');
+else
+  sat(4,h,M);
+end
+
@@ -0,0 +1,7 @@
+function []= sat_atmost(h,M,k)
+if (issparse(M))
+  sat(20,h,M',k);
+else
+  sat(20,h,M,k);
+end
+
@@ -0,0 +1,6 @@
+function [B,s]=sat_backbone(h,P)
+if (nargin < 2)
+  [B,s]=sat(17,h);
+else
+  [B,s]=sat(17,h,P);
+end
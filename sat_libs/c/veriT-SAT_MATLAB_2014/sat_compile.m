@@ -0,0 +1,2 @@
+function [n]=sat_compile(h)
+n=sat(11,h);
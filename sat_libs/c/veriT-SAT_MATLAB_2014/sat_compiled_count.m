@@ -0,0 +1,8 @@
+function [c,p]=sat_compiled_count(h,W,A)
+if (nargin < 2)
+  [c,p]=sat(12,h);
+elseif (nargin < 3)
+  [c,p]=sat(12,h,W);
+else
+  [c,p]=sat(12,h,W,A);
+end
@@ -0,0 +1,2 @@
+function h = sat_compiled_load(file)
+h = sat(14,file);
@@ -0,0 +1,6 @@
+function [V]=sat_compiled_sample(h,k,W)
+if (nargin < 3)
+  V=sat(16,h,k);
+else
+  V=sat(16,h,k,W);
+end
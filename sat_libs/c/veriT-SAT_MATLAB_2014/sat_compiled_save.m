@@ -0,0 +1,2 @@
+function sat_compiled_save(h,file)
+sat(13,h,file);
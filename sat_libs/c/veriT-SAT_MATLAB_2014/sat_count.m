@@ -0,0 +1,8 @@
+function [c]=sat_count(h,W,A)
+if (nargin < 2)
+  c=sat(10,h);
+elseif (nargin < 3)
+  c=sat(10,h,W);
+else
+  c=sat(10,h,W,A);
+end
@@ -0,0 +1,3 @@
+function []= sat_delete(h)
+sat(8,h);
+
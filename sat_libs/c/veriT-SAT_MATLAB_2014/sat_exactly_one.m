@@ -0,0 +1,7 @@
+function []= sat_exactly_one(h,M)
+if (issparse(M))
+  sat(21,h,M');
+else
+  sat(21,h,M);
+end
+
@@ -0,0 +1,8 @@
+function [s,v,c]=sat_maxsat(h,A,W,o)
+if (nargin < 3)
+  [s,v,c]=sat(19,h,A);
+elseif (nargin < 4)
+  [s,v,c]=sat(19,h,A,W);
+else
+  [s,v,c]=sat(19,h,A,W,o);
+end
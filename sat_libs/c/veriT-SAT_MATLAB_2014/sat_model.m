@@ -0,0 +1,3 @@
+function v = sat_model(h)
+v = sat(7,h);
+
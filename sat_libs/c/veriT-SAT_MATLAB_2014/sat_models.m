@@ -0,0 +1,9 @@
+function [n,models]=sat_models(h,max,P)
+if (nargin < 2)
+  [n,models]=sat(9,h);
+elseif (nargin < 3)
+  [n,models]=sat(9,h,max);
+else
+  [n,models]=sat(9,h,max,P);
+end
+
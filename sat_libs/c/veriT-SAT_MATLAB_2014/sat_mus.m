@@ -0,0 +1,6 @@
+function [s,C]=sat_mus(h,A,o)
+if (nargin < 3)
+  [s,C]=sat(18,h,A);
+else
+  [s,C]=sat(18,h,A,o);
+end
@@ -0,0 +1,3 @@
+function h = sat_new()
+h = sat(3);
+
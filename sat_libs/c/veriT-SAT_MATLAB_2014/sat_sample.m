@@ -0,0 +1,6 @@
+function [V]=sat_sample(h,k,P)
+if (nargin < 3)
+  V=sat(15,h,k);
+else
+  V=sat(15,h,k,P);
+end
@@ -0,0 +1,8 @@
+function [s,v,core]=sat_solve_assuming(h,A)
+if (nargin < 2)
+  [s,v]=sat(5,h);
+  core=[];
+else
+  [s,v,core]=sat(6,h,A);
+end
+
@@ -1,7 +1,12 @@
 /* PARAM
    define BCLAUSE_GENERATION
-   define BCLAUSE xor BCLAUSE_LIGHT xor NONE
+   define BCLAUSE xor BCLAUSE_LIGHT (default) xor NO_BCLAUSE
    define SIMP
+   define NO_ELIM
+   define NO_VIVIFY
+   define NO_REPHASE
+   define NO_SLS
+   define NO_CHRONO
    define RESTART_MIN_INTERVAL 7
 
    define LEARNTS_ADJ_FACT 1.5
@@ -25,7 +30,12 @@
 
 /* #define BLACK_MAGIC */
 /* #define BCLAUSE */
-/* #define BCLAUSE_LIGHT */
+
+/** binary clauses are propagated from implication lists, without
+    accessing the clause, unless NO_BCLAUSE is defined */
+#if !defined(BCLAUSE) && !defined(NO_BCLAUSE)
+#define BCLAUSE_LIGHT
+#endif
 
 /** define BACKTRACK if need to remove clauses */
 /* #define BACKTRACK */
@@ -38,11 +48,9 @@
 
 #define REUSE_TRAIL
 
-#if defined(BCLAUSE) || defined(BCLAUSE_LIGHT)
-#ifdef BACKTRACK
+#if defined(BCLAUSE) && defined(BACKTRACK)
 #error binary clauses are not compatible with backtracking
 #endif
-#endif
 
 #define SIMP
 #define CLAUSE_MIN
@@ -78,20 +86,134 @@
 #include "statistics.h"
 #endif
 
+/* SAT_THREADS enables concurrent solving (pthreads and GCC atomics) */
+#if !defined(SAT_NO_THREADS) && !defined(_WIN32) && \
+  !defined(PROOF) && !defined(HINTS)
+#define SAT_THREADS
+#include <pthread.h>
+#endif
+
+/* ELIM enables preprocessing (variable elimination, subsumption,
+   strengthening) before the first propagation.  Clauses have to be
+   kept as given for proofs and backtracking, and hinted variables
+   should not be eliminated */
+#if !defined(NO_ELIM) && !defined(PROOF) && !defined(HINTS) && \
+  !defined(BACKTRACK) && !defined(BCLAUSE)
+#define ELIM
+#endif
+
+/* VIVIFY enables the periodic shortening of learnt clauses by
+   propagation, which proofs do not record */
+#if !defined(NO_VIVIFY) && !defined(PROOF)
+#define VIVIFY
+#endif
+
+/* REPHASE enables target phases in stable phases of search, and the
+   periodic reset of phases */
+#ifndef NO_REPHASE
+#define REPHASE
+#endif
+
+/* SLS enables local search from the saved phases, before the first
+   search and when phases are reset in stable phases */
+#ifndef NO_SLS
+#define SLS
+#endif
+
+/* CHRONO enables chronological backtracking after long backjumps.
+   Literals may then be on the trail above literals of higher levels,
+   which push/pop, proofs, hints, and binary clause structures do not
+   expect */
+#if !defined(NO_CHRONO) && !defined(BACKTRACK) && !defined(PROOF) && \
+  !defined(HINTS) && !defined(BCLAUSE)
+#define CHRONO
+#endif
+
 /**
    \brief Tunable constants
    \remark the actual numbers are 1<<X */
 
 /**
-   \brief coefficient of the luby suite for number of conflicts between restarts */
+   \brief coefficient of the luby suite for number of conflicts between restarts
+   \remark default for params.restart_interval */
 /* tried 6 7 8 9 (7 is best) */
 #define RESTART_MIN_INTERVAL 7
 
+/**
+   \brief in focused phases, restart when the fast moving average of
+   learnt glue exceeds RESTART_GLUE_MARGIN times the slow one, at least
+   RESTART_GLUE_MIN conflicts after the previous restart
+   \remark the actual coefficients of the averages are 1/(1<<X) */
+#define RESTART_GLUE_MIN 50
+#define RESTART_GLUE_MARGIN 1.25
+#define RESTART_EMA_FAST 5
+#define RESTART_EMA_SLOW 12
+
+/**
+   \brief number of conflicts of the first focused and stable phases
+   \remark it doubles for every pair of phases */
+#define RESTART_PHASE_INIT 1000
+
+/**
+   \brief phases are reset after REPHASE_INTERVAL * i conflicts, for
+   the i-th time */
+#define REPHASE_INTERVAL 1000
+
+/**
+   \brief local search flips at most SLS_EFFORT times per literal of
+   the constraints, a variable being chosen with weight SLS_BREAK_BASE
+   to the power of minus its break count
+   \remark break counts above SLS_BREAK_MAX count as SLS_BREAK_MAX */
+#define SLS_EFFORT 1
+#define SLS_BREAK_BASE 2.5
+#define SLS_BREAK_MAX 16
+
+/**
+   \brief after a conflict, backtrack only one level if the backjump
+   would undo more than CHRONO_LEVELS levels */
+#define CHRONO_LEVELS 100
+
 #define LEARNTS_ADJ_FACT 1.5
 #define LEARNTS_MAX_FACT 1.1
 #define LEARNTS_ADJ_INIT 100
 #define LEARNTS_FACT_INIT 0.33
 
+/**
+   \brief learnt clauses of glue (number of decision levels of their
+   literals) at most GLUE_CORE are never purged, those of glue at most
+   GLUE_TIER2 are kept as long as they are used in conflict analysis
+   between purges, others are purged by glue and activity */
+#define GLUE_CORE 2
+#define GLUE_TIER2 6
+
+/**
+   \brief literals of clauses are compacted when more than 1/X of them
+   belong to deleted clauses */
+#define CLAUSE_LIT_WASTE_FACT 5
+
+/**
+   \brief preprocessing eliminates a variable if it occurs in at most
+   ELIM_OCC_MAX clauses (unless pure), and if the number of clauses
+   does not increase, with resolvents of at most ELIM_CLAUSE_MAX
+   literals */
+#define ELIM_OCC_MAX 32
+#define ELIM_CLAUSE_MAX 24
+/**
+   \brief clauses are not used to subsume others if their literal with
+   fewest occurrences occurs in more than SUBSUME_OCC_MAX clauses */
+#define SUBSUME_OCC_MAX 1000
+/**
+   \brief preprocessing stops after about ELIM_EFFORT literal visits per
+   literal in clauses */
+#define ELIM_EFFORT 10
+
+/**
+   \brief learnt clauses are vivified every VIVIFY_INTERVAL conflicts,
+   unassigning at most 1/VIVIFY_EFFORT_FACT as many literals as the
+   search since the previous time */
+#define VIVIFY_INTERVAL 5000
+#define VIVIFY_EFFORT_FACT 10
+
 /*
   PF
   use unsigned index rather than pointers for everything that is used often
@@ -108,7 +230,7 @@
 
   IMPROVE
   - code for binary clauses
-  - preprocessing and periodic simplification
+  - periodic simplification (preprocessing is only done once, see ELIM)
 */
 
 /**
@@ -127,9 +249,9 @@
 /*
   TODO
   Backtracking: review all code
-  I propose to remove all learnt clause if SAT_pop
-  It will be also necessary to remember unit clauses and restore the
-  stack_lit so that units are taken into account
+  Learnt clauses are all removed by SAT_pop, and root literals are
+  restored.  Keeping learnt clauses that do not depend on popped clauses
+  would be better
   Input clauses should not be simplified/removed from watch lists if BACKTRACKABLE
   history should be rethought */
 
@@ -155,6 +277,11 @@
 #define LIT_UNDEF SAT_LIT_UNDEF
 #define CLAUSE_UNDEF SAT_CLAUSE_UNDEF
 #define CLAUSE_LAZY UINT_MAX
+/* literals propagated by the cardinality constraint c have reason
+   CLAUSE_CARD | c, clause ids being less than 1 << 30 */
+#define CLAUSE_CARD (1u << 31)
+#define CLAUSE_IS_CARD(clause) \
+  (((clause) & CLAUSE_CARD) && (clause) != CLAUSE_LAZY)
 
 /*
   --------------------------------------------------------------
@@ -164,14 +291,275 @@
 
 #define ROOT_LEVEL 0
 
-Tstatus SAT_status = SAT_STATUS_UNDEF;     /**< status of the sat solver */
-Tlevel SAT_level = ROOT_LEVEL;           /**< decision level */
-Tclause SAT_empty_clause = CLAUSE_UNDEF; /**< clause id of empty clause */
-static unsigned conflict_nb = 0;
-
+/**
+   \brief a solver instance
+   \remark every piece of state of the solver lives here, so that
+   several instances can be used independently (and concurrently).
+   All functions take the instance as first argument, named S, and
+   the fields are accessed through the macros below, named after the
+   former global variables */
+struct SAT_Tsolver
+{
+  SAT_Tstate state;               /**< fields visible to the user */
+  Tclause SAT_empty_clause;       /**< clause id of empty clause */
+  unsigned conflict_nb;
+  unsigned misc_stack_size;
+  unsigned misc_stack_n;
+  Tlit * misc_stack;
+#ifdef BACKTRACK
+  unsigned history_size;          /**< size of allocated stack */
+  unsigned history_n;             /**< nb of fields in history */
+  struct Thistory * history;      /**< array of clauses id */
+#endif
+  struct Twatch * watch;
+  struct Tcard_watch * card_watch; /**< cardinality constraints by literal */
+  unsigned stack_card_size;       /**< size of allocated stack */
+  unsigned stack_card_n;          /**< nb of cardinality constraints */
+  struct TScard * stack_card;     /**< array of cardinality constraints */
+  unsigned stack_card_lit_size;   /**< size of allocated stack */
+  unsigned stack_card_lit_n;      /**< nb of literals in the stack */
+  Tlit * stack_card_lit;          /**< literals of all constraints */
+  unsigned card_stack_size;
+  Tlit * card_stack;              /**< literals of an explanation */
+  unsigned SAT_stack_var_size;    /**< size of allocated stack for vars */
+  unsigned SAT_stack_var_n;       /**< highest var id in the stack */
+  struct TSvar * SAT_stack_var;   /**< array of vars */
+  unsigned char * assign;         /**< assignment */
+#ifdef HINT_AS_DECISION
+  unsigned hint_n;
+  unsigned hint_p;
+  unsigned hint_size;
+  Tlit * hints;
+#endif
+  unsigned heap_var_n;
+  unsigned heap_var_size;
+  Tvar * heap_var;
+  unsigned heap_index_size;
+  unsigned * heap_index;
+  double var_inc;
+  unsigned stack_lit_size;        /**< size of allocated stack for literals */
+  unsigned stack_level_size;
+#ifndef PRESERVE_CLAUSES
+  unsigned first_free_clause;
+#endif
+  unsigned stack_clause_size;     /**< size of allocated stack */
+  unsigned stack_clause_n;        /**< highest clause id in the stack */
+  struct TSclause * stack_clause; /**< array of clauses */
+  unsigned stack_clause_lit_size; /**< size of allocated stack */
+  unsigned stack_clause_lit_n;    /**< nb of literals in the stack */
+  unsigned stack_clause_lit_waste; /**< nb of literals no longer used */
+  Tlit * stack_clause_lit;        /**< literals of all clauses */
+  unsigned learnt_stack_size;
+  Tlit * learnt_stack;            /**< literals of the clause learnt */
+  double clause_inc;
+  double clause_decay;
+  Tclause * learnts;
+  unsigned learnts_n;
+  unsigned learnts_size;
+  unsigned restart_n;             /**< number of restarts in stable
+				     phases, index in luby suite */
+  unsigned conflict_restart_n;    /**< conflicts before next restart,
+				     or before next test if focused */
+  bool restart_stable;            /**< in stable phase (luby restarts) */
+  unsigned restart_phase_length;  /**< conflicts in next phases */
+  unsigned restart_phase_nb;      /**< conflict_nb for next phase */
+  double glue_ema_fast;           /**< moving averages of learnt glue */
+  double glue_ema_slow;
+#ifdef REPHASE
+  unsigned target_trail_n;        /**< length of trail in phase_target */
+  unsigned best_trail_n;          /**< length of trail in phase_best */
+  unsigned rephase_n;             /**< number of rephasings */
+  unsigned rephase_conflict_nb;   /**< conflict_nb for next rephasing */
+#endif
+  unsigned learnts_max;           /**< 0 before first propagation */
+  unsigned learnts_n_adj_cnt;
+  double learnts_n_adj_cnt_restart;
+  unsigned learnts_kept;          /**< nb of learnt clauses kept by the
+				     last purge whatever their activity */
+  unsigned glue_stamp_size;
+  unsigned glue_stamp_n;          /**< current stamp */
+  unsigned * glue_stamp;          /**< by level, to compute glues */
+  unsigned assumption_core_size;
+  unsigned assumption_core_n;
+  Tlit * assumption_core;         /**< assumptions of the final conflict
+				     of the last solve under assumptions */
+  bool next_purge_valid;
+#ifdef VIVIFY
+  unsigned long unassigned_n;     /**< nb of literals unassigned by
+				     backtracking, to measure effort */
+  unsigned long vivify_unassigned_n; /**< unassigned_n after the
+					last vivification */
+  unsigned vivify_conflict_nb;    /**< conflict_nb for next vivification */
+#endif
+#ifdef ELIM
+  unsigned elim_stack_size;       /**< size of allocated stack */
+  unsigned elim_stack_n;          /**< nb of fields in elim_stack */
+  unsigned elim_clause_n;         /**< nb of clauses in elim_stack */
+  Tlit * elim_stack;              /**< clauses of eliminated variables */
+#endif
 #ifdef PROOF
-unsigned SAT_proof = 0;
+  unsigned proof_stack_size;
+#ifndef INSIDE_VERIT
+  unsigned proof_stack_n;
+  Tlit * proof_stack_lit;
+  Tclause * proof_stack_clause;
+#endif
+  unsigned proof_stack_size_2;
+  unsigned proof_stack_n_2;
+  Tlit * proof_stack_lit_2;
+  Tclause * proof_stack_clause_2;
+#endif
+#if defined(BCLAUSE) || defined(BCLAUSE_LIGHT)
+  struct Tbclause_lit * bclause_lit;
+#ifdef CYCLE_DETECTION
+  struct Tcycle * cycles;
+  unsigned cycle_size;
+  unsigned cycle_n;
+#endif
+#endif
+#ifdef SAT_THREADS
+  unsigned * interrupt;           /**< solving stops when set to non-0 */
+  struct Texchange * exchange;    /**< learnt clauses shared, or NULL */
+  unsigned exchange_id;           /**< id as a source of shared clauses */
+  unsigned long exchange_read;    /**< next position to read */
+#endif
+};
+
+#undef SAT_status
+#undef SAT_level
+#undef SAT_literal_stack
+#undef SAT_literal_stack_n
+#undef SAT_literal_stack_hold
+#undef SAT_literal_stack_unit
+#undef SAT_literal_stack_to_propagate
+#undef SAT_level_stack
+#undef SAT_level_stack_hold
+#define SAT_status (S->state.status)
+#define SAT_level (S->state.level)
+#define SAT_literal_stack (S->state.literal_stack)
+#define SAT_literal_stack_n (S->state.literal_stack_n)
+#define SAT_literal_stack_hold (S->state.literal_stack_hold)
+#define SAT_literal_stack_unit (S->state.literal_stack_unit)
+#define SAT_literal_stack_to_propagate (S->state.literal_stack_to_propagate)
+#define SAT_level_stack (S->state.level_stack)
+#define SAT_level_stack_hold (S->state.level_stack_hold)
+#ifdef SAT_SYM
+#undef SAT_var_orbit
+#define SAT_var_orbit (S->state.var_orbit)
 #endif
+#ifdef PROOF
+#undef SAT_proof
+#define SAT_proof (S->state.proof)
+#ifdef INSIDE_VERIT
+#undef SAT_proof_stack_n
+#undef SAT_proof_stack_lit
+#undef SAT_proof_stack_clause
+#define SAT_proof_stack_n (S->state.proof_stack_n)
+#define SAT_proof_stack_lit (S->state.proof_stack_lit)
+#define SAT_proof_stack_clause (S->state.proof_stack_clause)
+#endif
+#endif
+
+#define SAT_empty_clause (S->SAT_empty_clause)
+#define conflict_nb (S->conflict_nb)
+#define misc_stack_size (S->misc_stack_size)
+#define misc_stack_n (S->misc_stack_n)
+#define misc_stack (S->misc_stack)
+#define history_size (S->history_size)
+#define history_n (S->history_n)
+#define history (S->history)
+#define watch (S->watch)
+#define card_watch (S->card_watch)
+#define stack_card_size (S->stack_card_size)
+#define stack_card_n (S->stack_card_n)
+#define stack_card (S->stack_card)
+#define stack_card_lit_size (S->stack_card_lit_size)
+#define stack_card_lit_n (S->stack_card_lit_n)
+#define stack_card_lit (S->stack_card_lit)
+#define card_stack_size (S->card_stack_size)
+#define card_stack (S->card_stack)
+#define SAT_stack_var_size (S->SAT_stack_var_size)
+#define SAT_stack_var_n (S->SAT_stack_var_n)
+#define SAT_stack_var (S->SAT_stack_var)
+#define assign (S->assign)
+#define hint_n (S->hint_n)
+#define hint_p (S->hint_p)
+#define hint_size (S->hint_size)
+#define hints (S->hints)
+#define heap_var_n (S->heap_var_n)
+#define heap_var_size (S->heap_var_size)
+#define heap_var (S->heap_var)
+#define heap_index_size (S->heap_index_size)
+#define heap_index (S->heap_index)
+#define var_inc (S->var_inc)
+#define stack_lit_size (S->stack_lit_size)
+#define stack_level_size (S->stack_level_size)
+#define first_free_clause (S->first_free_clause)
+#define stack_clause_size (S->stack_clause_size)
+#define stack_clause_n (S->stack_clause_n)
+#define stack_clause (S->stack_clause)
+#define stack_clause_lit_size (S->stack_clause_lit_size)
+#define stack_clause_lit_n (S->stack_clause_lit_n)
+#define stack_clause_lit_waste (S->stack_clause_lit_waste)
+#define stack_clause_lit (S->stack_clause_lit)
+#define learnt_stack_size (S->learnt_stack_size)
+#define learnt_stack (S->learnt_stack)
+#define clause_inc (S->clause_inc)
+#define clause_decay (S->clause_decay)
+#define learnts (S->learnts)
+#define learnts_n (S->learnts_n)
+#define learnts_size (S->learnts_size)
+#define restart_n (S->restart_n)
+#define conflict_restart_n (S->conflict_restart_n)
+#define restart_stable (S->restart_stable)
+#define restart_phase_length (S->restart_phase_length)
+#define restart_phase_nb (S->restart_phase_nb)
+#define glue_ema_fast (S->glue_ema_fast)
+#define glue_ema_slow (S->glue_ema_slow)
+#ifdef REPHASE
+#define target_trail_n (S->target_trail_n)
+#define best_trail_n (S->best_trail_n)
+#define rephase_n (S->rephase_n)
+#define rephase_conflict_nb (S->rephase_conflict_nb)
+#endif
+#define learnts_max (S->learnts_max)
+#define learnts_n_adj_cnt (S->learnts_n_adj_cnt)
+#define learnts_n_adj_cnt_restart (S->learnts_n_adj_cnt_restart)
+#define learnts_kept (S->learnts_kept)
+#define glue_stamp_size (S->glue_stamp_size)
+#define glue_stamp_n (S->glue_stamp_n)
+#define glue_stamp (S->glue_stamp)
+#define assumption_core_size (S->assumption_core_size)
+#define assumption_core_n (S->assumption_core_n)
+#define assumption_core (S->assumption_core)
+#define next_purge_valid (S->next_purge_valid)
+#define unassigned_n (S->unassigned_n)
+#define vivify_unassigned_n (S->vivify_unassigned_n)
+#define vivify_conflict_nb (S->vivify_conflict_nb)
+#define elim_stack_size (S->elim_stack_size)
+#define elim_stack_n (S->elim_stack_n)
+#define elim_clause_n (S->elim_clause_n)
+#define elim_stack (S->elim_stack)
+#define proof_stack_size (S->proof_stack_size)
+#define proof_stack_size_2 (S->proof_stack_size_2)
+#define proof_stack_n_2 (S->proof_stack_n_2)
+#define proof_stack_lit_2 (S->proof_stack_lit_2)
+#define proof_stack_clause_2 (S->proof_stack_clause_2)
+#define bclause_lit (S->bclause_lit)
+#define cycles (S->cycles)
+#define cycle_size (S->cycle_size)
+#define cycle_n (S->cycle_n)
+
+
+/**
+   \brief instance used by comparison functions given to qsort
+   \remark qsort has no context argument: it is set just before sorting */
+static __thread SAT_Tsolver * cmp_solver = NULL;
+
+/**
+   \brief the default instance, used by the functions without _r suffix */
+static SAT_Tsolver SAT_default_solver;
+SAT_Tsolver * SAT_default = &SAT_default_solver;
 
 #if STATS_LEVEL >= 1
 unsigned stat_n_conflict = 0;
@@ -192,10 +580,6 @@ unsigned stat_prop_call_noprop = 0;
 #endif
 #endif
 
-static unsigned misc_stack_size = 0;
-static unsigned misc_stack_n = 0;
-static Tlit *   misc_stack = NULL;
-
 /*
   --------------------------------------------------------------
   Miscaleneous early declarations
@@ -203,20 +587,23 @@ static Tlit *   misc_stack = NULL;
 */
 
 #ifdef DEBUG_SAT
-static void check_consistency(void);
-static void check_consistency_final(void);
-static void check_consistency_propagation(void);
-static void check_consistency_heap(void);
-static void print_stack(void);
+static void check_consistency(SAT_Tsolver * S);
+static void check_consistency_final(SAT_Tsolver * S);
+static void check_consistency_propagation(SAT_Tsolver * S);
+static void check_consistency_heap(SAT_Tsolver * S);
+static void print_stack(SAT_Tsolver * S);
+#endif
+static inline void var_order_insert(SAT_Tsolver * S, Tvar var);
+#ifdef SLS
+static void local_search(SAT_Tsolver * S);
 #endif
-static inline void var_order_insert(Tvar var);
 
 #ifdef PROOF
-static void proof_begin(Tclause clause);
-static void proof_resolve(Tlit lit, Tclause clause);
-static void proof_end(Tclause clause);
+static void proof_begin(SAT_Tsolver * S, Tclause clause);
+static void proof_resolve(SAT_Tsolver * S, Tlit lit, Tclause clause);
+static void proof_end(SAT_Tsolver * S, Tclause clause);
 #ifdef PROOF_PRINT
-static void proof_print(Tclause clause);
+static void proof_print(SAT_Tsolver * S, Tclause clause);
 #endif
 #endif
 
@@ -287,25 +674,37 @@ typedef int (* TFcmp) (const void *, const void *);
   --------------------------------------------------------------
 */
 
+/* RANDOMIZE_DECISION makes random decisions (params.random_freq) on
+   by default */
 /* #define RANDOMIZE_DECISION */
-#ifdef RANDOMIZE_DECISION
 
 #define RANDOMIZE_SEED 123456
 #define RANDOMIZE_FREQ 100
 
-static unsigned int seed = RANDOMIZE_SEED;
-
 /* Taken from http://software.intel.com/en-us/articles/fast-random-number-generator-on-the-intel-pentiumr-4-processor/
    http://en.wikipedia.org/wiki/Linear_congruential_generator
    And modified.  This is certainly not good random at all, but good enough. */
 
 static inline unsigned
-fastrand(unsigned upper)
+fastrand(SAT_Tsolver * S, unsigned upper)
 { 
-  seed = (214013*seed+2531011); 
-  return (seed >> 1) % upper;
+  unsigned * seed = &S->state.params.seed;
+  *seed = (214013 * *seed + 2531011);
+  return (*seed >> 1) % upper;
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief initial polarity for decisions on a variable
+   \return 0 or 1, according to params.phase */
+static inline unsigned char
+phase_initial(SAT_Tsolver * S)
+{
+  if (S->state.params.phase == VAL_UNDEF)
+    return (unsigned char) fastrand(S, 2);
+  return S->state.params.phase;
 }
-#endif
 
 /*
   --------------------------------------------------------------
@@ -357,6 +756,12 @@ fastrand(unsigned upper)
    \li if 000, the history field gives the id of the last clause
    before last non backtracked push.  It also acts as a markup for
    information relavant to a given push
+   \li if 100, the history field gives the number of literals
+   assigned at root level at the time of the push.  It is right
+   below the markup
+   \li if 101, the history field gives the number of cardinality
+   constraints at the time of the push.  It is the lowest field of
+   the push
    
    @{ */
 
@@ -367,20 +772,19 @@ fastrand(unsigned upper)
 #ifndef PRESERVE_CLAUSES
 #define SAVE_CLAUSE_FREE_LIST 3
 #endif
+#define SAVE_STACK_LIT_UNIT 4
+#define SAVE_CARD_N 5
 
 typedef struct Thistory
 {
-  unsigned history_type:2;
-  Tclause clause:30;
+  unsigned history_type:3;
+  Tclause clause:29;
 } Thistory;
 
-static unsigned history_size = 0; /**< size of allocated stack */
-static unsigned history_n = 0;    /**< nb of fields in history */
-static Thistory * history = NULL;  /**< array of clauses id */
 /** @} */
 
 static inline void
-history_status_changed(void)
+history_status_changed(SAT_Tsolver * S)
 {
   STACK_RESIZE_EXP(history, history_n + 1, history_size, sizeof(Thistory));
   history[history_n].history_type = STATUS_CHANGED;
@@ -390,7 +794,7 @@ history_status_changed(void)
 /*--------------------------------------------------------------*/
 
 static inline void
-history_clause_unset_watched(Tclause clause)
+history_clause_unset_watched(SAT_Tsolver * S, Tclause clause)
 {
   STACK_RESIZE_EXP(history, history_n + 1, history_size, sizeof(Thistory));
   history[history_n].history_type = CLAUSE_UNSET_WATCHED;
@@ -404,34 +808,56 @@ history_clause_unset_watched(Tclause clause)
   --------------------------------------------------------------
 */
 
+/**
+   \brief entry of a watch list
+   \remark blocker is some literal of the clause: if it is true, the
+   clause is satisfied and propagation skips it without reading the
+   clause itself */
+typedef struct TSwatcher {
+  Tclause clause;
+  Tlit blocker;
+} TSwatcher;
+
 typedef struct Twatch {
   unsigned n;
   unsigned size;
-  Tclause * Pclause;
+  TSwatcher * Pwatcher;
 } Twatch;
 
-Twatch * watch = NULL;
+/**
+   \brief cardinality constraints with a literal, visited when it
+   becomes true
+   \remark constraints are in the order they were added */
+typedef struct Tcard_watch {
+  unsigned n;
+  unsigned size;
+  unsigned * Pcard;
+} Tcard_watch;
 
 /**
    \author Pascal Fontaine
    \brief adds a clause to the watched clauses of literal
    \param lit the literal
-   \param clause the clause */
+   \param clause the clause
+   \param blocker a literal of the clause other than lit */
 static inline void
-lit_watch(Tlit lit, Tclause clause)
+lit_watch(SAT_Tsolver * S, Tlit lit, Tclause clause, Tlit blocker)
 {
+  TSwatcher * Pwatcher;
   if (watch[lit].n == watch[lit].size)
     {
       watch[lit].size <<= 1;
-      MY_REALLOC(watch[lit].Pclause,
-		 (watch[lit].size * sizeof(Tclause)));
+      MY_REALLOC(watch[lit].Pwatcher,
+		 (watch[lit].size * sizeof(TSwatcher)));
     }
-  watch[lit].Pclause[watch[lit].n++] = clause;
+  Pwatcher = watch[lit].Pwatcher + watch[lit].n++;
+  Pwatcher->clause = clause;
+  Pwatcher->blocker = blocker;
 }
 
 /*--------------------------------------------------------------*/
 
-#ifdef BACKTRACK
+#if defined(BACKTRACK) || defined(CHRONO)
 /**
    \author Pascal Fontaine
    \brief removes clause from the watched clauses of literal
@@ -439,14 +865,13 @@ lit_watch(Tlit lit, Tclause clause)
    \param clause the clause
    \remark a call to this function may be expensive */
 static inline void
-lit_watch_remove(Tlit lit, Tclause clause)
+lit_watch_remove(SAT_Tsolver * S, Tlit lit, Tclause clause)
 {
-  Tclause * i = watch[lit].Pclause, * n = i + watch[lit].n;
-  while (clause != *i)
+  TSwatcher * i = watch[lit].Pwatcher, * n = i + watch[lit].n;
+  while (clause != i->clause)
     i++;
-  do
+  for (; i + 1 != n; i++)
     *i = *(i + 1);
-  while (++i != n);
   watch[lit].n--;
 }
 #endif
@@ -468,46 +893,22 @@ typedef struct TSvar
   unsigned decide:1;          /**< 1 iff decision on var is allowed */
   unsigned discarded:1;       /**< 1 iff discarded for minimal model */
   unsigned required:1;        /**< 1 iff selected for minimal model */
-  unsigned misc:5;            /**< unused (for alignment) */
+  unsigned eliminated:1;      /**< 1 iff eliminated by preprocessing */
+  unsigned phase_target:1;    /**< polarity in longest trail since
+				 restart, for stable phases */
+  unsigned phase_best:1;      /**< polarity in longest trail */
+  unsigned misc:2;            /**< unused (for alignment) */
+  unsigned card:1;            /**< 1 iff in a cardinality constraint */
 #ifdef PEDANTIC
-  unsigned padding:8;
+  unsigned padding:7;
 #endif
   SAT_Tlevel level;        /**< level of assignment */
   SAT_Tclause reason;      /**< clause responsible for propagation */
   double activity;         /**< variable activity */
 } TSvar;
 
-/**
-   \defgroup SAT_stack_var variable stack
-   \brief these fields define the stack for variables
-   \invariant SAT_stack_var_n is always the maximum id of variables
-   \invariant SAT_stack_var_size (the allocated size) >= SAT_stack_var_n + 1
-   @{ */
-static unsigned SAT_stack_var_size = 0; /**< size of allocated stack for vars */
-unsigned SAT_stack_var_n = 0;           /**< highest var id in the stack */
-static TSvar * SAT_stack_var = NULL;    /**< array of vars */
-/** @} */
-
-#ifdef SAT_SYM
-/**
-   \author Pascal Fontaine
-   \brief in case symmetry is used, once a unit clause about a variable
-   is deduced, unit clauses about all variables in the orbit are automatically
-   added.  This array stores the orbit. */
-Tvar * SAT_var_orbit = NULL;
-#endif
-
-static unsigned char * assign = NULL;   /**< assignment */
-
-#ifdef HINT_AS_DECISION
-static unsigned hint_n = 0;
-static unsigned hint_p = 0;
-static unsigned hint_size = 0;
-static Tlit * hints = NULL;
-#endif
-
 #if defined(BCLAUSE) || defined(BCLAUSE_LIGHT)
-static void bclause_resize(unsigned size_old, unsigned size_new);
+static void bclause_resize(SAT_Tsolver * S, unsigned size_old, unsigned size_new);
 #endif
 
 /**
@@ -515,7 +916,7 @@ static void bclause_resize(unsigned size_old, unsigned size_new);
    \brief creates a new variable
    \return the new variable id */
 Tvar
-SAT_var_new(void)
+SAT_var_new_r(SAT_Tsolver * S)
 {
   if (SAT_status != SAT_STATUS_UNSAT)
     SAT_status = SAT_STATUS_UNDEF;
@@ -529,8 +930,9 @@ SAT_var_new(void)
       MY_REALLOC(SAT_stack_var, SAT_stack_var_size * sizeof(TSvar));
       MY_REALLOC(assign, SAT_stack_var_size * sizeof(Tvalue));
       MY_REALLOC(watch, (2 * SAT_stack_var_size * sizeof(Twatch)));
+      MY_REALLOC(card_watch, (2 * SAT_stack_var_size * sizeof(Tcard_watch)));
 #if defined(BCLAUSE) || defined(BCLAUSE_LIGHT)
-      bclause_resize(SAT_stack_var_n * 2, 2 * SAT_stack_var_size);
+      bclause_resize(S, SAT_stack_var_n * 2, 2 * SAT_stack_var_size);
 #endif
 #ifdef SAT_SYM
       MY_REALLOC(SAT_var_orbit, SAT_stack_var_size * sizeof(Tvar));
@@ -541,40 +943,48 @@ SAT_var_new(void)
 	  {
 	    watch[i].n = 0;
 	    watch[i].size = 2;
-	    MY_MALLOC(watch[i].Pclause, 2 * sizeof(Tclause));
+	    MY_MALLOC(watch[i].Pwatcher, 2 * sizeof(TSwatcher));
+	    card_watch[i].n = card_watch[i].size = 0;
+	    card_watch[i].Pcard = NULL;
 	  }
       }
     }
   assign[SAT_stack_var_n] = VAL_UNDEF;
-  SAT_stack_var[SAT_stack_var_n].phase_cache = 0;
+  SAT_stack_var[SAT_stack_var_n].phase_cache =
+    phase_initial(S);
+  SAT_stack_var[SAT_stack_var_n].phase_target =
+    SAT_stack_var[SAT_stack_var_n].phase_best =
+    SAT_stack_var[SAT_stack_var_n].phase_cache;
   SAT_stack_var[SAT_stack_var_n].seen = 0;
   SAT_stack_var[SAT_stack_var_n].decide = 1;
   SAT_stack_var[SAT_stack_var_n].discarded = 0;
   SAT_stack_var[SAT_stack_var_n].required = 0;
+  SAT_stack_var[SAT_stack_var_n].eliminated = 0;
   SAT_stack_var[SAT_stack_var_n].misc = 0;
+  SAT_stack_var[SAT_stack_var_n].card = 0;
   SAT_stack_var[SAT_stack_var_n].level = 0;
   SAT_stack_var[SAT_stack_var_n].reason = CLAUSE_UNDEF;
   SAT_stack_var[SAT_stack_var_n].activity = 0;
 #ifdef SAT_SYM
   SAT_var_orbit[SAT_stack_var_n] = VAR_UNDEF;
 #endif
-  var_order_insert(SAT_stack_var_n);
+  var_order_insert(S, SAT_stack_var_n);
   return SAT_stack_var_n;
 }
 
 /*--------------------------------------------------------------*/
 
 static inline void
-SAT_var_free(Tvar var)
+SAT_var_free(SAT_Tsolver * S, Tvar var)
 {
-  free(watch[var<<1].Pclause);
-  free(watch[(var<<1) + 1].Pclause);
+  free(watch[var<<1].Pwatcher);
+  free(watch[(var<<1) + 1].Pwatcher);
   watch[var<<1].n = 0;
   watch[(var<<1) + 1].n = 0;
   watch[var<<1].size = 0;
   watch[(var<<1) + 1].size = 0;
-  watch[var<<1].Pclause = NULL;
-  watch[(var<<1) + 1].Pclause = NULL;
+  watch[var<<1].Pwatcher = NULL;
+  watch[(var<<1) + 1].Pwatcher = NULL;
 }
 
 /*--------------------------------------------------------------*/
@@ -584,10 +994,10 @@ SAT_var_free(Tvar var)
    \brief ensures variable of a given id exists
    \param id the variable id */
 void
-SAT_var_new_id(unsigned id)
+SAT_var_new_id_r(SAT_Tsolver * S, unsigned id)
 {
   while (SAT_stack_var_n < id)
-    SAT_var_new();
+    SAT_var_new_r(S);
 }
 
 /*--------------------------------------------------------------*/
@@ -598,7 +1008,7 @@ SAT_var_new_id(unsigned id)
    \param var the variable
    \return the value (VAL_FALSE, VAL_TRUE, or VAL_UNDEF) */
 inline Tvalue
-SAT_var_value(Tvar var)
+SAT_var_value_r(SAT_Tsolver * S, Tvar var)
 {
   assert(var <= SAT_stack_var_n);
   return assign[var];
@@ -613,7 +1023,7 @@ SAT_var_value(Tvar var)
    \remark while using this function you should know what you are
    doing.  The semantics of SAT/UNSAT depends on this */
 void
-SAT_var_block_decide(Tvar var)
+SAT_var_block_decide_r(SAT_Tsolver * S, Tvar var)
 {
   if (SAT_level != ROOT_LEVEL)
     my_error("SAT_var_block_decide call not at root level");
@@ -629,12 +1039,12 @@ SAT_var_block_decide(Tvar var)
    \remark while using this function you should know what you are
    doing.  The semantics of SAT/UNSAT depends on this */
 void
-SAT_var_unblock_decide(Tvar var)
+SAT_var_unblock_decide_r(SAT_Tsolver * S, Tvar var)
 {
   if (SAT_level != ROOT_LEVEL)
     my_error("SAT_var_unblock_decide call not at root level");
   SAT_stack_var[var].decide = 1;
-  var_order_insert(var);
+  var_order_insert(S, var);
 }
 
 /*--------------------------------------------------------------*/
@@ -643,12 +1053,13 @@ SAT_var_unblock_decide(Tvar var)
    \author Pascal Fontaine
    \brief check if variable can be chosen as a decision variable
    \param var the variable
-   \return 1 if suitable for decision, 0 otherwise */
+   \return 1 if suitable for decision, 0 otherwise
+   \remark eliminated variables are only assigned when extending models */
 static inline unsigned
-SAT_var_decision(Tvar var)
+SAT_var_decision(SAT_Tsolver * S, Tvar var)
 {
   assert(var <= SAT_stack_var_n);
-  return SAT_stack_var[var].decide;
+  return SAT_stack_var[var].decide && !SAT_stack_var[var].eliminated;
 }
 
 /*--------------------------------------------------------------*/
@@ -660,7 +1071,7 @@ SAT_var_decision(Tvar var)
    \return 1 if positive polarity, 0 otherwise
    \remark this is set in var_set_value */
 static inline unsigned
-SAT_var_phase_cache(Tvar var)
+SAT_var_phase_cache(SAT_Tsolver * S, Tvar var)
 {
   assert(var <= SAT_stack_var_n);
   return SAT_stack_var[var].phase_cache;
@@ -674,7 +1085,7 @@ SAT_var_phase_cache(Tvar var)
    \param var the variable
    \return 1 iff seen */
 static inline unsigned
-SAT_var_seen(Tvar var)
+SAT_var_seen(SAT_Tsolver * S, Tvar var)
 {
   assert(var <= SAT_stack_var_n);
   return SAT_stack_var[var].seen;
@@ -687,7 +1098,7 @@ SAT_var_seen(Tvar var)
    \brief set variable as seen
    \param var the variable */
 static inline void
-SAT_var_set_seen(Tvar var)
+SAT_var_set_seen(SAT_Tsolver * S, Tvar var)
 {
   assert(var <= SAT_stack_var_n);
   SAT_stack_var[var].seen = 1;
@@ -700,7 +1111,7 @@ SAT_var_set_seen(Tvar var)
    \brief set variable as unseen
    \param var the variable */
 static inline void
-SAT_var_set_unseen(Tvar var)
+SAT_var_set_unseen(SAT_Tsolver * S, Tvar var)
 {
   assert(var <= SAT_stack_var_n);
   SAT_stack_var[var].seen = 0;
@@ -723,7 +1134,7 @@ SAT_var_set_unseen(Tvar var)
    \param v2 the second variable
    \return 1 if first variable should be higher in the heap (less) */
 static inline int
-SAT_var_less(Tvar v1, Tvar v2)
+SAT_var_less(SAT_Tsolver * S, Tvar v1, Tvar v2)
 {
   return SAT_var_activity(v1) > SAT_var_activity(v2);
 }
@@ -736,7 +1147,7 @@ SAT_var_less(Tvar v1, Tvar v2)
    \param var the variable
    \return the level at which variable has been assigned */
 inline Tlevel
-SAT_var_level(Tvar var)
+SAT_var_level_r(SAT_Tsolver * S, Tvar var)
 {
   return SAT_stack_var[var].level;
 }
@@ -749,7 +1160,7 @@ SAT_var_level(Tvar var)
    \param var the variable
    \return the clause that propagated the variable */
 static inline Tclause
-SAT_var_reason(Tvar var)
+SAT_var_reason(SAT_Tsolver * S, Tvar var)
 {
   assert (assign[var] != VAL_UNDEF);
   return SAT_stack_var[var].reason;
@@ -759,13 +1170,15 @@ SAT_var_reason(Tvar var)
 
 /**
    \author Pascal Fontaine
-   \brief set the reason for variable value (lazy clause)
+   \brief set the reason for variable value (lazy clause, or
+   explanation of a cardinality constraint)
    \param var the variable
    \param reason the clause */
 static inline void
-SAT_var_set_reason(Tvar var, Tclause reason)
+SAT_var_set_reason(SAT_Tsolver * S, Tvar var, Tclause reason)
 {
-  assert (SAT_stack_var[var].reason == CLAUSE_LAZY);
+  assert (SAT_stack_var[var].reason == CLAUSE_LAZY ||
+	  CLAUSE_IS_CARD(SAT_stack_var[var].reason));
   SAT_stack_var[var].reason = reason;
 }
 
@@ -780,7 +1193,7 @@ SAT_var_set_reason(Tvar var, Tclause reason)
    \param reason the clause (CLAUSE_UNDEF for decisions) propagating the val
    \return 1 if succeeded, 0 if conflict */
 static inline void
-var_set_value(Tvar var, Tvalue value, Tlevel level, Tclause reason)
+var_set_value(SAT_Tsolver * S, Tvar var, Tvalue value, Tlevel level, Tclause reason)
 {
   assert(assign[var] == VAL_UNDEF);
   assign[var] = value;
@@ -797,13 +1210,13 @@ var_set_value(Tvar var, Tvalue value, Tlevel level, Tclause reason)
    \brief unset the value associated with the variable
    \param var the variable to unset */
 static inline void
-var_unset(Tvar var)
+var_unset(SAT_Tsolver * S, Tvar var)
 {
   assert(assign[var] != VAL_UNDEF);
   assign[var] = VAL_UNDEF;
   SAT_stack_var[var].reason = CLAUSE_UNDEF;
   SAT_stack_var[var].level = 0;
-  var_order_insert(var);
+  var_order_insert(S, var);
 }
 
 /*
@@ -813,10 +1226,16 @@ var_unset(Tvar var)
 */
 
 void
-SAT_phase_cache_set(void)
+SAT_phase_cache_set_r(SAT_Tsolver * S)
 {
-  /*   unsigned i; */
-  /*   for (i = 1; i <= SAT_stack_var_n; i++) */
+  unsigned i;
+  for (i = 1; i <= SAT_stack_var_n; i++)
+    SAT_stack_var[i].phase_cache = SAT_stack_var[i].phase_target =
+      SAT_stack_var[i].phase_best = phase_initial(S);
+#ifdef REPHASE
+  target_trail_n = best_trail_n = 0;
+#endif
+  /* Former experiments (all variables alike): */
   /* 17 Fail, 6579 < 5s */
   /*    SAT_stack_var[i].phase_cache = 1; */
   /* 16 Fail, 6585 < 5s */
@@ -841,12 +1260,6 @@ SAT_phase_cache_set(void)
   --------------------------------------------------------------
 */
 
-static unsigned heap_var_n = 0;
-static unsigned heap_var_size = 0;
-static Tvar * heap_var = NULL;
-static unsigned heap_index_size = 0;
-static unsigned * heap_index = NULL;
-
 #define HEAP_INDEX_UNDEF UINT_MAX
 
 static inline unsigned
@@ -874,11 +1287,11 @@ parent(unsigned i)
 /*--------------------------------------------------------------*/
 
 static inline void
-sift_up(unsigned i)
+sift_up(SAT_Tsolver * S, unsigned i)
 {
   Tvar var = heap_var[i];
   unsigned p = parent(i);
-  while (i && SAT_var_less(var, heap_var[p]))
+  while (i && SAT_var_less(S, var, heap_var[p]))
     {
       heap_var[i] = heap_var[p];
       heap_index[heap_var[p]] = i;
@@ -892,18 +1305,18 @@ sift_up(unsigned i)
 /*--------------------------------------------------------------*/
 
 static inline void
-sift_down(unsigned i)
+sift_down(SAT_Tsolver * S, unsigned i)
 {
   Tvar var = heap_var[i];
   while (left(i) < heap_var_n)
     {
       unsigned child;
       if (right(i) < heap_var_n &&
-	  SAT_var_less(heap_var[right(i)], heap_var[left(i)]))
+	  SAT_var_less(S, heap_var[right(i)], heap_var[left(i)]))
 	child = right(i);
       else
 	child = left(i);
-      if (!SAT_var_less(heap_var[child], var))
+      if (!SAT_var_less(S, heap_var[child], var))
 	break;
       heap_var[i] = heap_var[child];
       heap_index[heap_var[child]] = i;
@@ -916,7 +1329,7 @@ sift_down(unsigned i)
 /*--------------------------------------------------------------*/
 
 static inline int
-heap_var_in(Tvar var)
+heap_var_in(SAT_Tsolver * S, Tvar var)
 {
   assert (var != VAR_UNDEF);
   return var < heap_index_size && heap_index[var] != HEAP_INDEX_UNDEF;
@@ -925,7 +1338,7 @@ heap_var_in(Tvar var)
 /*--------------------------------------------------------------*/
 
 static inline void
-heap_var_insert(Tvar var)
+heap_var_insert(SAT_Tsolver * S, Tvar var)
 {
   assert(var!=VAR_UNDEF);
   if (!heap_var_size)
@@ -947,49 +1360,49 @@ heap_var_insert(Tvar var)
 	heap_index[i] = HEAP_INDEX_UNDEF;
       heap_index_size = SAT_stack_var_size;
     }
-  assert(!heap_var_in(var));
+  assert(!heap_var_in(S, var));
   heap_var[heap_var_n] = var;
   heap_index[var] = heap_var_n;
-  sift_up(heap_var_n++);
+  sift_up(S, heap_var_n++);
 }
 
 /*--------------------------------------------------------------*/
 
 static inline void
-heap_var_decrease(Tvar var)
+heap_var_decrease(SAT_Tsolver * S, Tvar var)
 {
-  assert(heap_var_in(var));
-  sift_up(heap_index[var]);
+  assert(heap_var_in(S, var));
+  sift_up(S, heap_index[var]);
 }
 
 /*--------------------------------------------------------------*/
 
 #if 0
 static inline void
-heap_var_increase(Tvar var)
+heap_var_increase(SAT_Tsolver * S, Tvar var)
 {
-  assert(heap_var_in(var));
-  sift_down(heap_index[var]);
+  assert(heap_var_in(S, var));
+  sift_down(S, heap_index[var]);
 }
 #endif
 
 /*--------------------------------------------------------------*/
 
 static inline Tvar
-heap_var_remove_min(void)
+heap_var_remove_min(SAT_Tsolver * S)
 {
   Tvar var = heap_var[0];
   heap_index[var] = HEAP_INDEX_UNDEF;
   heap_var[0] = heap_var[--heap_var_n];
   if (heap_var_n)
-    sift_down(0); /* index will be set in sift_down */
+    sift_down(S, 0); /* index will be set in sift_down */
   return var;
 }
 
 /*--------------------------------------------------------------*/
 
 static inline Tvar
-heap_var_get_min(void)
+heap_var_get_min(SAT_Tsolver * S)
 {
   return heap_var[0];
 }
@@ -998,14 +1411,14 @@ heap_var_get_min(void)
 
 #if 0
 static inline void
-heap_var_update(Tvar var)
+heap_var_update(SAT_Tsolver * S, Tvar var)
 {
-  if (!heap_var_in(var))
-    heap_var_insert(var);
+  if (!heap_var_in(S, var))
+    heap_var_insert(S, var);
   else
     {
-      sift_up(heap_index[var]);
-      sift_down(heap_index[var]);
+      sift_up(S, heap_index[var]);
+      sift_down(S, heap_index[var]);
     }
 }
 #endif
@@ -1013,7 +1426,7 @@ heap_var_update(Tvar var)
 /*--------------------------------------------------------------*/
 
 static inline int
-heap_var_empty(void)
+heap_var_empty(SAT_Tsolver * S)
 {
   return heap_var_n == 0;
 }
@@ -1022,7 +1435,7 @@ heap_var_empty(void)
 
 #if 0
 static void
-heap_var_build(Tvar * vs, unsigned n)
+heap_var_build(SAT_Tsolver * S, Tvar * vs, unsigned n)
 {
   int i;
   heap_var_n = 0;
@@ -1034,14 +1447,14 @@ heap_var_build(Tvar * vs, unsigned n)
     }
 
   for (i = heap_var_n / 2 - 1; i >= 0; i--)
-    sift_down(i);
+    sift_down(S, i);
 }
 #endif
 
 /*--------------------------------------------------------------*/
 
 static inline void
-heap_var_free(void)
+heap_var_free(SAT_Tsolver * S)
 {
   heap_var_n = 0;
   free(heap_var);
@@ -1054,30 +1467,28 @@ heap_var_free(void)
 
 /*--------------------------------------------------------------*/
 
-static double var_inc = 1;
-static double var_decay = 0.95;
 
 /*--------------------------------------------------------------*/
 
 static inline void
-var_order_insert(Tvar var)
+var_order_insert(SAT_Tsolver * S, Tvar var)
 {
-  if (!heap_var_in(var) && SAT_var_decision(var))
-    heap_var_insert(var);
+  if (!heap_var_in(S, var) && SAT_var_decision(S, var))
+    heap_var_insert(S, var);
 }
 
 /*--------------------------------------------------------------*/
 
 static inline void
-var_decrease_activity(void)
+var_decrease_activity(SAT_Tsolver * S)
 {
-  var_inc /= var_decay;
+  var_inc /= S->state.params.var_decay;
 }
 
 /*--------------------------------------------------------------*/
 
 static inline void
-var_increase_activity(Tvar var)
+var_increase_activity(SAT_Tsolver * S, Tvar var)
 {
   if ( (SAT_var_activity(var) += var_inc) > 1e100 )
     {
@@ -1088,8 +1499,8 @@ var_increase_activity(Tvar var)
       var_inc *= 1e-100;
     }
   /* Update order_heap with respect to new activity: */
-  if (heap_var_in(var))
-    heap_var_decrease(var);
+  if (heap_var_in(S, var))
+    heap_var_decrease(S, var);
 }
 
 /*
@@ -1099,14 +1510,14 @@ var_increase_activity(Tvar var)
 */
 
 inline Tvalue
-SAT_lit_value(Tlit lit)
+SAT_lit_value_r(SAT_Tsolver * S, Tlit lit)
 {
 #ifdef PEDANTIC
   Tvalue tmp = SAT_lit_pol(lit) ^ 1;
-  tmp ^= SAT_var_value(SAT_lit_var(lit));
+  tmp ^= SAT_var_value_r(S, SAT_lit_var(lit));
   return tmp;
 #else
-  return SAT_var_value(SAT_lit_var(lit)) ^ (SAT_lit_pol(lit) ^ 1);
+  return SAT_var_value_r(S, SAT_lit_var(lit)) ^ (SAT_lit_pol(lit) ^ 1);
 #endif
 }
 
@@ -1118,9 +1529,9 @@ SAT_lit_value(Tlit lit)
    \param lit the literal
    \return the value (VAL_FALSE, VAL_TRUE, or VAL_UNDEF) */
 static inline Tvalue
-SAT_lit_value_undef(Tlit lit)
+SAT_lit_value_undef(SAT_Tsolver * S, Tlit lit)
 {
-  return SAT_var_value(SAT_lit_var(lit)) == VAL_UNDEF;
+  return SAT_var_value_r(S, SAT_lit_var(lit)) == VAL_UNDEF;
 }
 
 /*--------------------------------------------------------------*/
@@ -1131,17 +1542,17 @@ SAT_lit_value_undef(Tlit lit)
    \param lit the literal
    \return the value (VAL_FALSE, VAL_TRUE, or VAL_UNDEF) */
 static inline int
-SAT_lit_value_is_true(Tlit lit)
+SAT_lit_value_is_true(SAT_Tsolver * S, Tlit lit)
 {
-  return (SAT_var_value(SAT_lit_var(lit)) ^ SAT_lit_pol(lit)) == VAL_FALSE;
+  return (SAT_var_value_r(S, SAT_lit_var(lit)) ^ SAT_lit_pol(lit)) == VAL_FALSE;
 }
 
 /*--------------------------------------------------------------*/
 
 inline Tlevel
-SAT_lit_level(Tlit lit)
+SAT_lit_level_r(SAT_Tsolver * S, Tlit lit)
 {
-  return SAT_var_level(SAT_lit_var(lit));
+  return SAT_var_level_r(S, SAT_lit_var(lit));
 }
 
 /*--------------------------------------------------------------*/
@@ -1152,9 +1563,9 @@ SAT_lit_level(Tlit lit)
    \param lit the literal
    \return 1 if seen, 0 otherwise */
 static inline unsigned
-SAT_lit_seen(Tlit lit)
+SAT_lit_seen(SAT_Tsolver * S, Tlit lit)
 {
-  return SAT_var_seen(SAT_lit_var(lit));
+  return SAT_var_seen(S, SAT_lit_var(lit));
 }
 
 /*--------------------------------------------------------------*/
@@ -1164,9 +1575,9 @@ SAT_lit_seen(Tlit lit)
    \brief set variable as seen
    \param lit the literal */
 static inline void
-SAT_lit_set_seen(Tlit lit)
+SAT_lit_set_seen(SAT_Tsolver * S, Tlit lit)
 {
-  SAT_var_set_seen(SAT_lit_var(lit));
+  SAT_var_set_seen(S, SAT_lit_var(lit));
 }
 
 /*--------------------------------------------------------------*/
@@ -1176,9 +1587,9 @@ SAT_lit_set_seen(Tlit lit)
    \brief set literal as unseen
    \param lit the literal */
 static inline void
-SAT_lit_set_unseen(Tlit lit)
+SAT_lit_set_unseen(SAT_Tsolver * S, Tlit lit)
 {
-  SAT_var_set_unseen(SAT_lit_var(lit));
+  SAT_var_set_unseen(S, SAT_lit_var(lit));
 }
 
 /*--------------------------------------------------------------*/
@@ -1189,9 +1600,9 @@ SAT_lit_set_unseen(Tlit lit)
    \param lit the literal
    \return the clause that propagated the literal */
 static inline Tclause
-SAT_lit_reason(Tlit lit)
+SAT_lit_reason(SAT_Tsolver * S, Tlit lit)
 {
-  return SAT_var_reason(SAT_lit_var(lit));
+  return SAT_var_reason(S, SAT_lit_var(lit));
 }
 
 /*--------------------------------------------------------------*/
@@ -1232,18 +1643,19 @@ SAT_lit_compare(const Tlit * lit1, const Tlit * lit2)
 static int
 SAT_lit_compare_level(const Tlit * Plit1, const Tlit * Plit2)
 {
-  switch (SAT_lit_value(*Plit1))
+  SAT_Tsolver * S = cmp_solver;
+  switch (SAT_lit_value_r(S, *Plit1))
     {
     case VAL_TRUE:
-      if (SAT_lit_value(*Plit2) == VAL_TRUE)
-	return ((int)SAT_lit_level(*Plit1)) - ((int)SAT_lit_level(*Plit2));
+      if (SAT_lit_value_r(S, *Plit2) == VAL_TRUE)
+	return ((int)SAT_lit_level_r(S, *Plit1)) - ((int)SAT_lit_level_r(S, *Plit2));
       return -1;
     case VAL_FALSE:
-      if (SAT_lit_value(*Plit2) == VAL_FALSE)
-	return ((int)SAT_lit_level(*Plit2)) - ((int)SAT_lit_level(*Plit1));
+      if (SAT_lit_value_r(S, *Plit2) == VAL_FALSE)
+	return ((int)SAT_lit_level_r(S, *Plit2)) - ((int)SAT_lit_level_r(S, *Plit1));
       return 1;
     default:
-      switch (SAT_lit_value(*Plit2))
+      switch (SAT_lit_value_r(S, *Plit2))
 	{
 	case VAL_TRUE: return 1;
 	case VAL_FALSE: return -1;
@@ -1271,12 +1683,6 @@ SAT_lit_compare_level(const Tlit * Plit1, const Tlit * Plit2)
    \invariant stack_lit_n is the index of the next literal
    \invariant stack_lit_size (the allocated size) >= stack_lit_n
    @{ */
-static unsigned  stack_lit_size = 0;  /**< size of allocated stack for literals */
-unsigned  stack_lit_n = 0;     /**< index of next position */
-Tlit     *stack_lit = NULL;    /**< array of literals */
-unsigned  stack_lit_to_propagate = 0; /**< index to the next literal to propagate */
-unsigned  stack_lit_hold = 0;
-unsigned  stack_lit_unit = 0;
 
 /**
    \author Pascal Fontaine
@@ -1284,19 +1690,19 @@ unsigned  stack_lit_unit = 0;
    \param lit the literal to add
    \param reason clause propagating the literal (CLAUSE_UNDEF if decision) */
 static inline void
-stack_lit_add(Tlit lit, Tclause reason)
+stack_lit_add(SAT_Tsolver * S, Tlit lit, Tclause reason)
 {
   STACK_RESIZE_EXP(stack_lit, stack_lit_n + 1, stack_lit_size, sizeof(Tlit));
   stack_lit[stack_lit_n++] = lit;
   /* printf("stack_lit_add %d %d\n", lit, reason); */
-  var_set_value(SAT_lit_var(lit), SAT_lit_pol(lit), SAT_level, reason);
+  var_set_value(S, SAT_lit_var(lit), SAT_lit_pol(lit), SAT_level, reason);
   if (SAT_level == ROOT_LEVEL)
     {
 #ifdef PROOF
       if (!SAT_proof)
-	SAT_lit_set_seen(lit);
+	SAT_lit_set_seen(S, lit);
 #else
-      SAT_lit_set_seen(lit); /* TODO This should be backtracked somewhere */
+      SAT_lit_set_seen(S, lit); /* TODO This should be backtracked somewhere */
 #endif
       stack_lit_unit = stack_lit_n;
     }
@@ -1304,8 +1710,28 @@ stack_lit_add(Tlit lit, Tclause reason)
 
 /*--------------------------------------------------------------*/
 
+#ifdef CHRONO
+/**
+   \brief add literal to the stack, implied at a level that may be
+   lower than the current one
+   \param lit the literal to add
+   \param reason clause propagating the literal
+   \param level the highest level of the other literals of reason
+   \remark the literal is kept by backtracking to level */
+static inline void
+stack_lit_add_level(SAT_Tsolver * S, Tlit lit, Tclause reason, Tlevel level)
+{
+  assert(level > ROOT_LEVEL && level <= SAT_level);
+  STACK_RESIZE_EXP(stack_lit, stack_lit_n + 1, stack_lit_size, sizeof(Tlit));
+  stack_lit[stack_lit_n++] = lit;
+  var_set_value(S, SAT_lit_var(lit), SAT_lit_pol(lit), level, reason);
+}
+#endif
+
+/*--------------------------------------------------------------*/
+
 static inline Tlit
-stack_lit_get(unsigned index)
+stack_lit_get(SAT_Tsolver * S, unsigned index)
 {
   return stack_lit[index];
 }
@@ -1328,10 +1754,8 @@ stack_lit_get(unsigned index)
    \invariant SAT_level is the index of the next stack_lit index
    \invariant stack_level_size (the allocated size) >= SAT_level
    \invariant stack_level[i] is the first literal asserted at level i + 1
+   \remark with CHRONO, literals of lower levels may follow it
    @{ */
-unsigned stack_level_size = 0;
-Tlevel * stack_level = NULL;
-unsigned stack_level_hold = 0;
 
 /*--------------------------------------------------------------*/
 
@@ -1340,13 +1764,13 @@ unsigned stack_level_hold = 0;
    \brief add decision literal to the stack, changing the level
    \param lit the literal to add */
 static inline void
-level_push(Tlit lit)
+level_push(SAT_Tsolver * S, Tlit lit)
 {
   STACK_RESIZE_EXP(stack_level, SAT_level + 1,
 		   stack_level_size, sizeof(unsigned));
   stack_level[SAT_level] = stack_lit_n;
   SAT_level++;
-  stack_lit_add(lit, CLAUSE_UNDEF);
+  stack_lit_add(S, lit, CLAUSE_UNDEF);
 }
 
 /*--------------------------------------------------------------*/
@@ -1356,7 +1780,7 @@ level_push(Tlit lit)
    \brief backtrack to a given level
    \param level the level not to backtrack */
 static inline void
-level_backtrack(Tlevel level)
+level_backtrack(SAT_Tsolver * S, Tlevel level)
 {
   unsigned stack_lit_bt;
   if (level >= SAT_level)
@@ -1367,15 +1791,35 @@ level_backtrack(Tlevel level)
   stack_lit_bt = stack_level[level];
   assert (stack_lit_to_propagate >= stack_lit_bt);
   SAT_level = level;
+#ifdef CHRONO
+  {
+    /* literals of lower levels are kept, and propagated again */
+    unsigned i, j;
+    for (i = j = stack_lit_bt; i < stack_lit_n; i++)
+      if (SAT_lit_level_r(S, stack_lit_get(S, i)) <= level)
+	stack_lit[j++] = stack_lit[i];
+      else
+	var_unset(S, SAT_lit_var(stack_lit_get(S, i)));
+#ifdef VIVIFY
+    unassigned_n += stack_lit_n - j;
+#endif
+    stack_lit_n = j;
+  }
+  stack_lit_to_propagate = stack_lit_bt;
+#else
+#ifdef VIVIFY
+  unassigned_n += stack_lit_n - stack_lit_bt;
+#endif
   /* PF there is no particular reason to do this backwards but easier for
      debugging purposes */
   while (stack_lit_n > stack_lit_bt)
     {
       stack_lit_n--;
-      var_unset(SAT_lit_var(stack_lit_get(stack_lit_n)));
+      var_unset(S, SAT_lit_var(stack_lit_get(S, stack_lit_n)));
     }
   assert(stack_lit_n == stack_lit_bt);
   stack_lit_n = stack_lit_to_propagate = stack_lit_bt;
+#endif
   if (stack_lit_n < stack_lit_hold)
     stack_lit_hold = stack_lit_n;
   if (level < stack_level_hold)
@@ -1394,30 +1838,30 @@ level_backtrack(Tlevel level)
    \remark returns UINT_MAX if there's none */
 #ifdef REUSE_TRAIL
 static inline Tlevel
-find_level_on_restart(void)
+find_level_on_restart(SAT_Tsolver * S)
 {
   unsigned i;
   double next_decision_act;
   Tvar var;
   while (1)
     {
-      assert(!heap_var_empty());
-      var = heap_var_get_min();
-      if (SAT_var_value(var) == VAL_UNDEF && SAT_var_decision(var))
+      assert(!heap_var_empty(S));
+      var = heap_var_get_min(S);
+      if (SAT_var_value_r(S, var) == VAL_UNDEF && SAT_var_decision(S, var))
 	break;
-      heap_var_remove_min();
+      heap_var_remove_min(S);
     }
   next_decision_act = SAT_var_activity(var);
   /* Iterate over all literals in the trail (literal stack) */
   for (i = 0; i < stack_lit_n; ++i) 
-    if (!SAT_var_reason(var = SAT_lit_var(stack_lit[i])) &&
+    if (!SAT_var_reason(S, var = SAT_lit_var(stack_lit[i])) &&
 	SAT_var_activity(var) < next_decision_act)
-      return SAT_var_level(var) - 1; 
+      return SAT_var_level_r(S, var) - 1; 
   return UINT_MAX;
 }
 #else
 static inline Tlevel
-find_level_on_restart(void)
+find_level_on_restart(SAT_Tsolver * S)
 {
   return ROOT_LEVEL;
 }
@@ -1440,6 +1884,8 @@ typedef struct TSclause
   unsigned char conflict;
   unsigned char learnt;
   unsigned char watched;
+  unsigned glue;
+  unsigned char used;
 #else
   unsigned n:28;        /**< number of literals */
   unsigned deleted:1;   /**< deleted */
@@ -1447,35 +1893,88 @@ typedef struct TSclause
   unsigned learnt:1;    /**< is it a learnt clause */
   unsigned watched:1;   /**< clause is in watch lists
 			     (any but empty, unit, or valid) */
+  unsigned glue:31;     /**< number of decision levels of the literals
+			     (learnt clauses), an upper bound */
+  unsigned used:1;      /**< used in conflict analysis since last purge */
 #endif
   double activity;      /**< variable activity */
-  Tlit blocker;
-  Tlit * lit;           /**< literals */
+  unsigned offset;      /**< position of the literals in stack_clause_lit */
 } TSclause;
 /* MiniSAT uses memory after clause to store literals.  Here it is not
-   possible since clause stack is an array */
-
-#ifndef PRESERVE_CLAUSES
-static unsigned first_free_clause = CLAUSE_UNDEF;
-#endif
+   possible since clause stack is an array.  Literals of all clauses are
+   rather stored contiguously in stack_clause_lit, which is compacted
+   when too much of it is wasted by deleted clauses */
 
 /**
-   \defgroup stack_clause clause stack
-   \brief these fields define the stack for clauses
-   \invariant stack_clause_n is always the maximum clause id
-   \invariant stack_clause_size (the allocated size) >= stack_clause_n + 1
-   @{ */
-static unsigned stack_clause_size = 0; /**< size of allocated stack */
-static unsigned stack_clause_n = 0;    /**< highest clause id in the stack */
-static TSclause * stack_clause = NULL; /**< array of clauses */
-/** @} */
+   \brief literals of a clause */
+#define CLAUSE_LIT(PSclause) (stack_clause_lit + (PSclause)->offset)
 
 static inline void
-clause_learnts_push(Tclause clause);
+clause_learnts_push(SAT_Tsolver * S, Tclause clause);
 #if defined(BCLAUSE) || defined(BCLAUSE_LIGHT)
 static inline void
-bclause_add(Tclause clause, Tlit lit1, Tlit lit2);
+bclause_add(SAT_Tsolver * S, Tclause clause, Tlit lit1, Tlit lit2);
+#endif
+#if defined(BCLAUSE_LIGHT) && defined(BACKTRACK)
+static inline void
+bclause_remove(SAT_Tsolver * S, Tclause clause, Tlit lit1, Tlit lit2);
 #endif
+#if defined(BCLAUSE_LIGHT) && defined(ELIM)
+static void
+bclause_clear(SAT_Tsolver * S);
+#endif
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief reserves room in stack_clause_lit
+   \param n the number of literals
+   \return the position of the room reserved
+   \remark pointers to literals of clauses may be invalidated */
+static inline unsigned
+clause_lit_alloc(SAT_Tsolver * S, unsigned n)
+{
+  unsigned offset = stack_clause_lit_n;
+  if (n >= (1u << 31) - stack_clause_lit_n)
+    my_error ("too many literals in clauses\n");
+  stack_clause_lit_n += n;
+  STACK_RESIZE_EXP(stack_clause_lit, stack_clause_lit_n,
+		   stack_clause_lit_size, sizeof(Tlit));
+  return offset;
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief compacts stack_clause_lit, if literals of deleted clauses take
+   more than 1/CLAUSE_LIT_WASTE_FACT of it
+   \remark pointers to literals of clauses are invalidated */
+static void
+clause_lit_gc(SAT_Tsolver * S)
+{
+  Tclause clause;
+  Tlit * lit;
+  unsigned n = 1;
+  if (stack_clause_lit_waste < stack_clause_lit_n / CLAUSE_LIT_WASTE_FACT)
+    return;
+  for (clause = 1; clause <= stack_clause_n; clause++)
+    if (stack_clause[clause].offset)
+      n += stack_clause[clause].n;
+  MY_MALLOC(lit, n * sizeof(Tlit));
+  for (n = 1, clause = 1; clause <= stack_clause_n; clause++)
+    {
+      TSclause * PSclause = stack_clause + clause;
+      if (!PSclause->offset)
+	continue;
+      memcpy(lit + n, CLAUSE_LIT(PSclause), PSclause->n * sizeof(Tlit));
+      PSclause->offset = n;
+      n += PSclause->n;
+    }
+  free(stack_clause_lit);
+  stack_clause_lit = lit;
+  stack_clause_lit_n = stack_clause_lit_size = n;
+  stack_clause_lit_waste = 0;
+}
 
 /*--------------------------------------------------------------*/
 
@@ -1489,10 +1988,10 @@ bclause_add(Tclause clause, Tlit lit1, Tlit lit2);
    \param conflict a flag indicating if the clause is a conflict clause.
    \return clause id
    \remark watches are the first two literals.  Choose adequately (IMPROVE)
-   \remark memory allocated by lit is confiscated, but can still be used (not freed or moved)
-   while no simplification occur */
+   \remark literals are copied into stack_clause_lit, lit is left to the
+   caller */
 static inline Tclause
-clause_new(unsigned n, Tlit * lit,
+clause_new(SAT_Tsolver * S, unsigned n, Tlit * lit,
 	   unsigned char learnt, unsigned char watched, unsigned char conflict)
 {
   TSclause * PSclause;
@@ -1503,8 +2002,8 @@ clause_new(unsigned n, Tlit * lit,
       static int j = 1;
       fprintf(stderr, "Unit clause added %d\n", j++);
       fprintf(stderr, "Subsumed %d, Strengthened %d\n",
-	      tmp_check_subsumed_unit(lit[0]),
-	      tmp_check_strengthenable_unit(lit[0]));
+	      tmp_check_subsumed_unit(S, lit[0]),
+	      tmp_check_strengthenable_unit(S, lit[0]));
     }
   if (n == 2)
     {
@@ -1513,7 +2012,13 @@ clause_new(unsigned n, Tlit * lit,
     }
 #endif
 #ifndef PRESERVE_CLAUSES
+#ifdef BACKTRACK
+  /* input clauses are removed by position when popping, and learnt
+     clauses are all discarded then, wherever they are */
+  if (first_free_clause != CLAUSE_UNDEF && learnt)
+#else
   if (first_free_clause != CLAUSE_UNDEF)
+#endif
     {
       clause = first_free_clause;
       PSclause = stack_clause + clause;
@@ -1536,29 +2041,32 @@ clause_new(unsigned n, Tlit * lit,
   stats_counter_inc(stat_n_clauses);
 #endif
   PSclause->n = n;
-  PSclause->lit = lit;
+  PSclause->offset = clause_lit_alloc(S, n);
+  if (n)
+    memcpy(CLAUSE_LIT(PSclause), lit, n * sizeof(Tlit));
   PSclause->learnt = learnt;
   if (learnt)
-    clause_learnts_push(clause);
+    clause_learnts_push(S, clause);
   PSclause->deleted = 0;
   PSclause->activity = 0;
   PSclause->conflict = conflict;
-  PSclause->blocker = LIT_UNDEF;
+  PSclause->glue = n;
+  PSclause->used = 0;
 #if defined(BCLAUSE) || defined(BCLAUSE_LIGHT)
   PSclause->watched = watched && (n >= 3);
   if (watched && n >= 3)
     {
-      lit_watch(PSclause->lit[0], clause);
-      lit_watch(PSclause->lit[1], clause);
+      lit_watch(S, CLAUSE_LIT(PSclause)[0], clause, CLAUSE_LIT(PSclause)[1]);
+      lit_watch(S, CLAUSE_LIT(PSclause)[1], clause, CLAUSE_LIT(PSclause)[0]);
     }
   if (n == 2)
-    bclause_add(clause, PSclause->lit[0], PSclause->lit[1]);
+    bclause_add(S, clause, CLAUSE_LIT(PSclause)[0], CLAUSE_LIT(PSclause)[1]);
 #else
   PSclause->watched = watched && (n >= 2);
   if (watched && n >= 2)
     {
-      lit_watch(PSclause->lit[0], clause);
-      lit_watch(PSclause->lit[1], clause);
+      lit_watch(S, CLAUSE_LIT(PSclause)[0], clause, CLAUSE_LIT(PSclause)[1]);
+      lit_watch(S, CLAUSE_LIT(PSclause)[1], clause, CLAUSE_LIT(PSclause)[0]);
     }
 #endif
   return clause;
@@ -1568,7 +2076,7 @@ clause_new(unsigned n, Tlit * lit,
 
 #if STATS_LEVEL >= 4
 int
-tmp_check_subsumed_unit(Tlit lit)
+tmp_check_subsumed_unit(SAT_Tsolver * S, Tlit lit)
 {
   unsigned i, j, n = 0;
   for (i = 1; i < stack_clause_n; i++)
@@ -1577,7 +2085,7 @@ tmp_check_subsumed_unit(Tlit lit)
     else
       {
 	for (j = 0; j < stack_clause[i].n; j++)
-	  if (lit == stack_clause[i].lit[j])
+	  if (lit == CLAUSE_LIT(stack_clause + i)[j])
 	    n++;
       }
   return n;
@@ -1586,7 +2094,7 @@ tmp_check_subsumed_unit(Tlit lit)
 /*--------------------------------------------------------------*/
 
 int
-tmp_check_strengthenable_unit(Tlit lit)
+tmp_check_strengthenable_unit(SAT_Tsolver * S, Tlit lit)
 {
   unsigned i, j, n = 0;
   for (i = 1; i < stack_clause_n; i++)
@@ -1595,7 +2103,7 @@ tmp_check_strengthenable_unit(Tlit lit)
     else
       {
 	for (j = 0; j < stack_clause[i].n; j++)
-	  if (lit == -stack_clause[i].lit[j])
+	  if (lit == -CLAUSE_LIT(stack_clause + i)[j])
 	    n++;
       }
   return n;
@@ -1604,32 +2112,19 @@ tmp_check_strengthenable_unit(Tlit lit)
 
 /*--------------------------------------------------------------*/
 
-/**
-   \author Pascal Fontaine
-   \brief remove a clause
-   \param clause the clause to remove
-   \remark this is only used in SAT_done, so minimalistic work accepted */
-static void
-SAT_clause_free(Tclause clause)
-{
-  free(stack_clause[clause].lit);
-}
-
-/*--------------------------------------------------------------*/
-
 #if 0
 /**
    \author Pascal Fontaine
    \brief desactivate a clause
    \param clause the clause to desactivate */
 static void
-clause_unset_watched(Tclause clause)
+clause_unset_watched(SAT_Tsolver * S, Tclause clause)
 {
   TSclause * PSclause = stack_clause + clause;
   if (!PSclause->watched)
     return;
-  lit_watch_remove(PSclause->lit[0], clause);
-  lit_watch_remove(PSclause->lit[1], clause);
+  lit_watch_remove(S, CLAUSE_LIT(PSclause)[0], clause);
+  lit_watch_remove(S, CLAUSE_LIT(PSclause)[1], clause);
   PSclause->watched = 0;
 }
 #endif
@@ -1642,13 +2137,18 @@ clause_unset_watched(Tclause clause)
    \brief activate clause
    \param clause the clause to activate */
 static void
-clause_set_watched(Tclause clause)
+clause_set_watched(SAT_Tsolver * S, Tclause clause)
 {
   TSclause * PSclause = stack_clause + clause;
+#ifdef BCLAUSE_LIGHT
+  if (PSclause->watched || PSclause->n < 3)
+    return;
+#else
   if (PSclause->watched || PSclause->n < 2)
     return;
-  lit_watch(PSclause->lit[0], clause);
-  lit_watch(PSclause->lit[1], clause);
+#endif
+  lit_watch(S, CLAUSE_LIT(PSclause)[0], clause, CLAUSE_LIT(PSclause)[1]);
+  lit_watch(S, CLAUSE_LIT(PSclause)[1], clause, CLAUSE_LIT(PSclause)[0]);
   PSclause->watched = 1;
 }
 #endif
@@ -1663,15 +2163,22 @@ clause_set_watched(Tclause clause)
    \remark this is only used in popping, so no need to update
    first_free_clause, or to put fields in an acceptable state */
 static void
-clause_remove(Tclause clause)
+clause_remove(SAT_Tsolver * S, Tclause clause)
 {
   TSclause * PSclause = stack_clause + clause;
   if (PSclause->watched)
     {
-      lit_watch_remove(PSclause->lit[0], clause);
-      lit_watch_remove(PSclause->lit[1], clause);
+      lit_watch_remove(S, CLAUSE_LIT(PSclause)[0], clause);
+      lit_watch_remove(S, CLAUSE_LIT(PSclause)[1], clause);
     }
-  free(PSclause->lit);
+#ifdef BCLAUSE_LIGHT
+  if (!PSclause->deleted && PSclause->n == 2)
+    bclause_remove(S, clause,
+		   CLAUSE_LIT(PSclause)[0], CLAUSE_LIT(PSclause)[1]);
+#endif
+  if (PSclause->offset)
+    stack_clause_lit_waste += PSclause->n;
+  PSclause->offset = 0;
 }
 #endif
 
@@ -1683,7 +2190,7 @@ clause_remove(Tclause clause)
    \param clause the clause to remove
    \remark this is only used in clause_purge */
 static inline void
-clause_lazy_delete(Tclause clause)
+clause_lazy_delete(SAT_Tsolver * S, Tclause clause)
 {
   TSclause * PSclause = stack_clause + clause;
   if (PSclause->deleted)
@@ -1695,10 +2202,10 @@ clause_lazy_delete(Tclause clause)
   if (SAT_proof)
     return;
 #endif
+  stack_clause_lit_waste += PSclause->n;
   PSclause->n = first_free_clause;
   first_free_clause = clause;
-  free(PSclause->lit);
-  PSclause->lit = NULL;
+  PSclause->offset = 0;
   PSclause->learnt = 0;
 #endif
 #if STATS_LEVEL >= 1
@@ -1710,7 +2217,7 @@ clause_lazy_delete(Tclause clause)
 
 #if defined(PROOF_PRINT_CLAUSES) || defined(DEBUG)
 void
-clause_print(Tclause clause)
+clause_print(SAT_Tsolver * S, Tclause clause)
 {
   unsigned i;
   TSclause * PSclause = stack_clause + clause;
@@ -1726,7 +2233,7 @@ clause_print(Tclause clause)
   if (PSclause->learnt)
     fprintf(stderr, "L");
   for (i = 0; i < PSclause->n; i++)
-    fprintf(stderr, i?" %d":"%d", PSclause->lit[i]);
+    fprintf(stderr, i?" %d":"%d", CLAUSE_LIT(PSclause)[i]);
 }
 #endif
 
@@ -1734,13 +2241,13 @@ clause_print(Tclause clause)
 
 #ifdef DEBUG
 void
-clause_print_all(void)
+clause_print_all(SAT_Tsolver * S)
 {
   unsigned i;
   for (i = 1; i < stack_clause_n; i++)
     {
       fprintf(stderr, "%d : ", i);
-      clause_print(i);
+      clause_print(S, i);
       fprintf(stderr, "\n");
     }
 }
@@ -1762,15 +2269,6 @@ clause_by_size(const Tclause * Pclause1, const Tclause * Pclause2)
   --------------------------------------------------------------
 */
 
-static double clause_inc = 1;
-static double clause_decay = 0.999;
-
-static Tclause * learnts = NULL;
-static unsigned learnts_n = 0;
-static unsigned learnts_size = 0;
-
-/*--------------------------------------------------------------*/
-
 /**
    \author Pascal Fontaine
    \brief access clause activity
@@ -1780,7 +2278,7 @@ static unsigned learnts_size = 0;
 /*--------------------------------------------------------------*/
 
 static inline void
-clause_decrease_activity(void)
+clause_decrease_activity(SAT_Tsolver * S)
 {
   clause_inc /= clause_decay;
 }
@@ -1788,7 +2286,7 @@ clause_decrease_activity(void)
 /*--------------------------------------------------------------*/
 
 static inline void
-clause_increase_activity(Tclause clause)
+clause_increase_activity(SAT_Tsolver * S, Tclause clause)
 {
   if ( (clause_activity(clause) += clause_inc) > 1e20 )
     {
@@ -1802,8 +2300,64 @@ clause_increase_activity(Tclause clause)
 
 /*--------------------------------------------------------------*/
 
+/**
+   \brief computes the glue of literals: the number of decision levels
+   they are assigned at
+   \param n the number of literals
+   \param lit the literals, all assigned */
+static unsigned
+lits_glue(SAT_Tsolver * S, unsigned n, Tlit * lit)
+{
+  unsigned i, glue = 0;
+  if (glue_stamp_size <= SAT_level)
+    {
+      unsigned size_old = glue_stamp_size;
+      STACK_RESIZE_EXP(glue_stamp, SAT_level + 1, glue_stamp_size,
+		       sizeof(unsigned));
+      memset(glue_stamp + size_old, 0,
+	     (glue_stamp_size - size_old) * sizeof(unsigned));
+    }
+  if (++glue_stamp_n == 0)
+    {
+      memset(glue_stamp, 0, glue_stamp_size * sizeof(unsigned));
+      glue_stamp_n = 1;
+    }
+  for (i = 0; i < n; i++)
+    {
+      Tlevel level = SAT_lit_level_r(S, lit[i]);
+      if (glue_stamp[level] != glue_stamp_n)
+	{
+	  glue_stamp[level] = glue_stamp_n;
+	  glue++;
+	}
+    }
+  return glue;
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief notes that a clause is used in conflict analysis: a learnt
+   clause is kept by the next purge if in tier 2, and its glue is
+   updated if lower
+   \param clause the clause, with all literals assigned */
+static inline void
+clause_used(SAT_Tsolver * S, Tclause clause)
+{
+  TSclause * PSclause = stack_clause + clause;
+  unsigned glue;
+  if (!PSclause->learnt || PSclause->glue <= GLUE_CORE)
+    return;
+  PSclause->used = 1;
+  glue = lits_glue(S, PSclause->n, CLAUSE_LIT(PSclause));
+  if (glue < PSclause->glue)
+    PSclause->glue = glue;
+}
+
+/*--------------------------------------------------------------*/
+
 static inline void
-clause_learnts_push(Tclause clause)
+clause_learnts_push(SAT_Tsolver * S, Tclause clause)
 {
   learnts_n++;
   STACK_RESIZE_EXP(learnts, learnts_n, learnts_size, sizeof(Tclause));
@@ -1813,51 +2367,47 @@ clause_learnts_push(Tclause clause)
 /*--------------------------------------------------------------*/
 
 static inline int
-clause_propagating(Tclause clause)
+clause_propagating(SAT_Tsolver * S, Tclause clause)
 {
-  return SAT_lit_value(stack_clause[clause].lit[0]) == VAL_TRUE &&
-    SAT_lit_reason(stack_clause[clause].lit[0]) == clause;
+  return SAT_lit_value_r(S, CLAUSE_LIT(stack_clause + clause)[0]) == VAL_TRUE &&
+    SAT_lit_reason(S, CLAUSE_LIT(stack_clause + clause)[0]) == clause;
 }
 
 /*--------------------------------------------------------------*/
 
 /**
-   \brief remove all deleted clauses from watch lists */
+   \brief remove all deleted clauses from watch lists, and compact their
+   literals if worthwhile */
 static inline void
-batch_rm_clauses_1(void)
+batch_rm_clauses_1(SAT_Tsolver * S)
 {
   unsigned i;
   for (i = 2; i <= (SAT_stack_var_n << 1) + 1; i++)
     if (watch[i].n)
       {
-	Tclause *j, *k ,*n;
-	j = k = watch[i].Pclause;
+	TSwatcher *j, *k ,*n;
+	j = k = watch[i].Pwatcher;
 	n = j + watch[i].n;
 	for (; j != n; j++)
-	  if (!stack_clause[*j].deleted && stack_clause[*j].watched)
+	  if (!stack_clause[j->clause].deleted &&
+	      stack_clause[j->clause].watched)
 	    *(k++) = *j;
 	watch[i].n -= (unsigned) (j - k);
       }
+  clause_lit_gc(S);
 }
 
 /*--------------------------------------------------------------*/
 
-/* lowest activity will be at the end */
+/* highest glue will be at the end, then lowest activity */
 static int
 cmp_clause(Tclause * clause1, Tclause * clause2)
 {
-  /*  if (stack_clause[*clause1].n <= 2)
-    {
-      if (stack_clause[*clause2].n > 2)
-	return -1;
-      return 0;
-    }
-  if (stack_clause[*clause2].n <= 2)
-  return 1; */
+  SAT_Tsolver * S = cmp_solver;
+  if (stack_clause[*clause1].glue != stack_clause[*clause2].glue)
+    return stack_clause[*clause1].glue > stack_clause[*clause2].glue ? 1 : -1;
   if (stack_clause[*clause1].activity < stack_clause[*clause2].activity)
     return 1;
-  /*  if (stack_clause[*clause1].activity == stack_clause[*clause2].activity)
-      return 0; */
   return -1;
 }
 
@@ -1868,7 +2418,7 @@ cmp_clause(Tclause * clause1, Tclause * clause2)
    \author Pascal Fontaine
    \brief remove false literals from clauses, and true clauses */
 static inline void 
-purge_valid(void)
+purge_valid(SAT_Tsolver * S)
 {
 #ifdef SIMP
   TSclause * i, *n;
@@ -1881,43 +2431,51 @@ purge_valid(void)
     {
       Tlit * k, *l, *m;
       if (i->deleted || !i->watched ||
-	  (SAT_lit_value(i->lit[0]) == VAL_TRUE &&
-	   stack_clause + SAT_lit_reason(i->lit[0]) == i))
+	  (SAT_lit_value_r(S, CLAUSE_LIT(i)[0]) == VAL_TRUE &&
+	   SAT_lit_reason(S, CLAUSE_LIT(i)[0]) == (Tclause) (i - stack_clause)))
 	continue;
       if (i->learnt)
 	{
-	  k = l = i->lit;
-	  m = i->lit + i->n;
+	  k = l = CLAUSE_LIT(i);
+	  m = CLAUSE_LIT(i) + i->n;
 	  for (; k != m; k++)
-	    if (SAT_lit_value_undef(*k))
+	    if (SAT_lit_value_undef(S, *k))
 	      *(l++) = *k;
-	    else if (SAT_lit_value_is_true(*k))
+	    else if (SAT_lit_value_is_true(S, *k))
 	      {
-		clause_lazy_delete((unsigned)(i - stack_clause));
+		clause_lazy_delete(S, (unsigned)(i - stack_clause));
 		goto super_continue;
 	      }
 	  i->n -= (unsigned) (k - l);
+	  stack_clause_lit_waste += (unsigned) (k - l);
+#if defined(BCLAUSE) || defined(BCLAUSE_LIGHT)
+	  if (i->n == 2)
+	    {
+	      i->watched = 0;
+	      bclause_add(S, i - stack_clause, CLAUSE_LIT(i)[0], CLAUSE_LIT(i)[1]);
+	    }
+#endif
 	  continue;
 	}
       /* PF do not remove literals from non-learnt clause
 	 (for backtracking) */
 #ifdef BACKTRACK
-      k = i->lit;
-      m = i->lit + i->n;
+      k = CLAUSE_LIT(i);
+      m = CLAUSE_LIT(i) + i->n;
       for (; k != m; k++)
-	if (SAT_lit_value_is_true(*k))
+	if (SAT_lit_value_is_true(S, *k))
 	  {
 	    i->watched = 0;
-	    history_clause_unset_watched(i - stack_clause);
+	    history_clause_unset_watched(S, i - stack_clause);
 	    break;
 	  }
 #else
-      k = l = i->lit;
-      m = i->lit + i->n;
+      k = l = CLAUSE_LIT(i);
+      m = CLAUSE_LIT(i) + i->n;
       for (; k != m; k++)
-	if (SAT_lit_value_undef(*k))
+	if (SAT_lit_value_undef(S, *k))
 	  *(l++) = *k;
-	else if (SAT_lit_value_is_true(*k))
+	else if (SAT_lit_value_is_true(S, *k))
 	  {
 	    i->watched = 0;
 	    goto super_continue;
@@ -1927,7 +2485,7 @@ purge_valid(void)
       if (i->n == 2)
 	{
 	  i->watched = 0;
-	  bclause_add(i - stack_clause, i->lit[0], i->lit[1]);
+	  bclause_add(S, i - stack_clause, CLAUSE_LIT(i)[0], CLAUSE_LIT(i)[1]);
 	}
 #endif
 #endif /* BACKTRACK */
@@ -1942,20 +2500,20 @@ purge_valid(void)
 	*(j++) = *i;
     learnts_n -= (unsigned) (n - j);
   }
-  batch_rm_clauses_1();
+  batch_rm_clauses_1(S);
 #endif /* SIMP */
 }
 
 /*--------------------------------------------------------------*/
 
+/**
+   \brief removes half of the learnt clauses that are not kept anyway
+   \remark binary clauses, core clauses, and tier 2 clauses used since
+   the last purge are kept.  Other clauses are sorted by glue, then
+   activity, and the worse half is removed, except reasons */
 static inline void 
-purge(void)
+purge(SAT_Tsolver * S)
 {
-  /* TODO could try to be a bit more agressive towards purging:
-     - sort binary clauses to the beginning,
-     - eliminate all clauses beyond threshold
-     - remove a portion of the rest */
-  double threshold = clause_inc / learnts_n;
   Tclause * i, * j, *n;
 #if STATS_LEVEL >= 1
   stats_counter_inc(stat_n_purge);
@@ -1963,244 +2521,779 @@ purge(void)
 #if STATS_LEVEL >= 4
   fprintf(stderr, "Starting purge\n");
 #endif
-  veriT_qsort(learnts, learnts_n, sizeof(Tclause), (TFcmp) cmp_clause);
-  /*  n = learnts + learnts_n / 2;
-  for (i = learnts; i != n; i++)
-  fprintf(stderr, "%f\n", stack_clause[*i].activity); */
-
+  /* kept clauses are moved to the beginning */
   i = j = learnts;
-  n = learnts + learnts_n / 2;
-  for (; i != n; i++)
-    if (stack_clause[*i].activity < threshold && stack_clause[*i].n > 2 &&
-	!clause_propagating(*i))
-      clause_lazy_delete(*i);
-    else
-      *(j++) = *i;
-  assert (i == learnts + learnts_n / 2);
   n = learnts + learnts_n;
   for (; i != n; i++)
-    if (stack_clause[*i].n > 2 && !clause_propagating(*i))
-      clause_lazy_delete(*i);
+    {
+      TSclause * PSclause = stack_clause + *i;
+      if (PSclause->n <= 2 || PSclause->glue <= GLUE_CORE ||
+	  (PSclause->glue <= GLUE_TIER2 && PSclause->used))
+	{
+	  Tclause tmp = *j;
+	  *(j++) = *i;
+	  *i = tmp;
+	}
+      PSclause->used = 0;
+    }
+  learnts_kept = (unsigned) (j - learnts);
+  cmp_solver = S;
+  veriT_qsort(j, (size_t) (n - j), sizeof(Tclause), (TFcmp) cmp_clause);
+  i = j = j + (n - j) / 2;
+  for (; i != n; i++)
+    if (!clause_propagating(S, *i))
+      clause_lazy_delete(S, *i);
     else
       *(j++) = *i;
 #if STATS_LEVEL >= 4
   fprintf(stderr, "%d learnt, %ld eliminated\n", learnts_n, n-j);
 #endif
   learnts_n -= (unsigned) (n - j);
-  batch_rm_clauses_1();
+  batch_rm_clauses_1(S);
 }
 
-/*
-  TODO
-  Eliminate satisfied clauses
-*/
-
 /*
   --------------------------------------------------------------
-  Purging
+  Preprocessing
   --------------------------------------------------------------
 */
 
-#if 0
-/*
-  Light purging maintains the database free of clauses
-  that are subsumed by unit or binary clauses
-  and ensures clauses cannot be strengthened by unit resolution
-  or by resolution with one binary clause.
-  To this end, it maintains the full list of clauses indexed by literals. */
-
-typedef struct TSvar_ext
-{
-  unsigned occur_n[2];
-  unsigned occur_size[2];
-  Tclause * occur[2];
-} TSvar_ext;
-  
-TSvar_ext * SAT_stack_var_ext = NULL;    /**< array of vars extended info */
-unsigned    SAT_stack_var_ext_size = 0;  /**< alloc size of prev. array */
+/**
+   \brief set of clauses containing a literal */
+typedef struct Tclause_list {
+  unsigned n;
+  unsigned size;
+  Tclause * Pclause;
+} Tclause_list;
 
 /*--------------------------------------------------------------*/
 
 /**
-   \author Pascal Fontaine
-   \brief add extended information for all variables */
+   \brief adds a clause to a set of clauses
+   \param Plist the set
+   \param clause the clause */
 static inline void
-SAT_var_ext_expand(void)
+clause_list_add(Tclause_list * Plist, Tclause clause)
 {
-  unsigned i = SAT_stack_var_ext_size;
-  STACK_RESIZE_EXP(SAT_stack_var_ext, SAT_stack_var_n + 1,
-		   SAT_stack_var_ext_size, sizeof(TSvar_ext));
-  for (; i < SAT_stack_var_ext_size; i++)
+  if (Plist->n == Plist->size)
     {
-      SAT_stack_var_ext[i].occur_n[VAL_FALSE] = 0;
-      SAT_stack_var_ext[i].occur_n[VAL_TRUE] = 0;
-      SAT_stack_var_ext[i].occur_size[VAL_FALSE] = 0;
-      SAT_stack_var_ext[i].occur_size[VAL_TRUE] = 0;
-      SAT_stack_var_ext[i].occur[VAL_FALSE] = NULL;
-      SAT_stack_var_ext[i].occur[VAL_TRUE] = NULL;
+      Plist->size += !Plist->size;
+      Plist->size <<= 1;
+      MY_REALLOC(Plist->Pclause, (Plist->size * sizeof(Tclause)));
     }
+  Plist->Pclause[Plist->n++] = clause;
 }
 
+#ifdef ELIM
+
+/*
+  Before the first propagation, input clauses are simplified using
+  occurrence lists: clauses subsumed by others are deleted, clauses
+  are strengthened by self-subsuming resolution, and variables are
+  eliminated by resolution (bounded variable elimination) as long as
+  the number of clauses does not increase.  Watch lists are rebuilt
+  afterwards.
+
+  The clauses of eliminated variables are saved in elim_stack, to
+  extend models to these variables (elim_extend), or to put them back
+  if a clause on an eliminated variable is added later (elim_restore).
+  For each eliminated variable, elim_stack contains its clauses, each
+  as its literals (the one on the variable first) followed by their
+  number, then the positive literal of the variable, then the number
+  of clauses.  It is read from the end.
+
+  Clauses deleted during preprocessing are only marked, and released
+  at the end, so that their ids are not reused while they may still
+  appear in occurrence lists.  Occurrence lists are not updated when a
+  clause is strengthened, so they may contain clauses without the
+  literal. */
+
+/**
+   \brief state of preprocessing */
+typedef struct Telim
+{
+  Tclause_list * occur;     /**< clauses by literal */
+  Tclause_list queue;       /**< clauses to subsume others with */
+  Tclause_list deleted;     /**< clauses deleted, released at the end */
+  unsigned char * mark;     /**< by literal, set for a clause */
+  unsigned sig_size;
+  unsigned * sig;           /**< by clause, a bit per variable modulo 32
+			       (strengthened clauses keep more bits) */
+  unsigned char * touched;  /**< by variable, set if in touched_var */
+  unsigned touched_n;
+  unsigned touched_size;
+  Tvar * touched_var;       /**< candidates for elimination */
+  unsigned res_n;
+  unsigned res_size;
+  Tlit * res;               /**< resolvents, each as its number of
+			       literals followed by the literals */
+  unsigned propagated;      /**< root literals already simplified with */
+  long effort;              /**< literal visits left */
+} Telim;
+
 /*--------------------------------------------------------------*/
 
 /**
-   \author Pascal Fontaine
-   \brief free extended information variables
+   \brief makes a variable a candidate for elimination
+   \param E the preprocessing state
    \param var the variable */
 static inline void
-SAT_var_ext_free(Tvar var)
+elim_touch(Telim * E, Tvar var)
 {
-  free(SAT_stack_var_ext[var].occur[VAL_FALSE]);
-  free(SAT_stack_var_ext[var].occur[VAL_TRUE]);
-  SAT_stack_var_ext[var].occur_n[VAL_FALSE] = 0;
-  SAT_stack_var_ext[var].occur_n[VAL_TRUE] = 0;
-  SAT_stack_var_ext[var].occur_size[VAL_FALSE] = 0;
-  SAT_stack_var_ext[var].occur_size[VAL_TRUE] = 0;
+  if (E->touched[var])
+    return;
+  E->touched[var] = 1;
+  STACK_RESIZE_EXP(E->touched_var, E->touched_n + 1, E->touched_size,
+		   sizeof(Tvar));
+  E->touched_var[E->touched_n++] = var;
 }
 
 /*--------------------------------------------------------------*/
 
 /**
-   \author Pascal Fontaine
-   \brief adds a clause to the watched clauses of variable, with given polarity
-   \param var the variable id
+   \brief check if a clause contains a literal
    \param clause the clause
-   \param pol the polarity */
-static inline void
-var_ext_occur(Tvar var, Tclause clause, unsigned pol)
+   \param lit the literal */
+static inline bool
+elim_clause_has(SAT_Tsolver * S, Tclause clause, Tlit lit)
 {
-  TSvar_ext * Pvar = &SAT_stack_var_ext[var];
-  Pvar->occur_n[pol]++;
-  STACK_RESIZE_LIN(Pvar->occur[pol], Pvar->occur_n[pol],
-		   Pvar->occur_size[pol], sizeof(Tclause));
-  Pvar->occur[pol][Pvar->occur_n[pol] - 1] = clause;
+  TSclause * PSclause = stack_clause + clause;
+  Tlit * Plit = CLAUSE_LIT(PSclause), * n = Plit + PSclause->n;
+  for (; Plit != n; Plit++)
+    if (*Plit == lit)
+      return true;
+  return false;
 }
 
 /*--------------------------------------------------------------*/
 
-Tclause * light_purge_clauses = NULL;     /**< array of small clauses */
-unsigned  light_purge_clauses_n = 0;      /**< number of small clauses */
-unsigned  light_purge_clauses_size = 0;   /**< alloc size of prev. array */
-
-static inline void
-light_purge_push(Tclause clause)
+/**
+   \brief computes the signature of a clause, a bit per variable
+   modulo 32
+   \param clause the clause */
+static inline unsigned
+elim_sig(SAT_Tsolver * S, Tclause clause)
 {
-  light_purge_clauses_n++;
-  STACK_RESIZE_EXP(light_purge_clauses, light_purge_clauses_n,
-		   light_purge_clauses_size, sizeof(Tclause));
-  light_purge_clauses[light_purge_clauses_n - 1] = clause;
+  TSclause * PSclause = stack_clause + clause;
+  Tlit * Plit = CLAUSE_LIT(PSclause);
+  unsigned i, sig = 0;
+  for (i = 0; i < PSclause->n; i++)
+    sig |= 1u << (SAT_lit_var(Plit[i]) & 31);
+  return sig;
 }
 
 /*--------------------------------------------------------------*/
 
-/** \brief add clauses to internal datastructure,
-    compute strengthened clauses, delete subsumed,
-    remove deleted clauses from datastructure */
-static inline void
-light_purge_check(void)
+/**
+   \brief deletes a clause, until the end of preprocessing
+   \param E the preprocessing state
+   \param clause the clause */
+static void
+elim_clause_delete(SAT_Tsolver * S, Telim * E, Tclause clause)
 {
-  unsigned i, j;
-  TSclause * PSclause;
-  assert(SAT_level == ROOT_LEVEL);
-  SAT_var_ext_expand();
-  /* Add all clauses */
-  for (i = 0; i < light_purge_clauses_n; i++)
-    {
-      PSclause = stack_clause + light_purge_clauses[i];
-      for (j = 0; j < PSclause->n; j++)
-	var_ext_occur(SAT_lit_var(PSclause->lit[j]), light_purge_clauses[i],
-		      SAT_lit_pol(PSclause->lit[j]));
-    }
-  /* First check unit clauses */
-  for (i = 0; i < light_purge_clauses_n; i++)
-    if ((stack_clause + light_purge_clauses[i])->n == 1)
-      {
-	Tlit lit = (stack_clause + light_purge_clauses[i])->lit[0];
-	TSvar_ext * Pvar  = &SAT_stack_var_ext[SAT_lit_var(lit)];
-	unsigned pol = SAT_lit_pol(lit);
-	/* Eliminate subsumed */
-	for (j = 0; j < Pvar->occur_n[pol]; j++)
-	  if (Pvar->occur[pol][j] != light_purge_clauses[i])
-	    clause_lazy_delete(Pvar->occur[pol][j]);
-#if 0
-	/* Strengthen */
-	for (j = 0; j < Pvar->occur_n[!pol]; j++)
-	  if (!(PSclause = stack_clause + Pvar->occur[pol][j])->deleted)
-	    {
-	      /* Resolve Pvar->occur[!pol][j] with light_purge_clauses[i] */
-	      unsigned k, n = PSclause->n;
-	      Tlit * Plit = NULL;
-	      Tclause clause;
-	      assert (n > 1); /* Complementary unit clauses should not occur */
-	      MY_MALLOC(Plit, (n - 1) * sizeof(Tlit));
-	      for (k = 0; k < n ; k++)
-		{
-		  Plit[k] = PSclause->lit[k];
-		  if (Plit[k] == SAT_lit_neg(lit))
-		    break;
-		}
-	      assert (k < n);
-	      for (k++; k < n; k++)
-		Plit[k - 1] = PSclause->lit[k];
-	      n--;
-	      clause = clause_new(n, Plit, 1, 1, 0);
-#ifdef PROOF
-	      if (SAT_proof)
-		{
-		  proof_begin(Pvar->occur[pol][j]);
-		  proof_resolve(lit, light_purge_clauses[i]);
-		  proof_end(clause);
-		}
-#endif
-	      clause_lazy_delete(Pvar->occur[pol][j]);
-	      /* Add the clause */
-	      light_purge_push(clause);
-	      for (k = 0; k < n; j++)
-		var_ext_occur(SAT_lit_var(Plit[j]), clause,
-			      SAT_lit_pol(Plit[j]));
-	    }
+  TSclause * PSclause = stack_clause + clause;
+  unsigned i;
+  PSclause->deleted = 1;
+  clause_list_add(&E->deleted, clause);
+  for (i = 0; i < PSclause->n; i++)
+    elim_touch(E, SAT_lit_var(CLAUSE_LIT(PSclause)[i]));
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief asserts the literal of a unit clause at root level
+   \param clause the clause
+   \remark the status becomes UNSAT if the literal is false */
+static void
+elim_unit(SAT_Tsolver * S, Tclause clause)
+{
+  Tlit lit = CLAUSE_LIT(stack_clause + clause)[0];
+  if (SAT_lit_value_undef(S, lit))
+    stack_lit_add(S, lit, clause);
+  else if (!SAT_lit_value_is_true(S, lit))
+    SAT_status = SAT_STATUS_UNSAT;
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief removes a literal from a clause
+   \param E the preprocessing state
+   \param clause the clause
+   \param lit the literal */
+static void
+elim_strengthen(SAT_Tsolver * S, Telim * E, Tclause clause, Tlit lit)
+{
+  TSclause * PSclause = stack_clause + clause;
+  Tlit * Plit = CLAUSE_LIT(PSclause);
+  unsigned i;
+  for (i = 0; Plit[i] != lit; i++) ;
+  for (PSclause->n--; i < PSclause->n; i++)
+    Plit[i] = Plit[i + 1];
+  stack_clause_lit_waste++;
+  elim_touch(E, SAT_lit_var(lit));
+  if (PSclause->n == 0)
+    SAT_status = SAT_STATUS_UNSAT;
+  else if (PSclause->n == 1)
+    elim_unit(S, clause);
+  else
+    clause_list_add(&E->queue, clause);
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief adds a clause derived by preprocessing
+   \param E the preprocessing state
+   \param n the number of literals
+   \param lit the literals, none of them false */
+static void
+elim_clause_add(SAT_Tsolver * S, Telim * E, unsigned n, Tlit * lit)
+{
+  unsigned i;
+  Tclause clause = clause_new(S, n, lit, 0, 0, 0);
+  if (n == 0)
+    {
+      SAT_status = SAT_STATUS_UNSAT;
+      return;
+    }
+  if (n == 1)
+    {
+      elim_unit(S, clause);
+      return;
+    }
+  STACK_RESIZE_EXP(E->sig, clause + 1, E->sig_size, sizeof(unsigned));
+  E->sig[clause] = elim_sig(S, clause);
+  for (i = 0; i < n; i++)
+    {
+      clause_list_add(E->occur + lit[i], clause);
+      elim_touch(E, SAT_lit_var(lit[i]));
+    }
+  clause_list_add(&E->queue, clause);
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief simplifies clauses with the new root literals
+   \param E the preprocessing state */
+static void
+elim_propagate(SAT_Tsolver * S, Telim * E)
+{
+  while (E->propagated < stack_lit_n && SAT_status != SAT_STATUS_UNSAT)
+    {
+      Tlit lit = stack_lit[E->propagated++];
+      Tclause_list * Plist = E->occur + lit;
+      unsigned i;
+      for (i = 0; i < Plist->n; i++)
+	{
+	  Tclause clause = Plist->Pclause[i];
+	  if (!stack_clause[clause].deleted && stack_clause[clause].n > 1 &&
+	      elim_clause_has(S, clause, lit))
+	    elim_clause_delete(S, E, clause);
+	}
+      Plist->n = 0;
+      lit = SAT_lit_neg(lit);
+      Plist = E->occur + lit;
+      for (i = 0; i < Plist->n && SAT_status != SAT_STATUS_UNSAT; i++)
+	{
+	  Tclause clause = Plist->Pclause[i];
+	  if (!stack_clause[clause].deleted && elim_clause_has(S, clause, lit))
+	    elim_strengthen(S, E, clause, lit);
+	}
+      Plist->n = 0;
+    }
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief deletes the clauses subsumed by a clause, and strengthens
+   the clauses it subsumes but for one literal, negated
+   \param E the preprocessing state
+   \param clause the clause
+   \remark candidates contain the literal of the clause with fewest
+   occurrences, or its negation */
+static void
+elim_subsume(SAT_Tsolver * S, Telim * E, Tclause clause)
+{
+  TSclause * PSclause = stack_clause + clause;
+  Tlit * Plit, best;
+  unsigned i, j, k, n, sig;
+  if (PSclause->deleted || PSclause->n < 2)
+    return;
+  n = PSclause->n;
+  sig = elim_sig(S, clause);
+  Plit = CLAUSE_LIT(PSclause);
+  best = Plit[0];
+  for (i = 1; i < n; i++)
+    if (E->occur[Plit[i]].n + E->occur[SAT_lit_neg(Plit[i])].n <
+	E->occur[best].n + E->occur[SAT_lit_neg(best)].n)
+      best = Plit[i];
+  if (E->occur[best].n + E->occur[SAT_lit_neg(best)].n > SUBSUME_OCC_MAX)
+    return;
+  for (i = 0; i < n; i++)
+    E->mark[Plit[i]] = 1;
+  for (k = 0; k < 2; k++)
+    {
+      Tclause_list * Plist = E->occur + (k ? SAT_lit_neg(best) : best);
+      for (i = 0; i < Plist->n; i++)
+	{
+	  Tclause other = Plist->Pclause[i];
+	  TSclause * PSother = stack_clause + other;
+	  Tlit * Plit2, pivot = LIT_UNDEF;
+	  unsigned hit = 0, neg = 0;
+	  if (other == clause || (sig & ~E->sig[other]) ||
+	      PSother->deleted || PSother->n < n)
+	    continue;
+	  Plit2 = CLAUSE_LIT(PSother);
+	  E->effort -= PSother->n;
+	  for (j = 0; j < PSother->n; j++)
+	    if (E->mark[Plit2[j]])
+	      hit++;
+	    else if (E->mark[SAT_lit_neg(Plit2[j])])
+	      {
+		neg++;
+		pivot = Plit2[j];
+	      }
+	  if (hit == n)
+	    elim_clause_delete(S, E, other);
+	  else if (hit + 1 == n && neg == 1)
+	    elim_strengthen(S, E, other, pivot);
+	}
+    }
+  for (i = 0; i < n; i++)
+    E->mark[Plit[i]] = 0;
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief removes the clauses deleted or strengthened from the
+   occurrence list of a literal
+   \param E the preprocessing state
+   \param lit the literal */
+static void
+elim_occur_clean(SAT_Tsolver * S, Telim * E, Tlit lit)
+{
+  Tclause_list * Plist = E->occur + lit;
+  Tclause * i = Plist->Pclause, * j = i, * n = i + Plist->n;
+  for (; i != n; i++)
+    {
+      E->effort -= stack_clause[*i].n;
+      if (!stack_clause[*i].deleted && elim_clause_has(S, *i, lit))
+	*(j++) = *i;
+    }
+  Plist->n = (unsigned) (j - Plist->Pclause);
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief computes the resolvent of two clauses, and appends it to E->res
+   \param E the preprocessing state
+   \param clause1 the clause with the positive literal of var
+   \param clause2 the clause with the negative literal of var
+   \param var the variable
+   \return false if the resolvent is a tautology (then not appended) */
+static bool
+elim_resolve(SAT_Tsolver * S, Telim * E, Tclause clause1, Tclause clause2,
+	     Tvar var)
+{
+  TSclause * PSclause1 = stack_clause + clause1;
+  TSclause * PSclause2 = stack_clause + clause2;
+  Tlit * Plit1 = CLAUSE_LIT(PSclause1), * Plit2 = CLAUSE_LIT(PSclause2);
+  unsigned i, start = E->res_n++;
+  bool valid = false;
+  STACK_RESIZE_EXP(E->res, E->res_n + PSclause1->n + PSclause2->n,
+		   E->res_size, sizeof(Tlit));
+  E->effort -= PSclause1->n + PSclause2->n;
+  for (i = 0; i < PSclause1->n; i++)
+    if (SAT_lit_var(Plit1[i]) != var)
+      {
+	E->mark[Plit1[i]] = 1;
+	E->res[E->res_n++] = Plit1[i];
+      }
+  for (i = 0; i < PSclause2->n && !valid; i++)
+    if (SAT_lit_var(Plit2[i]) == var || E->mark[Plit2[i]])
+      continue;
+    else if (E->mark[SAT_lit_neg(Plit2[i])])
+      valid = true;
+    else
+      E->res[E->res_n++] = Plit2[i];
+  for (i = 0; i < PSclause1->n; i++)
+    E->mark[Plit1[i]] = 0;
+  if (valid)
+    {
+      E->res_n = start;
+      return false;
+    }
+  E->res[start] = E->res_n - start - 1;
+  return true;
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief saves a clause of an eliminated variable in elim_stack
+   \param clause the clause
+   \param var the variable */
+static void
+elim_stack_push(SAT_Tsolver * S, Tclause clause, Tvar var)
+{
+  TSclause * PSclause = stack_clause + clause;
+  Tlit * Plit = CLAUSE_LIT(PSclause);
+  unsigned i, n = PSclause->n;
+  STACK_RESIZE_EXP(elim_stack, elim_stack_n + n + 1, elim_stack_size,
+		   sizeof(Tlit));
+  for (i = 0; SAT_lit_var(Plit[i]) != var; i++) ;
+  elim_stack[elim_stack_n++] = Plit[i];
+  for (i = 0; i < n; i++)
+    if (SAT_lit_var(Plit[i]) != var)
+      elim_stack[elim_stack_n++] = Plit[i];
+  elim_stack[elim_stack_n++] = n;
+  elim_clause_n++;
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief eliminates a variable, if this does not increase the number
+   of clauses
+   \param E the preprocessing state
+   \param var the variable
+   \remark variables with symmetries are not eliminated, since units may
+   be deduced for them
+   \remark variables of cardinality constraints are not eliminated
+   either, their occurrences there being unknown to resolution */
+static void
+elim_var(SAT_Tsolver * S, Telim * E, Tvar var)
+{
+  Tclause_list * pos = E->occur + SAT_lit(var, 1);
+  Tclause_list * neg = E->occur + SAT_lit(var, 0);
+  unsigned i, j, count = 0;
+  if (!SAT_var_decision(S, var) || !SAT_lit_value_undef(S, SAT_lit(var, 1)))
+    return;
+  if (SAT_stack_var[var].card)
+    return;
+#ifdef SAT_SYM
+  if (SAT_var_orbit[var] != VAR_UNDEF)
+    return;
 #endif
+  elim_occur_clean(S, E, SAT_lit(var, 1));
+  elim_occur_clean(S, E, SAT_lit(var, 0));
+  if (pos->n + neg->n > ELIM_OCC_MAX && pos->n && neg->n)
+    return;
+  E->res_n = 0;
+  for (i = 0; i < pos->n; i++)
+    for (j = 0; j < neg->n; j++)
+      {
+	unsigned start = E->res_n;
+	if (!elim_resolve(S, E, pos->Pclause[i], neg->Pclause[j], var))
+	  continue;
+	if (++count > pos->n + neg->n || E->res[start] > ELIM_CLAUSE_MAX ||
+	    E->effort <= 0)
+	  return;
       }
-  light_purge_clauses_n = 0;
-  /* TODO make sure OK when removing clauses because we delete
-     original clauses here */
+  for (i = 0; i < pos->n; i++)
+    {
+      elim_stack_push(S, pos->Pclause[i], var);
+      elim_clause_delete(S, E, pos->Pclause[i]);
+    }
+  for (i = 0; i < neg->n; i++)
+    {
+      elim_stack_push(S, neg->Pclause[i], var);
+      elim_clause_delete(S, E, neg->Pclause[i]);
+    }
+  STACK_RESIZE_EXP(elim_stack, elim_stack_n + 2, elim_stack_size,
+		   sizeof(Tlit));
+  elim_stack[elim_stack_n++] = SAT_lit(var, 1);
+  elim_stack[elim_stack_n++] = pos->n + neg->n;
+  SAT_stack_var[var].eliminated = 1;
+  pos->n = neg->n = 0;
+  for (i = 0; i < E->res_n && SAT_status != SAT_STATUS_UNSAT;
+       i += E->res[i] + 1)
+    elim_clause_add(S, E, E->res[i], E->res + i + 1);
 }
 
 /*--------------------------------------------------------------*/
 
-/** \brief remove all deleted clauses */
-static inline void
-light_purge_clean(void)
+/**
+   \brief subsumes with all clauses queued, and simplifies with the new
+   root literals
+   \param E the preprocessing state */
+static void
+elim_simplify(SAT_Tsolver * S, Telim * E)
 {
-  
+  elim_propagate(S, E);
+  while (E->queue.n && E->effort > 0 && SAT_status != SAT_STATUS_UNSAT)
+    {
+      elim_subsume(S, E, E->queue.Pclause[--E->queue.n]);
+      elim_propagate(S, E);
+    }
 }
 
 /*--------------------------------------------------------------*/
 
-/** \brief remove all deleted clauses from occurence lists */
-static inline
-batch_rm_clauses_2(void)
+/**
+   \brief tries to eliminate the touched variables, fewest occurrences
+   first, until none is touched
+   \param E the preprocessing state */
+static void
+elim_vars(SAT_Tsolver * S, Telim * E)
 {
-  unsigned i, j;
-  TSvar_ext * PSvar = SAT_stack_var_ext + 1;
-  for (i = 1; i <= SAT_stack_var_n; ++PSvar, ++i)
+  unsigned i, n, count[ELIM_OCC_MAX + 3];
+  unsigned * cost = NULL;
+  Tvar * var = NULL;
+  while (E->touched_n && E->effort > 0 && SAT_status != SAT_STATUS_UNSAT)
     {
-      Tclause * occur1, * occur2;
-      assert(PSvar == SAT_stack_var_ext + i);
-      occur1 = occur2 = PSvar->occur[VAL_FALSE];
-      for (j = PSvar->occur_n[VAL_FALSE]; j-- > 0; ++occur1)
-	if (!stack_clause[*occur1].deleted)
-	  *(occur2++) = *occur1;
-      PSvar->occur_n[VAL_FALSE] = (unsigned) (occur2 - PSvar->occur[VAL_FALSE]);
-      occur1 = occur2 = PSvar->occur[VAL_TRUE];
-      for (j = PSvar->occur_n[VAL_TRUE]; j-- > 0; ++occur1)
-	if (!stack_clause[*occur1].deleted)
-	  *(occur2++) = *occur1;
-      PSvar->occur_n[VAL_TRUE] = (unsigned) (occur2 - PSvar->occur[VAL_TRUE]);
+      /* sort by number of occurrences, pure variables first */
+      n = E->touched_n;
+      MY_MALLOC(var, n * sizeof(Tvar));
+      MY_MALLOC(cost, n * sizeof(unsigned));
+      memset(count, 0, sizeof(count));
+      for (i = 0; i < n; i++)
+	{
+	  Tvar v = E->touched_var[i];
+	  unsigned pos = E->occur[SAT_lit(v, 1)].n;
+	  unsigned neg = E->occur[SAT_lit(v, 0)].n;
+	  E->touched[v] = 0;
+	  cost[i] = (pos && neg) ? pos + neg : 0;
+	  if (cost[i] > ELIM_OCC_MAX)
+	    cost[i] = ELIM_OCC_MAX + 1;
+	  count[cost[i] + 1]++;
+	}
+      for (i = 1; i < ELIM_OCC_MAX + 3; i++)
+	count[i] += count[i - 1];
+      for (i = 0; i < n; i++)
+	var[count[cost[i]]++] = E->touched_var[i];
+      free(cost);
+      E->touched_n = 0;
+      for (i = 0; i < n && E->effort > 0 &&
+	     SAT_status != SAT_STATUS_UNSAT; i++)
+	{
+	  elim_var(S, E, var[i]);
+	  elim_simplify(S, E);
+	}
+      free(var);
     }
 }
 
+/*--------------------------------------------------------------*/
+
+/**
+   \brief puts back the clauses of preprocessing in watch lists,
+   releases deleted clauses and those learnt on eliminated variables
+   \param E the preprocessing state */
+static void
+elim_attach(SAT_Tsolver * S, Telim * E)
+{
+  Tclause clause;
+  Tlit lit;
+  unsigned i;
+  for (lit = 2; lit < (SAT_stack_var_n + 1) << 1; lit++)
+    watch[lit].n = 0;
+#ifdef BCLAUSE_LIGHT
+  bclause_clear(S);
+#endif
+  for (i = 0; i < E->deleted.n; i++)
+    {
+      stack_clause[E->deleted.Pclause[i]].deleted = 0;
+      clause_lazy_delete(S, E->deleted.Pclause[i]);
+    }
+  for (clause = 1; clause <= stack_clause_n; clause++)
+    {
+      TSclause * PSclause = stack_clause + clause;
+      Tlit * Plit = CLAUSE_LIT(PSclause);
+      bool assigned = false;
+      if (PSclause->deleted)
+	continue;
+      for (i = 0; i < PSclause->n; i++)
+	if (SAT_stack_var[SAT_lit_var(Plit[i])].eliminated)
+	  {
+	    assert(PSclause->learnt);
+	    clause_lazy_delete(S, clause);
+	    break;
+	  }
+	else if (!SAT_lit_value_undef(S, Plit[i]))
+	  assigned = true;
+      if (PSclause->deleted)
+	continue;
+      /* clauses with root literals are reasons, left as they are,
+	 except units obtained by strengthening */
+#ifdef BCLAUSE_LIGHT
+      if (!assigned)
+	PSclause->watched = PSclause->n >= 3;
+      if (PSclause->n == 2)
+	bclause_add(S, clause, Plit[0], Plit[1]);
+#else
+      if (!assigned)
+	PSclause->watched = PSclause->n >= 2;
 #endif
+      if (PSclause->n < 2)
+	PSclause->watched = 0;
+      if (PSclause->watched)
+	{
+	  lit_watch(S, Plit[0], clause, Plit[1]);
+	  lit_watch(S, Plit[1], clause, Plit[0]);
+	}
+    }
+  {
+    Tclause * i, * j, * n;
+    i = j = learnts;
+    n = learnts + learnts_n;
+    for (; i != n; i++)
+      if (!stack_clause[*i].deleted)
+	*(j++) = *i;
+    learnts_n -= (unsigned) (n - j);
+  }
+  clause_lit_gc(S);
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief simplifies input clauses by subsumption, strengthening, and
+   variable elimination
+   \pre level is root level, and propagation is complete
+   \remark the status becomes UNSAT if the empty clause is derived */
+static void
+preprocess(SAT_Tsolver * S)
+{
+  Telim E;
+  Tclause clause;
+  Tvar var;
+  unsigned i, j, lit_n = (SAT_stack_var_n + 1) << 1;
+  assert(SAT_level == ROOT_LEVEL && stack_lit_to_propagate == stack_lit_n);
+  memset(&E, 0, sizeof(Telim));
+  MY_MALLOC(E.occur, lit_n * sizeof(Tclause_list));
+  memset(E.occur, 0, lit_n * sizeof(Tclause_list));
+  MY_MALLOC(E.mark, lit_n);
+  memset(E.mark, 0, lit_n);
+  MY_MALLOC(E.touched, SAT_stack_var_n + 1);
+  memset(E.touched, 0, SAT_stack_var_n + 1);
+  E.sig_size = stack_clause_n + 1;
+  MY_MALLOC(E.sig, E.sig_size * sizeof(unsigned));
+  E.propagated = stack_lit_n;
+  E.effort = (long) ELIM_EFFORT * stack_clause_lit_n + (1l << 20);
+  /* satisfied clauses are deleted, false literals removed */
+  for (clause = 1; clause <= stack_clause_n; clause++)
+    {
+      TSclause * PSclause = stack_clause + clause;
+      Tlit * Plit = CLAUSE_LIT(PSclause);
+      bool reason = false, valid = false;
+      if (PSclause->deleted || PSclause->learnt || !PSclause->n)
+	continue;
+      for (i = 0; i < PSclause->n; i++)
+	if (SAT_lit_value_is_true(S, Plit[i]))
+	  {
+	    valid = true;
+	    reason |= SAT_lit_reason(S, Plit[i]) == clause;
+	  }
+      if (reason)
+	continue;
+      if (valid)
+	{
+	  elim_clause_delete(S, &E, clause);
+	  continue;
+	}
+      for (i = j = 0; i < PSclause->n; i++)
+	if (SAT_lit_value_undef(S, Plit[i]))
+	  Plit[j++] = Plit[i];
+      stack_clause_lit_waste += PSclause->n - j;
+      PSclause->n = j;
+      assert(j >= 2);
+      E.sig[clause] = elim_sig(S, clause);
+      for (i = 0; i < j; i++)
+	clause_list_add(E.occur + Plit[i], clause);
+      clause_list_add(&E.queue, clause);
+    }
+  for (var = 1; var <= SAT_stack_var_n; var++)
+    elim_touch(&E, var);
+  elim_simplify(S, &E);
+  elim_vars(S, &E);
+  elim_attach(S, &E);
+  for (i = 0; i < lit_n; i++)
+    free(E.occur[i].Pclause);
+  free(E.occur);
+  free(E.queue.Pclause);
+  free(E.deleted.Pclause);
+  free(E.mark);
+  free(E.touched);
+  free(E.sig);
+  free(E.touched_var);
+  free(E.res);
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief assigns the eliminated variables, so that the model also
+   satisfies their clauses
+   \pre all other variables that may be decided are assigned
+   \remark each value is a decision, at a new level */
+static void
+elim_extend(SAT_Tsolver * S)
+{
+  unsigned i = elim_stack_n;
+  while (i)
+    {
+      unsigned k = elim_stack[--i];
+      Tlit lit = SAT_lit_neg(elim_stack[--i]);
+      for (; k; k--)
+	{
+	  unsigned n = elim_stack[--i], j;
+	  i -= n;
+	  if (!SAT_lit_pol(elim_stack[i]) || SAT_lit_pol(lit))
+	    continue;
+	  /* a clause with the positive literal is not satisfied otherwise */
+	  for (j = 1; j < n && SAT_lit_value_r(S, elim_stack[i + j]) == VAL_FALSE;
+	       j++) ;
+	  if (j == n)
+	    lit = elim_stack[i];
+	}
+      if (SAT_lit_value_undef(S, lit))
+	level_push(S, lit);
+    }
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief puts back the clauses of eliminated variables
+   \remark this is done before adding a clause on an eliminated variable */
+static void
+elim_restore(SAT_Tsolver * S)
+{
+  Tlit * stack = elim_stack;
+  unsigned i = elim_stack_n;
+  level_backtrack(S, ROOT_LEVEL);
+  /* the model is undone, even if no clause is put back */
+  if (SAT_status == SAT_STATUS_SAT)
+    SAT_status = SAT_STATUS_UNDEF;
+  elim_stack = NULL;
+  elim_stack_n = elim_stack_size = elim_clause_n = 0;
+  while (i)
+    {
+      unsigned k = stack[--i];
+      Tvar var = SAT_lit_var(stack[--i]);
+      SAT_stack_var[var].eliminated = 0;
+      var_order_insert(S, var);
+      for (; k; k--)
+	{
+	  unsigned n = stack[--i];
+	  Tlit * lit;
+	  i -= n;
+	  MY_MALLOC(lit, n * sizeof(Tlit));
+	  memcpy(lit, stack + i, n * sizeof(Tlit));
+	  SAT_clause_new_r(S, n, lit);
+	}
+    }
+  free(stack);
+}
+
+#endif /* ELIM */
 
 /*
   --------------------------------------------------------------
@@ -2209,27 +3302,18 @@ batch_rm_clauses_2(void)
 */
 #ifdef PROOF
 
-static unsigned proof_stack_size = 0;
 #ifdef INSIDE_VERIT
 void proof_SAT_learnt(SAT_Tclause clause);
 void proof_SAT_set_id(SAT_Tclause clause_id);
 #define proof_stack_n SAT_proof_stack_n
 #define proof_stack_lit SAT_proof_stack_lit
 #define proof_stack_clause SAT_proof_stack_clause
-unsigned proof_stack_n = 0;
-Tlit *   proof_stack_lit = NULL;
-Tclause * proof_stack_clause = NULL;
 #else
-static unsigned proof_stack_n = 0;
-static Tlit *   proof_stack_lit = NULL;
-static Tclause * proof_stack_clause = NULL;
+#define proof_stack_n (S->proof_stack_n)
+#define proof_stack_lit (S->proof_stack_lit)
+#define proof_stack_clause (S->proof_stack_clause)
 #endif /* INSIDE_VERIT */
 
-static unsigned proof_stack_size_2 = 0;
-static unsigned proof_stack_n_2 = 0;
-static Tlit *   proof_stack_lit_2 = NULL;
-static Tclause * proof_stack_clause_2= NULL;
-
 /* State machine for variables.  States: */
 #define STATE_INIT 0
 #define STATE_POSITIVE 1
@@ -2267,7 +3351,7 @@ static Tclause * proof_stack_clause_2= NULL;
 /*--------------------------------------------------------------*/
 
 static void
-proof_begin(Tclause clause)
+proof_begin(SAT_Tsolver * S, Tclause clause)
 {
   if (proof_stack_n != 0)
     {
@@ -2293,7 +3377,7 @@ proof_begin(Tclause clause)
 /*--------------------------------------------------------------*/
 
 static void
-proof_resolve(Tlit lit, Tclause clause)
+proof_resolve(SAT_Tsolver * S, Tlit lit, Tclause clause)
 {
   assert(proof_stack_size > 0);
   assert(clause != CLAUSE_LAZY);
@@ -2311,7 +3395,7 @@ proof_resolve(Tlit lit, Tclause clause)
 /*--------------------------------------------------------------*/
 
 static inline int
-proof_update_lit(Tlit lit)
+proof_update_lit(SAT_Tsolver * S, Tlit lit)
 {
   TSvar * PSvar = SAT_stack_var + SAT_lit_var(lit);
   switch (PSvar->misc)
@@ -2361,7 +3445,7 @@ proof_update_lit(Tlit lit)
 /*--------------------------------------------------------------*/
 
 static inline void
-proof_resolve_lit(Tlit lit)
+proof_resolve_lit(SAT_Tsolver * S, Tlit lit)
 {
   TSvar * PSvar = SAT_stack_var + SAT_lit_var(lit);
   switch (PSvar->misc)
@@ -2388,34 +3472,34 @@ proof_resolve_lit(Tlit lit)
 /*--------------------------------------------------------------*/
 
 static void
-proof_end(Tclause clause)
+proof_end(SAT_Tsolver * S, Tclause clause)
 {
   unsigned i, j, count = 0;
   TSclause * PSclause;
 #ifdef PROOF_PRINT
-  proof_print(clause);
+  proof_print(S, clause);
 #endif
   /* first traversal */
   for (i = 0; i + 1 < proof_stack_n; ++i)
     {
       PSclause = stack_clause + proof_stack_clause[i];
       for (j = 0; j < PSclause->n; j++)
-	count = (unsigned) ((int) count + proof_update_lit(PSclause->lit[j]));
-      proof_resolve_lit(proof_stack_lit[i]);
+	count = (unsigned) ((int) count + proof_update_lit(S, CLAUSE_LIT(PSclause)[j]));
+      proof_resolve_lit(S, proof_stack_lit[i]);
     }
   PSclause = stack_clause + proof_stack_clause[i];
   for (j = 0; j < PSclause->n; j++)
-    count = (unsigned) ((int) count + proof_update_lit(PSclause->lit[j]));
+    count = (unsigned) ((int) count + proof_update_lit(S, CLAUSE_LIT(PSclause)[j]));
   /* second traversal */
   PSclause = stack_clause + clause;
   if (PSclause->n != count)
     my_error("proof error\n");
   for (j = 0; j < PSclause->n; j++)
-    switch (SAT_stack_var[SAT_lit_var(PSclause->lit[j])].misc)
+    switch (SAT_stack_var[SAT_lit_var(CLAUSE_LIT(PSclause)[j])].misc)
       {
       case STATE_POSITIVE :
       case STATE_NEGATIVE :
-	SAT_stack_var[SAT_lit_var(PSclause->lit[j])].misc = 0;
+	SAT_stack_var[SAT_lit_var(CLAUSE_LIT(PSclause)[j])].misc = 0;
 	break;
       default :
 	my_error("proof error\n");
@@ -2424,18 +3508,18 @@ proof_end(Tclause clause)
     {
       PSclause = stack_clause + proof_stack_clause[i];
       for (j = 0; j < PSclause->n; j++)
-	switch (SAT_stack_var[SAT_lit_var(PSclause->lit[j])].misc)
+	switch (SAT_stack_var[SAT_lit_var(CLAUSE_LIT(PSclause)[j])].misc)
 	  {
 	  case STATE_INIT :
 	  case STATE_RESOLVED :
-	    SAT_stack_var[SAT_lit_var(PSclause->lit[j])].misc = 0;
+	    SAT_stack_var[SAT_lit_var(CLAUSE_LIT(PSclause)[j])].misc = 0;
 	    break;
 	  case STATE_POSITIVE :
 	  case STATE_NEGATIVE :
 	  case STATE_POSITIVE_RESOLVING :
 	  case STATE_NEGATIVE_RESOLVING :
 	  case STATE_FAILED :
-	    SAT_stack_var[SAT_lit_var(PSclause->lit[j])].misc = 0;
+	    SAT_stack_var[SAT_lit_var(CLAUSE_LIT(PSclause)[j])].misc = 0;
 	    my_error("proof error\n");
 	  }
     }
@@ -2458,24 +3542,24 @@ proof_end(Tclause clause)
 #ifdef PROOF_PRINT
 
 static void
-proof_print(Tclause clause)
+proof_print(SAT_Tsolver * S, Tclause clause)
 {
   unsigned i;
   for (i = 0; i + 1 < proof_stack_n; ++i)
     {
       printf("%u", proof_stack_clause[i]);
 #ifdef PROOF_PRINT_CLAUSES
-      printf(" ("); clause_print(proof_stack_clause[i]); printf(")");
+      printf(" ("); clause_print(S, proof_stack_clause[i]); printf(")");
 #endif
       printf(" [%d] ", SAT_lit_var(proof_stack_lit[i]));
     }
   printf("%u", proof_stack_clause[i]);
 #ifdef PROOF_PRINT_CLAUSES
-  printf(" ("); clause_print(proof_stack_clause[i]); printf(")");
+  printf(" ("); clause_print(S, proof_stack_clause[i]); printf(")");
 #endif
   printf(" --> %d", clause);
 #ifdef PROOF_PRINT_CLAUSES
-  printf(" ("); clause_print(clause); printf(")");
+  printf(" ("); clause_print(S, clause); printf(")");
 #endif
   printf("\n");
 }
@@ -2517,51 +3601,180 @@ luby(unsigned i)
 /*--------------------------------------------------------------*/
 
 static inline unsigned
-restart_suite(unsigned i)
+restart_suite(SAT_Tsolver * S, unsigned i)
 {
-  return luby(i) << RESTART_MIN_INTERVAL;
+  return luby(i) << S->state.params.restart_interval;
 }
 
 /*--------------------------------------------------------------*/
 
 /**
-   \author Pascal Fontaine
-   \brief get the next decision (1st part)
-   \return the literal that is decided
-   \remark this can be called any number of time, and will return the
-   same result again, unless decision_pop is called */
-static inline Tlit
-decision_get(void)
+   \brief updates the moving averages of glue with a learnt clause
+   \remark the first averages are plain means, so that they do not
+   depend on the initial value */
+static inline void
+glue_ema_update(SAT_Tsolver * S, unsigned glue)
 {
-  Tvar next;
-  if (heap_var_empty())
-    return LIT_UNDEF;
-#ifdef HINT_AS_DECISION
-  while (hint_p < hint_n)
-    {
-      Tlit lit = hints[hint_p++];
-      if (SAT_lit_value(lit) == VAL_UNDEF)
+  double alpha = 1.0 / (conflict_nb + 1);
+  glue_ema_fast += (glue - glue_ema_fast) *
+    (alpha > 1.0 / (1 << RESTART_EMA_FAST) ? alpha :
+     1.0 / (1 << RESTART_EMA_FAST));
+  glue_ema_slow += (glue - glue_ema_slow) *
+    (alpha > 1.0 / (1 << RESTART_EMA_SLOW) ? alpha :
+     1.0 / (1 << RESTART_EMA_SLOW));
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief tests if a restart is due, after a conflict
+   \remark a restart is due as well when the phase is over */
+static inline bool
+restart_due(SAT_Tsolver * S)
+{
+  if (conflict_nb >= restart_phase_nb &&
+      S->state.params.restart == SAT_RESTART_MIXED)
+    return true;
+  if (conflict_restart_n)
+    {
+      conflict_restart_n--;
+      return false;
+    }
+  return restart_stable ||
+    glue_ema_fast > RESTART_GLUE_MARGIN * glue_ema_slow;
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief sets up the next restart, switching phases if needed
+   \remark the policy is read every time, since params may change */
+static void
+restart_next(SAT_Tsolver * S)
+{
+  switch (S->state.params.restart)
+    {
+    case SAT_RESTART_LUBY:
+      restart_stable = true;
+      break;
+    case SAT_RESTART_GLUE:
+      restart_stable = false;
+      break;
+    default:
+      if (conflict_nb < restart_phase_nb)
+	break;
+      restart_stable = !restart_stable;
+      restart_phase_nb = conflict_nb + restart_phase_length;
+      if (!restart_stable)
+	restart_phase_length *= 2;
+    }
+  conflict_restart_n = restart_stable ?
+    restart_suite(S, restart_n++) : RESTART_GLUE_MIN;
+}
+
+/*--------------------------------------------------------------*/
+
+#ifdef REPHASE
+/**
+   \brief saves target and best phases from the trail, on a conflict
+   \remark only the levels below the conflict level are consistent */
+static inline void
+phases_update(SAT_Tsolver * S)
+{
+  unsigned i, n = stack_level[SAT_level - 1];
+  if (n <= target_trail_n)
+    return;
+  target_trail_n = n;
+  for (i = 0; i < n; i++)
+    SAT_stack_var[SAT_lit_var(stack_lit[i])].phase_target =
+      SAT_lit_pol(stack_lit[i]);
+  if (n <= best_trail_n)
+    return;
+  best_trail_n = n;
+  for (i = 0; i < n; i++)
+    SAT_stack_var[SAT_lit_var(stack_lit[i])].phase_best =
+      SAT_lit_pol(stack_lit[i]);
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief resets saved and target phases, in turn to initial, best,
+   inverted initial, best, random, and best phases
+   \remark in stable phases, local search then starts from them
+   \remark best phases are then recomputed from scratch */
+static void
+rephase(SAT_Tsolver * S)
+{
+  unsigned i, kind = rephase_n++ % 6;
+  for (i = 1; i <= SAT_stack_var_n; i++)
+    {
+      unsigned char phase;
+      switch (kind)
+	{
+	case 0: phase = phase_initial(S); break;
+	case 2: phase = phase_initial(S) ^ 1; break;
+	case 4: phase = (unsigned char) fastrand(S, 2); break;
+	default: phase = SAT_stack_var[i].phase_best;
+	}
+      SAT_stack_var[i].phase_cache = SAT_stack_var[i].phase_target = phase;
+    }
+#ifdef SLS
+  if (restart_stable)
+    local_search(S);
+#endif
+  target_trail_n = 0;
+  if (kind & 1)
+    best_trail_n = 0;
+  rephase_conflict_nb = conflict_nb + REPHASE_INTERVAL * rephase_n;
+}
+#endif /* REPHASE */
+
+/*--------------------------------------------------------------*/
+
+/**
+   \author Pascal Fontaine
+   \brief get the next decision (1st part)
+   \return the literal that is decided
+   \remark this can be called any number of time, and will return the
+   same result again, unless decision_pop is called */
+static inline Tlit
+decision_get(SAT_Tsolver * S)
+{
+  Tvar next;
+  if (heap_var_empty(S))
+    return LIT_UNDEF;
+#ifdef HINT_AS_DECISION
+  while (hint_p < hint_n)
+    {
+      Tlit lit = hints[hint_p++];
+      if (SAT_lit_value_r(S, lit) == VAL_UNDEF)
 	return lit;
     }
   hint_p = hint_n = 0;
 #endif
-#ifdef RANDOMIZE_DECISION
-  if (fastrand(RANDOMIZE_FREQ << 2) < 4)
+  if (S->state.params.random_freq &&
+      fastrand(S, S->state.params.random_freq << 2) < 4)
     {
-      next = heap_var[fastrand(heap_var_n)];
-      if (SAT_var_value(next) == VAL_UNDEF && SAT_var_decision(next))
-	return SAT_lit(next, fastrand(2));
+      next = heap_var[fastrand(S, heap_var_n)];
+      if (SAT_var_value_r(S, next) == VAL_UNDEF && SAT_var_decision(S, next))
+	return SAT_lit(next, fastrand(S, 2));
     }
-#endif
   /* IMPROVE here optionally randomize variables a bit */
   while (1)
     {
-      next = heap_var_get_min();
-      heap_var_remove_min();
-      if (SAT_var_value(next) == VAL_UNDEF && SAT_var_decision(next))
+      next = heap_var_get_min(S);
+      heap_var_remove_min(S);
+      if (SAT_var_value_r(S, next) == VAL_UNDEF && SAT_var_decision(S, next))
 	/* IMPROVE here optionally randomize polarity a bit */
-	return SAT_lit(next, SAT_var_phase_cache(next));
-      if (heap_var_empty())
+#ifdef REPHASE
+	return SAT_lit(next, (restart_stable ?
+			      SAT_stack_var[next].phase_target :
+			      SAT_var_phase_cache(S, next)));
+#else
+	return SAT_lit(next, SAT_var_phase_cache(S, next));
+#endif
+      if (heap_var_empty(S))
 	return LIT_UNDEF;
     }
   return LIT_UNDEF;
@@ -2588,8 +3801,6 @@ typedef struct Tbclause_lit
   Tprop * prop;       /**< consequences */
 } Tbclause_lit;
 
-Tbclause_lit * bclause_lit = NULL;
-
 /*--------------------------------------------------------------*/
 
 /**
@@ -2601,7 +3812,7 @@ Tbclause_lit * bclause_lit = NULL;
    \return unsatisfiable if this leads to an unsatisfiable set of
    binary clauses */
 static inline void
-bclause_add(Tclause clause, Tlit lit1, Tlit lit2)
+bclause_add(SAT_Tsolver * S, Tclause clause, Tlit lit1, Tlit lit2)
 {
   /* All literals implying not lit1 will imply more,
      consequence lists should be updated */
@@ -2622,6 +3833,56 @@ bclause_add(Tclause clause, Tlit lit1, Tlit lit2)
 
 /*--------------------------------------------------------------*/
 
+#ifdef BACKTRACK
+/**
+   \brief removes a binary clause from the consequences of a literal
+   \param lit the literal
+   \param clause the clause
+   \remark clauses are mostly removed in reverse order of addition, so
+   the search starts from the end */
+static inline void
+bclause_lit_remove(SAT_Tsolver * S, Tlit lit, Tclause clause)
+{
+  Tprop * i = bclause_lit[lit].prop + bclause_lit[lit].n;
+  Tprop * n = i;
+  while ((--i)->clause != clause)
+    assert(i != bclause_lit[lit].prop);
+  for (; i + 1 != n; i++)
+    *i = *(i + 1);
+  bclause_lit[lit].n--;
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief removes a binary clause
+   \param clause the clause
+   \param lit1 the first literal
+   \param lit2 the second literal */
+static inline void
+bclause_remove(SAT_Tsolver * S, Tclause clause, Tlit lit1, Tlit lit2)
+{
+  bclause_lit_remove(S, SAT_lit_neg(lit1), clause);
+  bclause_lit_remove(S, SAT_lit_neg(lit2), clause);
+}
+#endif
+
+/*--------------------------------------------------------------*/
+
+#ifdef ELIM
+/**
+   \brief empties the consequences of every literal */
+static void
+bclause_clear(SAT_Tsolver * S)
+{
+  Tlit lit;
+  for (lit = 2; lit < (SAT_stack_var_n + 1) << 1; lit++)
+    bclause_lit[lit].n = 0;
+}
+
+/*--------------------------------------------------------------*/
+#endif
+
 /**
    \author Pascal Fontaine
    \brief compute the consequences of a literal
@@ -2631,14 +3892,15 @@ bclause_add(Tclause clause, Tlit lit1, Tlit lit2)
    \post misc bit are reset to 0
    \post consequences of lit are computed */
 static inline Tclause
-bclause_propagate(void)
+bclause_propagate(SAT_Tsolver * S)
 {
-  unsigned i, j;
+  unsigned i;
   for (i = stack_lit_to_propagate; i < stack_lit_n; i++)
     {
       Tlit lit = stack_lit[i];
-      for (j = 0; j < bclause_lit[lit].n; j++)
-	switch (SAT_lit_value(bclause_lit[lit].prop[j].lit))
+      Tprop * j = bclause_lit[lit].prop, * n = j + bclause_lit[lit].n;
+      for (; j != n; j++)
+	switch (SAT_lit_value_r(S, j->lit))
 	  {
 	  case VAL_TRUE: continue;
 	  case VAL_FALSE:
@@ -2646,42 +3908,34 @@ bclause_propagate(void)
 	    /* Propagation at ROOT_LEVEL: compute explicit unit clause */
 	    if (SAT_level == ROOT_LEVEL && SAT_proof)
 	      {
-		Tclause clause = bclause_lit[lit].prop[j].clause;
-		proof_begin(clause);
-		proof_resolve(stack_clause[clause].lit[0],
-			      SAT_lit_reason(stack_clause[clause].lit[0]));
-		proof_resolve(stack_clause[clause].lit[1],
-			      SAT_lit_reason(stack_clause[clause].lit[1]));
-		clause = clause_new(0, NULL, 0, 0, 0);
-		proof_end(clause);
+		Tclause clause = j->clause;
+		Tlit * Plit = CLAUSE_LIT(stack_clause + clause);
+		proof_begin(S, clause);
+		proof_resolve(S, Plit[0], SAT_lit_reason(S, Plit[0]));
+		proof_resolve(S, Plit[1], SAT_lit_reason(S, Plit[1]));
+		clause = clause_new(S, 0, NULL, 0, 0, 0);
+		proof_end(S, clause);
 		return clause;
 	      }
 #endif
-	    return bclause_lit[lit].prop[j].clause;
+	    return j->clause;
 	  default:
 #ifdef PROOF
 	    /* Propagation at ROOT_LEVEL: compute explicit unit clause */
 	    if (SAT_level == ROOT_LEVEL && SAT_proof)
 	      {
-		Tclause clause = bclause_lit[lit].prop[j].clause;
-		Tlit * Plit;
-		proof_begin(clause);
-		if (stack_clause[clause].lit[0] == bclause_lit[lit].prop[j].lit)
-		  proof_resolve(stack_clause[clause].lit[1],
-				SAT_lit_reason(stack_clause[clause].lit[1]));
-		else
-		  proof_resolve(stack_clause[clause].lit[0],
-				SAT_lit_reason(stack_clause[clause].lit[0]));
-		MY_MALLOC(Plit, sizeof(Tlit));
-		Plit[0] = bclause_lit[lit].prop[j].lit;
-		clause = clause_new(1, Plit, 0, 0, 0);
-		stack_lit_add(bclause_lit[lit].prop[j].lit, clause);
-		proof_end(clause);
+		Tclause clause = j->clause;
+		Tlit * Plit = CLAUSE_LIT(stack_clause + clause);
+		Tlit other = (Plit[0] == j->lit) ? Plit[1] : Plit[0];
+		proof_begin(S, clause);
+		proof_resolve(S, other, SAT_lit_reason(S, other));
+		clause = clause_new(S, 1, &j->lit, 0, 0, 0);
+		stack_lit_add(S, j->lit, clause);
+		proof_end(S, clause);
 		continue;
 	      }
 #endif
-	    stack_lit_add(bclause_lit[lit].prop[j].lit,
-			  bclause_lit[lit].prop[j].clause);
+	    stack_lit_add(S, j->lit, j->clause);
 	  }
     }
   return CLAUSE_UNDEF;
@@ -2690,7 +3944,7 @@ bclause_propagate(void)
 /*--------------------------------------------------------------*/
 
 static void
-bclause_resize(unsigned size_old, unsigned size_new)
+bclause_resize(SAT_Tsolver * S, unsigned size_old, unsigned size_new)
 {
   unsigned i;
   MY_REALLOC(bclause_lit, size_new * sizeof(Tbclause_lit));
@@ -2731,8 +3985,6 @@ typedef struct Tbclause_lit
   Tprop * prop;       /**< consequences */
 } Tbclause_lit;
 
-Tbclause_lit * bclause_lit = NULL;
-
 #ifdef CYCLE_DETECTION
 
 typedef struct Tcycle
@@ -2741,10 +3993,6 @@ typedef struct Tcycle
   Tlit start;
 } Tcycle;
 
-Tcycle * cycle = NULL;
-unsigned cycle_size = 0;
-unsigned cycle_n = 0;
-
 #endif
 
 /*--------------------------------------------------------------*/
@@ -2761,7 +4009,7 @@ unsigned cycle_n = 0;
     If l0 is a consequence of l1, then -l0 is a parent of -l1
   and  l1 will be added to consequences of -l2 */
 static inline void
-bclause_invalidate_parents(Tlit lit)
+bclause_invalidate_parents(SAT_Tsolver * S, Tlit lit)
 {
   unsigned i, j;
 #if defined(DEBUG_SAT) && DEBUG_LEVEL > 1
@@ -2809,12 +4057,12 @@ bclause_invalidate_parents(Tlit lit)
 #ifdef CYCLE_DETECTION
 
 static void
-bclause_cycle(Tlit lit1, Tlit lit2)
+bclause_cycle(SAT_Tsolver * S, Tlit lit1, Tlit lit2)
 {
-  cylce_n++;
-  STACK_RESIZE_EXP(cycle, cycle_n, cycle_size, sizeof(Tcycle));
-  cycle[cycle_n - 1].reach = lit1;
-  cycle[cycle_n - 1].start = lit2;
+  cycle_n++;
+  STACK_RESIZE_EXP(cycles, cycle_n, cycle_size, sizeof(Tcycle));
+  cycles[cycle_n - 1].reach = lit1;
+  cycles[cycle_n - 1].start = lit2;
 }
 
 #endif
@@ -2830,15 +4078,15 @@ bclause_cycle(Tlit lit1, Tlit lit2)
    \return unsatisfiable if this leads to an unsatisfiable set of
    binary clauses */
 static inline void
-bclause_add(Tclause clause, Tlit lit1, Tlit lit2)
+bclause_add(SAT_Tsolver * S, Tclause clause, Tlit lit1, Tlit lit2)
 {
   /* All literals implying not lit1 will imply more,
      consequence lists should be updated */
   /* printf("bclause_add %d %d (%d)\n", lit1, lit2, clause); */
   lit1 = SAT_lit_neg(lit1);
   lit2 = SAT_lit_neg(lit2);
-  bclause_invalidate_parents(lit1);
-  bclause_invalidate_parents(lit2);
+  bclause_invalidate_parents(S, lit1);
+  bclause_invalidate_parents(S, lit2);
   bclause_lit[lit1].n++;
   STACK_RESIZE_EXP(bclause_lit[lit1].prop, bclause_lit[lit1].n,
 		   bclause_lit[lit1].size, sizeof(Tprop));
@@ -2857,7 +4105,7 @@ bclause_add(Tclause clause, Tlit lit1, Tlit lit2)
 /*--------------------------------------------------------------*/
 
 static inline void
-bclause_cycle_closure()
+bclause_cycle_closure(SAT_Tsolver * S)
 {
   unsigned i, j, k;
   Tlit lit = misc_stack[0];
@@ -2969,7 +4217,7 @@ bclause_cycle_closure()
    \post misc bit are reset to 0
    \post consequences of lit are computed */
 static inline void
-bclause_compute_closure(Tlit lit)
+bclause_compute_closure(SAT_Tsolver * S, Tlit lit)
 {
   unsigned i, j;
   assert(!bclause_lit[lit].updated);
@@ -3005,7 +4253,7 @@ bclause_compute_closure(Tlit lit)
 
 #if defined(DEBUG_SAT) && DEBUG_LEVEL > 1
 static void
-bclause_print(Tlit lit)
+bclause_print(SAT_Tsolver * S, Tlit lit)
 {
   unsigned i;
   printf("lit %d :", lit);
@@ -3020,7 +4268,7 @@ bclause_print(Tlit lit)
 /*--------------------------------------------------------------*/
 
 static void
-bclause_ext_print_aux(Tlit lit)
+bclause_ext_print_aux(SAT_Tsolver * S, Tlit lit)
 {
   unsigned i;
   if (bclause_lit[lit].misc2)
@@ -3039,29 +4287,29 @@ bclause_ext_print_aux(Tlit lit)
 	   stack_clause[bclause_lit[lit].prop[i].clause].lit[1]);
   printf("\n");
   for (i = 0; i < bclause_lit[lit].direct; i++)
-    bclause_ext_print_aux(bclause_lit[lit].prop[i].lit);
+    bclause_ext_print_aux(S, bclause_lit[lit].prop[i].lit);
 }
 
 /*--------------------------------------------------------------*/
 
 static void
-bclause_ext_print_clean(Tlit lit)
+bclause_ext_print_clean(SAT_Tsolver * S, Tlit lit)
 {
   unsigned i;
   if (!bclause_lit[lit].misc2)
     return;
   bclause_lit[lit].misc2 = 0;
   for (i = 0; i < bclause_lit[lit].direct; i++)
-    bclause_ext_print_clean(bclause_lit[lit].prop[i].lit);
+    bclause_ext_print_clean(S, bclause_lit[lit].prop[i].lit);
 }
 
 /*--------------------------------------------------------------*/
 
 static void
-bclause_ext_print(Tlit lit)
+bclause_ext_print(SAT_Tsolver * S, Tlit lit)
 {
-  bclause_ext_print_aux(lit);
-  bclause_ext_print_clean(lit);
+  bclause_ext_print_aux(S, lit);
+  bclause_ext_print_clean(S, lit);
 }
 
 #endif
@@ -3074,7 +4322,7 @@ bclause_ext_print(Tlit lit)
    \param lit the literal
    \pre misc bit should be set to 0 for all literals */
 static inline void
-bclause_closure(Tlit lit)
+bclause_closure(SAT_Tsolver * S, Tlit lit)
 {
   unsigned i;
   /* misc_stack will be used to contain the dfs stack */
@@ -3091,7 +4339,7 @@ bclause_closure(Tlit lit)
       if (bclause_lit[lit2].misc)
 	{
 	  /* all consequences have been examined */
-	  bclause_compute_closure(lit2);
+	  bclause_compute_closure(S, lit2);
 	  bclause_lit[lit2].misc = 0;
 	  misc_stack_n--;
 	  continue;
@@ -3149,7 +4397,7 @@ bclause_closure(Tlit lit)
  cycle:
   /* cycle found, alternative computation starts
      A bit severe but keep it simple.  Certainly better to do */
-  bclause_cycle_closure();
+  bclause_cycle_closure(S);
   return;	      
 }
 
@@ -3158,7 +4406,7 @@ bclause_closure(Tlit lit)
 #if 0
 
 static void
-bclause_cycle_repair(void)
+bclause_cycle_repair(SAT_Tsolver * S)
 {
   /* misc_stack contains a path from lit to lit */
   unsigned i, j, k;
@@ -3235,21 +4483,34 @@ bclause_cycle_repair(void)
 /*--------------------------------------------------------------*/
 
 static Tclause
-bclause_propagate(void)
+bclause_propagate(SAT_Tsolver * S)
 {
   unsigned i, j, n = stack_lit_n;
   for (i = stack_lit_to_propagate; i < n; i++)
     {
       Tlit lit = stack_lit[i];
+#ifdef CHRONO
+      Tlevel level = SAT_lit_level_r(S, lit);
+#endif
       if (bclause_lit[lit].n == 0)
 	continue;
       if (!bclause_lit[lit].updated)
-	bclause_closure(lit);
+	bclause_closure(S, lit);
       for (j = 0; j < bclause_lit[lit].n; j++)
 	{
-	  if (SAT_lit_value_undef(bclause_lit[lit].prop[j].lit))
-#ifndef PROOF
-	    stack_lit_add(bclause_lit[lit].prop[j].lit,
+	  if (SAT_lit_value_undef(S, bclause_lit[lit].prop[j].lit))
+#ifdef CHRONO
+	    {
+	      /* consequences of lit are implied at its level */
+	      if (level < SAT_level)
+		stack_lit_add_level(S, bclause_lit[lit].prop[j].lit,
+				    bclause_lit[lit].prop[j].clause, level);
+	      else
+		stack_lit_add(S, bclause_lit[lit].prop[j].lit,
+			      bclause_lit[lit].prop[j].clause);
+	    }
+#elif !defined(PROOF)
+	    stack_lit_add(S, bclause_lit[lit].prop[j].lit,
 			  bclause_lit[lit].prop[j].clause);
 #else
 	    {
@@ -3257,26 +4518,23 @@ bclause_propagate(void)
 	      if (SAT_proof && SAT_level == ROOT_LEVEL)
 		{
 		  Tclause clause = bclause_lit[lit].prop[j].clause;
-		  Tlit * Plit;
-		  proof_begin(clause);
-		  if (stack_clause[clause].lit[0] == bclause_lit[lit].prop[j].lit)
-		    proof_resolve(stack_clause[clause].lit[1],
-				  SAT_lit_reason(stack_clause[clause].lit[1]));
+		  proof_begin(S, clause);
+		  if (CLAUSE_LIT(stack_clause + clause)[0] == bclause_lit[lit].prop[j].lit)
+		    proof_resolve(S, CLAUSE_LIT(stack_clause + clause)[1],
+				  SAT_lit_reason(S, CLAUSE_LIT(stack_clause + clause)[1]));
 		  else
-		    proof_resolve(stack_clause[clause].lit[0],
-				  SAT_lit_reason(stack_clause[clause].lit[0]));
-		  MY_MALLOC(Plit, sizeof(Tlit));
-		  Plit[0] = bclause_lit[lit].prop[j].lit;
-		  clause = clause_new(1, Plit, 0, 0, 0);
-		  stack_lit_add(bclause_lit[lit].prop[j].lit, clause);
-		  proof_end(clause);
+		    proof_resolve(S, CLAUSE_LIT(stack_clause + clause)[0],
+				  SAT_lit_reason(S, CLAUSE_LIT(stack_clause + clause)[0]));
+		  clause = clause_new(S, 1, &bclause_lit[lit].prop[j].lit, 0, 0, 0);
+		  stack_lit_add(S, bclause_lit[lit].prop[j].lit, clause);
+		  proof_end(S, clause);
 		}
 	      else
-		stack_lit_add(bclause_lit[lit].prop[j].lit,
+		stack_lit_add(S, bclause_lit[lit].prop[j].lit,
 			      bclause_lit[lit].prop[j].clause);
 	    }
 #endif /* PROOF */
-	  else if (SAT_lit_value(bclause_lit[lit].prop[j].lit) == VAL_FALSE)
+	  else if (SAT_lit_value_r(S, bclause_lit[lit].prop[j].lit) == VAL_FALSE)
 #ifndef PROOF
 	    return bclause_lit[lit].prop[j].clause;
 #else
@@ -3285,13 +4543,13 @@ bclause_propagate(void)
 	      if (SAT_proof && SAT_level == ROOT_LEVEL)
 		{
 		  Tclause clause = bclause_lit[lit].prop[j].clause;
-		  proof_begin(clause);
-		  proof_resolve(stack_clause[clause].lit[0],
-				SAT_lit_reason(stack_clause[clause].lit[0]));
-		  proof_resolve(stack_clause[clause].lit[1],
-				SAT_lit_reason(stack_clause[clause].lit[1]));
-		  clause = clause_new(0, NULL, 0, 0, 0);
-		  proof_end(clause);
+		  proof_begin(S, clause);
+		  proof_resolve(S, CLAUSE_LIT(stack_clause + clause)[0],
+				SAT_lit_reason(S, CLAUSE_LIT(stack_clause + clause)[0]));
+		  proof_resolve(S, CLAUSE_LIT(stack_clause + clause)[1],
+				SAT_lit_reason(S, CLAUSE_LIT(stack_clause + clause)[1]));
+		  clause = clause_new(S, 0, NULL, 0, 0, 0);
+		  proof_end(S, clause);
 		  return clause;
 		}
 	      return bclause_lit[lit].prop[j].clause;
@@ -3302,10 +4560,10 @@ bclause_propagate(void)
 		 stack_clause[bclause_lit[lit].prop[j].clause].lit[0] ||
 		 bclause_lit[lit].prop[j].lit ==
 		 stack_clause[bclause_lit[lit].prop[j].clause].lit[1]);
-	  assert(SAT_lit_value(stack_clause[bclause_lit[lit].prop[j].clause].lit[0]) == VAL_TRUE ||
-		 SAT_lit_value(stack_clause[bclause_lit[lit].prop[j].clause].lit[1]) == VAL_TRUE);
-	  assert(SAT_lit_value(stack_clause[bclause_lit[lit].prop[j].clause].lit[0]) == VAL_FALSE ||
-		 SAT_lit_value(stack_clause[bclause_lit[lit].prop[j].clause].lit[1]) == VAL_FALSE);
+	  assert(SAT_lit_value_r(S, stack_clause[bclause_lit[lit].prop[j].clause].lit[0]) == VAL_TRUE ||
+		 SAT_lit_value_r(S, stack_clause[bclause_lit[lit].prop[j].clause].lit[1]) == VAL_TRUE);
+	  assert(SAT_lit_value_r(S, stack_clause[bclause_lit[lit].prop[j].clause].lit[0]) == VAL_FALSE ||
+		 SAT_lit_value_r(S, stack_clause[bclause_lit[lit].prop[j].clause].lit[1]) == VAL_FALSE);
 #endif
 	}
 #if defined(DEBUG_SAT) && DEBUG_LEVEL > 1
@@ -3313,7 +4571,7 @@ bclause_propagate(void)
 	{
 	  unsigned k;
 	  for (k = 0; k < bclause_lit[bclause_lit[lit].prop[j].lit].n; k++)
-	    assert(SAT_lit_value(bclause_lit[bclause_lit[lit].prop[j].lit].prop[k].lit) == VAL_TRUE);
+	    assert(SAT_lit_value_r(S, bclause_lit[bclause_lit[lit].prop[j].lit].prop[k].lit) == VAL_TRUE);
 	}
 #endif
     }
@@ -3323,7 +4581,7 @@ bclause_propagate(void)
 /*--------------------------------------------------------------*/
 
 static void
-bclause_resize(unsigned size_old, unsigned size_new)
+bclause_resize(SAT_Tsolver * S, unsigned size_old, unsigned size_new)
 {
   unsigned i;
   MY_REALLOC(bclause_lit, size_new * sizeof(Tbclause_lit));
@@ -3344,104 +4602,623 @@ bclause_resize(unsigned size_old, unsigned size_new)
 
 /*
   --------------------------------------------------------------
-  Propagation
+  Cardinality constraints
   --------------------------------------------------------------
 */
 
+/*
+  A cardinality constraint states that at most k of its literals are
+  true.  It is visited whenever one of its literals becomes true, and
+  its true literals are counted: more than k is a conflict, and k
+  makes the others false.  Those are propagated with reason
+  CLAUSE_CARD | c, and the clause explaining them, i.e. the literal
+  with the negations of the k true ones, is only built if conflict
+  analysis needs it.
+  A literal is propagated at the highest level of the true literals
+  of the constraint, so those do not change as long as it is assigned,
+  and the explanation can be built later from them.
+  A conflict is the learnt clause of the negations of k + 1 true
+  literals, of highest levels.
+  Variables of constraints are not eliminated by preprocessing.
+*/
+
 /**
-   \author Pascal Fontaine
-   \brief propagates all implications
-   \return conflicting clause if conflict, CLAUSE_UNDEF otherwise
-   \remark we choose here to return after the first conflict.
-   \remark literal stack is truncated after the first conflict. */
-__attribute__((noinline))
+   \brief container for cardinality constraint information */
+typedef struct TScard
+{
+  unsigned k;               /**< at most k literals are true, k > 0 */
+  unsigned n;               /**< number of literals, more than k */
+  unsigned offset;          /**< position of the literals in stack_card_lit */
+} TScard;
+
+#define CARD_LIT(Pcard) (stack_card_lit + (Pcard)->offset)
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief adds a constraint to those of a literal
+   \param lit the literal
+   \param c the constraint */
+static inline void
+card_watch_add(SAT_Tsolver * S, Tlit lit, unsigned c)
+{
+  Tcard_watch * Pwatch = card_watch + lit;
+  if (Pwatch->n == Pwatch->size)
+    {
+      Pwatch->size += !Pwatch->size;
+      Pwatch->size <<= 1;
+      MY_REALLOC(Pwatch->Pcard, (Pwatch->size * sizeof(unsigned)));
+    }
+  Pwatch->Pcard[Pwatch->n++] = c;
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief collects the negations of the true literals of a constraint
+   \param c the constraint
+   \return their number, they are in card_stack from position 1 */
+static unsigned
+card_true(SAT_Tsolver * S, unsigned c)
+{
+  TScard * Pcard = stack_card + c;
+  Tlit * lit = CARD_LIT(Pcard);
+  unsigned i, n = 1;
+  STACK_RESIZE_EXP(card_stack, Pcard->n + 1, card_stack_size, sizeof(Tlit));
+  for (i = 0; i < Pcard->n; i++)
+    if (SAT_lit_value_is_true(S, lit[i]))
+      card_stack[n++] = SAT_lit_neg(lit[i]);
+  return n - 1;
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief builds the clause explaining a literal propagated by a
+   constraint, and makes it its reason
+   \param lit the literal, true
+   \return the clause, learnt
+   \remark pointers to literals of clauses may be invalidated */
 static Tclause
-propagate(void)
+card_explain(SAT_Tsolver * S, Tlit lit)
 {
-#if defined(BCLAUSE) || defined(BCLAUSE_LIGHT)
-  unsigned stack_lit_to_bpropagate = stack_lit_to_propagate;
-#endif
-#ifdef BLACK_MAGIC
-  /* PF two following line are a piece of black magic for efficiency */
-  static long long int v, w;
-  v = 0; w = 0;
+  unsigned n = card_true(S, SAT_lit_reason(S, lit) & ~CLAUSE_CARD);
+  Tclause clause;
+  assert(n == stack_card[SAT_lit_reason(S, lit) & ~CLAUSE_CARD].k);
+  card_stack[0] = lit;
+  cmp_solver = S;
+  veriT_qsort(card_stack + 1, n, sizeof(Tlit), (TFcmp) SAT_lit_compare_level);
+  clause = clause_new(S, n + 1, card_stack, 1, 1, 0);
+  stack_clause[clause].glue = lits_glue(S, n + 1, card_stack);
+  SAT_var_set_reason(S, SAT_lit_var(lit), clause);
+  return clause;
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief the reason of a propagated literal, as a clause
+   \param lit the literal, true
+   \remark the explanation of a constraint is built if needed */
+static inline Tclause
+lit_reason_clause(SAT_Tsolver * S, Tlit lit)
+{
+  Tclause clause = SAT_lit_reason(S, lit);
+  return CLAUSE_IS_CARD(clause) ? card_explain(S, lit) : clause;
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief builds the conflict of a constraint with more than k true
+   literals
+   \param c the constraint
+   \return the clause, learnt */
+static Tclause
+card_conflict(SAT_Tsolver * S, unsigned c)
+{
+  unsigned n = card_true(S, c);
+  Tclause clause;
+  assert(n > stack_card[c].k);
+  cmp_solver = S;
+  veriT_qsort(card_stack + 1, n, sizeof(Tlit), (TFcmp) SAT_lit_compare_level);
+  n = stack_card[c].k + 1;
+  clause = clause_new(S, n, card_stack + 1, 1, 1, 0);
+  stack_clause[clause].glue = lits_glue(S, n, card_stack + 1);
+  return clause;
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief visits the constraints of a literal that became true
+   \param lit the literal
+   \return conflicting clause if conflict, CLAUSE_UNDEF otherwise */
+static Tclause
+card_propagate(SAT_Tsolver * S, Tlit lit)
+{
+  Tcard_watch * Pwatch = card_watch + lit;
+  unsigned i, j;
+  for (i = 0; i < Pwatch->n; i++)
+    {
+      unsigned c = Pwatch->Pcard[i], count = 0;
+      TScard * Pcard = stack_card + c;
+      Tlit * lits = CARD_LIT(Pcard);
+      bool undef = false;
+#ifdef CHRONO
+      Tlevel level = ROOT_LEVEL;
+#endif
+      for (j = 0; j < Pcard->n; j++)
+	if (SAT_lit_value_undef(S, lits[j]))
+	  undef = true;
+	else if (SAT_lit_value_is_true(S, lits[j]))
+	  {
+	    count++;
+#ifdef CHRONO
+	    if (level < SAT_lit_level_r(S, lits[j]))
+	      level = SAT_lit_level_r(S, lits[j]);
 #endif
-#if STATS_LEVEL >= 2
-  unsigned old_stack_lit_to_propagate = stack_lit_to_propagate;
-  stats_counter_inc(stat_prop_call);
-  if (stack_lit_to_propagate >= stack_lit_n)
-    stats_counter_inc(stat_prop_call_waste);
+	  }
+      if (count > Pcard->k)
+	return card_conflict(S, c);
+      if (count < Pcard->k || !undef)
+	continue;
+      for (j = 0; j < Pcard->n; j++)
+	if (SAT_lit_value_undef(S, lits[j]))
+	  {
+#ifdef CHRONO
+	    if (level > ROOT_LEVEL && level < SAT_level)
+	      stack_lit_add_level(S, SAT_lit_neg(lits[j]), CLAUSE_CARD | c,
+				  level);
+	    else
 #endif
-#if PROOF
-  if (SAT_proof && SAT_level == ROOT_LEVEL)
-    {
-      unsigned i;
-      for (i = SAT_literal_stack_to_propagate; i < stack_lit_n; i++)
-	if (SAT_lit_reason(stack_lit[i]) == CLAUSE_LAZY)
-	  hint_explain(stack_lit[i]);
+	      stack_lit_add(S, SAT_lit_neg(lits[j]), CLAUSE_CARD | c);
+	  }
     }
-#endif
-  while (stack_lit_to_propagate < stack_lit_n)
+  return CLAUSE_UNDEF;
+}
+
+/*--------------------------------------------------------------*/
+
+#ifdef BACKTRACK
+/**
+   \brief removes the constraints added last
+   \param card_n the number of constraints to keep */
+static void
+card_pop(SAT_Tsolver * S, unsigned card_n)
+{
+  while (stack_card_n > card_n)
     {
-      Tlit lit = stack_lit[stack_lit_to_propagate];
-      Tclause *i, *j, *n;
-#if STATS_LEVEL >= 2
-      stats_counter_inc(stat_n_prop);
-      if (!watch[lit].n)
-	stats_counter_inc(stat_prop_lit_call_nowatch);
-#endif
-#if defined(BCLAUSE) || defined(BCLAUSE_LIGHT)
-      if (stack_lit_to_propagate == stack_lit_to_bpropagate)
+      TScard * Pcard = stack_card + --stack_card_n;
+      unsigned i;
+      for (i = 0; i < Pcard->n; i++)
 	{
-	  Tclause clause = bclause_propagate();
-	  if (clause != CLAUSE_UNDEF) return clause;
-	  stack_lit_to_bpropagate = stack_lit_n;
+	  Tcard_watch * Pwatch = card_watch + CARD_LIT(Pcard)[i];
+	  assert(Pwatch->n && Pwatch->Pcard[Pwatch->n - 1] == stack_card_n);
+	  Pwatch->n--;
 	}
+      stack_card_lit_n = Pcard->offset;
+    }
+}
 #endif
-      stack_lit_to_propagate++;
-      lit = SAT_lit_neg(lit);
-      if (!watch[lit].n)
-	continue;
-      i = j = watch[lit].Pclause;
-      n = i + watch[lit].n;
-      for (; i != n; ++i)
-	{
-	  TSclause * PSclause = stack_clause + *i;
-	  Tlit * lits;
-	  unsigned k;
-	  if (SAT_lit_value_is_true(PSclause->blocker))
-	    {
-	      *(j++) = *i;
-	      continue;
-	    }
-	  lits = PSclause->lit;
-#if STATS_LEVEL >= 2
-	  stats_counter_inc(stat_n_watched);
-#endif
-	  /* PF put lit in position 1 */
-	  if (lits[0] == lit)
-	    {
-	      lits[0] = lits[1];
-	      lits[1] = lit;
-	    }
-	  /* PF satisfied clause ? */
-	  if (SAT_lit_value_is_true(lits[0]))
-	    {
-	      /* PF leaving the clause in the watch, but no need to find
-		 another watch since this literal will remain true */
-	      PSclause->blocker = lits[0];
-	      *(j++) = *i;
-	      continue;
-	    }
-	  /* PF look for a new watch */
-	  for (k = 2; k < PSclause->n; ++k)
-	    if (SAT_lit_value(lits[k]) != VAL_FALSE)
-	      {
-		lits[1] = lits[k];
-		lits[k] = lit;
-		lit_watch(lits[1], *i);
-		/* delete the clause from the watch list:
-		   j is not incremented */
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief copies the constraints of an instance into another
+   \param S2 the other instance, with the same variables */
+static void
+card_copy(SAT_Tsolver * S, SAT_Tsolver * S2)
+{
+  unsigned c;
+  for (c = 0; c < stack_card_n; c++)
+    SAT_card_new_r(S2, stack_card[c].n, CARD_LIT(stack_card + c),
+		   stack_card[c].k);
+}
+
+/*
+  --------------------------------------------------------------
+  Local search
+  --------------------------------------------------------------
+*/
+
+#ifdef SLS
+/*
+  Local search (ProbSAT) flips values of variables in a complete
+  assignment, starting from the saved phases, to satisfy the input
+  clauses and cardinality constraints.  A constraint is picked at
+  random among the unsatisfied ones, and one of its variables is
+  flipped, with a probability decreasing exponentially with its break
+  count, i.e. the number of constraints the flip makes unsatisfied.
+  The assignment with the fewest unsatisfied constraints then becomes
+  the saved and target phases: if it is a model, search follows it
+  without conflict.
+  Root values are kept, and constraints they satisfy are ignored, as
+  are learnt clauses and assumptions.  Constraints are numbered as
+  clauses, cardinality constraint c being stack_clause_n + 1 + c.
+*/
+
+/**
+   \brief state of a local search */
+typedef struct Tsls
+{
+  unsigned char * value;    /**< current values of variables, 0 or 1 */
+  Tclause_list * occur;     /**< input clauses by literal */
+  unsigned * true_n;        /**< number of true literals, by constraint */
+  unsigned * unsat;         /**< unsatisfied constraints */
+  unsigned unsat_n;
+  unsigned * unsat_pos;     /**< position in unsat, by constraint */
+  Tvar * flips;             /**< variables flipped since the best
+			       assignment */
+  unsigned flips_n;
+  unsigned flips_size;
+  Tvar * cand;              /**< variables of the constraint picked */
+  double * cand_weight;     /**< cumulated weights of cand */
+  double weight[SLS_BREAK_MAX + 1]; /**< weight of a variable, by break
+				       count */
+} Tsls;
+
+#define SLS_LIT_TRUE(P, lit) ((P)->value[SAT_lit_var(lit)] == SAT_lit_pol(lit))
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief pseudo-random number in [0, 1)
+   \remark the low bits of fastrand have short periods, which local
+   search would follow, so only the high ones are used */
+static inline double
+sls_rand(SAT_Tsolver * S)
+{
+  return fastrand(S, 1u << 31) / 2147483648.0;
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief tests if the value of a variable is kept by local search */
+static inline bool
+sls_fixed(SAT_Tsolver * S, Tvar var)
+{
+  return SAT_var_value_r(S, var) != VAL_UNDEF &&
+    SAT_stack_var[var].level == ROOT_LEVEL;
+}
+
+/*--------------------------------------------------------------*/
+
+static inline void
+sls_unsat_add(Tsls * P, unsigned c)
+{
+  P->unsat_pos[c] = P->unsat_n;
+  P->unsat[P->unsat_n++] = c;
+}
+
+/*--------------------------------------------------------------*/
+
+static inline void
+sls_unsat_remove(Tsls * P, unsigned c)
+{
+  unsigned last = P->unsat[--P->unsat_n];
+  P->unsat[P->unsat_pos[c]] = last;
+  P->unsat_pos[last] = P->unsat_pos[c];
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief counts the constraints that flipping a variable makes
+   unsatisfied
+   \param var the variable
+   \return the count, at most SLS_BREAK_MAX */
+static unsigned
+sls_break(SAT_Tsolver * S, Tsls * P, Tvar var)
+{
+  Tlit lit = SAT_lit(var, P->value[var]);
+  Tclause_list * Plist = P->occur + lit;
+  Tcard_watch * Pwatch = card_watch + SAT_lit_neg(lit);
+  unsigned i, n = 0;
+  for (i = 0; i < Plist->n && n < SLS_BREAK_MAX; i++)
+    n += P->true_n[Plist->Pclause[i]] == 1;
+  for (i = 0; i < Pwatch->n && n < SLS_BREAK_MAX; i++)
+    n += P->true_n[stack_clause_n + 1 + Pwatch->Pcard[i]] ==
+      stack_card[Pwatch->Pcard[i]].k;
+  return n;
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief flips the value of a variable, and updates the counts of true
+   literals and the unsatisfied constraints
+   \param var the variable */
+static void
+sls_flip(SAT_Tsolver * S, Tsls * P, Tvar var)
+{
+  Tlit lit = SAT_lit(var, P->value[var]);
+  Tclause_list * Plist = P->occur + lit;
+  Tcard_watch * Pwatch = card_watch + lit;
+  unsigned i;
+  P->value[var] ^= 1;
+  for (i = 0; i < Plist->n; i++)
+    if (--P->true_n[Plist->Pclause[i]] == 0)
+      sls_unsat_add(P, Plist->Pclause[i]);
+  for (i = 0; i < Pwatch->n; i++)
+    {
+      unsigned c = stack_clause_n + 1 + Pwatch->Pcard[i];
+      if (P->true_n[c]-- == stack_card[Pwatch->Pcard[i]].k + 1)
+	sls_unsat_remove(P, c);
+    }
+  lit = SAT_lit_neg(lit);
+  Plist = P->occur + lit;
+  Pwatch = card_watch + lit;
+  for (i = 0; i < Plist->n; i++)
+    if (P->true_n[Plist->Pclause[i]]++ == 0)
+      sls_unsat_remove(P, Plist->Pclause[i]);
+  for (i = 0; i < Pwatch->n; i++)
+    {
+      unsigned c = stack_clause_n + 1 + Pwatch->Pcard[i];
+      if (++P->true_n[c] == stack_card[Pwatch->Pcard[i]].k + 1)
+	sls_unsat_add(P, c);
+    }
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief picks the variable to flip in an unsatisfied constraint
+   \return the variable, VAR_UNDEF if none can be flipped
+   \remark the variables of a clause are all false, and those of a
+   cardinality constraint to flip are the true ones */
+static Tvar
+sls_pick(SAT_Tsolver * S, Tsls * P)
+{
+  unsigned c = P->unsat[(unsigned) (sls_rand(S) * P->unsat_n)];
+  unsigned i, n = 0, lit_n;
+  Tlit * lit;
+  double sum = 0, r;
+  bool card = c > stack_clause_n;
+  if (card)
+    {
+      TScard * Pcard = stack_card + (c - stack_clause_n - 1);
+      lit = CARD_LIT(Pcard);
+      lit_n = Pcard->n;
+    }
+  else
+    {
+      lit = CLAUSE_LIT(stack_clause + c);
+      lit_n = stack_clause[c].n;
+    }
+  for (i = 0; i < lit_n; i++)
+    {
+      Tvar var = SAT_lit_var(lit[i]);
+      if (sls_fixed(S, var) || (card && !SLS_LIT_TRUE(P, lit[i])))
+	continue;
+      sum += P->weight[sls_break(S, P, var)];
+      P->cand[n] = var;
+      P->cand_weight[n++] = sum;
+    }
+  if (!n)
+    return VAR_UNDEF;
+  r = sls_rand(S) * sum;
+  for (i = 0; i < n - 1 && P->cand_weight[i] <= r; i++) ;
+  return P->cand[i];
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief searches locally for a model from the saved phases, and
+   saves the best assignment found as saved and target phases
+   \remark the solver may be at any level, but root literals are
+   propagated */
+static void
+local_search(SAT_Tsolver * S)
+{
+  Tsls P;
+  Tclause clause;
+  Tvar var;
+  unsigned c, i, best_n, max_n = 1;
+  unsigned constraint_n = stack_clause_n + stack_card_n + 1;
+  unsigned long lit_n = 0, flips;
+  if (SAT_status == SAT_STATUS_UNSAT)
+    return;
+  memset(&P, 0, sizeof(Tsls));
+  MY_MALLOC(P.value, SAT_stack_var_n + 1);
+  MY_MALLOC(P.occur, 2 * (SAT_stack_var_n + 1) * sizeof(Tclause_list));
+  memset(P.occur, 0, 2 * (SAT_stack_var_n + 1) * sizeof(Tclause_list));
+  MY_MALLOC(P.true_n, constraint_n * sizeof(unsigned));
+  MY_MALLOC(P.unsat, constraint_n * sizeof(unsigned));
+  MY_MALLOC(P.unsat_pos, constraint_n * sizeof(unsigned));
+  P.weight[0] = 1;
+  for (i = 1; i <= SLS_BREAK_MAX; i++)
+    P.weight[i] = P.weight[i - 1] / SLS_BREAK_BASE;
+  for (var = 1; var <= SAT_stack_var_n; var++)
+    P.value[var] = sls_fixed(S, var) ?
+      SAT_var_value_r(S, var) : SAT_stack_var[var].phase_cache;
+  for (clause = 1; clause <= stack_clause_n; clause++)
+    {
+      TSclause * PSclause = stack_clause + clause;
+      Tlit * Plit = CLAUSE_LIT(PSclause);
+      /* ignored clauses are never unsatisfied */
+      P.true_n[clause] = 1;
+      if (PSclause->deleted || PSclause->learnt || !PSclause->n)
+	continue;
+      for (i = 0; i < PSclause->n; i++)
+	if (sls_fixed(S, SAT_lit_var(Plit[i])) && SLS_LIT_TRUE(&P, Plit[i]))
+	  break;
+      if (i < PSclause->n)
+	continue;
+      P.true_n[clause] = 0;
+      for (i = 0; i < PSclause->n; i++)
+	{
+	  P.true_n[clause] += SLS_LIT_TRUE(&P, Plit[i]);
+	  clause_list_add(P.occur + Plit[i], clause);
+	}
+      lit_n += PSclause->n;
+      if (max_n < PSclause->n)
+	max_n = PSclause->n;
+      if (!P.true_n[clause])
+	sls_unsat_add(&P, clause);
+    }
+  for (c = 0; c < stack_card_n; c++)
+    {
+      TScard * Pcard = stack_card + c;
+      P.true_n[stack_clause_n + 1 + c] = 0;
+      for (i = 0; i < Pcard->n; i++)
+	P.true_n[stack_clause_n + 1 + c] +=
+	  SLS_LIT_TRUE(&P, CARD_LIT(Pcard)[i]);
+      lit_n += Pcard->n;
+      if (max_n < Pcard->n)
+	max_n = Pcard->n;
+      if (P.true_n[stack_clause_n + 1 + c] > Pcard->k)
+	sls_unsat_add(&P, stack_clause_n + 1 + c);
+    }
+  MY_MALLOC(P.cand, max_n * sizeof(Tvar));
+  MY_MALLOC(P.cand_weight, max_n * sizeof(double));
+  best_n = P.unsat_n;
+  for (flips = SLS_EFFORT * lit_n; P.unsat_n && flips; flips--)
+    {
+      var = sls_pick(S, &P);
+      if (var == VAR_UNDEF)
+	continue;
+      sls_flip(S, &P, var);
+      STACK_RESIZE_EXP(P.flips, P.flips_n + 1, P.flips_size, sizeof(Tvar));
+      P.flips[P.flips_n++] = var;
+      if (P.unsat_n < best_n)
+	{
+	  best_n = P.unsat_n;
+	  P.flips_n = 0;
+	}
+    }
+  /* back to the best assignment */
+  while (P.flips_n)
+    P.value[P.flips[--P.flips_n]] ^= 1;
+  for (var = 1; var <= SAT_stack_var_n; var++)
+    if (!sls_fixed(S, var))
+      SAT_stack_var[var].phase_cache = SAT_stack_var[var].phase_target =
+	P.value[var];
+  for (i = 0; i < 2 * (SAT_stack_var_n + 1); i++)
+    free(P.occur[i].Pclause);
+  free(P.occur);
+  free(P.value);
+  free(P.true_n);
+  free(P.unsat);
+  free(P.unsat_pos);
+  free(P.flips);
+  free(P.cand);
+  free(P.cand_weight);
+}
+#endif /* SLS */
+
+/*
+  --------------------------------------------------------------
+  Propagation
+  --------------------------------------------------------------
+*/
+
+/**
+   \author Pascal Fontaine
+   \brief propagates all implications
+   \return conflicting clause if conflict, CLAUSE_UNDEF otherwise
+   \remark we choose here to return after the first conflict.
+   \remark literal stack is truncated after the first conflict. */
+__attribute__((noinline))
+static Tclause
+propagate(SAT_Tsolver * S)
+{
+#if defined(BCLAUSE) || defined(BCLAUSE_LIGHT)
+  unsigned stack_lit_to_bpropagate = stack_lit_to_propagate;
+#endif
+#ifdef BLACK_MAGIC
+  /* PF two following line are a piece of black magic for efficiency */
+  static long long int v, w;
+  v = 0; w = 0;
+#endif
+#if STATS_LEVEL >= 2
+  unsigned old_stack_lit_to_propagate = stack_lit_to_propagate;
+  stats_counter_inc(stat_prop_call);
+  if (stack_lit_to_propagate >= stack_lit_n)
+    stats_counter_inc(stat_prop_call_waste);
+#endif
+#if PROOF
+  if (SAT_proof && SAT_level == ROOT_LEVEL)
+    {
+      unsigned i;
+      for (i = SAT_literal_stack_to_propagate; i < stack_lit_n; i++)
+	if (SAT_lit_reason(S, stack_lit[i]) == CLAUSE_LAZY)
+	  hint_explain(stack_lit[i]);
+    }
+#endif
+  while (stack_lit_to_propagate < stack_lit_n)
+    {
+      Tlit lit = stack_lit[stack_lit_to_propagate];
+      TSwatcher *i, *j, *n;
+#ifdef CHRONO
+      Tlevel level = SAT_lit_level_r(S, lit);
+#endif
+#if STATS_LEVEL >= 2
+      stats_counter_inc(stat_n_prop);
+      if (!watch[lit].n)
+	stats_counter_inc(stat_prop_lit_call_nowatch);
+#endif
+#if defined(BCLAUSE) || defined(BCLAUSE_LIGHT)
+      if (stack_lit_to_propagate == stack_lit_to_bpropagate)
+	{
+	  Tclause clause = bclause_propagate(S);
+	  if (clause != CLAUSE_UNDEF) return clause;
+	  stack_lit_to_bpropagate = stack_lit_n;
+	}
+#endif
+      stack_lit_to_propagate++;
+      if (card_watch[lit].n)
+	{
+	  Tclause clause = card_propagate(S, lit);
+	  if (clause != CLAUSE_UNDEF) return clause;
+	}
+      lit = SAT_lit_neg(lit);
+      if (!watch[lit].n)
+	continue;
+      i = j = watch[lit].Pwatcher;
+      n = i + watch[lit].n;
+      for (; i != n; ++i)
+	{
+	  TSclause * PSclause;
+	  Tlit * lits;
+	  unsigned k;
+	  if (SAT_lit_value_is_true(S, i->blocker))
+	    {
+	      *(j++) = *i;
+	      continue;
+	    }
+	  PSclause = stack_clause + i->clause;
+	  lits = CLAUSE_LIT(PSclause);
+#if STATS_LEVEL >= 2
+	  stats_counter_inc(stat_n_watched);
+#endif
+	  /* PF put lit in position 1 */
+	  if (lits[0] == lit)
+	    {
+	      lits[0] = lits[1];
+	      lits[1] = lit;
+	    }
+	  /* PF satisfied clause ? */
+	  if (SAT_lit_value_is_true(S, lits[0]))
+	    {
+	      /* PF leaving the clause in the watch, but no need to find
+		 another watch since this literal will remain true */
+	      j->clause = i->clause;
+	      j->blocker = lits[0];
+	      j++;
+	      continue;
+	    }
+	  /* PF look for a new watch */
+	  for (k = 2; k < PSclause->n; ++k)
+	    if (SAT_lit_value_r(S, lits[k]) != VAL_FALSE)
+	      {
+		lits[1] = lits[k];
+		lits[k] = lit;
+		lit_watch(S, lits[1], i->clause, lits[0]);
+		/* delete the clause from the watch list:
+		   j is not incremented */
 		goto next_watch;
 	      }
 	  /* clause is either propagating or conflicting.
@@ -3454,21 +5231,22 @@ propagate(void)
 	      Tclause clause;
 	      assert(PSclause->n > 1);
 	      if (SAT_proof)
-		proof_begin(*i);
+		proof_begin(S, i->clause);
 	      for (k = 1; k < PSclause->n; k++)
 		{
-		  assert(SAT_lit_value(lits[k]) == VAL_FALSE);
+		  assert(SAT_lit_value_r(S, lits[k]) == VAL_FALSE);
 		  if (SAT_proof)
 		    {
-		      clause = SAT_lit_reason(lits[k]);
+		      clause = SAT_lit_reason(S, lits[k]);
 		      assert(clause != CLAUSE_LAZY);
-		      proof_resolve(lits[k], clause);
+		      proof_resolve(S, lits[k], clause);
 		    }
 		}
-	      if (SAT_lit_value(lits[0]) == VAL_FALSE)
+	      if (SAT_lit_value_r(S, lits[0]) == VAL_FALSE)
 		{
-		  Tclause clause = clause_new(0, NULL, 0, 0, 0);
-		  PSclause = stack_clause + *i;
+		  Tclause clause = clause_new(S, 0, NULL, 0, 0, 0);
+		  PSclause = stack_clause + i->clause;
+		  lits = CLAUSE_LIT(PSclause);
 		  /* conflicting clause */
 		  i++; /* remove from watch */
 		  for ( ; i != n; ++i, ++j)
@@ -3476,31 +5254,29 @@ propagate(void)
 		  watch[lit].n -= (unsigned)(i - j);
 		  if (SAT_proof)
 		    {
-		      Tclause clause2 = SAT_lit_reason(lits[0]);
+		      Tclause clause2 = SAT_lit_reason(S, lits[0]);
 		      assert(clause2 != CLAUSE_LAZY);
-		      proof_resolve(lits[0], clause2);
-		      proof_end(clause);
+		      proof_resolve(S, lits[0], clause2);
+		      proof_end(S, clause);
 		    }
 		  return clause;
 		}
 	      else
 		{
 		  Tclause clause;
-		  Tlit * Plit2;
-		  MY_MALLOC(Plit2, sizeof(Tlit));
-		  Plit2[0] = lits[0];
-		  clause = clause_new(1, Plit2, 0, 0, 0);
-		  stack_lit_add(lits[0], clause);
+		  Tlit lit0 = lits[0];
+		  clause = clause_new(S, 1, &lit0, 0, 0, 0);
+		  stack_lit_add(S, lit0, clause);
 		  if (SAT_proof)
-		    proof_end(clause);
+		    proof_end(S, clause);
 		  goto next_watch;
 		}
 	    }
 #endif /* PROOF */
-	  if (SAT_lit_value(lits[0]) == VAL_FALSE)
+	  if (SAT_lit_value_r(S, lits[0]) == VAL_FALSE)
 	    {
 	      /* conflicting clause */
-	      Tclause clause = *i;
+	      Tclause clause = i->clause;
 	      i++; /* remove from watch */
 	      /* First version
 	      for ( ; i != n; ++i, ++j)
@@ -3519,7 +5295,7 @@ propagate(void)
 	      watch[lit].n -= (unsigned) (i - j);
 #if defined(DEBUG_SAT) && DEBUG_LEVEL > 1
 	      for (k = 0; k < PSclause->n; ++k)
-		assert(SAT_lit_value(lits[k]) == VAL_FALSE);
+		assert(SAT_lit_value_r(S, lits[k]) == VAL_FALSE);
 #endif
 #if STATS_LEVEL >= 2
 	      if (old_stack_lit_to_propagate + 1 == stack_lit_n)
@@ -3528,7 +5304,19 @@ propagate(void)
 	      return clause;
 	    }
 	  /* propagating clause */
-	  stack_lit_add(lits[0], *i);
+#ifdef CHRONO
+	  if (level < SAT_level)
+	    {
+	      /* the other literals may all be of lower levels */
+	      Tlevel level2 = level;
+	      for (k = 2; k < PSclause->n; ++k)
+		if (SAT_lit_level_r(S, lits[k]) > level2)
+		  level2 = SAT_lit_level_r(S, lits[k]);
+	      stack_lit_add_level(S, lits[0], i->clause, level2);
+	    }
+	  else
+#endif
+	    stack_lit_add(S, lits[0], i->clause);
 	next_watch: ;
 	}
       watch[lit].n -= (unsigned) (i - j);
@@ -3555,73 +5343,72 @@ propagate(void)
 #endif
 
 static Tstatus
-bclause_generate(void)
+bclause_generate(SAT_Tsolver * S)
 {
   unsigned i, j, k, counter = 0;
   /* We assume root level propagation and subsumption by unit clauses */
   for (i = 2; i < 2 * (SAT_stack_var_n + 1); i++)
-    if (SAT_lit_value_undef(i))
+    if (SAT_lit_value_undef(S, i))
       {
 	unsigned stack_lit_n_old = stack_lit_n;
 	/* for each literal, propagate */
-	level_push(i);
-	if (propagate() != CLAUSE_UNDEF)
+	level_push(S, i);
+	if (propagate(S) != CLAUSE_UNDEF)
 	  { 
 	    Tclause clause;
-	    Tlit * Plit;
+	    Tlit lit = SAT_lit_neg(i);
 	    /* asserting i leads to unsat, -i should be asserted */
-	    level_backtrack(ROOT_LEVEL);
-	    MY_MALLOC(Plit, sizeof(Tlit));
-	    Plit[0] = SAT_lit_neg(i);
-	    clause = clause_new(1, Plit, 0, 0, 0);
-	    stack_lit_add(Plit[0], clause);
-	    if (propagate() != CLAUSE_UNDEF)
+	    level_backtrack(S, ROOT_LEVEL);
+	    clause = clause_new(S, 1, &lit, 0, 0, 0);
+	    stack_lit_add(S, lit, clause);
+	    if (propagate(S) != CLAUSE_UNDEF)
 	      return SAT_STATUS_UNSAT;
 	    continue;
 	  }
+	/* reasons are read as clauses below */
 	for (j = stack_lit_n_old + 1; j < stack_lit_n; j++)
-	  if (stack_clause[SAT_lit_reason(stack_lit[j])].n > 2)
+	  lit_reason_clause(S, stack_lit[j]);
+	for (j = stack_lit_n_old + 1; j < stack_lit_n; j++)
+	  if (stack_clause[SAT_lit_reason(S, stack_lit[j])].n > 2)
 	    {
 	      /* deduce a binary clause */
 	      /* there is a unique implication point whose consequences are
 		 all but literal j */
-	      Tclause clause = SAT_lit_reason(stack_lit[j]);
-	      Tlit * Plit;
-	      MY_MALLOC(Plit, 2 * sizeof(Tlit));
+	      Tclause clause = SAT_lit_reason(S, stack_lit[j]);
+	      Tlit Plit[2];
 	      Plit[0] = stack_lit[j];
-	      assert(stack_clause[clause].lit[0] == Plit[0]);
+	      assert(CLAUSE_LIT(stack_clause + clause)[0] == Plit[0]);
 	      counter = 0;
 	      for (k = 1; k < stack_clause[clause].n; k++)
-		if (!SAT_lit_seen(stack_clause[clause].lit[k]))
+		if (!SAT_lit_seen(S, CLAUSE_LIT(stack_clause + clause)[k]))
 		  {
 		    counter++;
-		    SAT_lit_set_seen(stack_clause[clause].lit[k]);
-		    Plit[1] = stack_clause[clause].lit[k];
+		    SAT_lit_set_seen(S, CLAUSE_LIT(stack_clause + clause)[k]);
+		    Plit[1] = CLAUSE_LIT(stack_clause + clause)[k];
 		  }
 	      for (; counter > 1; )
-		if (SAT_lit_seen(stack_lit[--j]))
+		if (SAT_lit_seen(S, stack_lit[--j]))
 		  {
-		    Tclause clause = SAT_lit_reason(stack_lit[j]);
+		    Tclause clause = SAT_lit_reason(S, stack_lit[j]);
+		    Tlit * Plit2 = CLAUSE_LIT(stack_clause + clause);
 		    counter--;
-		    SAT_lit_set_unseen(stack_lit[j]);
+		    SAT_lit_set_unseen(S, stack_lit[j]);
 		    assert(stack_clause[clause].n == 2);
-		    assert(stack_clause[clause].lit[0] == stack_lit[j] ||
-			   stack_clause[clause].lit[1] == stack_lit[j]);
-		    Plit[1] = stack_clause[clause].lit[(stack_clause[clause].lit[0] ==
-							stack_lit[j])?1:0];
-		    if (!SAT_lit_seen(Plit[1]))
+		    assert(Plit2[0] == stack_lit[j] || Plit2[1] == stack_lit[j]);
+		    Plit[1] = Plit2[(Plit2[0] == stack_lit[j])?1:0];
+		    if (!SAT_lit_seen(S, Plit[1]))
 		      {
 			counter++;
-			SAT_lit_set_seen(Plit[1]);
+			SAT_lit_set_seen(S, Plit[1]);
 			/* Here we could set a variable.
 			   If the variable is not set at the end,
 			   new bclause is subsuming original clause */
 		      }
 		  }
-	      assert(SAT_lit_seen(Plit[1]));
-	      SAT_lit_set_unseen(Plit[1]);
-	      level_backtrack(ROOT_LEVEL);
-	      clause_new(2, Plit, 0, 0, 0);
+	      assert(SAT_lit_seen(S, Plit[1]));
+	      SAT_lit_set_unseen(S, Plit[1]);
+	      level_backtrack(S, ROOT_LEVEL);
+	      clause_new(S, 2, Plit, 0, 0, 0);
 	      /* clause will anyway not be propagating at root level
 		 no need for a call to propagate */
 
@@ -3632,7 +5419,7 @@ bclause_generate(void)
 		 Maybe there are better ways, but OK for now */
 	      continue;
 	    }
-	level_backtrack(ROOT_LEVEL);
+	level_backtrack(S, ROOT_LEVEL);
       }
   return SAT_STATUS_SAT;
 }
@@ -3640,102 +5427,334 @@ bclause_generate(void)
 
 /*
   --------------------------------------------------------------
-  Analyse
+  Learnt clause exchange
   --------------------------------------------------------------
 */
 
-typedef unsigned Talevel;
+#ifdef SAT_THREADS
+
+/*
+  Instances solving the same problem (see SAT_solve_portfolio) share
+  short learnt clauses through a ring buffer.  Writers claim a position
+  with an atomic increment, and each slot is protected by a sequence
+  number (odd while written).  Readers copy a slot and check the
+  sequence number is unchanged, otherwise the clause is skipped.  The
+  buffer is lossy: slow readers lose clauses overwritten meanwhile,
+  and writers drop clauses if the slot is being written. */
+
+/**
+   \brief number of slots in the exchange buffer (power of two) */
+#define EXCHANGE_SIZE 4096
+/**
+   \brief only clauses with at most this number of literals are exported */
+#define EXCHANGE_LIT_MAX 8
+/**
+   \brief only clauses with at most this number of distinct levels
+   (glue) are exported */
+#define EXCHANGE_GLUE_MAX 4
+
+typedef struct Texchange_slot
+{
+  unsigned long seq;        /**< 2 * position + 2 once written */
+  unsigned source;          /**< id of the exporting instance */
+  unsigned n;               /**< number of literals */
+  Tlit lit[EXCHANGE_LIT_MAX];
+} Texchange_slot;
+
+typedef struct Texchange
+{
+  unsigned long head;       /**< next position to write */
+  Texchange_slot slot[EXCHANGE_SIZE];
+} Texchange;
 
 /*--------------------------------------------------------------*/
 
 /**
-   \author Pascal Fontaine
-   \brief repair clauses from conflicting state
-   \param clause the conflicting or propagating clause
-   \param level at which the clause is propagating
-   \remark this should work for empty clauses
-   \remark this should work for unit clauses
-   \remark this should work for propagating clauses
-   \remark this should work for clauses propagating at root level */
+   \brief exports a learnt clause, if it is short enough
+   \param n the number of literals
+   \param lit the literals
+   \pre all literals are false */
 static void
-repair_conflict(Tclause clause, Tlevel level)
+exchange_export(SAT_Tsolver * S, unsigned n, Tlit * lit)
 {
-  assert (stack_clause[clause].n != 0 || level == ROOT_LEVEL);
-  assert (stack_clause[clause].n != 1 || level == ROOT_LEVEL);
-  if (stack_clause[clause].n == 0)
+  Texchange * exchange = S->exchange;
+  Texchange_slot * slot;
+  unsigned long pos, seq;
+  unsigned i, j, glue = 0;
+  if (n > EXCHANGE_LIT_MAX)
+    return;
+  for (i = 0; i < n; i++)
     {
-      level_backtrack(level);
-      return;
+      for (j = 0; j < i; j++)
+	if (SAT_lit_level_r(S, lit[j]) == SAT_lit_level_r(S, lit[i]))
+	  break;
+      if (j == i)
+	glue++;
     }
-  if (stack_clause[clause].n == 1)
+  if (glue > EXCHANGE_GLUE_MAX)
+    return;
+  pos = __atomic_fetch_add(&exchange->head, 1, __ATOMIC_RELAXED);
+  slot = exchange->slot + (pos & (EXCHANGE_SIZE - 1));
+  seq = __atomic_load_n(&slot->seq, __ATOMIC_RELAXED);
+  if ((seq & 1) ||
+      !__atomic_compare_exchange_n(&slot->seq, &seq, 2 * pos + 1, false,
+				   __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    return;
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  __atomic_store_n(&slot->source, S->exchange_id, __ATOMIC_RELAXED);
+  __atomic_store_n(&slot->n, n, __ATOMIC_RELAXED);
+  for (i = 0; i < n; i++)
+    __atomic_store_n(slot->lit + i, lit[i], __ATOMIC_RELAXED);
+  __atomic_store_n(&slot->seq, 2 * pos + 2, __ATOMIC_RELEASE);
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief adds a clause learnt by another instance
+   \param n the number of literals
+   \param lit the literals (not confiscated)
+   \pre level is root level */
+static void
+clause_import(SAT_Tsolver * S, unsigned n, Tlit * lit)
+{
+  unsigned i, j;
+  Tclause clause;
+  for (i = 0, j = 0; i < n; i++)
+    if (SAT_lit_value_r(S, lit[i]) == VAL_TRUE)
+      return;
+    else if (SAT_lit_value_r(S, lit[i]) != VAL_FALSE)
+      lit[j++] = lit[i];
+  if (j == 0)
     {
-      level_backtrack(level);
-      stack_lit_add(stack_clause[clause].lit[0], clause);
-#ifdef SAT_SYM
-      if (SAT_var_orbit[SAT_lit_var(stack_clause[clause].lit[0])])
-	{
-	  Tvar v, v_end = SAT_lit_var(stack_clause[clause].lit[0]);
-	  Tvar pol = SAT_lit_pol(stack_clause[clause].lit[0]);
-	  v = v_end;
-	  while ((v = SAT_var_orbit[v]) != v_end)
-	    if (SAT_var_value(v) == VAL_UNDEF)
-	      {
-		Tlit * Plit;
-		MY_MALLOC(Plit, 1 * sizeof(Tlit));
-		Plit[0] = SAT_lit(v, pol);
-		clause = clause_new(1, Plit, 1, 1, 0);
-		stack_lit_add(stack_clause[clause].lit[0], clause);
-	      }
-	}
+#ifdef BACKTRACK
+      history_status_changed(S);
 #endif
+      SAT_status = SAT_STATUS_UNSAT;
       return;
     }
-  assert(SAT_lit_value(stack_clause[clause].lit[0]) == VAL_FALSE);
-  assert(SAT_lit_value(stack_clause[clause].lit[1]) == VAL_FALSE);
-  assert(SAT_lit_level(stack_clause[clause].lit[1]) <
-	 SAT_lit_level(stack_clause[clause].lit[0]));
-  assert(SAT_lit_level(stack_clause[clause].lit[1]) == level);
-  level_backtrack(level);
-  assert(SAT_lit_value_undef(stack_clause[clause].lit[0]));
-  stack_lit_add(stack_clause[clause].lit[0], clause);
+  clause = clause_new(S, j, lit, 1, 1, 0);
+  clause_increase_activity(S, clause);
+  if (j == 1)
+    stack_lit_add(S, lit[0], clause);
 }
 
 /*--------------------------------------------------------------*/
 
-#ifdef CLAUSE_MIN
-
-static inline bool
-analyse_required_clause(Tlit lit, Talevel alevel)
+/**
+   \brief adds all clauses exported by other instances since last call
+   \pre level is root level */
+static void
+exchange_import(SAT_Tsolver * S)
 {
-  unsigned j;
-  TSclause * Pclause = stack_clause + SAT_lit_reason(lit);
-  assert(SAT_lit_reason(lit) != CLAUSE_UNDEF);
+  Texchange * exchange = S->exchange;
+  unsigned long head = __atomic_load_n(&exchange->head, __ATOMIC_RELAXED);
+  if (head - S->exchange_read > EXCHANGE_SIZE)
+    S->exchange_read = head - EXCHANGE_SIZE;
+  for (; S->exchange_read < head; S->exchange_read++)
+    {
+      unsigned long pos = S->exchange_read;
+      Texchange_slot * slot = exchange->slot + (pos & (EXCHANGE_SIZE - 1));
+      Tlit lit[EXCHANGE_LIT_MAX];
+      unsigned i, n, source;
+      if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != 2 * pos + 2)
+	continue;
+      source = __atomic_load_n(&slot->source, __ATOMIC_RELAXED);
+      n = __atomic_load_n(&slot->n, __ATOMIC_RELAXED);
+      if (n > EXCHANGE_LIT_MAX)
+	continue;
+      for (i = 0; i < n; i++)
+	lit[i] = __atomic_load_n(slot->lit + i, __ATOMIC_RELAXED);
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+      if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != 2 * pos + 2 ||
+	  source == S->exchange_id)
+	continue;
+      clause_import(S, n, lit);
+      if (SAT_status == SAT_STATUS_UNSAT)
+	return;
+    }
+}
+
+#endif /* SAT_THREADS */
+
+/*
+  --------------------------------------------------------------
+  Analyse
+  --------------------------------------------------------------
+*/
+
+typedef unsigned Talevel;
+
+/*--------------------------------------------------------------*/
+
+/**
+   \author Pascal Fontaine
+   \brief repair clauses from conflicting state
+   \param clause the conflicting or propagating clause
+   \param level at which the clause is propagating
+   \remark this should work for empty clauses
+   \remark this should work for unit clauses
+   \remark this should work for propagating clauses
+   \remark this should work for clauses propagating at root level */
+static void
+repair_conflict(SAT_Tsolver * S, Tclause clause, Tlevel level)
+{
+  assert (stack_clause[clause].n != 0 || level == ROOT_LEVEL);
+  assert (stack_clause[clause].n != 1 || level == ROOT_LEVEL);
+  if (stack_clause[clause].n == 0)
+    {
+      level_backtrack(S, level);
+      return;
+    }
+  if (stack_clause[clause].n == 1)
+    {
+      level_backtrack(S, level);
+      stack_lit_add(S, CLAUSE_LIT(stack_clause + clause)[0], clause);
+#ifdef SAT_SYM
+      if (SAT_var_orbit[SAT_lit_var(CLAUSE_LIT(stack_clause + clause)[0])])
+	{
+	  Tvar v, v_end = SAT_lit_var(CLAUSE_LIT(stack_clause + clause)[0]);
+	  Tvar pol = SAT_lit_pol(CLAUSE_LIT(stack_clause + clause)[0]);
+	  v = v_end;
+	  while ((v = SAT_var_orbit[v]) != v_end)
+	    if (SAT_var_value_r(S, v) == VAL_UNDEF)
+	      {
+		Tlit lit = SAT_lit(v, pol);
+		clause = clause_new(S, 1, &lit, 1, 1, 0);
+		stack_lit_add(S, CLAUSE_LIT(stack_clause + clause)[0], clause);
+	      }
+	}
+#endif
+      return;
+    }
+  assert(SAT_lit_value_r(S, CLAUSE_LIT(stack_clause + clause)[0]) == VAL_FALSE);
+  assert(SAT_lit_value_r(S, CLAUSE_LIT(stack_clause + clause)[1]) == VAL_FALSE);
+  assert(SAT_lit_level_r(S, CLAUSE_LIT(stack_clause + clause)[1]) <
+	 SAT_lit_level_r(S, CLAUSE_LIT(stack_clause + clause)[0]));
+  assert(SAT_lit_level_r(S, CLAUSE_LIT(stack_clause + clause)[1]) == level);
+#ifdef CHRONO
+  if (level > ROOT_LEVEL && SAT_level - level > CHRONO_LEVELS)
+    {
+      level_backtrack(S, SAT_level - 1);
+      stack_lit_add_level(S, CLAUSE_LIT(stack_clause + clause)[0], clause,
+			  level);
+      return;
+    }
+#endif
+  level_backtrack(S, level);
+  assert(SAT_lit_value_undef(S, CLAUSE_LIT(stack_clause + clause)[0]));
+  stack_lit_add(S, CLAUSE_LIT(stack_clause + clause)[0], clause);
+}
+
+/*--------------------------------------------------------------*/
+
+#ifdef CHRONO
+/**
+   \brief prepares a conflict for analysis, since its literals may all
+   be of levels lower than the current one: the two literals of
+   highest levels are moved first (and watched), and backtracking is
+   done to the highest level
+   \param clause the conflicting clause
+   \return true if only one literal is of highest level.  The clause is
+   then propagating that literal, and it is done instead of analysis */
+static bool
+conflict_repair(SAT_Tsolver * S, Tclause clause)
+{
+  TSclause * PSclause = stack_clause + clause;
+  Tlit * lits = CLAUSE_LIT(PSclause);
+  unsigned i, k;
+  Tlevel level, level1;
+  if (PSclause->n < 2)
+    return false;
+  for (i = 0; i < 2; i++)
+    {
+      unsigned j = i;
+      Tlit tmp;
+      for (k = i + 1; k < PSclause->n; k++)
+	if (SAT_lit_level_r(S, lits[k]) > SAT_lit_level_r(S, lits[j]))
+	  j = k;
+      if (j == i)
+	continue;
+      tmp = lits[i];
+      lits[i] = lits[j];
+      lits[j] = tmp;
+      /* only the first two literals are watched */
+      if (j >= 2 && PSclause->watched)
+	{
+	  lit_watch_remove(S, lits[j], clause);
+	  lit_watch(S, lits[i], clause, lits[1 - i]);
+	}
+    }
+  level = SAT_lit_level_r(S, lits[0]);
+  level1 = SAT_lit_level_r(S, lits[1]);
+  if (level == level1)
+    {
+      level_backtrack(S, level);
+      return false;
+    }
+  if (level1 == ROOT_LEVEL)
+    {
+      level_backtrack(S, ROOT_LEVEL);
+      stack_lit_add(S, lits[0], clause);
+    }
+  else
+    {
+      level_backtrack(S, level - 1);
+      stack_lit_add_level(S, lits[0], clause, level1);
+    }
+  return true;
+}
+#endif
+
+/*--------------------------------------------------------------*/
+
+#ifdef CLAUSE_MIN
+
+static inline bool
+analyse_required_clause(SAT_Tsolver * S, Tlit lit, Talevel alevel)
+{
+  unsigned j, n;
+  Tlit * Plit;
+  Tclause clause = SAT_lit_reason(S, lit);
+  assert(clause != CLAUSE_UNDEF);
 #ifdef HINTS
-  assert(SAT_lit_reason(lit) != CLAUSE_LAZY);
+  assert(clause != CLAUSE_LAZY);
 #endif
-  STACK_RESIZE_EXP(misc_stack, misc_stack_n + Pclause->n,
-		   misc_stack_size, sizeof(Tlit));
-#if defined(BCLAUSE) || defined(BCLAUSE_LIGHT)
-  if (Pclause->n == 2 && Pclause->lit[0] != SAT_lit_neg(lit))
+  if (CLAUSE_IS_CARD(clause))
     {
-      Tlit lit = Pclause->lit[0];
-      Pclause->lit[0] = Pclause->lit[1];
-      Pclause->lit[1] = lit;
+      /* the reason is not built: the constraint gives its literals */
+      n = card_true(S, clause & ~CLAUSE_CARD) + 1;
+      Plit = card_stack;
     }
+  else
+    {
+      TSclause * Pclause = stack_clause + clause;
+#if defined(BCLAUSE) || defined(BCLAUSE_LIGHT)
+      if (Pclause->n == 2 && CLAUSE_LIT(Pclause)[0] != SAT_lit_neg(lit))
+	{
+	  Tlit lit = CLAUSE_LIT(Pclause)[0];
+	  CLAUSE_LIT(Pclause)[0] = CLAUSE_LIT(Pclause)[1];
+	  CLAUSE_LIT(Pclause)[1] = lit;
+	}
 #endif
-  assert(Pclause->lit[0] == SAT_lit_neg(lit));
+      assert(CLAUSE_LIT(Pclause)[0] == SAT_lit_neg(lit));
+      n = Pclause->n;
+      Plit = CLAUSE_LIT(Pclause);
+    }
+  STACK_RESIZE_EXP(misc_stack, misc_stack_n + n,
+		   misc_stack_size, sizeof(Tlit));
   /* PF first add literals that are not already in conflict on misc_stack */
-  for (j = 1; j < Pclause->n; j++)
-    if (!SAT_lit_seen(Pclause->lit[j]))
+  for (j = 1; j < n; j++)
+    if (!SAT_lit_seen(S, Plit[j]))
       {
-	if (SAT_lit_reason(Pclause->lit[j]) == CLAUSE_UNDEF ||
+	if (SAT_lit_reason(S, Plit[j]) == CLAUSE_UNDEF ||
 #ifdef HINTS
-	    SAT_lit_reason(Pclause->lit[j]) == CLAUSE_LAZY ||
+	    SAT_lit_reason(S, Plit[j]) == CLAUSE_LAZY ||
 #endif
-	    ((1u << (SAT_lit_level(Pclause->lit[j]) & 31u)) & alevel) == 0)
+	    ((1u << (SAT_lit_level_r(S, Plit[j]) & 31u)) & alevel) == 0)
 	  return true;
-	SAT_lit_set_seen(Pclause->lit[j]);
-	misc_stack[misc_stack_n++] = Pclause->lit[j];
+	SAT_lit_set_seen(S, Plit[j]);
+	misc_stack[misc_stack_n++] = Plit[j];
       }
   return false;
 }
@@ -3743,20 +5762,20 @@ analyse_required_clause(Tlit lit, Talevel alevel)
 /*--------------------------------------------------------------*/
 
 static inline bool
-analyse_required(Tlit lit, Talevel alevel)
+analyse_required(SAT_Tsolver * S, Tlit lit, Talevel alevel)
 {
   /* Use misc_stack from misc_stack_n */
   unsigned i, top = misc_stack_n;
-  if (analyse_required_clause(lit, alevel))
+  if (analyse_required_clause(S, lit, alevel))
     goto clean;
   /* PF then recursively add, for each lit on stack, the reasons */
   for (i = top; i < misc_stack_n; i++)
-    if (analyse_required_clause(misc_stack[i], alevel))
+    if (analyse_required_clause(S, misc_stack[i], alevel))
       goto clean;
   return false;
  clean :
   for (i = top; i < misc_stack_n; i++)
-    SAT_lit_set_unseen(misc_stack[i]);
+    SAT_lit_set_unseen(S, misc_stack[i]);
   misc_stack_n = top;
   return true;
 }
@@ -3774,14 +5793,15 @@ analyse_required(Tlit lit, Talevel alevel)
    - increasing clause activity of the conflict clause proved slightly counterproductive
    - computing level at the end was counterproductive */
 static void
-analyse(Tclause clause)
+analyse(SAT_Tsolver * S, Tclause clause)
 {
   Tlevel level;
-  unsigned i, j, index, counter = 0;
+  unsigned i, j, index, counter = 0, glue;
   Tlit p;
-  Tlit * Plit = stack_clause[clause].lit;
+  Tlit * Plit = CLAUSE_LIT(stack_clause + clause);
   unsigned n = stack_clause[clause].n;
-  clause_increase_activity(clause);
+  clause_increase_activity(S, clause);
+  clause_used(S, clause);
   assert(SAT_level != ROOT_LEVEL);
   misc_stack_n = 1;
   STACK_RESIZE_EXP(misc_stack, misc_stack_n + 1,
@@ -3789,15 +5809,15 @@ analyse(Tclause clause)
   assert(stack_lit_n > 0);
 #if defined(DEBUG_SAT) && DEBUG_LEVEL > 1
   for (i = 0; i < n; ++i)
-    assert(SAT_lit_value(Plit[i]) == VAL_FALSE);
+    assert(SAT_lit_value_r(S, Plit[i]) == VAL_FALSE);
   for (i = 0; i < n; i++)
-    if (SAT_lit_level(Plit[i]) == SAT_level)
+    if (SAT_lit_level_r(S, Plit[i]) == SAT_level)
       break;
   assert(i < n);
 #endif
 
 #ifdef PROOF
-  if (SAT_proof) proof_begin(clause);
+  if (SAT_proof) proof_begin(S, clause);
 #endif
   index = stack_lit_n - 1;
   assert (index > 0);
@@ -3806,16 +5826,16 @@ analyse(Tclause clause)
       STACK_RESIZE_EXP(misc_stack, misc_stack_n + n,
 		       misc_stack_size, sizeof(Tlit));
       for (i = 0; i < n; i++)
-	if (!SAT_lit_seen(Plit[i]))
+	if (!SAT_lit_seen(S, Plit[i]))
 	  {
 	    Tvar var = SAT_lit_var(Plit[i]);
-	    assert(SAT_lit_value(Plit[i]) == VAL_FALSE);
+	    assert(SAT_lit_value_r(S, Plit[i]) == VAL_FALSE);
 #ifndef PROOF
-	    assert(SAT_var_level(var) > ROOT_LEVEL);
+	    assert(SAT_var_level_r(S, var) > ROOT_LEVEL);
 #endif
-	    SAT_var_set_seen(var);
-	    var_increase_activity(var);
-	    if (SAT_var_level(var) == SAT_level)
+	    SAT_var_set_seen(S, var);
+	    var_increase_activity(S, var);
+	    if (SAT_var_level_r(S, var) == SAT_level)
 	      counter++; /* count all literals at current level */
 	    else
 	      misc_stack[misc_stack_n++] = Plit[i];
@@ -3827,70 +5847,78 @@ analyse(Tclause clause)
 	 examined, otherwise clause would have been propagating.
 	 counter == 0 iff no more literals of the current level are to be
 	 examined */
-      while (!SAT_lit_seen(stack_lit_get(index)))
+      /* with CHRONO, literals of lower levels may be seen on the way */
+      while (!SAT_lit_seen(S, stack_lit_get(S, index)) ||
+	     SAT_lit_level_r(S, stack_lit_get(S, index)) != SAT_level)
 	{
-	  assert(index > 0 && SAT_lit_level(stack_lit_get(index)) == SAT_level);
+	  assert(index > 0);
 	  index--;
 	}
-      p = stack_lit_get(index);
-      SAT_lit_set_unseen(p);
+      p = stack_lit_get(S, index);
+      SAT_lit_set_unseen(S, p);
       counter--;
       if (counter != 0)
 	{
-	  clause = SAT_lit_reason(p);
+	  clause = SAT_lit_reason(S, p);
 #ifdef HINTS
 	  if (clause == CLAUSE_LAZY)
 	    {
-	      assert(SAT_lit_value(p) == VAL_TRUE)
+	      assert(SAT_lit_value_r(S, p) == VAL_TRUE)
 	      hint_explain(p);
-	      clause = SAT_lit_reason(p);
+	      clause = SAT_lit_reason(S, p);
 	      assert(clause != CLAUSE_LAZY);
 	    }
 #endif
-	  clause_increase_activity(clause);
+	  if (CLAUSE_IS_CARD(clause))
+	    clause = card_explain(S, p);
+	  clause_increase_activity(S, clause);
+	  clause_used(S, clause);
 #if defined(BCLAUSE) || defined(BCLAUSE_LIGHT)
 	  /* In bclauses, literals are not reordered */
-	  if (stack_clause[clause].n == 2 && stack_clause[clause].lit[0] != p)
+	  Plit = CLAUSE_LIT(stack_clause + clause);
+	  if (stack_clause[clause].n == 2 && Plit[0] != p)
 	    {
-	      Tlit tmp = stack_clause[clause].lit[0];
-	      stack_clause[clause].lit[0] = stack_clause[clause].lit[1];
-	      stack_clause[clause].lit[1] = tmp;
+	      Tlit tmp = Plit[0];
+	      Plit[0] = Plit[1];
+	      Plit[1] = tmp;
 	    }
 #endif
-	  Plit = stack_clause[clause].lit + 1;
+	  Plit = CLAUSE_LIT(stack_clause + clause) + 1;
 	  n = stack_clause[clause].n - 1;
-	  assert(SAT_lit_value(*Plit) == VAL_FALSE);
+	  assert(SAT_lit_value_r(S, *Plit) == VAL_FALSE);
 #ifdef PROOF
-	  if (SAT_proof) proof_resolve(p, clause);
+	  if (SAT_proof) proof_resolve(S, p, clause);
 #endif
-	  assert(clause != CLAUSE_UNDEF && p == stack_clause[clause].lit[0]);
+	  assert(clause != CLAUSE_UNDEF && p == CLAUSE_LIT(stack_clause + clause)[0]);
 	}
     }
   while (counter != 0);
   misc_stack[0] = SAT_lit_neg(p);
-  MY_MALLOC(Plit, misc_stack_n * sizeof(Tlit));
+  STACK_RESIZE_EXP(learnt_stack, misc_stack_n, learnt_stack_size,
+		   sizeof(Tlit));
+  Plit = learnt_stack;
   memcpy(Plit, misc_stack, misc_stack_n * sizeof(Tlit));
   n = misc_stack_n;
 #ifdef PROOF
   if (SAT_proof)
     {
       for (i = 1, j = 1; i < n; i++)
-	if (SAT_lit_level(Plit[i]) != ROOT_LEVEL)
+	if (SAT_lit_level_r(S, Plit[i]) != ROOT_LEVEL)
 	  Plit[j++] = Plit[i];
 	else
-	  proof_resolve(Plit[i], SAT_lit_reason(Plit[i]));
+	  proof_resolve(S, Plit[i], SAT_lit_reason(S, Plit[i]));
     }
   else
     {
       Talevel alevels = 0;
       for (i = 1; i < n; i++)
-	alevels |= 1u << (SAT_lit_level(Plit[i]) & 31);
+	alevels |= 1u << (SAT_lit_level_r(S, Plit[i]) & 31);
       for (i = 1, j = 1; i < n; i++)
-	if (SAT_lit_reason(Plit[i]) == CLAUSE_UNDEF ||
+	if (SAT_lit_reason(S, Plit[i]) == CLAUSE_UNDEF ||
 #ifdef HINTS
-	    SAT_lit_reason(Plit[i]) == CLAUSE_LAZY ||
+	    SAT_lit_reason(S, Plit[i]) == CLAUSE_LAZY ||
 #endif /* HINTS */
-	    analyse_required(Plit[i], alevels))
+	    analyse_required(S, Plit[i], alevels))
 	  Plit[j++] = Plit[i];
     }
   n = j;
@@ -3899,13 +5927,13 @@ analyse(Tclause clause)
   {
     Talevel alevels = 0;
     for (i = 1; i < n; i++)
-      alevels |= 1u << (SAT_lit_level(Plit[i]) & 31);
+      alevels |= 1u << (SAT_lit_level_r(S, Plit[i]) & 31);
     for (i = 1, j = 1; i < n; i++)
-      if (SAT_lit_reason(Plit[i]) == CLAUSE_UNDEF ||
+      if (SAT_lit_reason(S, Plit[i]) == CLAUSE_UNDEF ||
 #ifdef HINTS
-	  SAT_lit_reason(Plit[i]) == CLAUSE_LAZY ||
+	  SAT_lit_reason(S, Plit[i]) == CLAUSE_LAZY ||
 #endif /* HINTS */
-	  analyse_required(Plit[i], alevels))
+	  analyse_required(S, Plit[i], alevels))
 	Plit[j++] = Plit[i];
     n = j;
   }
@@ -3915,30 +5943,162 @@ analyse(Tclause clause)
   if (n > 1)
     {
       for (i = 1, j = 1; i < n; i++)
-	if (level < SAT_lit_level(Plit[i]))
-	  level = SAT_lit_level(Plit[j = i]);
+	if (level < SAT_lit_level_r(S, Plit[i]))
+	  level = SAT_lit_level_r(S, Plit[j = i]);
       p = Plit[1];
       Plit[1] = Plit[j];
       Plit[j] = p;
     }
-  assert(!SAT_lit_seen(misc_stack[0]));
+  assert(!SAT_lit_seen(S, misc_stack[0]));
   for (i = 1; i < misc_stack_n; i++)
-    SAT_lit_set_unseen(misc_stack[i]);
+    SAT_lit_set_unseen(S, misc_stack[i]);
 #if defined(DEBUG_SAT) && DEBUG_LEVEL > 1
   for (i = 0; i < n; ++i)
-    assert(SAT_lit_value(Plit[i]) == VAL_FALSE);
+    assert(SAT_lit_value_r(S, Plit[i]) == VAL_FALSE);
 #endif
 #if STATS_LEVEL >= 1
   stats_counter_inc(stat_n_conflict);
   stats_counter_add(stat_n_conflict_lit, (int) n);
 #endif
-  MY_REALLOC(Plit, n * sizeof(Tlit));
-  clause = clause_new(n, Plit, 1, 1, 0);
-  repair_conflict(clause, level);
+  glue = lits_glue(S, n, Plit);
+  glue_ema_update(S, glue);
+  clause = clause_new(S, n, Plit, 1, 1, 0);
+  stack_clause[clause].glue = glue;
+#ifdef SAT_THREADS
+  if (S->exchange)
+    exchange_export(S, n, Plit);
+#endif
+  repair_conflict(S, clause, level);
 #ifdef PROOF
-  if (SAT_proof) proof_end(clause);
+  if (SAT_proof) proof_end(S, clause);
+#endif
+}
+
+#ifdef VIVIFY
+/*
+  --------------------------------------------------------------
+  Vivification
+  --------------------------------------------------------------
+*/
+
+/**
+   \brief shortens a learnt clause: the negations of its literals are
+   decided in turn, and the literals found false are dropped, until a
+   conflict, or a true literal.  The literals decided (and the true
+   one) then form a clause implied by the others
+   \param clause the clause
+   \return true if the clause is to be deleted, since it is satisfied
+   at root level, or replaced by a shorter clause
+   \pre level is root level, and propagation is complete
+   \remark the shorter clause is added, units are propagated */
+static bool
+vivify_clause(SAT_Tsolver * S, Tclause clause)
+{
+  unsigned i, j, n = stack_clause[clause].n;
+  unsigned glue = stack_clause[clause].glue;
+  double activity = stack_clause[clause].activity;
+  /* propagation reorders the literals of the clause */
+  STACK_RESIZE_EXP(learnt_stack, n, learnt_stack_size, sizeof(Tlit));
+  memcpy(learnt_stack, CLAUSE_LIT(stack_clause + clause), n * sizeof(Tlit));
+  for (i = 0, j = 0; i < n; i++)
+    {
+      Tlit lit = learnt_stack[i];
+      if (SAT_lit_value_is_true(S, lit))
+	{
+	  if (SAT_lit_level_r(S, lit) == ROOT_LEVEL)
+	    {
+	      level_backtrack(S, ROOT_LEVEL);
+	      return true;
+	    }
+	  learnt_stack[j++] = lit;
+	  break;
+	}
+      if (!SAT_lit_value_undef(S, lit))
+	continue;
+      learnt_stack[j++] = lit;
+      level_push(S, SAT_lit_neg(lit));
+      if (propagate(S) != CLAUSE_UNDEF)
+	break;
+    }
+  level_backtrack(S, ROOT_LEVEL);
+  if (j == n)
+    return false;
+  clause = clause_new(S, j, learnt_stack, 1, 1, 0);
+  stack_clause[clause].activity = activity;
+  if (glue < j)
+    stack_clause[clause].glue = glue;
+  if (j == 1)
+    {
+      stack_lit_add(S, learnt_stack[0], clause);
+      if (propagate(S) != CLAUSE_UNDEF)
+	{
+#ifdef BACKTRACK
+	  history_status_changed(S);
 #endif
+	  SAT_status = SAT_STATUS_UNSAT;
+	}
+    }
+  return true;
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief vivifies learnt clauses, most active first, within an effort
+   relative to the search since the last time
+   \pre level is root level, and propagation is complete
+   \remark phases are preserved */
+static void
+vivify(SAT_Tsolver * S)
+{
+  unsigned i, n = learnts_n;
+  unsigned long start = unassigned_n;
+  unsigned long effort = (start - vivify_unassigned_n) / VIVIFY_EFFORT_FACT;
+  unsigned char * phase;
+  Tclause * candidates;
+  Tclause_list deleted = {0, 0, NULL};
+  assert(SAT_level == ROOT_LEVEL && stack_lit_to_propagate == stack_lit_n);
+  MY_MALLOC(phase, SAT_stack_var_n + 1);
+  for (i = 1; i <= SAT_stack_var_n; i++)
+    phase[i] = SAT_stack_var[i].phase_cache;
+  MY_MALLOC(candidates, (n + 1) * sizeof(Tclause));
+  memcpy(candidates, learnts, n * sizeof(Tclause));
+  cmp_solver = S;
+  veriT_qsort(candidates, n, sizeof(Tclause), (TFcmp) cmp_clause);
+  for (i = 0; i < n && unassigned_n - start < effort &&
+	 SAT_status != SAT_STATUS_UNSAT; i++)
+    {
+      Tclause clause = candidates[i];
+      if (stack_clause[clause].deleted || stack_clause[clause].n < 3 ||
+	  clause_propagating(S, clause))
+	continue;
+      if (vivify_clause(S, clause))
+	clause_list_add(&deleted, clause);
+    }
+  free(candidates);
+  /* clauses are deleted at the end, so that ids are not reused while
+     they are in watch lists */
+  for (i = 0; i < deleted.n; i++)
+    if (!clause_propagating(S, deleted.Pclause[i]))
+      clause_lazy_delete(S, deleted.Pclause[i]);
+  free(deleted.Pclause);
+  {
+    Tclause * i, * j, * n;
+    i = j = learnts;
+    n = learnts + learnts_n;
+    for (; i != n; i++)
+      if (!stack_clause[*i].deleted)
+	*(j++) = *i;
+    learnts_n -= (unsigned) (n - j);
+  }
+  batch_rm_clauses_1(S);
+  for (i = 1; i <= SAT_stack_var_n; i++)
+    SAT_stack_var[i].phase_cache = phase[i];
+  free(phase);
+  vivify_unassigned_n = unassigned_n;
+  vivify_conflict_nb = conflict_nb + VIVIFY_INTERVAL;
 }
+#endif /* VIVIFY */
 
 /*
   --------------------------------------------------------------
@@ -3951,13 +6111,8 @@ analyse(Tclause clause)
    \brief propagates until a decision has to be done
    \return SAT_STATUS_SAT, SAT_STATUS_UNSAT, or SAT_STATUS_UNDEF */
 Tstatus
-SAT_propagate(void)
+SAT_propagate_r(SAT_Tsolver * S)
 {
-  static unsigned restart_n = 0; /**< number of restarts */
-  static unsigned conflict_restart_n = 1 << RESTART_MIN_INTERVAL;
-  static unsigned learnts_max = 0, learnts_n_adj_cnt = LEARNTS_ADJ_INIT;
-  static double learnts_n_adj_cnt_restart = LEARNTS_ADJ_INIT;
-  static bool next_purge_valid = false;
   Tclause conflict;
   /* IMPROVE REMOVE THIS TEST TO SEE IF SIGNIFICANT OVERHEAD */
   if (SAT_status != SAT_STATUS_UNDEF)
@@ -3965,44 +6120,101 @@ SAT_propagate(void)
   if (!learnts_max)
     {
       /* PF First call to SAT_propagate after adding clauses */
-      learnts_max = (unsigned) (stack_clause_n * LEARNTS_FACT_INIT + 1);
+      /* a cardinality constraint counts as a clause per literal */
+      learnts_max = (unsigned) ((stack_clause_n + stack_card_lit_n) *
+				LEARNTS_FACT_INIT + 1);
+      restart_next(S);
 #ifdef SIMP
 #ifdef PROOF
       if (!SAT_proof)
 #endif /* PROOF */
 	{
-	  if (propagate() != CLAUSE_UNDEF)
-	    return (SAT_status = SAT_STATUS_UNSAT);
-	  purge_valid();
+	  if (propagate(S) != CLAUSE_UNDEF)
+	    {
+#ifdef BACKTRACK
+	      history_status_changed(S);
+#endif
+	      return (SAT_status = SAT_STATUS_UNSAT);
+	    }
+	  purge_valid(S);
+#ifdef ELIM
+	  if (S->state.params.preprocess)
+	    {
+	      preprocess(S);
+	      if (SAT_status == SAT_STATUS_UNSAT)
+		return SAT_status;
+	    }
+#endif
+#if defined(BCLAUSE_GENERATION) || defined(SLS)
+	  /* units of preprocessing are not yet propagated */
+	  if (propagate(S) != CLAUSE_UNDEF)
+	    {
+#ifdef BACKTRACK
+	      history_status_changed(S);
+#endif
+	      return (SAT_status = SAT_STATUS_UNSAT);
+	    }
+#endif
 #ifdef BCLAUSE_GENERATION
-	  bclause_generate();
+	  bclause_generate(S);
 #endif /* BCLAUSE_GENERATION */
+#ifdef SLS
+	  local_search(S);
+#endif
 	}
 #endif /* SIMP */
     }
-  ON_DEBUG_SAT(check_consistency());
-  ON_DEBUG_SAT(check_consistency_heap());
-  while ((conflict = propagate()) != CLAUSE_UNDEF)
+  ON_DEBUG_SAT(check_consistency(S));
+  ON_DEBUG_SAT(check_consistency_heap(S));
+  while ((conflict = propagate(S)) != CLAUSE_UNDEF)
     {
+#ifdef CHRONO
+      if (conflict_repair(S, conflict))
+	continue;
+#endif
       if (SAT_level == ROOT_LEVEL)
 	{
 #ifdef BACKTRACK
-	  history_status_changed();
+	  history_status_changed(S);
 #endif
 #ifdef PROOF
 	  SAT_empty_clause = conflict;
 #endif
 	  return (SAT_status = SAT_STATUS_UNSAT);
 	}
-      analyse(conflict);
-      if (conflict_restart_n-- == 0)
+#ifdef REPHASE
+      phases_update(S);
+#endif
+      analyse(S, conflict);
+      if (restart_due(S))
 	{
 #if STATS_LEVEL >= 1
 	  stats_counter_inc(stat_n_restart);
 #endif
-	  level_backtrack(find_level_on_restart());
-	  conflict_restart_n = restart_suite(++restart_n);
+#ifdef VIVIFY
+	  /* vivification is done at root level */
+	  if (conflict_nb >= vivify_conflict_nb)
+	    level_backtrack(S, ROOT_LEVEL);
+	  else
+#endif
+	    level_backtrack(S, find_level_on_restart(S));
+	  restart_next(S);
+#ifdef REPHASE
+	  /* target phases come from the trails since the last restart */
+	  target_trail_n = 0;
+	  if (conflict_nb >= rephase_conflict_nb)
+	    rephase(S);
+#endif
 	  next_purge_valid = true;
+#ifdef SAT_THREADS
+	  if (S->exchange)
+	    {
+	      level_backtrack(S, ROOT_LEVEL);
+	      exchange_import(S);
+	      if (SAT_status == SAT_STATUS_UNSAT)
+		return SAT_status;
+	    }
+#endif
 	}
       if (--learnts_n_adj_cnt == 0)
 	{
@@ -4012,27 +6224,35 @@ SAT_propagate(void)
 	  learnts_max = (unsigned) (learnts_max * LEARNTS_MAX_FACT);
 	}
       conflict_nb++;
-      var_decrease_activity();
-      clause_decrease_activity();
+      var_decrease_activity(S);
+      clause_decrease_activity(S);
     }
   if (SAT_level == ROOT_LEVEL && next_purge_valid)
     {
 #ifdef PROOF
-      if (!SAT_proof) purge_valid();
+      if (!SAT_proof) purge_valid(S);
 #else
-      purge_valid();
+      purge_valid(S);
 #endif
       next_purge_valid = false;
+#ifdef VIVIFY
+      if (conflict_nb >= vivify_conflict_nb)
+	{
+	  vivify(S);
+	  if (SAT_status == SAT_STATUS_UNSAT)
+	    return SAT_status;
+	}
+#endif
     }
-  if (learnts_n >= learnts_max + stack_lit_n)
+  if (learnts_n >= learnts_max + learnts_kept + stack_lit_n)
     {
-      purge();
+      purge(S);
     }
-  ON_DEBUG_SAT(check_consistency());
-  ON_DEBUG_SAT(check_consistency_heap());
-  ON_DEBUG_SAT(check_consistency_propagation());
+  ON_DEBUG_SAT(check_consistency(S));
+  ON_DEBUG_SAT(check_consistency_heap(S));
+  ON_DEBUG_SAT(check_consistency_propagation(S));
 #if defined(DEBUG_SAT) && DEBUG_LEVEL > 1
-  print_stack();
+  print_stack(S);
 #endif
   return SAT_STATUS_UNDEF;
 }
@@ -4042,13 +6262,13 @@ SAT_propagate(void)
 #if PROOF
   /* PF first sanitize all propagations at ROOT level */
 void
-SAT_sanitize_root_level(void)
+SAT_sanitize_root_level_r(SAT_Tsolver * S)
 {
   unsigned i;
   if (!SAT_proof || SAT_level != ROOT_LEVEL)
     return;
   for (i = SAT_literal_stack_to_propagate; i < stack_lit_n; i++)
-    if (SAT_lit_reason(stack_lit[i]) == CLAUSE_LAZY)
+    if (SAT_lit_reason(S, stack_lit[i]) == CLAUSE_LAZY)
       hint_explain(stack_lit[i]);
 }
 #endif
@@ -4060,10 +6280,10 @@ SAT_sanitize_root_level(void)
    \author Pascal Fontaine
    \brief adds hint, i.e. propagated literal with lazy clause */
 void
-SAT_hint(Tlit lit)
+SAT_hint_r(SAT_Tsolver * S, Tlit lit)
 {
   assert(SAT_lit_var(lit) <= SAT_stack_var_n);
-  if (!SAT_lit_value_undef(lit))
+  if (!SAT_lit_value_undef(S, lit))
     return;
 #if STATS_LEVEL >= 1
   stats_counter_inc(stat_n_tp);
@@ -4076,9 +6296,9 @@ SAT_hint(Tlit lit)
     }
   hints[hint_n++] = lit;
 #else
-  stack_lit_add(lit, CLAUSE_LAZY);
+  stack_lit_add(S, lit, CLAUSE_LAZY);
 #endif /* HINT_AS_DECISION */
-  /* Clauses at root level will be explained in propagate()
+  /* Clauses at root level will be explained in propagate(S)
      Not here because DP work may not be completed */
 }
 #endif /* HINTS */
@@ -4089,22 +6309,25 @@ SAT_hint(Tlit lit)
    \author Pascal Fontaine
    \brief adds decision */
 bool
-SAT_decide(void)
+SAT_decide_r(SAT_Tsolver * S)
 {
   Tlit lit;
-  ON_DEBUG_SAT(check_consistency_propagation());
-  lit = decision_get();
+  ON_DEBUG_SAT(check_consistency_propagation(S));
+  lit = decision_get(S);
   if (!lit) /* All variables assigned */
     {
-      ON_DEBUG_SAT(check_consistency_final());
+#ifdef ELIM
+      elim_extend(S);
+#endif
+      ON_DEBUG_SAT(check_consistency_final(S));
       SAT_status = SAT_STATUS_SAT;
       return false;
     }
-  assert(SAT_lit_value_undef(lit));
+  assert(SAT_lit_value_undef(S, lit));
 #if STATS_LEVEL >= 1
   stats_counter_inc(stat_n_decision);
 #endif /* STATS_LEVEL >= 1 */
-  level_push(lit);
+  level_push(S, lit);
   return true;
 }
 
@@ -4114,15 +6337,15 @@ SAT_decide(void)
    \author Pascal Fontaine
    \brief restart SAT solver */
 void
-SAT_restart(void)
+SAT_restart_r(SAT_Tsolver * S)
 {
-  level_backtrack(ROOT_LEVEL);
+  level_backtrack(S, ROOT_LEVEL);
 #if PROOF
-  if (SAT_propagate() == SAT_STATUS_UNDEF && !SAT_proof)
-    purge_valid();
+  if (SAT_propagate_r(S) == SAT_STATUS_UNDEF && !SAT_proof)
+    purge_valid(S);
 #else
-  if (SAT_propagate() == SAT_STATUS_UNDEF)
-    purge_valid();
+  if (SAT_propagate_r(S) == SAT_STATUS_UNDEF)
+    purge_valid(S);
 #endif
 }
 
@@ -4133,13 +6356,150 @@ SAT_restart(void)
    \brief adds decision
    \return SAT_STATUS_SAT, SAT_STATUS_UNSAT, or SAT_STATUS_UNDEF */
 Tstatus
-SAT_solve(void)
+SAT_solve_r(SAT_Tsolver * S)
+{
+  while (SAT_propagate_r(S) == SAT_STATUS_UNDEF)
+    {
+#ifdef SAT_THREADS
+      if (S->interrupt && __atomic_load_n(S->interrupt, __ATOMIC_RELAXED))
+	return SAT_STATUS_UNDEF;
+#endif
+      SAT_decide_r(S);
+    }
+  return SAT_status;
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief collects in assumption_core the assumptions responsible for
+   an assumption being false
+   \param lit the false assumption
+   \remark decisions are all assumptions, since those are decided first.
+   The core contains lit, and the decisions on which its negation
+   depends */
+static void
+assumption_core_set(SAT_Tsolver * S, Tlit lit)
+{
+  unsigned i, j;
+  assumption_core_n = 0;
+  STACK_RESIZE_EXP(assumption_core, 1, assumption_core_size, sizeof(Tlit));
+  assumption_core[assumption_core_n++] = lit;
+  if (SAT_lit_level_r(S, lit) == ROOT_LEVEL)
+    return;
+  SAT_lit_set_seen(S, lit);
+  /* literals of root level are always seen, and are skipped */
+  for (i = stack_lit_n; i-- > stack_level[0]; )
+    {
+      Tlit lit2 = stack_lit_get(S, i);
+      Tvar var = SAT_lit_var(lit2);
+      Tclause clause;
+      if (!SAT_var_seen(S, var))
+	continue;
+      SAT_var_set_unseen(S, var);
+      clause = SAT_var_reason(S, var);
+      if (clause == CLAUSE_UNDEF)
+	{
+	  STACK_RESIZE_EXP(assumption_core, assumption_core_n + 1,
+			   assumption_core_size, sizeof(Tlit));
+	  assumption_core[assumption_core_n++] = lit2;
+	  continue;
+	}
+      if (CLAUSE_IS_CARD(clause))
+	{
+	  unsigned n = card_true(S, clause & ~CLAUSE_CARD);
+	  for (j = 1; j <= n; j++)
+	    if (SAT_lit_level_r(S, card_stack[j]) != ROOT_LEVEL)
+	      SAT_lit_set_seen(S, card_stack[j]);
+	  continue;
+	}
+      for (j = 0; j < stack_clause[clause].n; j++)
+	{
+	  Tlit lit3 = CLAUSE_LIT(stack_clause + clause)[j];
+	  if (SAT_lit_var(lit3) != var &&
+	      SAT_lit_level_r(S, lit3) != ROOT_LEVEL)
+	    SAT_lit_set_seen(S, lit3);
+	}
+    }
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief runs with the given literals decided first, until a model is
+   found or the literals are shown inconsistent with the clauses
+   \param n the number of literals
+   \param lit the literals
+   \return SAT_STATUS_SAT, SAT_STATUS_UNSAT, or SAT_STATUS_UNDEF if
+   interrupted
+   \remark the status becomes UNSAT only if the clauses alone are unsat.
+   Otherwise, if the literals are inconsistent with the clauses, the
+   status is unchanged, the solver is back at root level, and the
+   literals responsible are in assumption_core */
+static Tstatus
+solve_assuming(SAT_Tsolver * S, unsigned n, Tlit * lit)
 {
-  while (SAT_propagate() == SAT_STATUS_UNDEF)
-    SAT_decide();
+  unsigned i;
+  while (SAT_propagate_r(S) == SAT_STATUS_UNDEF)
+    {
+#ifdef SAT_THREADS
+      if (S->interrupt && __atomic_load_n(S->interrupt, __ATOMIC_RELAXED))
+	return SAT_STATUS_UNDEF;
+#endif
+      for (i = 0; i < n && SAT_lit_value_r(S, lit[i]) == VAL_TRUE; i++) ;
+      if (i == n)
+	{
+	  SAT_decide_r(S);
+	  continue;
+	}
+      if (SAT_lit_value_r(S, lit[i]) == VAL_FALSE)
+	{
+	  assumption_core_set(S, lit[i]);
+	  level_backtrack(S, ROOT_LEVEL);
+	  return SAT_STATUS_UNSAT;
+	}
+#if STATS_LEVEL >= 1
+      stats_counter_inc(stat_n_decision);
+#endif /* STATS_LEVEL >= 1 */
+      level_push(S, lit[i]);
+    }
   return SAT_status;
 }
 
+/*--------------------------------------------------------------*/
+
+Tstatus
+SAT_solve_assuming_r(SAT_Tsolver * S, unsigned n, Tlit * lit)
+{
+#ifdef ELIM
+  unsigned i;
+#endif
+  assumption_core_n = 0;
+  if (SAT_status == SAT_STATUS_UNSAT)
+    return SAT_STATUS_UNSAT;
+  /* the model of a previous call may not satisfy the literals */
+  level_backtrack(S, ROOT_LEVEL);
+  SAT_status = SAT_STATUS_UNDEF;
+  if (SAT_propagate_r(S) != SAT_STATUS_UNDEF)
+    return SAT_status;
+#ifdef ELIM
+  for (i = 0; i < n && elim_stack_n; i++)
+    if (SAT_stack_var[SAT_lit_var(lit[i])].eliminated)
+      elim_restore(S);
+#endif
+  return solve_assuming(S, n, lit);
+}
+
+/*--------------------------------------------------------------*/
+
+void
+SAT_assumptions_core_r(SAT_Tsolver * S, SAT_Tlit ** PPlit, unsigned *n)
+{
+  MY_REALLOC(*PPlit, assumption_core_n * sizeof(Tlit));
+  memcpy(*PPlit, assumption_core, assumption_core_n * sizeof(Tlit));
+  *n = assumption_core_n;
+}
+
 /*
   --------------------------------------------------------------
   Adding clauses, push, pop
@@ -4153,7 +6513,7 @@ SAT_solve(void)
    \param lit an array of n literals
    \param conflict flag indicating if it is a conflict clause
    \remark this may be called at any time
-   \remark destructive for the array of literals
+   \remark the array of literals is modified, but left to the caller
    \remark returns CLAUSE_UNDEF if valid clause or problem already found unsat
    \return clause id or CLAUSE_UNDEF
    \remark added clause may require different treatment
@@ -4181,7 +6541,7 @@ SAT_solve(void)
    a conflict analysis
    </ul> */
 static inline Tclause
-SAT_clause_new_aux(unsigned n, Tlit * lit, unsigned char conflict)
+clause_add(SAT_Tsolver * S, unsigned n, Tlit * lit, unsigned char conflict)
 {
   unsigned i, j;
   Tclause clause;
@@ -4191,24 +6551,28 @@ SAT_clause_new_aux(unsigned n, Tlit * lit, unsigned char conflict)
       if (SAT_proof)
 	proof_SAT_set_id(CLAUSE_UNDEF);
 #endif
-      free(lit);
       return CLAUSE_UNDEF;
     }
   SAT_status = SAT_STATUS_UNDEF;
+#ifdef ELIM
+  for (i = 0; i < n && elim_stack_n; i++)
+    if (SAT_stack_var[SAT_lit_var(lit[i])].eliminated)
+      elim_restore(S);
+#endif
 #if defined(DEBUG_SAT) && DEBUG_LEVEL > 1
   fprintf(stderr, "SAT_clause_new :");
   for (i = 0; i < n; ++i)
     fprintf(stderr, " %d", lit[i]);
   fprintf(stderr, "\n");
-  check_consistency();
-  check_consistency_heap();
+  check_consistency(S);
+  check_consistency_heap(S);
 #endif
   if (n == 0)
     {
       /* input clause is empty clause */
-      clause = clause_new(n, NULL, 0, 0, 0);
+      clause = clause_new(S, n, NULL, 0, 0, 0);
 #ifdef BACKTRACK
-      history_status_changed();
+      history_status_changed(S);
 #endif
 #ifdef PROOF
       if (SAT_proof)
@@ -4225,25 +6589,23 @@ SAT_clause_new_aux(unsigned n, Tlit * lit, unsigned char conflict)
   veriT_qsort(lit, n, sizeof(Tlit), (TFcmp) SAT_lit_compare);
   /* checking for complementary literals, true literals,
      and eliminating duplicates */
-  if (SAT_lit_value(lit[0]) == VAL_TRUE && SAT_lit_level(lit[0]) == ROOT_LEVEL)
+  if (SAT_lit_value_r(S, lit[0]) == VAL_TRUE && SAT_lit_level_r(S, lit[0]) == ROOT_LEVEL)
       {
 	/* true literal, valid clause */
 #if defined(PROOF) && defined(INSIDE_VERIT)
 	if (SAT_proof)
 	  proof_SAT_set_id(CLAUSE_UNDEF);
 #endif
-	free(lit);
 	return CLAUSE_UNDEF;
       }
   for (j = 1, i = 1; i < n; ++i)
     if (lit[i] == lit[j - 1])
       continue;
     else if (SAT_lit_var(lit[i]) == SAT_lit_var(lit[j - 1]) ||
-	     (SAT_lit_value(lit[i]) == VAL_TRUE &&
-	      SAT_lit_level(lit[i]) == ROOT_LEVEL))
+	     (SAT_lit_value_r(S, lit[i]) == VAL_TRUE &&
+	      SAT_lit_level_r(S, lit[i]) == ROOT_LEVEL))
       {
 	/* complementary literals or true literal, valid clause */
-	free(lit);
 #if defined(PROOF) && defined(INSIDE_VERIT)
 	if (SAT_proof)
 	  proof_SAT_set_id(CLAUSE_UNDEF);
@@ -4255,39 +6617,36 @@ SAT_clause_new_aux(unsigned n, Tlit * lit, unsigned char conflict)
 
   n = j;
   for (j = 0, i = 0; i < n; ++i)
-    if (SAT_lit_value(lit[i]) != VAL_FALSE ||
-	SAT_lit_level(lit[i]) != ROOT_LEVEL)
+    if (SAT_lit_value_r(S, lit[i]) != VAL_FALSE ||
+	SAT_lit_level_r(S, lit[i]) != ROOT_LEVEL)
       lit[j++] = lit[i];
 #ifdef PROOF
     else if (SAT_proof)
       {
 	if (i == j)
 	  {
-	    Tlit * Plit2;
-	    MY_MALLOC(Plit2, n * sizeof(Tlit));
-	    memcpy(Plit2, lit, n * sizeof(Tlit));
-	    clause = clause_new(n, Plit2, 0, 0, 0);
+	    clause = clause_new(S, n, lit, 0, 0, 0);
 #ifdef INSIDE_VERIT
 	    proof_SAT_set_id(clause);
 #endif
-	    proof_begin(clause);
+	    proof_begin(S, clause);
 	  }
-	proof_resolve(lit[i], SAT_lit_reason(lit[i]));
+	proof_resolve(S, lit[i], SAT_lit_reason(S, lit[i]));
       }
   if (SAT_proof && n != j)
     {
       n = j;
-      MY_REALLOC(lit, n * sizeof(lit));
+      cmp_solver = S;
       veriT_qsort(lit, n, sizeof(Tlit), (TFcmp) SAT_lit_compare_level);
-      clause = clause_new(n, lit, 0, 1, conflict);
-      proof_end(clause);
+      clause = clause_new(S, n, lit, 0, 1, conflict);
+      proof_end(S, clause);
     }
   else
     {
       n = j;
-      MY_REALLOC(lit, n * sizeof(lit));
+      cmp_solver = S;
       veriT_qsort(lit, n, sizeof(Tlit), (TFcmp) SAT_lit_compare_level);
-      clause = clause_new(n, lit, 0, 1, conflict);
+      clause = clause_new(S, n, lit, 0, 1, conflict);
 #ifdef INSIDE_VERIT
       if (SAT_proof)
 	proof_SAT_set_id(clause);
@@ -4295,17 +6654,17 @@ SAT_clause_new_aux(unsigned n, Tlit * lit, unsigned char conflict)
     }
 #else /* PROOF */
   n = j;
-  MY_REALLOC(lit, n * sizeof(lit));
+  cmp_solver = S;
   veriT_qsort(lit, n, sizeof(Tlit), (TFcmp) SAT_lit_compare_level);
-  clause = clause_new(n, lit, 0, 1, conflict);
+  clause = clause_new(S, n, lit, 0, 1, conflict);
 #endif /* PROOF */
 
   if (n == 0)
     {
       /* empty clause */
-      level_backtrack(ROOT_LEVEL);
+      level_backtrack(S, ROOT_LEVEL);
 #ifdef BACKTRACK
-      history_status_changed ();
+      history_status_changed(S);
 #endif
 #ifdef PROOF
       if (SAT_proof)
@@ -4315,56 +6674,69 @@ SAT_clause_new_aux(unsigned n, Tlit * lit, unsigned char conflict)
     }
   else if (n == 1)
     {
-      level_backtrack(ROOT_LEVEL);
+      level_backtrack(S, ROOT_LEVEL);
       /* should be propagating otherwise reduced to empty clause */
-      stack_lit_add(stack_clause[clause].lit[0], clause);
+      stack_lit_add(S, CLAUSE_LIT(stack_clause + clause)[0], clause);
     }
-  else if (SAT_lit_value(lit[1]) != VAL_FALSE)
+  else if (SAT_lit_value_r(S, lit[1]) != VAL_FALSE)
     /* first case: clause would never have been propagating
        no backtracking required
        clause can be safely added */
     {
     }
-  else if (SAT_lit_value(lit[0]) == VAL_TRUE &&
-	   SAT_lit_level(lit[0]) <= SAT_lit_level(lit[1]))
+  else if (SAT_lit_value_r(S, lit[0]) == VAL_TRUE &&
+	   SAT_lit_level_r(S, lit[0]) <= SAT_lit_level_r(S, lit[1]))
     /* second case: clause may never have been propagating since blocked
        by true literal
        clause can be safely added */
     {
     }
-  else if (SAT_lit_value(lit[0]) != VAL_FALSE ||
-	   SAT_lit_level(lit[0]) != SAT_lit_level(lit[1])) /* > */
-    /*  assert (SAT_lit_value(lit[1]) == VAL_FALSE);
-	assert (SAT_lit_value(lit[0]) != VAL_TRUE ||
-                SAT_lit_level(lit[0]) > SAT_lit_level(lit[1])); */
+  else if (SAT_lit_value_r(S, lit[0]) != VAL_FALSE ||
+	   SAT_lit_level_r(S, lit[0]) != SAT_lit_level_r(S, lit[1])) /* > */
+    /*  assert (SAT_lit_value_r(S, lit[1]) == VAL_FALSE);
+	assert (SAT_lit_value_r(S, lit[0]) != VAL_TRUE ||
+                SAT_lit_level_r(S, lit[0]) > SAT_lit_level_r(S, lit[1])); */
     {
       /* third and fourth case */
-      level_backtrack(SAT_lit_level(lit[1]));
-      stack_lit_add(stack_clause[clause].lit[0], clause);
+      level_backtrack(S, SAT_lit_level_r(S, lit[1]));
+      stack_lit_add(S, CLAUSE_LIT(stack_clause + clause)[0], clause);
     }
   else
     /*
-      assert(SAT_lit_value(lit[0]) == VAL_FALSE);
-      assert(SAT_lit_value(lit[1]) == VAL_FALSE);
-      assert(SAT_lit_level(lit[0]) == SAT_lit_level(lit[1])); */
+      assert(SAT_lit_value_r(S, lit[0]) == VAL_FALSE);
+      assert(SAT_lit_value_r(S, lit[1]) == VAL_FALSE);
+      assert(SAT_lit_level_r(S, lit[0]) == SAT_lit_level_r(S, lit[1])); */
     {
       /* last case: clause is conflicting */
-      level_backtrack(SAT_lit_level(lit[0]));
+      level_backtrack(S, SAT_lit_level_r(S, lit[0]));
       assert(SAT_level != ROOT_LEVEL);
       /* not root level otherwise reduced to empty clause earlier */
-      analyse(clause);
+      analyse(S, clause);
     }
 #if defined(DEBUG_SAT) && DEBUG_LEVEL > 1
-  check_consistency();
-  check_consistency_heap();
+  check_consistency(S);
+  check_consistency_heap(S);
 #endif
   return clause;
 }
 
 /*--------------------------------------------------------------*/
 
+/**
+   \brief adds a clause, as clause_add
+   \remark destructive for the array of literals, which is freed */
+static inline Tclause
+SAT_clause_new_aux(SAT_Tsolver * S, unsigned n, Tlit * lit, unsigned char conflict)
+{
+  Tclause clause = clause_add(S, n, lit, conflict);
+  free(lit);
+  return clause;
+}
+
+/*--------------------------------------------------------------*/
+
 Tclause
-SAT_clause_new_lazy(unsigned n, Tlit * lit)
+SAT_clause_new_lazy_r(SAT_Tsolver * S, unsigned n, Tlit * lit)
 {
   /* TODO CHECK if there is no interleaving of proofs */
   unsigned i = 0, j = 0;
@@ -4374,53 +6746,49 @@ SAT_clause_new_lazy(unsigned n, Tlit * lit)
   for (i = 0; i < n; ++i)
     fprintf(stderr, " %d", lit[i]);
   fprintf(stderr, "\n");
-  check_consistency();
-  check_consistency_heap();
+  check_consistency(S);
+  check_consistency_heap(S);
 #endif
+  cmp_solver = S;
   veriT_qsort(lit, n, sizeof(Tlit), (TFcmp) SAT_lit_compare_level);
   /* checking for complementary literals, true literals,
      and eliminating duplicates */
 #ifdef DEBUG
-  assert(n && SAT_lit_value(lit[0]) == VAL_TRUE);
-  assert(SAT_lit_reason(lit[0]) == CLAUSE_LAZY);
+  assert(n && SAT_lit_value_r(S, lit[0]) == VAL_TRUE);
+  assert(SAT_lit_reason(S, lit[0]) == CLAUSE_LAZY);
   for (i = 0; i < n; i++)
-    assert((i == 0 || SAT_lit_value(lit[i]) == VAL_FALSE) &&
-	   SAT_lit_level(lit[i]) <= SAT_lit_level(lit[0]) &&
+    assert((i == 0 || SAT_lit_value_r(S, lit[i]) == VAL_FALSE) &&
+	   SAT_lit_level_r(S, lit[i]) <= SAT_lit_level_r(S, lit[0]) &&
 	   (i == 0 || lit[i] != lit[i - 1]));
 #endif
   for (j = 1, i = 1; i < n; ++i)
-    if (SAT_lit_value(lit[i]) != VAL_FALSE ||
-	SAT_lit_level(lit[i]) != ROOT_LEVEL)
+    if (SAT_lit_value_r(S, lit[i]) != VAL_FALSE ||
+	SAT_lit_level_r(S, lit[i]) != ROOT_LEVEL)
       lit[j++] = lit[i];
 #ifdef PROOF
     else if (SAT_proof)
       {
 	if (i == j)
 	  {
-	    Tlit * Plit2;
-	    MY_MALLOC(Plit2, n * sizeof(Tlit));
-	    memcpy(Plit2, lit, n * sizeof(Tlit));
-	    clause = clause_new(n, Plit2, 0, 0, 0);
+	    clause = clause_new(S, n, lit, 0, 0, 0);
 #ifdef INSIDE_VERIT
 	    proof_SAT_set_id(clause);
 #endif
-	    proof_begin(clause);
+	    proof_begin(S, clause);
 	  }
-	assert(SAT_lit_reason(lit[i]) && SAT_lit_reason(lit[i]) != CLAUSE_LAZY);
-	proof_resolve(lit[i], SAT_lit_reason(lit[i]));
+	assert(SAT_lit_reason(S, lit[i]) && SAT_lit_reason(S, lit[i]) != CLAUSE_LAZY);
+	proof_resolve(S, lit[i], SAT_lit_reason(S, lit[i]));
       }
   if (SAT_proof && n != j)
     {
       n = j;
-      MY_REALLOC(lit, n * sizeof(lit));
-      clause = clause_new(n, lit, 0, 1, 1);
-      proof_end(clause);
+      clause = clause_new(S, n, lit, 0, 1, 1);
+      proof_end(S, clause);
     }
   else
     {
       n = j;
-      MY_REALLOC(lit, n * sizeof(lit));
-      clause = clause_new(n, lit, 0, 1, 1);
+      clause = clause_new(S, n, lit, 0, 1, 1);
 #ifdef INSIDE_VERIT
       if (SAT_proof)
 	proof_SAT_set_id(clause);
@@ -4428,21 +6796,21 @@ SAT_clause_new_lazy(unsigned n, Tlit * lit)
     }
 #else /* PROOF */
   n = j;
-  MY_REALLOC(lit, n * sizeof(lit));
-  clause = clause_new(n, lit, 0, 1, 1);
+  clause = clause_new(S, n, lit, 0, 1, 1);
 #endif /* PROOF */
 #ifdef EXPERIMENT_WITH_ACTIVITY
-  var_decrease_activity();
+  var_decrease_activity(S);
   for (i = 0; i < n; i++)
-    var_increase_activity(SAT_lit_var(lit[i]));
-  var_decrease_activity();
+    var_increase_activity(S, SAT_lit_var(lit[i]));
+  var_decrease_activity(S);
   for (i = 0; i < n; i++)
-    var_increase_activity(SAT_lit_var(lit[i]));
+    var_increase_activity(S, SAT_lit_var(lit[i]));
 #endif
-  SAT_var_set_reason(SAT_lit_var(lit[0]), clause);
+  SAT_var_set_reason(S, SAT_lit_var(lit[0]), clause);
+  free(lit);
 #if defined(DEBUG_SAT) && DEBUG_LEVEL > 1
-  check_consistency();
-  check_consistency_heap();
+  check_consistency(S);
+  check_consistency_heap(S);
 #endif
   return clause;
 }
@@ -4450,45 +6818,274 @@ SAT_clause_new_lazy(unsigned n, Tlit * lit)
 /*--------------------------------------------------------------*/
 
 Tclause
-SAT_clause_new(unsigned n, Tlit * lit)
+SAT_clause_new_r(SAT_Tsolver * S, unsigned n, Tlit * lit)
 {
-  return SAT_clause_new_aux(n, lit, 0);
+  return SAT_clause_new_aux(S, n, lit, 0);
 }
 
 /*--------------------------------------------------------------*/
 
 Tclause
-SAT_clause_new_conflict(unsigned n, Tlit * lit)
+SAT_clause_new_conflict_r(SAT_Tsolver * S, unsigned n, Tlit * lit)
 {
-  return SAT_clause_new_aux(n, lit, 1);
+  return SAT_clause_new_aux(S, n, lit, 1);
 }
 
 /*--------------------------------------------------------------*/
 
-#ifdef BACKTRACK
 /**
-   \author Pascal Fontaine
-   \brief adds a backtrackable point */
+   \brief adds clauses given in compressed sparse form
+   \remark stacks of clauses are sized once, and literals are all
+   converted in a single buffer */
 void
-SAT_push(void)
+SAT_clauses_load_csc_r(SAT_Tsolver * S, unsigned n, const size_t * start,
+		       const size_t * index, const double * value)
 {
-  STACK_RESIZE_EXP(history, history_n + 2, history_size, sizeof(Tclause));
-#ifndef PRESERVE_CLAUSES
-  history[history_n].history_type = SAVE_CLAUSE_FREE_LIST;
-  history[history_n++].clause = first_free_clause;
-  first_free_clause = CLAUSE_UNDEF;
-#endif
-  history[history_n].history_type = PUSH_MARKUP;
-  history[history_n++].clause = stack_clause_n;
-}
-
-/*--------------------------------------------------------------*/
-
-/**
-   \author Pascal Fontaine
-   \brief backtracks to the latest backtrackable point */
+  size_t k, m = start[n] - start[0];
+  unsigned i, j;
+  Tvar var_max = 0;
+  Tlit * lit;
+  if (m >= (1u << 31) - stack_clause_lit_n)
+    my_error ("too many literals in clauses\n");
+  MY_MALLOC(lit, (m ? m : 1) * sizeof(Tlit));
+  for (k = 0; k < m; k++)
+    {
+      Tvar var = (Tvar) index[start[0] + k] + 1;
+      if (value[start[0] + k] == 0)
+	{
+	  /* no variable 0, this marks entries to skip */
+	  lit[k] = 0;
+	  continue;
+	}
+      if (var > var_max)
+	var_max = var;
+      lit[k] = SAT_lit(var, (value[start[0] + k] > 0));
+    }
+  SAT_var_new_id_r(S, var_max);
+  STACK_RESIZE_EXP(stack_clause, stack_clause_n + n + 1,
+		   stack_clause_size, sizeof(TSclause));
+  STACK_RESIZE_EXP(stack_clause_lit, stack_clause_lit_n + (unsigned) m,
+		   stack_clause_lit_size, sizeof(Tlit));
+  for (i = 0; i < n; i++)
+    {
+      Tlit * Plit = lit + (start[i] - start[0]);
+      unsigned n_lit = (unsigned) (start[i + 1] - start[i]);
+      for (j = 0, k = 0; k < n_lit; k++)
+	if (Plit[k])
+	  Plit[j++] = Plit[k];
+      clause_add(S, j, Plit, 0);
+    }
+  free(lit);
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief adds a cardinality constraint
+   \remark literals of root level are taken into account once and for
+   all, so are not stored.  Constraints that cannot be violated are not
+   stored either, and those allowing no true literal are units */
 void
-SAT_pop(void)
+SAT_card_new_r(SAT_Tsolver * S, unsigned n, const SAT_Tlit * lit, unsigned k)
+{
+  unsigned i, j, count = 0, c;
+  TScard * Pcard;
+#ifdef PROOF
+  if (SAT_proof)
+    my_error("cardinality constraints are not supported with proofs\n");
+#endif
+  if (SAT_status == SAT_STATUS_UNSAT)
+    return;
+  SAT_status = SAT_STATUS_UNDEF;
+  level_backtrack(S, ROOT_LEVEL);
+#ifdef ELIM
+  for (i = 0; i < n && elim_stack_n; i++)
+    if (SAT_stack_var[SAT_lit_var(lit[i])].eliminated)
+      elim_restore(S);
+#endif
+  if (n >= (1u << 30) - stack_card_lit_n)
+    my_error("too many literals in cardinality constraints\n");
+  STACK_RESIZE_EXP(stack_card_lit, stack_card_lit_n + n, stack_card_lit_size,
+		   sizeof(Tlit));
+  for (i = j = 0; i < n; i++)
+    if (SAT_lit_value_undef(S, lit[i]))
+      stack_card_lit[stack_card_lit_n + j++] = lit[i];
+    else
+      count += SAT_lit_value_is_true(S, lit[i]);
+  if (count > k)
+    {
+      clause_add(S, 0, NULL, 0);
+      return;
+    }
+  k -= count;
+  if (j <= k)
+    return;
+  if (k == 0)
+    {
+      for (i = 0; i < j; i++)
+	{
+	  Tlit neg = SAT_lit_neg(stack_card_lit[stack_card_lit_n + i]);
+	  clause_add(S, 1, &neg, 0);
+	}
+      return;
+    }
+  c = stack_card_n++;
+  STACK_RESIZE_EXP(stack_card, stack_card_n, stack_card_size, sizeof(TScard));
+  Pcard = stack_card + c;
+  Pcard->k = k;
+  Pcard->n = j;
+  Pcard->offset = stack_card_lit_n;
+  stack_card_lit_n += j;
+  for (i = 0; i < j; i++)
+    {
+      card_watch_add(S, CARD_LIT(Pcard)[i], c);
+      SAT_stack_var[SAT_lit_var(CARD_LIT(Pcard)[i])].card = 1;
+    }
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief adds the constraint that exactly one literal is true, as a
+   clause and a cardinality constraint */
+void
+SAT_exactly_one_r(SAT_Tsolver * S, unsigned n, const SAT_Tlit * lit)
+{
+  Tlit * lit2;
+  MY_MALLOC(lit2, (n ? n : 1) * sizeof(Tlit));
+  memcpy(lit2, lit, n * sizeof(Tlit));
+  SAT_clause_new_r(S, n, lit2);
+  SAT_card_new_r(S, n, lit, 1);
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief adds cardinality constraints given in compressed sparse form
+   \remark see SAT_clauses_load_csc_r */
+void
+SAT_cards_load_csc_r(SAT_Tsolver * S, unsigned n, const size_t * start,
+		     const size_t * index, const double * value,
+		     const unsigned * k)
+{
+  size_t l, m = start[n] - start[0];
+  unsigned i, j;
+  Tvar var_max = 0;
+  Tlit * lit;
+  MY_MALLOC(lit, (m ? m : 1) * sizeof(Tlit));
+  for (l = 0; l < m; l++)
+    {
+      Tvar var = (Tvar) index[start[0] + l] + 1;
+      if (value[start[0] + l] == 0)
+	{
+	  lit[l] = 0;
+	  continue;
+	}
+      if (var > var_max)
+	var_max = var;
+      lit[l] = SAT_lit(var, (value[start[0] + l] > 0));
+    }
+  SAT_var_new_id_r(S, var_max);
+  for (i = 0; i < n; i++)
+    {
+      Tlit * Plit = lit + (start[i] - start[0]);
+      unsigned n_lit = (unsigned) (start[i + 1] - start[i]);
+      for (j = 0, l = 0; l < n_lit; l++)
+	if (Plit[l])
+	  Plit[j++] = Plit[l];
+      SAT_card_new_r(S, j, Plit, k[i]);
+    }
+  free(lit);
+}
+
+/*--------------------------------------------------------------*/
+
+#ifdef BACKTRACK
+/**
+   \author Pascal Fontaine
+   \brief adds a backtrackable point */
+void
+SAT_push_r(SAT_Tsolver * S)
+{
+  STACK_RESIZE_EXP(history, history_n + 4, history_size, sizeof(Thistory));
+  history[history_n].history_type = SAVE_CARD_N;
+  history[history_n++].clause = stack_card_n;
+#ifndef PRESERVE_CLAUSES
+  history[history_n].history_type = SAVE_CLAUSE_FREE_LIST;
+  history[history_n++].clause = first_free_clause;
+  first_free_clause = CLAUSE_UNDEF;
+#endif
+  history[history_n].history_type = SAVE_STACK_LIT_UNIT;
+  history[history_n++].clause = stack_lit_unit;
+  history[history_n].history_type = PUSH_MARKUP;
+  history[history_n++].clause = stack_clause_n;
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief removes clauses and consequences added since a push
+   \param stack_clause_bt the number of clauses at the time of the push
+   \param stack_lit_bt the number of root literals at the time of the push
+   \remark learnt clauses may depend on removed clauses, or have been
+   simplified with removed root literals.  They are all discarded,
+   except those that are the reason of a remaining root literal */
+static void
+history_pop_markup(SAT_Tsolver * S, Tclause stack_clause_bt,
+		   unsigned stack_lit_bt)
+{
+  Tclause * i, * j, * n;
+  level_backtrack(S, ROOT_LEVEL);
+  while (stack_lit_n > stack_lit_bt)
+    {
+      stack_lit_n--;
+      SAT_lit_set_unseen(S, stack_lit[stack_lit_n]);
+      var_unset(S, SAT_lit_var(stack_lit[stack_lit_n]));
+    }
+  stack_lit_unit = stack_lit_n;
+  if (stack_lit_n < stack_lit_hold)
+    stack_lit_hold = stack_lit_n;
+  /* watches of restored clauses may be on root literals */
+  stack_lit_to_propagate = 0;
+  while (stack_clause_n > stack_clause_bt)
+    clause_remove(S, stack_clause_n--);
+  i = j = learnts;
+  n = learnts + learnts_n;
+  for (; i != n; i++)
+    {
+      TSclause * PSclause = stack_clause + *i;
+      unsigned k;
+      if (*i > stack_clause_n || PSclause->deleted)
+	continue;
+      for (k = 0; k < PSclause->n; k++)
+	if (SAT_lit_value_r(S, CLAUSE_LIT(PSclause)[k]) == VAL_TRUE &&
+	    SAT_lit_reason(S, CLAUSE_LIT(PSclause)[k]) == *i)
+	  break;
+      if (k < PSclause->n)
+	{
+	  *(j++) = *i;
+	  continue;
+	}
+#ifdef BCLAUSE_LIGHT
+      if (PSclause->n == 2)
+	bclause_remove(S, *i, CLAUSE_LIT(PSclause)[0], CLAUSE_LIT(PSclause)[1]);
+#endif
+      clause_lazy_delete(S, *i);
+    }
+  learnts_n = (unsigned) (j - learnts);
+  learnts_kept = 0;
+  batch_rm_clauses_1(S);
+  if (SAT_status == SAT_STATUS_SAT)
+    SAT_status = SAT_STATUS_UNDEF;
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \author Pascal Fontaine
+   \brief backtracks to the latest backtrackable point */
+void
+SAT_pop_r(SAT_Tsolver * S)
 {
   while (history_n)
     {
@@ -4498,8 +7095,20 @@ SAT_pop(void)
 	case PUSH_MARKUP :
 	  {
 	    unsigned stack_clause_bt = history[history_n].clause;
-	    while (stack_clause_n > stack_clause_bt)
-	      clause_remove(stack_clause_n--);
+	    unsigned stack_lit_bt, card_n;
+	    assert(history_n &&
+		   history[history_n - 1].history_type == SAVE_STACK_LIT_UNIT);
+	    stack_lit_bt = history[--history_n].clause;
+#ifndef PRESERVE_CLAUSES
+	    assert(history_n &&
+		   history[history_n - 1].history_type == SAVE_CLAUSE_FREE_LIST);
+	    first_free_clause = history[--history_n].clause;
+#endif
+	    assert(history_n &&
+		   history[history_n - 1].history_type == SAVE_CARD_N);
+	    card_n = history[--history_n].clause;
+	    history_pop_markup(S, stack_clause_bt, stack_lit_bt);
+	    card_pop(S, card_n);
 	    assert(stack_clause_n == stack_clause_bt);
 	  }
 	  return;
@@ -4509,13 +7118,8 @@ SAT_pop(void)
 	  SAT_status = SAT_STATUS_UNDEF;
 	  break;
 	case CLAUSE_UNSET_WATCHED :
-	  clause_set_watched(history[history_n].clause);
-	  break;
-#ifndef PRESERVE_CLAUSES
-	case SAVE_CLAUSE_FREE_LIST :
-	  first_free_clause = history[history_n].clause;
+	  clause_set_watched(S, history[history_n].clause);
 	  break;
-#endif
 	default :
 	  my_error("internal error: strange history type\n");
 	}
@@ -4535,20 +7139,24 @@ SAT_pop(void)
 #define SAT_VAL_MASK2 (1 << 5)
 
 void
-SAT_minimal_model(SAT_Tlit ** PPlit, unsigned *n, unsigned options)
+SAT_minimal_model_r(SAT_Tsolver * S, SAT_Tlit ** PPlit, unsigned *n, unsigned options)
 {
   unsigned i, j;
-  Twatch * clauses_by_lit = NULL;
+  Tclause_list * clauses_by_lit = NULL;
   unsigned * clauses_counter = NULL;
   Tclause clause;
   TSclause * PSclause;
   assert(SAT_stack_var_n == SAT_literal_stack_n);
   /* For each literal, associate the set of non-learnt clauses */
   /* For each clause, compute the number of satisfied literals */
-  i = (unsigned) (((SAT_stack_var_n + 1) * 2) * sizeof(Twatch));
+  i = (unsigned) (((SAT_stack_var_n + 1) * 2) * sizeof(Tclause_list));
   MY_MALLOC(clauses_by_lit, i);
   memset(clauses_by_lit, 0, i);
+#ifdef ELIM
+  i = (stack_clause_n + elim_clause_n + 1u) * (unsigned) sizeof(unsigned);
+#else
   i = (stack_clause_n + 1u) * (unsigned) sizeof(unsigned);
+#endif
   MY_MALLOC(clauses_counter, i);
   memset(clauses_counter, 0, i);
   for (i = 1, PSclause = stack_clause + 1; i <= stack_clause_n;
@@ -4556,17 +7164,30 @@ SAT_minimal_model(SAT_Tlit ** PPlit, unsigned *n, unsigned options)
     if (!PSclause->learnt && !PSclause->deleted)
       for (j = 0; j < PSclause->n; j++)
 	{
-	  Twatch * Pwatch = clauses_by_lit + PSclause->lit[j];
-	  if (Pwatch->n == Pwatch->size)
+	  clause_list_add(clauses_by_lit + CLAUSE_LIT(PSclause)[j], i);
+	  if (SAT_lit_value_is_true(S, CLAUSE_LIT(PSclause)[j]))
+	    clauses_counter[i]++;
+	}
+#ifdef ELIM
+  /* clauses of eliminated variables have to be satisfied as well.
+     They are numbered after the others */
+  for (i = elim_stack_n, clause = stack_clause_n; i; )
+    {
+      unsigned k = elim_stack[--i], m;
+      for (--i; k; k--)
+	{
+	  m = elim_stack[--i];
+	  i -= m;
+	  clause++;
+	  for (j = 0; j < m; j++)
 	    {
-	      Pwatch->size += !Pwatch->size;
-	      Pwatch->size <<= 1;
-	      MY_REALLOC(Pwatch->Pclause, (Pwatch->size * sizeof(Tclause)));
+	      clause_list_add(clauses_by_lit + elim_stack[i + j], clause);
+	      if (SAT_lit_value_is_true(S, elim_stack[i + j]))
+		clauses_counter[clause]++;
 	    }
-	  Pwatch->Pclause[Pwatch->n++] = i;
-	  if (SAT_lit_value_is_true(PSclause->lit[j]))
-	    clauses_counter[i]++;
 	}
+    }
+#endif
   if (!*n)
     {
       /* Copy the literal stack */
@@ -4580,8 +7201,11 @@ SAT_minimal_model(SAT_Tlit ** PPlit, unsigned *n, unsigned options)
   /* A literal whose clauses are multi-satisfied can be eliminated */
   for (i = 0; i < SAT_literal_stack_n; i++)
     {
-      Twatch * Pwatch = clauses_by_lit + (*PPlit)[i];
-      if ((options & SAT_MIN_SKIP_PROPAGATED) && SAT_lit_reason((*PPlit)[i]))
+      Tclause_list * Pwatch = clauses_by_lit + (*PPlit)[i];
+      if ((options & SAT_MIN_SKIP_PROPAGATED) && SAT_lit_reason(S, (*PPlit)[i]))
+	continue;
+      /* constraints are not clauses: their literals are kept */
+      if (SAT_stack_var[SAT_lit_var((*PPlit)[i])].card)
 	continue;
       for (j = 0; j < Pwatch->n; j++)
 	if (clauses_counter[Pwatch->Pclause[j]] == 1)
@@ -4607,7 +7231,7 @@ SAT_minimal_model(SAT_Tlit ** PPlit, unsigned *n, unsigned options)
 	  Tlit lit = LIT_UNDEF;
 	  for (j = 0; j < PSclause->n; j++)
 	    {
-	      Tvalue val = SAT_lit_value(PSclause->lit[j]);
+	      Tvalue val = SAT_lit_value_r(S, CLAUSE_LIT(PSclause)[j]);
 	      if (val & (SAT_VAL_MASK | SAT_VAL_MASK2))
 		goto next_clause;
 	      if (val == VAL_UNDEF)
@@ -4616,7 +7240,7 @@ SAT_minimal_model(SAT_Tlit ** PPlit, unsigned *n, unsigned options)
 		{
 		  if (lit != LIT_UNDEF)
 		    goto next_clause;
-		  lit = PSclause->lit[j];
+		  lit = CLAUSE_LIT(PSclause)[j];
 		}
 	      assert(val == VAL_FALSE);
 	    }
@@ -4626,11 +7250,12 @@ SAT_minimal_model(SAT_Tlit ** PPlit, unsigned *n, unsigned options)
 #else
   if (options & SAT_MIN_USE_TAUTOLOGIES)
     for (i = SAT_literal_stack_n; i-- > 0; )
-      if ((clause = SAT_lit_reason((*PPlit)[i])) &&
+      if ((clause = SAT_lit_reason(S, (*PPlit)[i])) &&
+	  !CLAUSE_IS_CARD(clause) &&
 	  (PSclause = stack_clause + clause)->conflict)
 	{
 	  for (j = 0; j < PSclause->n; j++)
-	    if (SAT_lit_value(PSclause->lit[j]) & SAT_VAL_MASK)
+	    if (SAT_lit_value_r(S, CLAUSE_LIT(PSclause)[j]) & SAT_VAL_MASK)
 	      goto next_clause;
 	  assign[SAT_lit_var((*PPlit)[i])] |= SAT_VAL_MASK2;
 	next_clause: ;
@@ -4638,291 +7263,3217 @@ SAT_minimal_model(SAT_Tlit ** PPlit, unsigned *n, unsigned options)
 #endif
   /* Compress the literal stack */
   for (i = j = 0; i < SAT_literal_stack_n; i++)
-    if (SAT_lit_value((*PPlit)[i]) & (SAT_VAL_MASK | SAT_VAL_MASK2))
+    if (SAT_lit_value_r(S, (*PPlit)[i]) & (SAT_VAL_MASK | SAT_VAL_MASK2))
       assign[SAT_lit_var((*PPlit)[i])] &= 3;
     else
       (*PPlit)[j++] = (*PPlit)[i];
   *n = j;
 }
 
-/*
-  --------------------------------------------------------------
-  init and done
-  --------------------------------------------------------------
-*/
+/*
+  --------------------------------------------------------------
+  model enumeration
+  --------------------------------------------------------------
+*/
+
+/**
+   \remark once a model is found, it is blocked by a clause, which is
+   added without restarting: it backtracks just to its highest level.
+   Without projection, the clause is the negation of the decisions,
+   since they determine the model by propagation.  With projection, it
+   is the negation of the model restricted to the variables projected on
+   \remark preprocessing would drop the models on eliminated variables,
+   so it is not done */
+unsigned long
+SAT_models_r(SAT_Tsolver * S, unsigned n, SAT_Tvar * var, unsigned long max,
+	     SAT_Tmodel_callback callback, void * data)
+{
+  unsigned long count = 0;
+  bool preprocess = S->state.params.preprocess;
+  Tlit * lit;
+  unsigned i, m;
+  S->state.params.preprocess = false;
+#ifdef ELIM
+  if (elim_stack_n)
+    elim_restore(S);
+#endif
+  MY_MALLOC(lit, ((n ? n : SAT_stack_var_n) + 1) * sizeof(Tlit));
+  while ((!max || count < max) && SAT_solve_r(S) == SAT_STATUS_SAT)
+    {
+      count++;
+      m = 0;
+      if (n)
+	{
+	  for (i = 0; i < n; i++)
+	    if (SAT_var_value_r(S, var[i]) != VAL_UNDEF &&
+		SAT_var_level_r(S, var[i]) != ROOT_LEVEL)
+	      lit[m++] = SAT_lit(var[i], (SAT_var_value_r(S, var[i]) ==
+					  VAL_FALSE));
+	}
+      else
+	for (i = stack_lit_unit; i < stack_lit_n; i++)
+	  if (SAT_lit_reason(S, stack_lit_get(S, i)) == CLAUSE_UNDEF)
+	    lit[m++] = SAT_lit_neg(stack_lit_get(S, i));
+      if (callback && !callback(S, data))
+	max = count;
+      clause_add(S, m, lit, 0);
+    }
+  free(lit);
+  S->state.params.preprocess = preprocess;
+  return count;
+}
+
+/*
+  --------------------------------------------------------------
+  backbone
+  --------------------------------------------------------------
+*/
+
+/*
+  The backbone is computed by iterative assumption solving on the
+  instance itself, so that learnt clauses are kept from a call to the
+  next.  Candidates are the literals true in a first model.  A chunk of
+  candidates is refuted at once by assuming all their negations: a model
+  drops every candidate it falsifies, at least the whole chunk.
+  Otherwise, the assumptions core tells which candidates are involved:
+  a single one is in the backbone, and is added as a unit, while a larger
+  core is moved first and tried again in a chunk half its size.  Chunks
+  grow back after each model, up to BACKBONE_CHUNK.
+*/
+
+#define BACKBONE_CHUNK 64
+
+/**
+   \remark preprocessing is not done, it would drop the values of
+   eliminated variables
+   \remark candidates true at root level are in the backbone without
+   further solving */
+Tstatus
+SAT_backbone_r(SAT_Tsolver * S, unsigned n, SAT_Tvar * var,
+	       SAT_Tlit ** PPlit, unsigned * lit_n)
+{
+  bool preprocess = S->state.params.preprocess;
+  Tlit * cand, * assumption;
+  bool * in;
+  unsigned i, j, k, m, cand_n = 0, chunk = BACKBONE_CHUNK;
+  Tstatus status;
+  *lit_n = 0;
+  S->state.params.preprocess = false;
+#ifdef ELIM
+  if (elim_stack_n)
+    elim_restore(S);
+#endif
+  status = SAT_solve_r(S);
+  if (status != SAT_STATUS_SAT)
+    {
+      S->state.params.preprocess = preprocess;
+      return status;
+    }
+  m = n ? n : SAT_stack_var_n;
+  MY_MALLOC(cand, (m + 1) * sizeof(Tlit));
+  MY_MALLOC(assumption, (BACKBONE_CHUNK + 1) * sizeof(Tlit));
+  MY_MALLOC(in, (SAT_stack_var_n + 1) * sizeof(bool));
+  memset(in, 0, (SAT_stack_var_n + 1) * sizeof(bool));
+  MY_REALLOC(*PPlit, (m + 1) * sizeof(Tlit));
+  for (i = 0; i < m; i++)
+    {
+      Tvar v = n ? var[i] : i + 1;
+      /* variables given twice are considered once */
+      if (in[v] || SAT_var_value_r(S, v) == VAL_UNDEF)
+	continue;
+      in[v] = true;
+      cand[cand_n++] = SAT_lit(v, (SAT_var_value_r(S, v) == VAL_TRUE));
+    }
+  memset(in, 0, (SAT_stack_var_n + 1) * sizeof(bool));
+  while (true)
+    {
+      /* candidates falsified by the model, if any, are dropped, and those
+	 true at root level are in the backbone */
+      for (i = 0, j = 0; i < cand_n; i++)
+	if (SAT_lit_value_r(S, cand[i]) == VAL_FALSE)
+	  continue;
+	else if (SAT_lit_value_r(S, cand[i]) == VAL_TRUE &&
+		 SAT_lit_level_r(S, cand[i]) == ROOT_LEVEL)
+	  (*PPlit)[(*lit_n)++] = cand[i];
+	else
+	  cand[j++] = cand[i];
+      cand_n = j;
+      if (!cand_n)
+	{
+	  status = SAT_STATUS_SAT;
+	  break;
+	}
+      k = cand_n < chunk ? cand_n : chunk;
+      for (i = 0; i < k; i++)
+	assumption[i] = SAT_lit_neg(cand[i]);
+      status = SAT_solve_assuming_r(S, k, assumption);
+      if (status == SAT_STATUS_SAT)
+	{
+	  chunk = 2 * chunk < BACKBONE_CHUNK ? 2 * chunk : BACKBONE_CHUNK;
+	  continue;
+	}
+      /* the clauses have a model, and only implied units are added, so
+	 the core is not empty */
+      if (status != SAT_STATUS_UNSAT || !assumption_core_n)
+	break;
+      if (assumption_core_n == 1)
+	{
+	  /* at root level, the next filtering gives it */
+	  assumption[0] = SAT_lit_neg(assumption_core[0]);
+	  clause_add(S, 1, assumption, 0);
+	  SAT_propagate_r(S);
+	  continue;
+	}
+      /* the core goes first, the other candidates keep their order */
+      for (i = 0; i < assumption_core_n; i++)
+	in[SAT_lit_var(assumption_core[i])] = true;
+      for (i = 0, j = 0; i < k; i++)
+	if (in[SAT_lit_var(cand[i])])
+	  assumption[j++] = cand[i];
+      for (i = k, m = k; i-- > 0; )
+	if (!in[SAT_lit_var(cand[i])])
+	  cand[--m] = cand[i];
+      memcpy(cand, assumption, j * sizeof(Tlit));
+      for (i = 0; i < j; i++)
+	in[SAT_lit_var(cand[i])] = false;
+      chunk = j / 2;
+    }
+  veriT_qsort(*PPlit, *lit_n, sizeof(Tlit), (TFcmp) SAT_lit_compare);
+  free(cand);
+  free(assumption);
+  free(in);
+  S->state.params.preprocess = preprocess;
+  return status;
+}
+
+/*
+  --------------------------------------------------------------
+  minimal unsatisfiable subsets
+  --------------------------------------------------------------
+*/
+
+/*
+  Subsets are of assumptions, typically selectors: clauses of a group
+  are added with the negation of its selector, and assuming the
+  selector enables the group.  All is done by assumption solving on the
+  instance itself, so clauses learnt for a subset help for the next.
+  The first core is trimmed by solving again under it until it no longer
+  shrinks (at most MUS_TRIM times), then minimized:
+  - by deletion: each literal left is dropped in turn.  If the others
+  are still inconsistent, the literals outside their core are dropped
+  too (clause set refinement), otherwise the literal is necessary, and
+  kept for good.  This takes a call per literal of the result at least.
+  - by QuickXplain: the literals are split in two halves, the minimal
+  subset of the second one given the first one is found, and then the
+  minimal subset of the first one given it.  This takes about
+  2 k log(n / k) calls for a result of k out of n literals, which is
+  better when k is small.
+*/
+
+#define MUS_TRIM 3
+
+/**
+   \brief state of a minimization */
+typedef struct Tmus
+{
+  Tlit * assumption;        /**< background literals, and buffer */
+  Tlit * mus;               /**< literals of the minimal subset */
+  unsigned mus_n;
+  Tstatus status;           /**< SAT_STATUS_UNDEF if interrupted */
+} Tmus;
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief keeps the literals of lit that are in the assumptions core
+   \param n the number of literals
+   \param mark a flag per literal, all false, left so
+   \return the number of literals kept, in the same order */
+static unsigned
+mus_refine(SAT_Tsolver * S, Tlit * lit, unsigned n, bool * mark)
+{
+  unsigned i, j;
+  for (i = 0; i < assumption_core_n; i++)
+    mark[assumption_core[i]] = true;
+  for (i = 0, j = 0; i < n; i++)
+    if (mark[lit[i]])
+      lit[j++] = lit[i];
+  for (i = 0; i < assumption_core_n; i++)
+    mark[assumption_core[i]] = false;
+  return j;
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief minimizes by deletion
+   \param lit the literals, inconsistent, set to a minimal subset
+   \param n the number of literals
+   \param mark as for mus_refine
+   \return the number of literals of the minimal subset */
+static unsigned
+mus_deletion(SAT_Tsolver * S, Tmus * M, Tlit * lit, unsigned n, bool * mark)
+{
+  unsigned necessary = 0;
+  /* necessary literals are first, the last one is tried */
+  while (necessary < n)
+    {
+      Tlit tmp = lit[n - 1];
+      M->status = SAT_solve_assuming_r(S, n - 1, lit);
+      if (M->status == SAT_STATUS_SAT)
+	{
+	  lit[n - 1] = lit[necessary];
+	  lit[necessary++] = tmp;
+	}
+      else if (M->status == SAT_STATUS_UNSAT)
+	/* necessary literals are in every core */
+	n = mus_refine(S, lit, n - 1, mark);
+      else
+	return n;
+    }
+  M->status = SAT_STATUS_UNSAT;
+  return n;
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief QuickXplain: adds to M->mus a minimal subset of the n
+   literals of lit, inconsistent with the b first literals of
+   M->assumption
+   \param check whether the background may be inconsistent alone */
+static void
+mus_quickxplain(SAT_Tsolver * S, Tmus * M, unsigned b, Tlit * lit,
+		unsigned n, bool check)
+{
+  unsigned h = n / 2, start = M->mus_n;
+  if (check)
+    {
+      M->status = SAT_solve_assuming_r(S, b, M->assumption);
+      if (M->status != SAT_STATUS_SAT)
+	return;
+    }
+  if (n == 1)
+    {
+      M->mus[M->mus_n++] = lit[0];
+      return;
+    }
+  memcpy(M->assumption + b, lit, h * sizeof(Tlit));
+  mus_quickxplain(S, M, b + h, lit + h, n - h, true);
+  if (M->status == SAT_STATUS_UNDEF)
+    return;
+  memcpy(M->assumption + b, M->mus + start,
+	 (M->mus_n - start) * sizeof(Tlit));
+  mus_quickxplain(S, M, b + M->mus_n - start, lit, h, M->mus_n > start);
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \remark the instance gets learnt clauses only */
+Tstatus
+SAT_mus_r(SAT_Tsolver * S, unsigned n, SAT_Tlit * lit, SAT_Tlit ** PPlit,
+	  unsigned * lit_n, unsigned options)
+{
+  Tmus M;
+  Tlit * core;
+  bool * mark;
+  unsigned i, core_n;
+  *lit_n = 0;
+  M.status = SAT_solve_assuming_r(S, n, lit);
+  if (M.status != SAT_STATUS_UNSAT)
+    return M.status;
+  core_n = assumption_core_n;
+  MY_MALLOC(core, (core_n + 1) * sizeof(Tlit));
+  for (i = 0; i < core_n; i++)
+    core[i] = assumption_core[i];
+  MY_MALLOC(mark, (2 * SAT_stack_var_n + 2) * sizeof(bool));
+  memset(mark, 0, (2 * SAT_stack_var_n + 2) * sizeof(bool));
+  for (i = 0; i < MUS_TRIM && core_n > 1 && M.status == SAT_STATUS_UNSAT &&
+	 !(options & SAT_MUS_CORE); i++)
+    {
+      unsigned core_n2 = core_n;
+      M.status = SAT_solve_assuming_r(S, core_n, core);
+      if (M.status == SAT_STATUS_UNSAT)
+	core_n = mus_refine(S, core, core_n, mark);
+      if (core_n == core_n2)
+	break;
+    }
+  if (M.status == SAT_STATUS_UNSAT && core_n > 1 && !(options & SAT_MUS_CORE))
+    {
+      if (options & SAT_MUS_QUICKXPLAIN)
+	{
+	  MY_MALLOC(M.assumption, core_n * sizeof(Tlit));
+	  MY_MALLOC(M.mus, core_n * sizeof(Tlit));
+	  M.mus_n = 0;
+	  mus_quickxplain(S, &M, 0, core, core_n, false);
+	  if (M.status != SAT_STATUS_UNDEF)
+	    {
+	      M.status = SAT_STATUS_UNSAT;
+	      memcpy(core, M.mus, M.mus_n * sizeof(Tlit));
+	      core_n = M.mus_n;
+	    }
+	  free(M.assumption);
+	  free(M.mus);
+	}
+      else
+	core_n = mus_deletion(S, &M, core, core_n, mark);
+    }
+  if (M.status == SAT_STATUS_UNSAT)
+    {
+      MY_REALLOC(*PPlit, (core_n + 1) * sizeof(Tlit));
+      memcpy(*PPlit, core, core_n * sizeof(Tlit));
+      *lit_n = core_n;
+    }
+  free(core);
+  free(mark);
+  return M.status;
+}
+
+/*
+  --------------------------------------------------------------
+  model counting
+  --------------------------------------------------------------
+*/
+
+/*
+  Models are counted by an exhaustive DPLL on the propagation of the
+  solver.  The unassigned variables are split into components, i.e.
+  sets of variables connected by the input clauses not yet satisfied,
+  and the count is the product of those of the components.  A
+  component is counted by deciding each polarity of one of its
+  variables, and counting the components of what is left.  The counts
+  of components are cached, keyed by their variables and clauses,
+  which determine what is left of the clauses.
+  Learnt clauses are used by propagation, but not to build components.
+  They may then assign variables of other components, which is sound as
+  long as the clauses are satisfiable under the current assignment.
+  Otherwise, some component counts 0, and the counts cached since the
+  assignment are dropped, since they may be too low.
+  No clause is learnt while counting: a branch refuted by propagation
+  just counts 0 (cardinality constraints still add their conflicts as
+  learnt clauses, which are not used either).
+  Cardinality constraints that some assignment of their unassigned
+  literals may violate connect these like clauses.  Their key is
+  CLAUSE_CARD with the position of their literals plus the number of
+  literals left to be true, which determines what is left of them.
+  The same search compiles the clauses into a decision-DNNF (see
+  below) when values are nodes instead of counts: products are and
+  nodes, sums of the two branches of a decision are or nodes, and the
+  cache maps components to their nodes.
+*/
+
+/**
+   \brief cached count of a component */
+typedef struct Tcount_entry
+{
+  unsigned hash;
+  unsigned next;            /**< next entry with the same bucket, 0 if none */
+  unsigned key;             /**< position of the key in keys */
+  unsigned var_n;           /**< number of variables of the component */
+  unsigned clause_n;        /**< number of clauses of the component */
+  double count;
+} Tcount_entry;
+
+/**
+   \brief state of a model count */
+typedef struct Tcount
+{
+  const double * weight;    /**< weights of literals, NULL for 1 */
+  SAT_Tnnf * nnf;           /**< circuit being compiled, NULL if counting */
+  Tclause_list * occur;     /**< input clauses by variable */
+  unsigned * var_stamp;     /**< marks of variables, by stamp */
+  unsigned * clause_stamp;  /**< marks of clauses, by stamp */
+  unsigned clause_n;        /**< number of clauses when counting started */
+  unsigned * card_stamp;    /**< marks of cardinality constraints, by stamp */
+  unsigned * score;         /**< occurrences of variables in a component */
+  unsigned stamp;
+  unsigned * stack;         /**< components being counted, each as
+			       number of variables, number of clauses,
+			       variables, clauses (sorted) */
+  unsigned stack_n;
+  unsigned stack_size;
+  Tvar * queue;             /**< variables of the component being built */
+  Tclause * clauses;        /**< clauses of the component being built */
+  unsigned clauses_size;
+  double * value;           /**< factors of the products being computed */
+  unsigned value_n;
+  unsigned value_size;
+  Tcount_entry * entry;     /**< cache, entry 0 is unused */
+  unsigned entry_n;
+  unsigned entry_size;
+  unsigned * bucket;        /**< first entry by hash, entry_size of them */
+  unsigned * keys;          /**< keys of entries, one after the other */
+  unsigned keys_n;
+  unsigned keys_size;
+} Tcount;
+
+#define COUNT_WEIGHT(C, lit) ((C)->weight ? (C)->weight[lit] : 1.0)
+
+/*
+  A decision-DNNF is a circuit of and/or nodes over literals, such that
+  the children of an and node share no variable, and the children of
+  an or node are the two branches of a decision, i.e. are conjunctions
+  with opposite literals on the decided variable.  Both branches, and
+  all models, are also on the same variables.  The weighted count is
+  then the value of the root, with the weights of literals, products
+  for and nodes and sums for or nodes, and the weighted count of the
+  models with a given literal is its weight times the derivative of the
+  root with respect to it, so all are computed in time linear in the
+  circuit.
+  Node 0 is false, node 1 is true, and node lit for lit from 2 to
+  2 * var_n + 1 is the literal.  Other nodes follow their children.
+*/
+
+#define NNF_LIT 0
+#define NNF_AND 1
+#define NNF_OR 2
+
+#define NNF_MAGIC 0x31464e4eu /* "NNF1" */
+
+struct SAT_Tnnf
+{
+  unsigned var_n;
+  unsigned node_n;
+  unsigned node_size;
+  unsigned char * kind;     /**< kind of each node */
+  unsigned * start;         /**< children of node i are child[start[i]]
+			       to child[start[i + 1] - 1] */
+  unsigned * child;
+  unsigned child_n;
+  unsigned child_size;
+  unsigned root;
+};
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief a new circuit with only the constants and literals
+   \param var_n the number of variables */
+static SAT_Tnnf *
+nnf_new(unsigned var_n)
+{
+  SAT_Tnnf * N;
+  MY_MALLOC(N, sizeof(SAT_Tnnf));
+  N->var_n = var_n;
+  N->node_n = N->node_size = 2 * var_n + 2;
+  MY_MALLOC(N->kind, N->node_size * sizeof(unsigned char));
+  memset(N->kind, NNF_LIT, N->node_size * sizeof(unsigned char));
+  MY_MALLOC(N->start, (N->node_size + 1) * sizeof(unsigned));
+  memset(N->start, 0, (N->node_size + 1) * sizeof(unsigned));
+  N->child = NULL;
+  N->child_n = N->child_size = 0;
+  N->root = 1;
+  return N;
+}
+
+/*--------------------------------------------------------------*/
+
+static void
+nnf_child(SAT_Tnnf * N, unsigned node)
+{
+  STACK_RESIZE_EXP(N->child, N->child_n + 1, N->child_size, sizeof(unsigned));
+  N->child[N->child_n++] = node;
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief a new node
+   \param kind NNF_AND or NNF_OR
+   \return the node, whose children are those added since the last node */
+static unsigned
+nnf_node(SAT_Tnnf * N, unsigned char kind)
+{
+  if (N->node_n + 1 >= N->node_size)
+    {
+      N->node_size *= 2;
+      MY_REALLOC(N->kind, N->node_size * sizeof(unsigned char));
+      MY_REALLOC(N->start, (N->node_size + 1) * sizeof(unsigned));
+    }
+  N->kind[N->node_n] = kind;
+  N->start[N->node_n + 1] = N->child_n;
+  return N->node_n++;
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief removes the nodes not reachable from the root
+   \remark search may have built nodes for components whose cache
+   entries were dropped */
+static void
+nnf_compact(SAT_Tnnf * N)
+{
+  unsigned first = 2 * N->var_n + 2, i, j, k, n, begin, end, * map;
+  MY_MALLOC(map, N->node_n * sizeof(unsigned));
+  memset(map, 0, N->node_n * sizeof(unsigned));
+  map[N->root] = 1;
+  for (i = N->node_n; i-- > first; )
+    if (map[i])
+      for (j = N->start[i]; j < N->start[i + 1]; j++)
+	map[N->child[j]] = 1;
+  for (i = 0; i < first; i++)
+    map[i] = i;
+  n = N->start[first];
+  for (i = k = first, begin = n; i < N->node_n; i++, begin = end)
+    {
+      end = N->start[i + 1];
+      if (!map[i])
+	continue;
+      map[i] = k;
+      N->kind[k] = N->kind[i];
+      for (j = begin; j < end; j++)
+	N->child[n++] = map[N->child[j]];
+      N->start[++k] = n;
+    }
+  N->root = map[N->root];
+  N->node_n = k;
+  N->child_n = n;
+  free(map);
+}
+
+/*--------------------------------------------------------------*/
+
+static int
+cmp_unsigned(const unsigned * P1, const unsigned * P2)
+{
+  return *P1 < *P2 ? -1 : (*P1 > *P2);
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief a new stamp, to mark variables and clauses
+   \remark marks are reset when stamps wrap around */
+static unsigned
+count_stamp(SAT_Tsolver * S, Tcount * C)
+{
+  if (C->stamp >= UINT_MAX - 2)
+    {
+      memset(C->var_stamp, 0, (SAT_stack_var_n + 1) * sizeof(unsigned));
+      memset(C->clause_stamp, 0, (C->clause_n + 1) * sizeof(unsigned));
+      memset(C->card_stamp, 0, (stack_card_n + 1) * sizeof(unsigned));
+      C->stamp = 0;
+    }
+  return C->stamp += 2;
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief the value of a literal: its weight, or its node */
+static double
+count_lit(Tcount * C, Tlit lit)
+{
+  return C->nnf ? (double) lit : COUNT_WEIGHT(C, lit);
+}
+
+/*--------------------------------------------------------------*/
+
+static void
+count_push(Tcount * C, double value)
+{
+  STACK_RESIZE_EXP(C->value, C->value_n + 1, C->value_size, sizeof(double));
+  C->value[C->value_n++] = value;
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief pops the values pushed from the given position on
+   \param base the position of the first value
+   \return their product, or the and node of the nodes */
+static double
+count_and(Tcount * C, unsigned base)
+{
+  unsigned i, n = 0;
+  double value = 1;
+  if (!C->nnf)
+    {
+      for (i = base; i < C->value_n; i++)
+	value *= C->value[i];
+      C->value_n = base;
+      return value;
+    }
+  for (i = base; i < C->value_n; i++)
+    if (C->value[i] == 0)
+      {
+	C->value_n = base;
+	return 0;
+      }
+    else if (C->value[i] != 1)
+      C->value[base + n++] = C->value[i];
+  C->value_n = base;
+  if (n <= 1)
+    return n ? C->value[base] : 1;
+  for (i = 0; i < n; i++)
+    nnf_child(C->nnf, (unsigned) C->value[base + i]);
+  return nnf_node(C->nnf, NNF_AND);
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief the value of a decision
+   \param value1 the value of the positive branch
+   \param value0 the value of the negative branch
+   \return their sum, or the or node of the nodes */
+static double
+count_or(Tcount * C, double value1, double value0)
+{
+  if (!C->nnf)
+    return value1 + value0;
+  if (value1 == 0 || value0 == 0)
+    return value1 + value0;
+  nnf_child(C->nnf, (unsigned) value1);
+  nnf_child(C->nnf, (unsigned) value0);
+  return nnf_node(C->nnf, NNF_OR);
+}
+
+/*--------------------------------------------------------------*/
+
+static unsigned
+count_hash(unsigned * key, unsigned n)
+{
+  unsigned i, hash = n;
+  for (i = 0; i < n; i++)
+    hash = (hash ^ key[i]) * 16777619u;
+  return hash;
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief looks for the count of a component in the cache
+   \param o the position of the component in the stack
+   \param Pcount set to the count if found
+   \return true if found */
+static bool
+count_cache_get(Tcount * C, unsigned o, double * Pcount)
+{
+  unsigned n = C->stack[o] + C->stack[o + 1], * key = C->stack + o + 2;
+  unsigned hash = count_hash(key, n), i;
+  if (!C->entry_size)
+    return false;
+  for (i = C->bucket[hash & (C->entry_size - 1)]; i; i = C->entry[i].next)
+    if (C->entry[i].hash == hash &&
+	C->entry[i].var_n == C->stack[o] &&
+	C->entry[i].clause_n == C->stack[o + 1] &&
+	!memcmp(C->keys + C->entry[i].key, key, n * sizeof(unsigned)))
+      {
+	*Pcount = C->entry[i].count;
+	return true;
+      }
+  return false;
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief caches the count of a component
+   \param o the position of the component in the stack
+   \param count the count
+   \remark entries are chained newest first, and the table is grown
+   by rehashing entries oldest first, so the newest entries can be
+   removed from the heads of the chains */
+static void
+count_cache_set(Tcount * C, unsigned o, double count)
+{
+  unsigned n = C->stack[o] + C->stack[o + 1], * key = C->stack + o + 2;
+  unsigned i, size = C->entry_size;
+  Tcount_entry * Pentry;
+  if (C->entry_n + 1 >= size)
+    {
+      C->entry_size = size ? 2 * size : 1024;
+      MY_REALLOC(C->entry, C->entry_size * sizeof(Tcount_entry));
+      MY_REALLOC(C->bucket, C->entry_size * sizeof(unsigned));
+      memset(C->bucket, 0, C->entry_size * sizeof(unsigned));
+      if (!C->entry_n)
+	C->entry_n = 1;
+      for (i = 1; i < C->entry_n; i++)
+	{
+	  Pentry = C->entry + i;
+	  Pentry->next = C->bucket[Pentry->hash & (C->entry_size - 1)];
+	  C->bucket[Pentry->hash & (C->entry_size - 1)] = i;
+	}
+    }
+  STACK_RESIZE_EXP(C->keys, C->keys_n + n, C->keys_size, sizeof(unsigned));
+  memcpy(C->keys + C->keys_n, key, n * sizeof(unsigned));
+  Pentry = C->entry + C->entry_n;
+  Pentry->hash = count_hash(key, n);
+  Pentry->key = C->keys_n;
+  Pentry->var_n = C->stack[o];
+  Pentry->clause_n = C->stack[o + 1];
+  Pentry->count = count;
+  Pentry->next = C->bucket[Pentry->hash & (C->entry_size - 1)];
+  C->bucket[Pentry->hash & (C->entry_size - 1)] = C->entry_n++;
+  C->keys_n += n;
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief removes the entries of the cache from the given one on
+   \param entry_n the first entry to remove */
+static void
+count_cache_drop(Tcount * C, unsigned entry_n)
+{
+  while (C->entry_n > entry_n && C->entry_n > 1)
+    {
+      Tcount_entry * Pentry = C->entry + --C->entry_n;
+      assert(C->bucket[Pentry->hash & (C->entry_size - 1)] == C->entry_n);
+      C->bucket[Pentry->hash & (C->entry_size - 1)] = Pentry->next;
+      C->keys_n = Pentry->key;
+    }
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief pushes the components of the unassigned variables of a
+   component on the stack
+   \param o the position of the component in the stack
+   \remark pushes the values of the variables in no clause, i.e. the
+   sums of the values of their literals */
+static void
+count_split(SAT_Tsolver * S, Tcount * C, unsigned o)
+{
+  unsigned stamp = count_stamp(S, C), i, j, k, var_n, clause_n;
+  for (i = 0; i < C->stack[o]; i++)
+    C->var_stamp[C->stack[o + 2 + i]] = stamp;
+  for (i = 0; i < C->stack[o]; i++)
+    {
+      Tvar var = C->stack[o + 2 + i];
+      if (C->var_stamp[var] != stamp ||
+	  SAT_var_value_r(S, var) != VAL_UNDEF)
+	continue;
+      /* breadth first search from var */
+      C->var_stamp[var] = stamp + 1;
+      C->queue[0] = var;
+      var_n = 1;
+      clause_n = 0;
+      for (j = 0; j < var_n; j++)
+	{
+	  Tclause_list * Plist = C->occur + C->queue[j];
+	  for (k = 0; k < Plist->n; k++)
+	    {
+	      Tclause clause = Plist->Pclause[k];
+	      TSclause * PSclause = stack_clause + clause;
+	      Tlit * lit = CLAUSE_LIT(PSclause);
+	      unsigned l;
+	      if (C->clause_stamp[clause] == stamp)
+		continue;
+	      C->clause_stamp[clause] = stamp;
+	      for (l = 0; l < PSclause->n; l++)
+		if (SAT_lit_value_is_true(S, lit[l]))
+		  break;
+	      if (l < PSclause->n)
+		continue;
+	      STACK_RESIZE_EXP(C->clauses, clause_n + 1, C->clauses_size,
+			       sizeof(Tclause));
+	      C->clauses[clause_n++] = clause;
+	      for (l = 0; l < PSclause->n; l++)
+		{
+		  Tvar var2 = SAT_lit_var(lit[l]);
+		  if (C->var_stamp[var2] != stamp ||
+		      SAT_var_value_r(S, var2) != VAL_UNDEF)
+		    continue;
+		  C->var_stamp[var2] = stamp + 1;
+		  C->queue[var_n++] = var2;
+		}
+	    }
+	  for (k = 0; k < 2; k++)
+	    {
+	      Tcard_watch * Pwatch = card_watch + SAT_lit(C->queue[j], k);
+	      unsigned l, m;
+	      for (l = 0; l < Pwatch->n; l++)
+		{
+		  unsigned c = Pwatch->Pcard[l], count = 0, undef = 0;
+		  TScard * Pcard = stack_card + c;
+		  Tlit * lit = CARD_LIT(Pcard);
+		  if (C->card_stamp[c] == stamp)
+		    continue;
+		  C->card_stamp[c] = stamp;
+		  for (m = 0; m < Pcard->n; m++)
+		    if (SAT_lit_value_undef(S, lit[m]))
+		      undef++;
+		    else
+		      count += SAT_lit_value_is_true(S, lit[m]);
+		  if (count + undef <= Pcard->k)
+		    continue;
+		  STACK_RESIZE_EXP(C->clauses, clause_n + 1, C->clauses_size,
+				   sizeof(Tclause));
+		  C->clauses[clause_n++] =
+		    CLAUSE_CARD | (Pcard->offset + Pcard->k - count);
+		  for (m = 0; m < Pcard->n; m++)
+		    {
+		      Tvar var2 = SAT_lit_var(lit[m]);
+		      if (C->var_stamp[var2] != stamp ||
+			  SAT_var_value_r(S, var2) != VAL_UNDEF)
+			continue;
+		      C->var_stamp[var2] = stamp + 1;
+		      C->queue[var_n++] = var2;
+		    }
+		}
+	    }
+	}
+      if (!clause_n)
+	{
+	  count_push(C, count_or(C, count_lit(C, SAT_lit(var, 1)),
+				 count_lit(C, SAT_lit(var, 0))));
+	  continue;
+	}
+      STACK_RESIZE_EXP(C->stack, C->stack_n + 2 + var_n + clause_n,
+		       C->stack_size, sizeof(unsigned));
+      C->stack[C->stack_n] = var_n;
+      C->stack[C->stack_n + 1] = clause_n;
+      veriT_qsort(C->queue, var_n, sizeof(Tvar), (TFcmp) cmp_unsigned);
+      veriT_qsort(C->clauses, clause_n, sizeof(Tclause), (TFcmp) cmp_unsigned);
+      memcpy(C->stack + C->stack_n + 2, C->queue, var_n * sizeof(Tvar));
+      memcpy(C->stack + C->stack_n + 2 + var_n, C->clauses,
+	     clause_n * sizeof(Tclause));
+      C->stack_n += 2 + var_n + clause_n;
+    }
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief the cardinality constraint of a key of a component
+   \param key CLAUSE_CARD with a position in stack_card_lit
+   \return the constraint whose literals are at or before the position */
+static TScard *
+count_card(SAT_Tsolver * S, unsigned key)
+{
+  unsigned lo = 0, hi = stack_card_n, offset = key & ~CLAUSE_CARD;
+  while (hi - lo > 1)
+    {
+      unsigned mid = lo + (hi - lo) / 2;
+      if (stack_card[mid].offset <= offset)
+	lo = mid;
+      else
+	hi = mid;
+    }
+  return stack_card + lo;
+}
+
+/*--------------------------------------------------------------*/
+
+static double count_component(SAT_Tsolver * S, Tcount * C, unsigned o);
+
+/**
+   \brief counts the models of the unassigned variables of a component
+   \param o the position of the component in the stack
+   \return the weighted count */
+static double
+count_components(SAT_Tsolver * S, Tcount * C, unsigned o)
+{
+  unsigned first = C->stack_n, entry_n = C->entry_n, base = C->value_n, i;
+  double count = 1;
+  count_split(S, C, o);
+  for (i = first; i < C->stack_n && count != 0;
+       i += 2 + C->stack[i] + C->stack[i + 1])
+    {
+      if (!count_cache_get(C, i, &count))
+	{
+	  count = count_component(S, C, i);
+	  count_cache_set(C, i, count);
+	}
+      count_push(C, count);
+    }
+  count = count_and(C, base);
+  /* counts are exact if the clauses are satisfiable under the current
+     assignment, which is the case if this is not 0 */
+  if (count == 0)
+    count_cache_drop(C, entry_n);
+  C->stack_n = first;
+  return count;
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief pushes the values of the literals of the last level on the
+   variables of a component
+   \param o the position of the component in the stack
+   \return false if some value is 0 */
+static bool
+count_level(SAT_Tsolver * S, Tcount * C, unsigned o)
+{
+  unsigned stamp = count_stamp(S, C), i;
+  bool nonzero = true;
+  for (i = 0; i < C->stack[o]; i++)
+    C->var_stamp[C->stack[o + 2 + i]] = stamp;
+  for (i = stack_level[SAT_level - 1]; i < stack_lit_n; i++)
+    if (C->var_stamp[SAT_lit_var(stack_lit_get(S, i))] == stamp)
+      {
+	count_push(C, count_lit(C, stack_lit_get(S, i)));
+	nonzero = nonzero && C->value[C->value_n - 1] != 0;
+      }
+  return nonzero;
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief counts the models of a component
+   \param o the position of the component in the stack
+   \return the weighted count
+   \remark decides the variable occurring in most clauses of the
+   component */
+static double
+count_component(SAT_Tsolver * S, Tcount * C, unsigned o)
+{
+  unsigned i, j, var_n = C->stack[o], clause_n = C->stack[o + 1], base;
+  Tvar var = 0;
+  double count[2];
+  for (i = 0; i < clause_n; i++)
+    {
+      unsigned key = C->stack[o + 2 + var_n + i], n;
+      Tlit * lit;
+      if (key & CLAUSE_CARD)
+	{
+	  TScard * Pcard = count_card(S, key);
+	  n = Pcard->n;
+	  lit = CARD_LIT(Pcard);
+	}
+      else
+	{
+	  n = stack_clause[key].n;
+	  lit = CLAUSE_LIT(stack_clause + key);
+	}
+      /* assigned variables are not scored, so scores of the variables
+	 of the component are all to reset */
+      for (j = 0; j < n; j++)
+	if (SAT_lit_value_undef(S, lit[j]))
+	  C->score[SAT_lit_var(lit[j])]++;
+    }
+  for (i = 0; i < var_n; i++)
+    {
+      Tvar var2 = C->stack[o + 2 + i];
+      if (!var || C->score[var2] > C->score[var])
+	var = var2;
+    }
+  for (i = 0; i < var_n; i++)
+    C->score[C->stack[o + 2 + i]] = 0;
+  for (i = 0; i < 2; i++)
+    {
+      Tlit lit = SAT_lit(var, 1 - i);
+      count[i] = 0;
+      if (count_lit(C, lit) == 0)
+	continue;
+      level_push(S, lit);
+      base = C->value_n;
+      if (propagate(S) == CLAUSE_UNDEF && count_level(S, C, o))
+	{
+	  count_push(C, count_components(S, C, o));
+	  count[i] = count_and(C, base);
+	}
+      C->value_n = base;
+      level_backtrack(S, SAT_level - 1);
+    }
+  return count_or(C, count[0], count[1]);
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief counts the models satisfying the given literals
+   \param n the number of literals
+   \param lit an array of n literals
+   \return the weighted count, or the root of the circuit
+   \remark preprocessing would drop the models on eliminated variables,
+   so it is not done.  The instance is back at root level afterwards */
+static double
+count_run(SAT_Tsolver * S, Tcount * C, unsigned n, SAT_Tlit * lit)
+{
+  double count = 1;
+  bool preprocess = S->state.params.preprocess;
+  unsigned i, j;
+  S->state.params.preprocess = false;
+#ifdef ELIM
+  if (elim_stack_n)
+    elim_restore(S);
+#endif
+  level_backtrack(S, ROOT_LEVEL);
+  if (SAT_status == SAT_STATUS_SAT)
+    SAT_status = SAT_STATUS_UNDEF;
+  if (SAT_propagate_r(S) == SAT_STATUS_UNSAT)
+    count = 0;
+  for (i = 0; i < n && count != 0; i++)
+    if (SAT_lit_value_r(S, lit[i]) == VAL_FALSE)
+      count = 0;
+    else if (SAT_lit_value_undef(S, lit[i]))
+      {
+	level_push(S, lit[i]);
+	if (propagate(S) != CLAUSE_UNDEF)
+	  count = 0;
+      }
+  if (count == 0)
+    {
+      level_backtrack(S, ROOT_LEVEL);
+      S->state.params.preprocess = preprocess;
+      return 0;
+    }
+  i = (SAT_stack_var_n + 1) * (unsigned) sizeof(unsigned);
+  MY_MALLOC(C->occur, (SAT_stack_var_n + 1) * sizeof(Tclause_list));
+  memset(C->occur, 0, (SAT_stack_var_n + 1) * sizeof(Tclause_list));
+  MY_MALLOC(C->var_stamp, i);
+  memset(C->var_stamp, 0, i);
+  MY_MALLOC(C->score, i);
+  memset(C->score, 0, i);
+  MY_MALLOC(C->queue, i);
+  /* cardinality constraints may add clauses, which are not stamped */
+  C->clause_n = stack_clause_n;
+  i = (stack_clause_n + 1) * (unsigned) sizeof(unsigned);
+  MY_MALLOC(C->clause_stamp, i);
+  memset(C->clause_stamp, 0, i);
+  i = (stack_card_n + 1) * (unsigned) sizeof(unsigned);
+  MY_MALLOC(C->card_stamp, i);
+  memset(C->card_stamp, 0, i);
+  for (i = 1; i <= stack_clause_n; i++)
+    if (!stack_clause[i].learnt && !stack_clause[i].deleted)
+      for (j = 0; j < stack_clause[i].n; j++)
+	clause_list_add(C->occur + SAT_lit_var(CLAUSE_LIT(stack_clause + i)[j]),
+			i);
+  /* the whole instance is the first component, without clauses */
+  STACK_RESIZE_EXP(C->stack, SAT_stack_var_n + 2, C->stack_size,
+		   sizeof(unsigned));
+  C->stack[0] = C->stack[1] = 0;
+  for (i = 1; i <= SAT_stack_var_n; i++)
+    if (SAT_var_value_r(S, i) == VAL_UNDEF)
+      C->stack[2 + C->stack[0]++] = i;
+    else
+      {
+	count_push(C, count_lit(C, SAT_lit(i, SAT_var_value_r(S, i))));
+	if (C->value[C->value_n - 1] == 0)
+	  count = 0;
+      }
+  C->stack_n = 2 + C->stack[0];
+  if (count != 0)
+    count_push(C, count_components(S, C, 0));
+  count = count_and(C, 0);
+  level_backtrack(S, ROOT_LEVEL);
+  for (i = 0; i <= SAT_stack_var_n; i++)
+    free(C->occur[i].Pclause);
+  free(C->occur);
+  free(C->var_stamp);
+  free(C->score);
+  free(C->queue);
+  free(C->clause_stamp);
+  free(C->card_stamp);
+  free(C->stack);
+  free(C->clauses);
+  free(C->value);
+  free(C->entry);
+  free(C->bucket);
+  free(C->keys);
+  S->state.params.preprocess = preprocess;
+  return count;
+}
+
+/*--------------------------------------------------------------*/
+
+double
+SAT_count_r(SAT_Tsolver * S, const double * weight, unsigned n,
+	    SAT_Tlit * lit)
+{
+  Tcount C;
+  memset(&C, 0, sizeof(Tcount));
+  C.weight = weight;
+  return count_run(S, &C, n, lit);
+}
+
+/*--------------------------------------------------------------*/
+
+SAT_Tnnf *
+SAT_compile_r(SAT_Tsolver * S)
+{
+  Tcount C;
+  memset(&C, 0, sizeof(Tcount));
+  C.nnf = nnf_new(SAT_stack_var_n);
+  C.nnf->root = (unsigned) count_run(S, &C, 0, NULL);
+  nnf_compact(C.nnf);
+  return C.nnf;
+}
+
+/*--------------------------------------------------------------*/
+
+void
+SAT_nnf_delete(SAT_Tnnf * nnf)
+{
+  if (!nnf)
+    return;
+  free(nnf->kind);
+  free(nnf->start);
+  free(nnf->child);
+  free(nnf);
+}
+
+/*--------------------------------------------------------------*/
+
+unsigned
+SAT_nnf_var_n(const SAT_Tnnf * nnf)
+{
+  return nnf->var_n;
+}
+
+/*--------------------------------------------------------------*/
+
+unsigned
+SAT_nnf_size(const SAT_Tnnf * nnf)
+{
+  return nnf->child_n;
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief computes the values of the nodes
+   \param weight the weights of literals, NULL for 1
+   \param value set to the value of each node */
+static void
+nnf_eval(const SAT_Tnnf * N, const double * weight, double * value)
+{
+  unsigned first = 2 * N->var_n + 2, i, j;
+  value[0] = 0;
+  value[1] = 1;
+  for (i = 2; i < first; i++)
+    value[i] = weight ? weight[i] : 1;
+  for (i = first; i < N->node_n; i++)
+    {
+      value[i] = N->kind[i] == NNF_AND ? 1 : 0;
+      for (j = N->start[i]; j < N->start[i + 1]; j++)
+	if (N->kind[i] == NNF_AND)
+	  value[i] *= value[N->child[j]];
+	else
+	  value[i] += value[N->child[j]];
+    }
+}
+
+/*--------------------------------------------------------------*/
+
+double
+SAT_nnf_count(const SAT_Tnnf * nnf, const double * weight)
+{
+  double * value, count;
+  MY_MALLOC(value, nnf->node_n * sizeof(double));
+  nnf_eval(nnf, weight, value);
+  count = value[nnf->root];
+  free(value);
+  return count;
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \remark the derivatives are propagated from the root down, i.e. by
+   decreasing nodes.  The derivative of a child of an and node is the
+   product of the values of the other children, computed from the
+   products of the children before and after it */
+double
+SAT_nnf_marginals(const SAT_Tnnf * nnf, const double * weight,
+		  double * marginal)
+{
+  unsigned first = 2 * nnf->var_n + 2, i, j;
+  double * value, * deriv, * before, after, count;
+  MY_MALLOC(value, nnf->node_n * sizeof(double));
+  MY_MALLOC(deriv, nnf->node_n * sizeof(double));
+  MY_MALLOC(before, (nnf->child_n + 1) * sizeof(double));
+  nnf_eval(nnf, weight, value);
+  memset(deriv, 0, nnf->node_n * sizeof(double));
+  deriv[nnf->root] = 1;
+  for (i = nnf->node_n; i-- > first; )
+    {
+      if (deriv[i] == 0)
+	continue;
+      if (nnf->kind[i] == NNF_OR)
+	{
+	  for (j = nnf->start[i]; j < nnf->start[i + 1]; j++)
+	    deriv[nnf->child[j]] += deriv[i];
+	  continue;
+	}
+      after = deriv[i];
+      for (j = nnf->start[i]; j < nnf->start[i + 1]; j++)
+	{
+	  before[j] = after;
+	  after *= value[nnf->child[j]];
+	}
+      for (j = nnf->start[i + 1], after = 1; j-- > nnf->start[i]; )
+	{
+	  deriv[nnf->child[j]] += before[j] * after;
+	  after *= value[nnf->child[j]];
+	}
+    }
+  marginal[0] = marginal[1] = 0;
+  for (i = 2; i < first; i++)
+    marginal[i] = value[i] * deriv[i];
+  count = value[nnf->root];
+  free(value);
+  free(deriv);
+  free(before);
+  return count;
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \remark the file holds the magic number, the numbers of variables,
+   nodes and children, the root, then the kinds, children ends, and
+   children of the and/or nodes, as unsigned integers in native byte
+   order, but kinds as bytes */
+bool
+SAT_nnf_save(const SAT_Tnnf * nnf, const char * file)
+{
+  unsigned first = 2 * nnf->var_n + 2, n = nnf->node_n - first;
+  unsigned header[5];
+  bool ok;
+  FILE * fp = fopen(file, "wb");
+  if (!fp)
+    return false;
+  header[0] = NNF_MAGIC;
+  header[1] = nnf->var_n;
+  header[2] = nnf->node_n;
+  header[3] = nnf->child_n;
+  header[4] = nnf->root;
+  ok = fwrite(header, sizeof(unsigned), 5, fp) == 5 &&
+    fwrite(nnf->kind + first, sizeof(unsigned char), n, fp) == n &&
+    fwrite(nnf->start + first + 1, sizeof(unsigned), n, fp) == n &&
+    (!nnf->child_n ||
+     fwrite(nnf->child, sizeof(unsigned), nnf->child_n, fp) == nnf->child_n);
+  return fclose(fp) == 0 && ok;
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \remark the circuit is checked to be well formed, i.e. nodes are
+   and/or nodes with children before them */
+SAT_Tnnf *
+SAT_nnf_load(const char * file)
+{
+  unsigned header[5], first, n, i, j;
+  SAT_Tnnf * N;
+  bool ok;
+  FILE * fp = fopen(file, "rb");
+  if (!fp)
+    return NULL;
+  if (fread(header, sizeof(unsigned), 5, fp) != 5 ||
+      header[0] != NNF_MAGIC || header[1] >= UINT_MAX / 4 ||
+      header[2] < 2 * header[1] + 2 || header[4] >= header[2])
+    {
+      fclose(fp);
+      return NULL;
+    }
+  N = nnf_new(header[1]);
+  first = N->node_n;
+  n = header[2] - first;
+  N->node_size = header[2];
+  MY_REALLOC(N->kind, N->node_size * sizeof(unsigned char));
+  MY_REALLOC(N->start, (N->node_size + 1) * sizeof(unsigned));
+  N->node_n = header[2];
+  N->child_n = N->child_size = header[3];
+  N->root = header[4];
+  MY_MALLOC(N->child, (N->child_size ? N->child_size : 1) * sizeof(unsigned));
+  ok = fread(N->kind + first, sizeof(unsigned char), n, fp) == n &&
+    fread(N->start + first + 1, sizeof(unsigned), n, fp) == n &&
+    fread(N->child, sizeof(unsigned), N->child_n, fp) == N->child_n &&
+    fgetc(fp) == EOF;
+  fclose(fp);
+  for (i = first; i < N->node_n && ok; i++)
+    {
+      ok = (N->kind[i] == NNF_AND || N->kind[i] == NNF_OR) &&
+	N->start[i] <= N->start[i + 1] && N->start[i + 1] <= N->child_n;
+      for (j = N->start[i]; j < N->start[i + 1] && ok; j++)
+	ok = N->child[j] < i;
+    }
+  if (!ok || N->start[N->node_n] != N->child_n)
+    {
+      SAT_nnf_delete(N);
+      return NULL;
+    }
+  return N;
+}
+
+/*
+  --------------------------------------------------------------
+  model sampling
+  --------------------------------------------------------------
+*/
+
+/*
+  Models are sampled near uniformly by hashing, as in UniGen: random
+  xor constraints on the sampled variables split their assignments
+  into cells of about the same number of models, and a model is drawn
+  uniformly from a random cell, once all its models are enumerated.
+  The number of xors is adjusted from a sample to the next so that
+  cells have between SAMPLE_LO and SAMPLE_HI models, the bounds of
+  UniGen2 for a tolerance of 16 (kappa 0.638): each model is then
+  drawn with a probability within a factor 17 of uniform, and much
+  closer in practice.
+  Sampling is done on a copy of the instance: xors and blocking
+  clauses of a cell are guarded by a new activation literal, assumed
+  while enumerating the cell, and falsified afterwards, and xors are
+  cut into chunks of SAMPLE_XOR_LEN variables linked by auxiliary
+  variables, so that each costs a few short clauses.  Auxiliary
+  variables are reused from a cell to the next: clauses on them,
+  learnt ones included, all have the negation of the activation literal
+  of their cell, and are satisfied once it is falsified.
+*/
+
+#define SAMPLE_LO 12
+#define SAMPLE_HI 64
+#define SAMPLE_XOR_LEN 4
+
+/**
+   \brief state of model sampling */
+typedef struct Tsample
+{
+  unsigned n;               /**< number of sampled variables */
+  Tvar * var;               /**< sampled variables */
+  Tvalue * cell;            /**< values of the variables of the models of
+			       the cell, n per model */
+  unsigned cell_size;
+  Tvar * aux;               /**< auxiliary variables */
+  unsigned aux_n;           /**< number of those used by the cell */
+  unsigned aux_size;
+  unsigned aux_var_n;       /**< number of those created */
+  Tlit * lit;               /**< buffer for clauses */
+  Tvar * xvar;              /**< buffer for xors */
+} Tsample;
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief random number, from the generator of fastrand
+   \param upper the bound, at most 1 << 16
+   \return a number in [0, upper)
+   \remark high bits are used, low ones have short periods */
+static inline unsigned
+sample_rand(SAT_Tsolver * S, unsigned upper)
+{
+  unsigned * seed = &S->state.params.seed;
+  *seed = (214013 * *seed + 2531011);
+  return (*seed >> 16) % upper;
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief copies the instance
+   \remark the instance is at root level, its input clauses and root
+   literals are copied */
+static SAT_Tsolver *
+sample_copy(SAT_Tsolver * S)
+{
+  SAT_Tsolver * S2 = SAT_new();
+  Tlit * lit;
+  unsigned i, size = 1;
+  S2->state.params = S->state.params;
+  S2->state.params.preprocess = false;
+  SAT_var_new_id_r(S2, SAT_stack_var_n);
+  for (i = 1; i <= stack_clause_n; i++)
+    if (size < stack_clause[i].n)
+      size = stack_clause[i].n;
+  MY_MALLOC(lit, size * sizeof(Tlit));
+  for (i = 1; i <= stack_clause_n; i++)
+    if (!stack_clause[i].learnt && !stack_clause[i].deleted)
+      {
+	memcpy(lit, CLAUSE_LIT(stack_clause + i),
+	       stack_clause[i].n * sizeof(Tlit));
+	clause_add(S2, stack_clause[i].n, lit, 0);
+      }
+  for (i = 0; i < stack_lit_n; i++)
+    {
+      lit[0] = stack_lit_get(S, i);
+      clause_add(S2, 1, lit, 0);
+    }
+  free(lit);
+  card_copy(S, S2);
+  return S2;
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief adds the clauses, guarded by act, stating that the xor of
+   variables is the given parity
+   \param n the number of variables, at most SAMPLE_XOR_LEN
+   \param var the variables
+   \param parity 0 or 1 */
+static void
+sample_xor_clauses(SAT_Tsolver * S, Tsample * T, Tlit act, unsigned n,
+		   Tvar * var, unsigned parity)
+{
+  unsigned mask, i, odd;
+  /* a clause excludes the assignment falsifying all its literals */
+  for (mask = 0; mask < (1u << n); mask++)
+    {
+      T->lit[0] = SAT_lit_neg(act);
+      for (i = 0, odd = 0; i < n; i++)
+	{
+	  T->lit[i + 1] = SAT_lit(var[i], ((mask >> i) & 1));
+	  odd ^= ((mask >> i) & 1) ^ 1;
+	}
+      if (odd != parity)
+	clause_add(S, n + 1, T->lit, 0);
+    }
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief adds a random xor of the sampled variables, guarded by act
+   \remark chunks are linked by auxiliary variables, each being the xor
+   of the variables before it */
+static void
+sample_xor(SAT_Tsolver * S, Tsample * T, Tlit act)
+{
+  unsigned i, n = 0, parity = sample_rand(S, 2);
+  for (i = 0; i < T->n; i++)
+    {
+      if (!sample_rand(S, 2))
+	continue;
+      if (n == SAMPLE_XOR_LEN - 1)
+	{
+	  if (T->aux_n == T->aux_var_n)
+	    {
+	      STACK_RESIZE_EXP(T->aux, T->aux_var_n + 1, T->aux_size,
+			       sizeof(Tvar));
+	      T->aux[T->aux_var_n++] = SAT_var_new_r(S);
+	    }
+	  T->xvar[n++] = T->aux[T->aux_n];
+	  sample_xor_clauses(S, T, act, n, T->xvar, 0);
+	  T->xvar[0] = T->aux[T->aux_n++];
+	  n = 1;
+	}
+      T->xvar[n++] = T->var[i];
+    }
+  sample_xor_clauses(S, T, act, n, T->xvar, parity);
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief enumerates the models of a random cell, up to SAMPLE_HI + 1
+   \param m the number of xors defining the cell
+   \return the number of models of the cell, SAMPLE_HI + 1 if more */
+static unsigned
+sample_cell(SAT_Tsolver * S, Tsample * T, unsigned m)
+{
+  Tlit act = SAT_lit(SAT_var_new_r(S), 1);
+  unsigned i, count = 0;
+  T->aux_n = 0;
+  for (i = 0; i < m; i++)
+    sample_xor(S, T, act);
+  while (count <= SAMPLE_HI &&
+	 SAT_solve_assuming_r(S, 1, &act) == SAT_STATUS_SAT)
+    {
+      Tvalue * value = T->cell + count++ * T->n;
+      T->lit[0] = SAT_lit_neg(act);
+      for (i = 0; i < T->n; i++)
+	{
+	  value[i] = SAT_var_value_r(S, T->var[i]) == VAL_TRUE ?
+	    VAL_TRUE : VAL_FALSE;
+	  T->lit[i + 1] = SAT_lit(T->var[i], (value[i] == VAL_FALSE));
+	}
+      clause_add(S, T->n + 1, T->lit, 0);
+    }
+  T->lit[0] = SAT_lit_neg(act);
+  clause_add(S, 1, T->lit, 0);
+  return count;
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \remark the instance is left with the same clauses, at root level */
+unsigned
+SAT_sample_r(SAT_Tsolver * S, unsigned n, SAT_Tvar * var,
+	     unsigned sample_n, SAT_Tvalue * sample)
+{
+  Tsample T;
+  SAT_Tsolver * S2;
+  bool preprocess = S->state.params.preprocess;
+  unsigned i, count, m = 1, drawn = 0, tries = 0;
+  S->state.params.preprocess = false;
+#ifdef ELIM
+  if (elim_stack_n)
+    elim_restore(S);
+#endif
+  level_backtrack(S, ROOT_LEVEL);
+  if (SAT_status == SAT_STATUS_SAT)
+    SAT_status = SAT_STATUS_UNDEF;
+  if (SAT_propagate_r(S) == SAT_STATUS_UNSAT)
+    {
+      S->state.params.preprocess = preprocess;
+      return 0;
+    }
+  memset(&T, 0, sizeof(Tsample));
+  T.n = n ? n : SAT_stack_var_n;
+  MY_MALLOC(T.var, (T.n + 1) * sizeof(Tvar));
+  for (i = 0; i < T.n; i++)
+    T.var[i] = n ? var[i] : i + 1;
+  MY_MALLOC(T.cell, (SAMPLE_HI + 1) * (T.n + 1) * sizeof(Tvalue));
+  MY_MALLOC(T.lit, (T.n + SAMPLE_XOR_LEN + 1) * sizeof(Tlit));
+  MY_MALLOC(T.xvar, SAMPLE_XOR_LEN * sizeof(Tvar));
+  S2 = sample_copy(S);
+  count = sample_cell(S2, &T, 0);
+  if (count > 0 && count <= SAMPLE_HI)
+    /* few enough models to draw uniformly from all of them */
+    for (; drawn < sample_n; drawn++)
+      memcpy(sample + drawn * T.n, T.cell + sample_rand(S2, count) * T.n,
+	     T.n * sizeof(Tvalue));
+  else if (count > 0)
+    while (drawn < sample_n && tries++ < 10 * (sample_n + T.n))
+      {
+	count = sample_cell(S2, &T, m);
+	if (count > SAMPLE_HI)
+	  m++;
+	else if (count < SAMPLE_LO)
+	  {
+	    if (m > 1)
+	      m--;
+	  }
+	else
+	  {
+	    memcpy(sample + drawn * T.n, T.cell + sample_rand(S2, count) * T.n,
+		   T.n * sizeof(Tvalue));
+	    drawn++;
+	  }
+      }
+  S->state.params.seed = S2->state.params.seed;
+  SAT_delete(S2);
+  free(T.var);
+  free(T.cell);
+  free(T.aux);
+  free(T.lit);
+  free(T.xvar);
+  S->state.params.preprocess = preprocess;
+  return drawn;
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \remark a model is drawn from the root down: and nodes give all
+   their children, or nodes one of their children with a probability
+   proportional to its value */
+unsigned
+SAT_nnf_sample(const SAT_Tnnf * nnf, const double * weight,
+	       unsigned sample_n, SAT_Tvalue * sample, unsigned * seed)
+{
+  unsigned first = 2 * nnf->var_n + 2, i, j, k, n, * stack;
+  double * value, r;
+  MY_MALLOC(value, nnf->node_n * sizeof(double));
+  nnf_eval(nnf, weight, value);
+  if (value[nnf->root] <= 0)
+    {
+      free(value);
+      return 0;
+    }
+  MY_MALLOC(stack, (nnf->child_n + 1) * sizeof(unsigned));
+  for (i = 0; i < sample_n; i++)
+    {
+      SAT_Tvalue * model = sample + i * nnf->var_n;
+      memset(model, VAL_FALSE, nnf->var_n * sizeof(SAT_Tvalue));
+      stack[0] = nnf->root;
+      n = 1;
+      while (n)
+	{
+	  unsigned node = stack[--n];
+	  if (node < first)
+	    {
+	      if (node >= 2)
+		model[SAT_lit_var(node) - 1] = (SAT_Tvalue) SAT_lit_pol(node);
+	      continue;
+	    }
+	  if (nnf->kind[node] == NNF_AND)
+	    {
+	      for (j = nnf->start[node]; j < nnf->start[node + 1]; j++)
+		stack[n++] = nnf->child[j];
+	      continue;
+	    }
+	  *seed = 214013 * *seed + 2531011;
+	  r = (double) (*seed >> 8) / 16777216.0 * value[node];
+	  for (j = k = nnf->start[node]; j < nnf->start[node + 1]; j++)
+	    if (value[nnf->child[j]] > 0)
+	      {
+		k = j;
+		if ((r -= value[nnf->child[j]]) < 0)
+		  break;
+	      }
+	  stack[n++] = nnf->child[k];
+	}
+    }
+  free(stack);
+  free(value);
+  return sample_n;
+}
+
+/*
+  --------------------------------------------------------------
+  MaxSAT
+  --------------------------------------------------------------
+*/
+
+/*
+  Weighted partial MaxSAT: the clauses are hard, and soft literals have
+  weights, the cost of a model being the total weight of the soft
+  literals it falsifies.  The search is core-guided (OLL, as in RC2), on
+  the instance itself under assumptions: soft literals are assumed, and
+  each core found raises the lower bound by its least weight w, which is
+  taken off the weights of its literals.  The core is then relaxed: a
+  totalizer counts how many of its literals are false, and the negation
+  of its output "at least 2" becomes soft with weight w, i.e. one of
+  them may now be false for free.  Outputs of totalizers found in a core
+  are relaxed to the next output likewise.  Once the soft literals left
+  can be all satisfied, the lower bound is reached, and is the cost.
+  Soft literals are stratified: those of the highest weights are assumed
+  first, lower weights only once those are satisfied, so that big cores
+  of small weights are not found first.
+  Totalizers are quadratic in the size of the core: beyond
+  MAXSAT_CORE_MAX literals, the search falls back to linear SAT-UNSAT
+  search, i.e. models of decreasing cost, on the soft literals given.
+  Their cost is counted by a generalized totalizer, whose outputs are
+  the sums of weights that can be reached, sums above the cost of the
+  first model being merged.  Assuming false all outputs of at least the
+  cost of the last model asks for a better one, until there is none,
+  or the lower bound of the cores found is met.
+*/
+
+#define MAXSAT_CORE_MAX 512
+
+/**
+   \brief soft literal */
+typedef struct Tsoft
+{
+  Tlit lit;
+  unsigned long weight;     /**< 0 once relaxed, or hardened */
+  unsigned sum;             /**< totalizer of which lit is the negation of
+			       an output, plus 1, 0 if none */
+  unsigned bound;           /**< the output */
+} Tsoft;
+
+/**
+   \brief totalizer: out[i] is true if at least i + 1 inputs are true */
+typedef struct Tsum
+{
+  unsigned n;               /**< number of inputs */
+  Tlit * out;
+} Tsum;
+
+/**
+   \brief state of a MaxSAT search */
+typedef struct Tmaxsat
+{
+  Tsoft * soft;
+  unsigned soft_n;
+  unsigned soft_size;
+  unsigned * soft_of;       /**< soft literal of each literal, plus 1,
+			       0 if none */
+  unsigned soft_of_size;
+  Tsum * sum;
+  unsigned sum_n;
+  unsigned sum_size;
+  Tlit * assumption;
+  unsigned assumption_size;
+  unsigned long cost;       /**< lower bound */
+} Tmaxsat;
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief adds weight to a soft literal, new if need be
+   \param sum as in Tsoft, for a new soft literal
+   \param bound as in Tsoft, for a new soft literal */
+static void
+maxsat_soft(SAT_Tsolver * S, Tmaxsat * M, Tlit lit, unsigned long weight,
+	    unsigned sum, unsigned bound)
+{
+  if (M->soft_of_size < 2 * SAT_stack_var_n + 2)
+    {
+      unsigned size = M->soft_of_size;
+      M->soft_of_size = 2 * SAT_stack_var_n + 2;
+      MY_REALLOC(M->soft_of, M->soft_of_size * sizeof(unsigned));
+      memset(M->soft_of + size, 0,
+	     (M->soft_of_size - size) * sizeof(unsigned));
+    }
+  if (!M->soft_of[lit])
+    {
+      STACK_RESIZE_EXP(M->soft, M->soft_n + 1, M->soft_size, sizeof(Tsoft));
+      M->soft[M->soft_n].lit = lit;
+      M->soft[M->soft_n].weight = 0;
+      M->soft[M->soft_n].sum = sum;
+      M->soft[M->soft_n].bound = bound;
+      M->soft_of[lit] = ++M->soft_n;
+    }
+  M->soft[M->soft_of[lit] - 1].weight += weight;
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief builds a totalizer
+   \param in the n inputs
+   \param out set to the n outputs, out[i] being implied by at least i + 1
+   inputs true */
+static void
+maxsat_totalizer(SAT_Tsolver * S, Tlit * in, unsigned n, Tlit * out)
+{
+  unsigned h = n / 2, i, j;
+  Tlit * a, clause[3];
+  if (n == 1)
+    {
+      out[0] = in[0];
+      return;
+    }
+  MY_MALLOC(a, n * sizeof(Tlit));
+  maxsat_totalizer(S, in, h, a);
+  maxsat_totalizer(S, in + h, n - h, a + h);
+  for (i = 0; i < n; i++)
+    out[i] = SAT_lit(SAT_var_new_r(S), 1);
+  /* a[i] for i < h counts the left inputs, a[h + j] the right ones */
+  for (i = 0; i < n; i++)
+    {
+      clause[0] = SAT_lit_neg(a[i]);
+      clause[1] = out[i < h ? i : i - h];
+      clause_add(S, 2, clause, 0);
+    }
+  for (i = 0; i < h; i++)
+    for (j = h; j < n; j++)
+      {
+	clause[0] = SAT_lit_neg(a[i]);
+	clause[1] = SAT_lit_neg(a[j]);
+	clause[2] = out[i + j - h + 1];
+	clause_add(S, 3, clause, 0);
+      }
+  free(a);
+}
+
+/*--------------------------------------------------------------*/
+
+static int
+cmp_unsigned_long(const unsigned long * P1, const unsigned long * P2)
+{
+  return *P1 < *P2 ? -1 : (*P1 > *P2);
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief builds a generalized totalizer: sums of weights of true inputs
+   \param in the n inputs
+   \param weight their weights
+   \param cap sums above cap are merged with cap
+   \param value set to the sums reachable (but 0), increasing, allocated
+   \param out set to their outputs, allocated, out[i] being implied by a
+   sum of value[i] (and by a sum at least cap, if value[i] is cap)
+   \return the number of sums */
+static unsigned
+maxsat_gte(SAT_Tsolver * S, Tlit * in, const unsigned long * weight,
+	   unsigned n, unsigned long cap, unsigned long ** value, Tlit ** out)
+{
+  unsigned long * value1, * value2;
+  Tlit * out1, * out2, clause[3];
+  unsigned n1, n2, i, j, k, m;
+  if (n == 1)
+    {
+      MY_MALLOC(*value, sizeof(unsigned long));
+      MY_MALLOC(*out, sizeof(Tlit));
+      (*value)[0] = weight[0] < cap ? weight[0] : cap;
+      (*out)[0] = in[0];
+      return 1;
+    }
+  n1 = maxsat_gte(S, in, weight, n / 2, cap, &value1, &out1);
+  n2 = maxsat_gte(S, in + n / 2, weight + n / 2, n - n / 2, cap,
+		  &value2, &out2);
+  /* all sums, i = n1 and j = n2 standing for nothing */
+  MY_MALLOC(*value, ((n1 + 1) * (n2 + 1)) * sizeof(unsigned long));
+  for (i = 0, m = 0; i <= n1; i++)
+    for (j = 0; j <= n2; j++)
+      if (i < n1 || j < n2)
+	{
+	  unsigned long v = (i < n1 ? value1[i] : 0) + (j < n2 ? value2[j] : 0);
+	  (*value)[m++] = v < cap ? v : cap;
+	}
+  veriT_qsort(*value, m, sizeof(unsigned long), (TFcmp) cmp_unsigned_long);
+  for (i = 1, k = 1; i < m; i++)
+    if ((*value)[i] != (*value)[k - 1])
+      (*value)[k++] = (*value)[i];
+  MY_REALLOC(*value, k * sizeof(unsigned long));
+  MY_MALLOC(*out, k * sizeof(Tlit));
+  for (i = 0; i < k; i++)
+    (*out)[i] = SAT_lit(SAT_var_new_r(S), 1);
+  for (i = 0; i <= n1; i++)
+    for (j = 0; j <= n2; j++)
+      if (i < n1 || j < n2)
+	{
+	  unsigned long v = (i < n1 ? value1[i] : 0) + (j < n2 ? value2[j] : 0);
+	  unsigned lo = 0, hi = k - 1, c = 0;
+	  if (v > cap)
+	    v = cap;
+	  while (lo < hi)
+	    {
+	      unsigned mid = (lo + hi) / 2;
+	      if ((*value)[mid] < v)
+		lo = mid + 1;
+	      else
+		hi = mid;
+	    }
+	  if (i < n1)
+	    clause[c++] = SAT_lit_neg(out1[i]);
+	  if (j < n2)
+	    clause[c++] = SAT_lit_neg(out2[j]);
+	  clause[c++] = (*out)[lo];
+	  clause_add(S, c, clause, 0);
+	}
+  free(value1);
+  free(value2);
+  free(out1);
+  free(out2);
+  return k;
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief cost of the model of the instance */
+static unsigned long
+maxsat_cost(SAT_Tsolver * S, unsigned n, Tlit * lit,
+	    const unsigned long * weight)
+{
+  unsigned long cost = 0;
+  unsigned i;
+  for (i = 0; i < n; i++)
+    if (SAT_lit_value_r(S, lit[i]) != VAL_TRUE)
+      cost += weight[i];
+  return cost;
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief linear SAT-UNSAT search
+   \param n the number of soft literals, distinct
+   \param lit the soft literals
+   \param weight their weights
+   \param cost the lower bound, set to the cost
+   \return SAT_STATUS_SAT, SAT_STATUS_UNSAT, or SAT_STATUS_UNDEF if
+   interrupted
+   \remark the model of the instance is optimal on SAT_STATUS_SAT */
+static Tstatus
+maxsat_linear(SAT_Tsolver * S, unsigned n, Tlit * lit,
+	      const unsigned long * weight, unsigned long * cost)
+{
+  unsigned long upper, * value;
+  unsigned i, k, m;
+  Tlit * in, * out, * best;
+  Tstatus status = SAT_solve_assuming_r(S, 0, NULL);
+  if (status != SAT_STATUS_SAT)
+    return status;
+  upper = maxsat_cost(S, n, lit, weight);
+  if (upper <= *cost)
+    {
+      *cost = upper;
+      return status;
+    }
+  /* best holds the soft literals satisfied by the best model */
+  MY_MALLOC(in, n * sizeof(Tlit));
+  MY_MALLOC(best, n * sizeof(Tlit));
+  for (i = 0, m = 0; i < n; i++)
+    {
+      in[i] = SAT_lit_neg(lit[i]);
+      if (SAT_lit_value_r(S, lit[i]) == VAL_TRUE)
+	best[m++] = lit[i];
+    }
+  k = maxsat_gte(S, in, weight, n, upper, &value, &out);
+  /* outputs are assumed false from the end of out */
+  MY_REALLOC(in, k * sizeof(Tlit));
+  for (i = 0; i < k; i++)
+    in[i] = SAT_lit_neg(out[k - 1 - i]);
+  while (upper > *cost)
+    {
+      for (i = 0; i < k && value[k - 1 - i] >= upper; i++) ;
+      status = SAT_solve_assuming_r(S, i, in);
+      if (status != SAT_STATUS_SAT)
+	break;
+      upper = maxsat_cost(S, n, lit, weight);
+      for (i = 0, m = 0; i < n; i++)
+	if (SAT_lit_value_r(S, lit[i]) == VAL_TRUE)
+	  best[m++] = lit[i];
+    }
+  if (status != SAT_STATUS_UNDEF)
+    {
+      /* the clauses are sat: a model of the cost is found again */
+      *cost = upper;
+      status = SAT_solve_assuming_r(S, m, best);
+    }
+  free(in);
+  free(best);
+  free(value);
+  free(out);
+  return status;
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \remark soft literals given twice have their weights added */
+Tstatus
+SAT_maxsat_r(SAT_Tsolver * S, unsigned n, SAT_Tlit * lit,
+	     const unsigned long * weight, unsigned long * cost,
+	     unsigned options)
+{
+  Tmaxsat M;
+  Tlit * core = NULL, * lit2;
+  unsigned long strat = 0, w, * weight2;
+  unsigned i, j, k, core_n, n2;
+  Tstatus status;
+  memset(&M, 0, sizeof(Tmaxsat));
+  *cost = 0;
+  for (i = 0; i < n; i++)
+    if (weight[i])
+      maxsat_soft(S, &M, lit[i], weight[i], 0, 0);
+  /* soft literals, distinct, as given to maxsat_linear */
+  n2 = M.soft_n;
+  MY_MALLOC(lit2, (n2 + 1) * sizeof(Tlit));
+  MY_MALLOC(weight2, (n2 + 1) * sizeof(unsigned long));
+  for (i = 0; i < n2; i++)
+    {
+      lit2[i] = M.soft[i].lit;
+      weight2[i] = M.soft[i].weight;
+      if (strat < weight2[i])
+	strat = weight2[i];
+    }
+  if (options & SAT_MAXSAT_LINEAR)
+    status = maxsat_linear(S, n2, lit2, weight2, &M.cost);
+  else
+    while (true)
+      {
+	for (i = 0, k = 0; i < M.soft_n; i++)
+	  if (M.soft[i].weight >= strat && M.soft[i].weight)
+	    {
+	      STACK_RESIZE_EXP(M.assumption, k + 1, M.assumption_size,
+			       sizeof(Tlit));
+	      M.assumption[k++] = M.soft[i].lit;
+	    }
+	status = SAT_solve_assuming_r(S, k, M.assumption);
+	if (status == SAT_STATUS_SAT)
+	  {
+	    /* next stratum */
+	    unsigned long next = 0;
+	    for (i = 0; i < M.soft_n; i++)
+	      if (M.soft[i].weight < strat && M.soft[i].weight > next)
+		next = M.soft[i].weight;
+	    if (!next)
+	      break;
+	    strat = next;
+	    continue;
+	  }
+	if (status != SAT_STATUS_UNSAT || !assumption_core_n)
+	  break;
+	core_n = assumption_core_n;
+	MY_REALLOC(core, core_n * sizeof(Tlit));
+	memcpy(core, assumption_core, core_n * sizeof(Tlit));
+	for (i = 0; i < MUS_TRIM && core_n > 1; i++)
+	  {
+	    status = SAT_solve_assuming_r(S, core_n, core);
+	    if (status != SAT_STATUS_UNSAT || assumption_core_n == core_n)
+	      break;
+	    core_n = assumption_core_n;
+	    memcpy(core, assumption_core, core_n * sizeof(Tlit));
+	  }
+	if (status == SAT_STATUS_UNDEF)
+	  break;
+	if (core_n > MAXSAT_CORE_MAX)
+	  {
+	    status = maxsat_linear(S, n2, lit2, weight2, &M.cost);
+	    break;
+	  }
+	/* the least weight of the core is paid */
+	w = M.soft[M.soft_of[core[0]] - 1].weight;
+	for (i = 1; i < core_n; i++)
+	  if (w > M.soft[M.soft_of[core[i]] - 1].weight)
+	    w = M.soft[M.soft_of[core[i]] - 1].weight;
+	M.cost += w;
+	for (i = 0; i < core_n; i++)
+	  {
+	    Tsoft * soft = M.soft + M.soft_of[core[i]] - 1;
+	    Tsum * sum = soft->sum ? M.sum + soft->sum - 1 : NULL;
+	    soft->weight -= w;
+	    if (sum && soft->bound + 1 < sum->n)
+	      maxsat_soft(S, &M, SAT_lit_neg(sum->out[soft->bound + 1]), w,
+			  soft->sum, soft->bound + 1);
+	  }
+	if (core_n == 1)
+	  {
+	    /* the literal is false in every model */
+	    core[0] = SAT_lit_neg(core[0]);
+	    clause_add(S, 1, core, 0);
+	    continue;
+	  }
+	STACK_RESIZE_EXP(M.sum, M.sum_n + 1, M.sum_size, sizeof(Tsum));
+	M.sum[M.sum_n].n = core_n;
+	MY_MALLOC(M.sum[M.sum_n].out, core_n * sizeof(Tlit));
+	for (i = 0; i < core_n; i++)
+	  core[i] = SAT_lit_neg(core[i]);
+	maxsat_totalizer(S, core, core_n, M.sum[M.sum_n].out);
+	M.sum_n++;
+	/* one of the core is false: at most one for free */
+	maxsat_soft(S, &M, SAT_lit_neg(M.sum[M.sum_n - 1].out[1]), w,
+		    M.sum_n, 1);
+      }
+  *cost = M.cost;
+  if (status == SAT_STATUS_SAT)
+    {
+      *cost = maxsat_cost(S, n2, lit2, weight2);
+      assert(*cost == M.cost);
+    }
+  for (j = 0; j < M.sum_n; j++)
+    free(M.sum[j].out);
+  free(M.sum);
+  free(M.soft);
+  free(M.soft_of);
+  free(M.assumption);
+  free(core);
+  free(lit2);
+  free(weight2);
+  return status;
+}
+
+/*
+  --------------------------------------------------------------
+  init and done
+  --------------------------------------------------------------
+*/
+
+/**
+   \brief initialises an instance
+   \param S the instance
+   \remark SAT_proof is kept, since it is set by the user beforehand */
+static void
+solver_init(SAT_Tsolver * S)
+{
+#ifdef PROOF
+  unsigned proof = SAT_proof;
+#endif
+  memset(S, 0, sizeof(SAT_Tsolver));
+#ifdef PROOF
+  SAT_proof = proof;
+#endif
+  var_inc = 1;
+  S->state.params.var_decay = 0.95;
+  S->state.params.seed = RANDOMIZE_SEED;
+#ifdef RANDOMIZE_DECISION
+  S->state.params.random_freq = RANDOMIZE_FREQ;
+#endif
+  S->state.params.restart = SAT_RESTART_MIXED;
+  S->state.params.restart_interval = RESTART_MIN_INTERVAL;
+  S->state.params.phase = VAL_FALSE;
+  S->state.params.preprocess = true;
+  clause_inc = 1;
+  clause_decay = 0.999;
+  SAT_status = SAT_STATUS_SAT;
+  SAT_level = ROOT_LEVEL;
+  SAT_empty_clause = CLAUSE_UNDEF;
+  learnts_n_adj_cnt = LEARNTS_ADJ_INIT;
+  learnts_n_adj_cnt_restart = LEARNTS_ADJ_INIT;
+  restart_phase_length = RESTART_PHASE_INIT;
+  restart_phase_nb = RESTART_PHASE_INIT;
+#ifdef REPHASE
+  rephase_conflict_nb = REPHASE_INTERVAL;
+#endif
+#ifdef VIVIFY
+  vivify_conflict_nb = VIVIFY_INTERVAL;
+#endif
+  MY_MALLOC(SAT_stack_var, sizeof(TSvar));
+  SAT_stack_var_size = 1;
+  MY_MALLOC(assign, sizeof(Tvalue));
+  assign[0] = VAL_UNDEF;
+#ifdef HINT_AS_DECISION
+  hint_n = hint_p = 0;
+  hint_size = 4;
+  MY_MALLOC(hints, hint_size * sizeof(Tlit));
+#endif
+  MY_MALLOC(watch, 2 * sizeof(Twatch));
+  memset(watch, 0,  2 * sizeof(Twatch));
+  MY_MALLOC(card_watch, 2 * sizeof(Tcard_watch));
+  memset(card_watch, 0,  2 * sizeof(Tcard_watch));
+  /* position 0 is not used: it is the offset of released literals */
+  stack_clause_lit_size = 2;
+  MY_MALLOC(stack_clause_lit, stack_clause_lit_size * sizeof(Tlit));
+  stack_clause_lit_n = 1;
+  SAT_stack_var[VAR_UNDEF].phase_cache = 0;
+  SAT_stack_var[VAR_UNDEF].seen = 0;
+  SAT_stack_var[VAR_UNDEF].decide = 0;
+  SAT_stack_var[VAR_UNDEF].misc = 0;
+  SAT_stack_var[VAR_UNDEF].level = 0;
+  SAT_stack_var[VAR_UNDEF].reason = CLAUSE_UNDEF;
+  SAT_stack_var[VAR_UNDEF].activity = 0;
+#ifdef SAT_SYM
+  MY_MALLOC(SAT_var_orbit, sizeof(Tvar));
+  SAT_var_orbit[VAR_UNDEF] = VAR_UNDEF;
+#endif
+#if defined(BCLAUSE) || defined(BCLAUSE_LIGHT)
+  bclause_resize(S, 0, 2);
+#endif
+  ON_DEBUG_SAT(check_consistency(S));
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief releases all memory held by an instance
+   \param S the instance */
+static void
+solver_done(SAT_Tsolver * S)
+{
+  unsigned i;
+#ifdef PROOF
+  proof_stack_size = 0;
+  free(proof_stack_lit);
+  proof_stack_lit = NULL;
+  free(proof_stack_clause);
+  proof_stack_clause = NULL;
+  proof_stack_size_2 = 0;
+  free(proof_stack_lit_2);
+  proof_stack_lit_2 = NULL;
+  free(proof_stack_clause_2);
+  proof_stack_clause_2 = NULL;
+#endif
+  for (i = 1; i <= SAT_stack_var_n; ++i)
+    SAT_var_free(S, i);
+  for (i = (SAT_stack_var_n + 1) << 1; i < 2 * SAT_stack_var_size; ++i)
+    free(watch[i].Pwatcher);
+  free(watch);
+  for (i = 0; i < 2 * SAT_stack_var_size; ++i)
+    free(card_watch[i].Pcard);
+  free(card_watch);
+  card_watch = NULL;
+  free(stack_card);
+  stack_card = NULL;
+  stack_card_n = 0;
+  stack_card_size = 0;
+  free(stack_card_lit);
+  stack_card_lit = NULL;
+  stack_card_lit_n = 0;
+  stack_card_lit_size = 0;
+  free(card_stack);
+  card_stack = NULL;
+  card_stack_size = 0;
+#if defined(BCLAUSE) || defined(BCLAUSE_LIGHT)
+  for (i = 0; i < (SAT_stack_var_n + 1) << 1; i++)
+    free(bclause_lit[i].prop);
+  free(bclause_lit);
+#ifdef CYCLE_DETECTION
+  free(cycles);
+#endif
+#endif
+  free(SAT_stack_var);
+  SAT_stack_var = NULL;
+  SAT_stack_var_n = 0;
+  SAT_stack_var_size = 0;
+#ifdef SAT_SYM
+  free(SAT_var_orbit);
+  SAT_var_orbit = NULL;
+#endif
+  free(stack_clause);
+  stack_clause = NULL;
+  stack_clause_n = 0;
+  stack_clause_size = 0;
+  free(stack_clause_lit);
+  stack_clause_lit = NULL;
+  stack_clause_lit_n = 0;
+  stack_clause_lit_size = 0;
+  stack_clause_lit_waste = 0;
+  free(learnt_stack);
+  learnt_stack = NULL;
+  learnt_stack_size = 0;
+  free(learnts);
+  learnts = NULL;
+  learnts_n = 0;
+  learnts_size = 0;
+  learnts_kept = 0;
+  free(glue_stamp);
+  glue_stamp = NULL;
+  glue_stamp_size = 0;
+  glue_stamp_n = 0;
+  free(assumption_core);
+  assumption_core = NULL;
+  assumption_core_size = 0;
+  assumption_core_n = 0;
+#ifdef ELIM
+  free(elim_stack);
+  elim_stack = NULL;
+  elim_stack_n = 0;
+  elim_stack_size = 0;
+  elim_clause_n = 0;
+#endif
+  heap_var_free(S);
+  free(stack_lit);
+  stack_lit = NULL;
+  stack_lit_n = 0;
+  stack_lit_size = 0;
+  free(stack_level);
+  stack_level = NULL;
+  stack_level_size = 0;
+#ifdef BACKTRACK
+  free(history);
+  history = NULL;
+  history_size = 0;
+  history_n = 0;
+#endif
+  SAT_level = ROOT_LEVEL;
+  free(misc_stack);
+  misc_stack = NULL;
+  misc_stack_size = 0;
+  misc_stack_n = 0;
+  free(assign);
+  assign = NULL;
+#ifdef HINT_AS_DECISION
+  free(hints);
+  hint_n = hint_p = hint_size = 0;
+#endif
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief creates a new solver instance
+   \return the instance, ready to receive variables and clauses */
+SAT_Tsolver *
+SAT_new(void)
+{
+  SAT_Tsolver * S;
+  MY_MALLOC(S, sizeof(SAT_Tsolver));
+  memset(S, 0, sizeof(SAT_Tsolver));
+  solver_init(S);
+  return S;
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief releases a solver instance and all its memory
+   \param S the instance */
+void
+SAT_delete(SAT_Tsolver * S)
+{
+  solver_done(S);
+  free(S);
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \author Pascal Fontaine
+   \brief module initialise */
+void
+SAT_init(void)
+{
+  solver_init(SAT_default);
+#if STATS_LEVEL >= 1
+#ifndef INSIDE_VERIT
+  stats_init();
+#endif
+  stat_n_conflict = stats_counter_new("SAT_n_conflict",
+				      "Number of conflicts in SAT", "%9d");
+  stat_n_conflict_lit = stats_counter_new("SAT_n_conflict_lit",
+					  "Number of literals in conflicts in SAT", "%9d");
+  stat_n_decision = stats_counter_new("SAT_n_dec",
+				      "Number of decisions in SAT", "%9d");
+  stat_n_tp = stats_counter_new("SAT_n_tp",
+				"Number of theory propagations in SAT", "%9d");
+  stat_n_delete = stats_counter_new("SAT_n_del",
+				    "Number of clause deletions in SAT", "%9d");
+  stat_n_restart = stats_counter_new("SAT_n_restart",
+				     "Number of restarts in SAT", "%6d");
+  stat_n_purge = stats_counter_new("SAT_n_purge",
+				   "Number of purges in SAT", "%6d");
+  stat_n_clauses = stats_counter_new("SAT_n_clauses",
+				     "Number of clauses added in SAT", "%9d");
+  stat_n_prop = stats_counter_new("SAT_n_prop",
+				  "Number of propagation", "%9d");
+#if STATS_LEVEL >= 2
+  stat_n_watched = stats_counter_new("SAT_n_watch",
+				     "Number of clauses examined by watched", "%9d");
+  stat_prop_lit_call_nowatch =
+    stats_counter_new("SAT_prop_lit_call_nowatch",
+		      "Number of calls to prop_lit with no watchers", "%9d");
+  stat_prop_call = 
+    stats_counter_new("SAT_prop_call",
+		      "Number of calls to propagate", "%9d");
+  stat_prop_call_waste = 
+    stats_counter_new("SAT_prop_call_waste",
+		      "Number of calls to propagate with nothing to propagate", "%9d");
+  stat_prop_call_noprop = 
+    stats_counter_new("SAT_prop_call_noprop",
+		      "Number of calls to propagate without further propagation", "%9d");
+#endif
+#endif
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \author Pascal Fontaine
+   \brief module release */
+void
+SAT_done(void)
+{
+  solver_done(SAT_default);
+#ifndef INSIDE_VERIT
+#if STATS_LEVEL >= 1
+  stats_fprint(stdout);
+  stats_done();
+#endif
+#endif
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \author Pascal Fontaine
+   \brief module reset */
+void
+SAT_reset_r(SAT_Tsolver * S)
+{
+  solver_done(S);
+  solver_init(S);
+}
+
+/*
+  --------------------------------------------------------------
+  Portfolio
+  --------------------------------------------------------------
+*/
+
+#ifdef SAT_THREADS
+
+/**
+   \brief a race between instances: the first one to conclude wins */
+typedef struct Trace
+{
+  unsigned done;            /**< set by the first instance to conclude */
+  unsigned winner;          /**< index of that instance */
+} Trace;
+
+/**
+   \brief an instance taking part in a race */
+typedef struct Tworker
+{
+  SAT_Tsolver * S;          /**< the instance */
+  unsigned index;           /**< its index in the race */
+  Trace * race;             /**< the race */
+  struct Tcubes * cubes;    /**< cubes to solve (cube and conquer) */
+  pthread_t thread;
+} Tworker;
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief copies the clause set of an instance into a new instance
+   \param S the instance
+   \param params the parameters for the new instance
+   \return the new instance
+   \remark only input clauses and root level units are copied
+   \remark the copy is not preprocessed again */
+static SAT_Tsolver *
+solver_clone(SAT_Tsolver * S, const SAT_Tparams * params)
+{
+  unsigned i;
+  SAT_Tsolver * S2 = SAT_new();
+  SAT_state(S2)->params = *params;
+  SAT_state(S2)->params.preprocess = false;
+  SAT_var_new_id_r(S2, SAT_stack_var_n);
+  for (i = 1; i <= SAT_stack_var_n; i++)
+    {
+      if (!SAT_stack_var[i].decide)
+	SAT_var_block_decide_r(S2, i);
+#ifdef SAT_SYM
+      SAT_state(S2)->var_orbit[i] = SAT_var_orbit[i];
+#endif
+    }
+  for (i = 0; i < stack_lit_unit; i++)
+    {
+      Tlit * lit;
+      MY_MALLOC(lit, sizeof(Tlit));
+      lit[0] = stack_lit[i];
+      SAT_clause_new_r(S2, 1, lit);
+    }
+  for (i = 1; i <= stack_clause_n; i++)
+    {
+      TSclause * PSclause = stack_clause + i;
+      Tlit * lit;
+      if (PSclause->deleted || PSclause->learnt || !PSclause->n)
+	continue;
+      MY_MALLOC(lit, PSclause->n * sizeof(Tlit));
+      memcpy(lit, CLAUSE_LIT(PSclause), PSclause->n * sizeof(Tlit));
+      SAT_clause_new_r(S2, PSclause->n, lit);
+    }
+  card_copy(S, S2);
+  return S2;
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief parameters of the i-th copy in a portfolio
+   \param params parameters of the original instance, modified in place
+   \param i the index of the copy (positive)
+   \remark the first copies explore the parameters one by one around the
+   defaults, later ones combine them */
+static void
+params_diversify(SAT_Tparams * params, unsigned i)
+{
+  static const unsigned restart_intervals[] = { 7, 5, 9, 6, 8 };
+  static const double var_decays[] = { 0.95, 0.9, 0.99, 0.8 };
+  static const SAT_Tvalue phases[] = { VAL_TRUE, VAL_UNDEF, VAL_FALSE };
+  static const SAT_Trestart restarts[] =
+    { SAT_RESTART_MIXED, SAT_RESTART_GLUE, SAT_RESTART_LUBY };
+  params->seed += 7919 * i;
+  params->random_freq = (i & 1) ? RANDOMIZE_FREQ : 10 * RANDOMIZE_FREQ;
+  params->restart_interval = restart_intervals[i % 5];
+  params->var_decay = var_decays[(i / 2) % 4];
+  params->phase = phases[i % 3];
+  params->restart = restarts[(i / 3) % 3];
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief solves the instance of a worker and records if it concluded first
+   \param P the worker */
+static void *
+worker_solve(void * P)
+{
+  Tworker * worker = (Tworker *) P;
+  unsigned expected = 0;
+  if (SAT_solve_r(worker->S) != SAT_STATUS_UNDEF &&
+      __atomic_compare_exchange_n(&worker->race->done, &expected, 1, false,
+				  __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    worker->race->winner = worker->index;
+  return NULL;
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief take the answer of another instance
+   \param S the instance
+   \param S2 the other instance, with status SAT or UNSAT
+   \remark a model is rebuilt by solving again with the other model as
+   polarities: propagation cannot contradict it, so no conflict occurs */
+static void
+solver_adopt(SAT_Tsolver * S, SAT_Tsolver * S2)
+{
+  unsigned i, freq = S->state.params.random_freq;
+  /* the instance concluded as well, but lost the race */
+  if (SAT_status != SAT_STATUS_UNDEF)
+    return;
+  level_backtrack(S, ROOT_LEVEL);
+  if (SAT_state(S2)->status == SAT_STATUS_UNSAT)
+    {
+#ifdef BACKTRACK
+      history_status_changed(S);
+#endif
+      SAT_status = SAT_STATUS_UNSAT;
+      return;
+    }
+  for (i = 1; i <= SAT_stack_var_n; i++)
+    if (SAT_var_value_r(S2, i) != VAL_UNDEF)
+      SAT_stack_var[i].phase_cache = SAT_var_value_r(S2, i);
+  S->state.params.random_freq = 0;
+  SAT_solve_r(S);
+  S->state.params.random_freq = freq;
+}
+
+#endif /* SAT_THREADS */
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief runs several diversified copies of the solver concurrently
+   \param nthreads the number of threads (the calling one included)
+   \return SAT_STATUS_SAT, SAT_STATUS_UNSAT
+   \remark the instance itself is the first copy, with its parameters */
+Tstatus
+SAT_solve_portfolio_r(SAT_Tsolver * S, unsigned nthreads)
+{
+#ifdef SAT_THREADS
+  unsigned i;
+  Trace race;
+  Tworker * workers;
+  Texchange * exchange;
+  if (nthreads <= 1 || SAT_propagate_r(S) != SAT_STATUS_UNDEF)
+    return SAT_solve_r(S);
+  race.done = 0;
+  race.winner = 0;
+  MY_MALLOC(exchange, sizeof(Texchange));
+  memset(exchange, 0, sizeof(Texchange));
+  MY_MALLOC(workers, nthreads * sizeof(Tworker));
+  workers[0].S = S;
+  for (i = 1; i < nthreads; i++)
+    {
+      SAT_Tparams params = S->state.params;
+      params_diversify(&params, i);
+      workers[i].S = solver_clone(S, &params);
+    }
+  for (i = 0; i < nthreads; i++)
+    {
+      workers[i].index = i;
+      workers[i].race = &race;
+      workers[i].S->interrupt = &race.done;
+      workers[i].S->exchange = exchange;
+      workers[i].S->exchange_id = i;
+      workers[i].S->exchange_read = 0;
+    }
+  for (i = 1; i < nthreads; i++)
+    if (pthread_create(&workers[i].thread, NULL, worker_solve, workers + i))
+      my_error("SAT_solve_portfolio: unable to create thread");
+  worker_solve(workers);
+  for (i = 1; i < nthreads; i++)
+    pthread_join(workers[i].thread, NULL);
+  S->interrupt = NULL;
+  S->exchange = NULL;
+  if (race.winner != 0)
+    solver_adopt(S, workers[race.winner].S);
+  for (i = 1; i < nthreads; i++)
+    SAT_delete(workers[i].S);
+  free(workers);
+  free(exchange);
+  return SAT_status;
+#else
+  return SAT_solve_r(S);
+#endif
+}
+
+/*
+  --------------------------------------------------------------
+  Cube and conquer
+  --------------------------------------------------------------
+*/
+
+#ifdef SAT_THREADS
+
+/**
+   \brief number of most active variables tried for each split */
+#define CUBE_CANDIDATES 64
+
+/**
+   \brief cubes given to a worker: the owner takes from the bottom,
+   thieves from the top */
+typedef struct Tdeque
+{
+  pthread_mutex_t lock;
+  unsigned * cube;          /**< indices of the cubes */
+  unsigned top;             /**< first cube left */
+  unsigned bottom;          /**< past the last cube left */
+} Tdeque;
+
+/**
+   \brief the cubes of a cube-and-conquer run */
+typedef struct Tcubes
+{
+  Tlit * lit;               /**< literals of all cubes, one after the other */
+  unsigned lit_n;
+  unsigned lit_size;
+  unsigned * start;         /**< start[i] is the first literal of cube i,
+			       start[cube_n] is lit_n */
+  unsigned start_size;
+  unsigned cube_n;          /**< number of cubes */
+  Tdeque * deque;           /**< one per worker */
+  unsigned deque_n;         /**< number of workers */
+} Tcubes;
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief adds the current decisions as a cube
+   \param cubes the cubes */
+static void
+cubes_add(SAT_Tsolver * S, Tcubes * cubes)
+{
+  Tlevel level;
+  STACK_RESIZE_EXP(cubes->start, cubes->cube_n + 2, cubes->start_size,
+		   sizeof(unsigned));
+  STACK_RESIZE_EXP(cubes->lit, cubes->lit_n + SAT_level, cubes->lit_size,
+		   sizeof(Tlit));
+  cubes->start[cubes->cube_n] = cubes->lit_n;
+  for (level = ROOT_LEVEL; level < SAT_level; level++)
+    cubes->lit[cubes->lit_n++] = stack_lit[stack_level[level]];
+  cubes->start[++cubes->cube_n] = cubes->lit_n;
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief number of literals assigned by deciding and propagating a
+   literal
+   \param lit the literal, undefined
+   \return the number of literals, 0 if propagation conflicts */
+static unsigned
+lookahead(SAT_Tsolver * S, Tlit lit)
+{
+  unsigned n;
+  Tclause conflict;
+  level_push(S, lit);
+  conflict = propagate(S);
+  n = stack_lit_n - stack_level[SAT_level - 1];
+  level_backtrack(S, SAT_level - 1);
+  return conflict == CLAUSE_UNDEF ? n : 0;
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief adds the cubes extending the current decisions
+   \param cubes the cubes
+   \param depth the number of splits left
+   \remark among the first undefined variables of the heap, splits on
+   the one whose polarities propagate most (product of both counts).  A
+   polarity whose propagation conflicts is refuted and yields no cube,
+   so such variables are chosen first
+   \pre propagation is complete and without conflict */
+static void
+cubes_split(SAT_Tsolver * S, Tcubes * cubes, unsigned depth)
+{
+  unsigned i, candidates = 0, count[2] = { 0, 0 };
+  unsigned long score, best_score = 0;
+  Tvar best = 0;
+  for (i = 0; depth && i < heap_var_n && candidates < CUBE_CANDIDATES; i++)
+    {
+      Tvar var = heap_var[i];
+      unsigned n0, n1;
+      if (SAT_var_value_r(S, var) != VAL_UNDEF || !SAT_var_decision(S, var))
+	continue;
+      candidates++;
+      n0 = lookahead(S, SAT_lit(var, 0));
+      n1 = lookahead(S, SAT_lit(var, 1));
+      score = (!n0 || !n1) ? ULONG_MAX : (unsigned long) n0 * n1;
+      if (best && score <= best_score)
+	continue;
+      best = var;
+      best_score = score;
+      count[0] = n0;
+      count[1] = n1;
+      if (score == ULONG_MAX)
+	break;
+    }
+  if (!best)
+    {
+      cubes_add(S, cubes);
+      return;
+    }
+  for (i = 0; i < 2; i++)
+    {
+      if (!count[i])
+	continue;
+      level_push(S, SAT_lit(best, i));
+      propagate(S);
+      cubes_split(S, cubes, depth - 1);
+      level_backtrack(S, SAT_level - 1);
+    }
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief takes a cube to solve, from the own deque or from another one
+   \param cubes the cubes
+   \param index the index of the worker
+   \param cube set to the index of the cube taken
+   \return false if no cube is left */
+static bool
+cubes_take(Tcubes * cubes, unsigned index, unsigned * cube)
+{
+  unsigned i;
+  Tdeque * deque = cubes->deque + index;
+  pthread_mutex_lock(&deque->lock);
+  if (deque->top < deque->bottom)
+    {
+      *cube = deque->cube[--deque->bottom];
+      pthread_mutex_unlock(&deque->lock);
+      return true;
+    }
+  pthread_mutex_unlock(&deque->lock);
+  for (i = 1; i < cubes->deque_n; i++)
+    {
+      deque = cubes->deque + (index + i) % cubes->deque_n;
+      pthread_mutex_lock(&deque->lock);
+      if (deque->top < deque->bottom)
+	{
+	  *cube = deque->cube[deque->top++];
+	  pthread_mutex_unlock(&deque->lock);
+	  return true;
+	}
+      pthread_mutex_unlock(&deque->lock);
+    }
+  return false;
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief solves cubes until none is left, a model is found, or the
+   clauses are found unsat, and records if the worker concluded first
+   \param P the worker */
+static void *
+worker_conquer(void * P)
+{
+  Tworker * worker = (Tworker *) P;
+  SAT_Tsolver * S = worker->S;
+  Tcubes * cubes = worker->cubes;
+  unsigned cube, expected = 0;
+  while (!__atomic_load_n(&worker->race->done, __ATOMIC_RELAXED) &&
+	 cubes_take(cubes, worker->index, &cube))
+    {
+      if (solve_assuming(S, cubes->start[cube + 1] - cubes->start[cube],
+			 cubes->lit + cubes->start[cube]) == SAT_STATUS_UNDEF)
+	return NULL;
+      if (SAT_status == SAT_STATUS_UNDEF)
+	continue;
+      if (__atomic_compare_exchange_n(&worker->race->done, &expected, 1, false,
+				      __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+	worker->race->winner = worker->index;
+      return NULL;
+    }
+  return NULL;
+}
+
+#endif /* SAT_THREADS */
+
+/*--------------------------------------------------------------*/
+
+/**
+   \brief cube-and-conquer on nthreads copies of the solver
+   \param nthreads the number of threads (the calling one included)
+   \return SAT_STATUS_SAT, SAT_STATUS_UNSAT
+   \remark the instance itself is the first copy.  Cubes are generated
+   on it at root level, then dealt round-robin to the copies */
+Tstatus
+SAT_solve_cubes_r(SAT_Tsolver * S, unsigned nthreads)
+{
+#ifdef SAT_THREADS
+  unsigned i, depth = S->state.params.cube_depth;
+  Trace race;
+  Tworker * workers;
+  Texchange * exchange;
+  Tcubes cubes;
+  if (nthreads <= 1 || SAT_propagate_r(S) != SAT_STATUS_UNDEF)
+    return SAT_solve_r(S);
+  level_backtrack(S, ROOT_LEVEL);
+  if (!depth)
+    for (depth = 4, i = nthreads; i > 1; i >>= 1)
+      depth++;
+  memset(&cubes, 0, sizeof(Tcubes));
+  cubes_split(S, &cubes, depth);
+  if (!cubes.cube_n)
+    {
+      /* every branch is refuted by propagation */
+#ifdef BACKTRACK
+      history_status_changed(S);
+#endif
+      free(cubes.lit);
+      free(cubes.start);
+      return (SAT_status = SAT_STATUS_UNSAT);
+    }
+  cubes.deque_n = nthreads;
+  MY_MALLOC(cubes.deque, nthreads * sizeof(Tdeque));
+  for (i = 0; i < nthreads; i++)
+    {
+      pthread_mutex_init(&cubes.deque[i].lock, NULL);
+      MY_MALLOC(cubes.deque[i].cube, cubes.cube_n * sizeof(unsigned));
+      cubes.deque[i].top = cubes.deque[i].bottom = 0;
+    }
+  for (i = 0; i < cubes.cube_n; i++)
+    {
+      Tdeque * deque = cubes.deque + i % nthreads;
+      deque->cube[deque->bottom++] = i;
+    }
+  race.done = 0;
+  race.winner = 0;
+  MY_MALLOC(exchange, sizeof(Texchange));
+  memset(exchange, 0, sizeof(Texchange));
+  MY_MALLOC(workers, nthreads * sizeof(Tworker));
+  workers[0].S = S;
+  for (i = 1; i < nthreads; i++)
+    {
+      SAT_Tparams params = S->state.params;
+      params.seed += 7919 * i;
+      workers[i].S = solver_clone(S, &params);
+    }
+  for (i = 0; i < nthreads; i++)
+    {
+      workers[i].index = i;
+      workers[i].race = &race;
+      workers[i].cubes = &cubes;
+      workers[i].S->interrupt = &race.done;
+      workers[i].S->exchange = exchange;
+      workers[i].S->exchange_id = i;
+      workers[i].S->exchange_read = 0;
+    }
+  for (i = 1; i < nthreads; i++)
+    if (pthread_create(&workers[i].thread, NULL, worker_conquer, workers + i))
+      my_error("SAT_solve_cubes: unable to create thread");
+  worker_conquer(workers);
+  for (i = 1; i < nthreads; i++)
+    pthread_join(workers[i].thread, NULL);
+  S->interrupt = NULL;
+  S->exchange = NULL;
+  if (race.winner != 0)
+    solver_adopt(S, workers[race.winner].S);
+  else if (!race.done)
+    {
+      /* every cube is refuted */
+      level_backtrack(S, ROOT_LEVEL);
+#ifdef BACKTRACK
+      history_status_changed(S);
+#endif
+      SAT_status = SAT_STATUS_UNSAT;
+    }
+  for (i = 1; i < nthreads; i++)
+    SAT_delete(workers[i].S);
+  for (i = 0; i < nthreads; i++)
+    {
+      pthread_mutex_destroy(&cubes.deque[i].lock);
+      free(cubes.deque[i].cube);
+    }
+  free(cubes.deque);
+  free(cubes.lit);
+  free(cubes.start);
+  free(workers);
+  free(exchange);
+  return SAT_status;
+#else
+  return SAT_solve_r(S);
+#endif
+}
+
+/*
+  --------------------------------------------------------------
+  Default instance
+  --------------------------------------------------------------
+*/
+
+/* The functions without _r suffix work on SAT_default */
+
+SAT_Tvar
+SAT_var_new(void)
+{
+  return SAT_var_new_r(SAT_default);
+}
+
+/*--------------------------------------------------------------*/
+
+void
+SAT_var_new_id(unsigned id)
+{
+  SAT_var_new_id_r(SAT_default, id);
+}
+
+/*--------------------------------------------------------------*/
+
+SAT_Tvalue
+SAT_var_value(SAT_Tvar var)
+{
+  return SAT_var_value_r(SAT_default, var);
+}
+
+/*--------------------------------------------------------------*/
+
+SAT_Tlevel
+SAT_var_level(SAT_Tvar var)
+{
+  return SAT_var_level_r(SAT_default, var);
+}
+
+/*--------------------------------------------------------------*/
+
+void
+SAT_var_block_decide(SAT_Tvar var)
+{
+  SAT_var_block_decide_r(SAT_default, var);
+}
+
+/*--------------------------------------------------------------*/
+
+void
+SAT_var_unblock_decide(SAT_Tvar var)
+{
+  SAT_var_unblock_decide_r(SAT_default, var);
+}
+
+/*--------------------------------------------------------------*/
+
+void
+SAT_phase_cache_set(void)
+{
+  SAT_phase_cache_set_r(SAT_default);
+}
+
+/*--------------------------------------------------------------*/
+
+SAT_Tvalue
+SAT_lit_value(SAT_Tlit lit)
+{
+  return SAT_lit_value_r(SAT_default, lit);
+}
+
+/*--------------------------------------------------------------*/
+
+SAT_Tlevel
+SAT_lit_level(SAT_Tlit lit)
+{
+  return SAT_lit_level_r(SAT_default, lit);
+}
+
+/*--------------------------------------------------------------*/
+
+#ifdef PROOF
+void
+SAT_sanitize_root_level(void)
+{
+  SAT_sanitize_root_level_r(SAT_default);
+}
+#endif
+
+/*--------------------------------------------------------------*/
+
+SAT_Tclause
+SAT_clause_new(unsigned n, SAT_Tlit * lits)
+{
+  return SAT_clause_new_r(SAT_default, n, lits);
+}
+
+/*--------------------------------------------------------------*/
+
+SAT_Tclause
+SAT_clause_new_conflict(unsigned n, SAT_Tlit * lits)
+{
+  return SAT_clause_new_conflict_r(SAT_default, n, lits);
+}
+
+/*--------------------------------------------------------------*/
+
+SAT_Tclause
+SAT_clause_new_lazy(unsigned n, SAT_Tlit * lit)
+{
+  return SAT_clause_new_lazy_r(SAT_default, n, lit);
+}
+
+/*--------------------------------------------------------------*/
+
+#ifdef BACKTRACK
+void
+SAT_push(void)
+{
+  SAT_push_r(SAT_default);
+}
+#endif
+
+/*--------------------------------------------------------------*/
+
+#ifdef BACKTRACK
+void
+SAT_pop(void)
+{
+  SAT_pop_r(SAT_default);
+}
+#endif
+
+/*--------------------------------------------------------------*/
+
+SAT_Tstatus
+SAT_propagate(void)
+{
+  return SAT_propagate_r(SAT_default);
+}
+
+/*--------------------------------------------------------------*/
+
+#ifdef HINTS
+void
+SAT_hint(SAT_Tlit lit)
+{
+  SAT_hint_r(SAT_default, lit);
+}
+#endif
+
+/*--------------------------------------------------------------*/
+
+bool
+SAT_decide(void)
+{
+  return SAT_decide_r(SAT_default);
+}
+
+/*--------------------------------------------------------------*/
+
+void
+SAT_restart(void)
+{
+  SAT_restart_r(SAT_default);
+}
+
+/*--------------------------------------------------------------*/
+
+SAT_Tstatus
+SAT_solve(void)
+{
+  return SAT_solve_r(SAT_default);
+}
+
+/*--------------------------------------------------------------*/
+
+void
+SAT_clauses_load_csc(unsigned n, const size_t * start, const size_t * index,
+		     const double * value)
+{
+  SAT_clauses_load_csc_r(SAT_default, n, start, index, value);
+}
+
+/*--------------------------------------------------------------*/
+
+void
+SAT_card_new(unsigned n, const SAT_Tlit * lit, unsigned k)
+{
+  SAT_card_new_r(SAT_default, n, lit, k);
+}
+
+/*--------------------------------------------------------------*/
+
+void
+SAT_exactly_one(unsigned n, const SAT_Tlit * lit)
+{
+  SAT_exactly_one_r(SAT_default, n, lit);
+}
+
+/*--------------------------------------------------------------*/
+
+void
+SAT_cards_load_csc(unsigned n, const size_t * start, const size_t * index,
+		   const double * value, const unsigned * k)
+{
+  SAT_cards_load_csc_r(SAT_default, n, start, index, value, k);
+}
+
+/*--------------------------------------------------------------*/
+
+SAT_Tstatus
+SAT_solve_assuming(unsigned n, SAT_Tlit * lits)
+{
+  return SAT_solve_assuming_r(SAT_default, n, lits);
+}
+
+/*--------------------------------------------------------------*/
+
+void
+SAT_assumptions_core(SAT_Tlit ** PPlit, unsigned *n)
+{
+  SAT_assumptions_core_r(SAT_default, PPlit, n);
+}
+
+/*--------------------------------------------------------------*/
+
+SAT_Tstatus
+SAT_solve_portfolio(unsigned nthreads)
+{
+  return SAT_solve_portfolio_r(SAT_default, nthreads);
+}
+
+/*--------------------------------------------------------------*/
+
+SAT_Tstatus
+SAT_solve_cubes(unsigned nthreads)
+{
+  return SAT_solve_cubes_r(SAT_default, nthreads);
+}
+
+/*--------------------------------------------------------------*/
+
+void
+SAT_minimal_model(SAT_Tlit ** PPlit, unsigned *n, unsigned options)
+{
+  SAT_minimal_model_r(SAT_default, PPlit, n, options);
+}
+
+/*--------------------------------------------------------------*/
+
+unsigned long
+SAT_models(unsigned n, SAT_Tvar * var, unsigned long max,
+	   SAT_Tmodel_callback callback, void * data)
+{
+  return SAT_models_r(SAT_default, n, var, max, callback, data);
+}
+
+/*--------------------------------------------------------------*/
+
+Tstatus
+SAT_backbone(unsigned n, SAT_Tvar * var, SAT_Tlit ** PPlit, unsigned * lit_n)
+{
+  return SAT_backbone_r(SAT_default, n, var, PPlit, lit_n);
+}
+
+/*--------------------------------------------------------------*/
+
+Tstatus
+SAT_mus(unsigned n, SAT_Tlit * lit, SAT_Tlit ** PPlit, unsigned * lit_n,
+	unsigned options)
+{
+  return SAT_mus_r(SAT_default, n, lit, PPlit, lit_n, options);
+}
+
+/*--------------------------------------------------------------*/
+
+Tstatus
+SAT_maxsat(unsigned n, SAT_Tlit * lit, const unsigned long * weight,
+	   unsigned long * cost, unsigned options)
+{
+  return SAT_maxsat_r(SAT_default, n, lit, weight, cost, options);
+}
+
+/*--------------------------------------------------------------*/
 
-/**
-   \author Pascal Fontaine
-   \brief module initialise */
-void
-SAT_init(void)
+double
+SAT_count(const double * weight, unsigned n, SAT_Tlit * lit)
 {
-  var_inc = 1;
-  var_decay = 0.95;
-  SAT_status = SAT_STATUS_SAT;
-  SAT_level = ROOT_LEVEL;
-  SAT_empty_clause = CLAUSE_UNDEF;
-  conflict_nb = 0;
-  stack_lit_to_propagate = 0;
-  stack_lit_hold = 0;
-  stack_lit_unit = 0;
-  MY_MALLOC(SAT_stack_var, sizeof(TSvar));
-  SAT_stack_var_size = 1;
-  MY_MALLOC(assign, sizeof(Tvalue));
-  assign[0] = VAL_UNDEF;
-#ifdef HINT_AS_DECISION
-  hint_n = hint_p = 0;
-  hint_size = 4;
-  MY_MALLOC(hints, hint_size * sizeof(Tlit));
-#endif
-  MY_MALLOC(watch, 2 * sizeof(Twatch));
-  memset(watch, 0,  2 * sizeof(Twatch));
-  SAT_stack_var[VAR_UNDEF].phase_cache = 0;
-  SAT_stack_var[VAR_UNDEF].seen = 0;
-  SAT_stack_var[VAR_UNDEF].decide = 0;
-  SAT_stack_var[VAR_UNDEF].misc = 0;
-  SAT_stack_var[VAR_UNDEF].level = 0;
-  SAT_stack_var[VAR_UNDEF].reason = CLAUSE_UNDEF;
-  SAT_stack_var[VAR_UNDEF].activity = 0;
-#ifdef SAT_SYM
-  MY_MALLOC(SAT_var_orbit, sizeof(Tvar));
-  SAT_var_orbit[VAR_UNDEF] = VAR_UNDEF;
-#endif
+  return SAT_count_r(SAT_default, weight, n, lit);
+}
 
-#if defined(BCLAUSE) || defined(BCLAUSE_LIGHT)
-  bclause_resize(0, 2);
-#endif
-  ON_DEBUG_SAT(check_consistency());
-#if STATS_LEVEL >= 1
-#ifndef INSIDE_VERIT
-  stats_init();
-#endif
-  stat_n_conflict = stats_counter_new("SAT_n_conflict",
-				      "Number of conflicts in SAT", "%9d");
-  stat_n_conflict_lit = stats_counter_new("SAT_n_conflict_lit",
-					  "Number of literals in conflicts in SAT", "%9d");
-  stat_n_decision = stats_counter_new("SAT_n_dec",
-				      "Number of decisions in SAT", "%9d");
-  stat_n_tp = stats_counter_new("SAT_n_tp",
-				"Number of theory propagations in SAT", "%9d");
-  stat_n_delete = stats_counter_new("SAT_n_del",
-				    "Number of clause deletions in SAT", "%9d");
-  stat_n_restart = stats_counter_new("SAT_n_restart",
-				     "Number of restarts in SAT", "%6d");
-  stat_n_purge = stats_counter_new("SAT_n_purge",
-				   "Number of purges in SAT", "%6d");
-  stat_n_clauses = stats_counter_new("SAT_n_clauses",
-				     "Number of clauses added in SAT", "%9d");
-  stat_n_prop = stats_counter_new("SAT_n_prop",
-				  "Number of propagation", "%9d");
-#if STATS_LEVEL >= 2
-  stat_n_watched = stats_counter_new("SAT_n_watch",
-				     "Number of clauses examined by watched", "%9d");
-  stat_prop_lit_call_nowatch =
-    stats_counter_new("SAT_prop_lit_call_nowatch",
-		      "Number of calls to prop_lit with no watchers", "%9d");
-  stat_prop_call = 
-    stats_counter_new("SAT_prop_call",
-		      "Number of calls to propagate", "%9d");
-  stat_prop_call_waste = 
-    stats_counter_new("SAT_prop_call_waste",
-		      "Number of calls to propagate with nothing to propagate", "%9d");
-  stat_prop_call_noprop = 
-    stats_counter_new("SAT_prop_call_noprop",
-		      "Number of calls to propagate without further propagation", "%9d");
-#endif
-#endif
+/*--------------------------------------------------------------*/
+
+SAT_Tnnf *
+SAT_compile(void)
+{
+  return SAT_compile_r(SAT_default);
 }
 
 /*--------------------------------------------------------------*/
 
-/**
-   \author Pascal Fontaine
-   \brief module release */
-void
-SAT_done(void)
+unsigned
+SAT_sample(unsigned n, SAT_Tvar * var, unsigned sample_n, SAT_Tvalue * sample)
 {
-  unsigned i;
-#ifdef PROOF
-  proof_stack_size = 0;
-  free(proof_stack_lit);
-  proof_stack_lit = NULL;
-  free(proof_stack_clause);
-  proof_stack_clause = NULL;
-  proof_stack_size_2 = 0;
-  free(proof_stack_lit_2);
-  proof_stack_lit_2 = NULL;
-  free(proof_stack_clause_2);
-  proof_stack_clause_2 = NULL;
-#endif
-  for (i = 1; i <= SAT_stack_var_n; ++i)
-    SAT_var_free(i);
-  for (i = (SAT_stack_var_n + 1) << 1; i < 2 * SAT_stack_var_size; ++i)
-    free(watch[i].Pclause);
-  free(watch);
-#if defined(BCLAUSE) || defined(BCLAUSE_LIGHT)
-  for (i = 0; i < (SAT_stack_var_n + 1) << 1; i++)
-    free(bclause_lit[i].prop);
-  free(bclause_lit);
-#endif
-  free(SAT_stack_var);
-  SAT_stack_var = NULL;
-  SAT_stack_var_n = 0;
-  SAT_stack_var_size = 0;
-#ifdef SAT_SYM
-  free(SAT_var_orbit);
-  SAT_var_orbit = NULL;
-#endif
-  for (i = 1; i <= stack_clause_n; ++i)
-    SAT_clause_free(i);
-  free(stack_clause);
-  stack_clause = NULL;
-  stack_clause_n = 0;
-  stack_clause_size = 0;
-  free(learnts);
-  learnts = NULL;
-  learnts_n = 0;
-  learnts_size = 0;
-  heap_var_free();
-  free(stack_lit);
-  stack_lit = NULL;
-  stack_lit_n = 0;
-  stack_lit_size = 0;
-  free(stack_level);
-  stack_level = NULL;
-  stack_level_size = 0;
-#ifdef BACKTRACK
-  free(history);
-  history = NULL;
-  history_size = 0;
-  history_n = 0;
-#endif
-  SAT_level = ROOT_LEVEL;
-  free(misc_stack);
-  misc_stack = NULL;
-  misc_stack_size = 0;
-  misc_stack_n = 0;
-  free(assign);
-#ifdef HINT_AS_DECISION
-  free(hints);
-  hint_n = hint_p = hint_size = 0;
-#endif
-#ifndef INSIDE_VERIT
-#if STATS_LEVEL >= 1
-  stats_fprint(stdout);
-  stats_done();
-#endif
-#endif
+  return SAT_sample_r(SAT_default, n, var, sample_n, sample);
 }
 
 /*--------------------------------------------------------------*/
 
-/**
-   \author Pascal Fontaine
-   \brief module reset */
 void
 SAT_reset(void)
 {
-  unsigned i;
-#ifdef PROOF
-  proof_stack_size = 0;
-  free(proof_stack_lit);
-  proof_stack_lit = NULL;
-  free(proof_stack_clause);
-  proof_stack_clause = NULL;
-  proof_stack_size_2 = 0;
-  free(proof_stack_lit_2);
-  proof_stack_lit_2 = NULL;
-  free(proof_stack_clause_2);
-  proof_stack_clause_2 = NULL;
-#endif
-  for (i = 1; i <= SAT_stack_var_n; ++i)
-    SAT_var_free(i);
-  for (i = (SAT_stack_var_n + 1) << 1; i < 2 * SAT_stack_var_size; ++i)
-    free(watch[i].Pclause);
-  free(watch);
-#if defined(BCLAUSE) || defined(BCLAUSE_LIGHT)
-  for (i = 0; i < (SAT_stack_var_n + 1) << 1; i++)
-    free(bclause_lit[i].prop);
-  free(bclause_lit);
-#endif
-  free(SAT_stack_var);
-  SAT_stack_var = NULL;
-  SAT_stack_var_n = 0;
-  SAT_stack_var_size = 0;
-  for (i = 1; i <= stack_clause_n; ++i)
-    SAT_clause_free(i);
-  free(stack_clause);
-  stack_clause = NULL;
-  stack_clause_n = 0;
-  stack_clause_size = 0;
-  free(learnts);
-  learnts = NULL;
-  learnts_n = 0;
-  learnts_size = 0;
-  heap_var_free();
-  free(stack_lit);
-  stack_lit = NULL;
-  stack_lit_n = 0;
-  stack_lit_size = 0;
-  free(stack_level);
-  stack_level = NULL;
-  stack_level_size = 0;
-#ifdef BACKTRACK
-  free(history);
-  history = NULL;
-  history_size = 0;
-  history_n = 0;
-#endif
-  SAT_level = ROOT_LEVEL;
-  free(misc_stack);
-  misc_stack = NULL;
-  misc_stack_size = 0;
-  misc_stack_n = 0;
-  free(assign);
-#ifdef HINT_AS_DECISION
-  free(hints);
-#endif
-
-  var_inc = 1;
-  var_decay = 0.95;
-  SAT_status = SAT_STATUS_SAT;
-  SAT_level = ROOT_LEVEL;
-  SAT_empty_clause = CLAUSE_UNDEF;
-  conflict_nb = 0;
-  stack_lit_to_propagate = 0;
-  stack_lit_hold = 0;
-  stack_lit_unit = 0;
-  MY_MALLOC(SAT_stack_var, sizeof(TSvar));
-  SAT_stack_var_size = 1;
-  MY_MALLOC(assign, sizeof(Tvalue));
-  assign[0] = VAL_UNDEF;
-#ifdef HINT_AS_DECISION
-  hint_n = hint_p = 0;
-  hint_size = 4;
-  MY_MALLOC(hints, hint_size * sizeof(Tlit));
-#endif
-  MY_MALLOC(watch, 2 * sizeof(Twatch));
-  memset(watch, 0,  2 * sizeof(Twatch));
-  SAT_stack_var[VAR_UNDEF].phase_cache = 0;
-  SAT_stack_var[VAR_UNDEF].seen = 0;
-  SAT_stack_var[VAR_UNDEF].decide = 0;
-  SAT_stack_var[VAR_UNDEF].misc = 0;
-  SAT_stack_var[VAR_UNDEF].level = 0;
-  SAT_stack_var[VAR_UNDEF].reason = CLAUSE_UNDEF;
-  SAT_stack_var[VAR_UNDEF].activity = 0;
-#if defined(BCLAUSE) || defined(BCLAUSE_LIGHT)
-  bclause_resize(0, 2);
-#endif
-  ON_DEBUG_SAT(check_consistency());
+  SAT_reset_r(SAT_default);
 }
 
+
 /*--------------------------------------------------------------*/
 
 #ifdef DEBUG_SAT
 
 static void
-check_consistency(void)
+check_consistency(SAT_Tsolver * S)
 {
   int * count_watch = NULL;
   unsigned i, j, k;
@@ -4934,50 +10485,52 @@ check_consistency(void)
   for (var = 1; var <= SAT_stack_var_n; var++)
     {
       Tclause clause;
-      assert(SAT_var_value(var) != VAL_UNDEF ||
-	     !SAT_stack_var[var].decide ||
-	     heap_var_in(var));
+      assert(SAT_var_value_r(S, var) != VAL_UNDEF ||
+	     !SAT_var_decision(S, var) ||
+	     heap_var_in(S, var));
       clause = SAT_stack_var[var].reason;
-      if (clause == CLAUSE_LAZY || clause == CLAUSE_UNDEF)
+      if (clause == CLAUSE_LAZY || clause == CLAUSE_UNDEF ||
+	  CLAUSE_IS_CARD(clause))
 	continue;
 #if defined(BCLAUSE) || defined(BCLAUSE_LIGHT)
       if (stack_clause[clause].n == 2)
-	assert(SAT_lit_var(stack_clause[clause].lit[0]) == var ||
-	       SAT_lit_var(stack_clause[clause].lit[1]) == var);
+	assert(SAT_lit_var(CLAUSE_LIT(stack_clause + clause)[0]) == var ||
+	       SAT_lit_var(CLAUSE_LIT(stack_clause + clause)[1]) == var);
       else
-	assert(SAT_lit_var(stack_clause[clause].lit[0]) == var);
+	assert(SAT_lit_var(CLAUSE_LIT(stack_clause + clause)[0]) == var);
 #else
-      assert(SAT_lit_var(stack_clause[clause].lit[0]) == var);
+      assert(SAT_lit_var(CLAUSE_LIT(stack_clause + clause)[0]) == var);
 #endif
       for (i = 0, j = 0; i < stack_clause[clause].n; i++)
-	if (SAT_lit_value(stack_clause[clause].lit[i]) == VAL_FALSE)
+	if (SAT_lit_value_r(S, CLAUSE_LIT(stack_clause + clause)[i]) == VAL_FALSE)
 	  j++;
 	else
-	  assert(SAT_lit_value(stack_clause[clause].lit[i]) == VAL_TRUE &&
-		 SAT_lit_var(stack_clause[clause].lit[i]) == var);
+	  assert(SAT_lit_value_r(S, CLAUSE_LIT(stack_clause + clause)[i]) == VAL_TRUE &&
+		 SAT_lit_var(CLAUSE_LIT(stack_clause + clause)[i]) == var);
       assert(j == stack_clause[clause].n - 1);
     }
   for (lit = 2; lit < (SAT_stack_var_n + 1) << 1; lit++)
     for (j = 0; j < watch[lit].n; j++)
       {
-	TSclause * PSclause = stack_clause + watch[lit].Pclause[j];
-	assert(watch[lit].Pclause[j] <= stack_clause_n);
+	Tclause clause = watch[lit].Pwatcher[j].clause;
+	TSclause * PSclause = stack_clause + clause;
+	assert(clause <= stack_clause_n);
 	assert(PSclause->watched);
 #if defined(BCLAUSE) || defined(BCLAUSE_LIGHT)
 	assert(PSclause->n >= 3);
 #else
 	assert(PSclause->n >= 2);
 #endif
-	assert(PSclause->lit[0] == lit || PSclause->lit[1] == lit);
-	if (PSclause->lit[0] == lit)
+	assert(CLAUSE_LIT(PSclause)[0] == lit || CLAUSE_LIT(PSclause)[1] == lit);
+	if (CLAUSE_LIT(PSclause)[0] == lit)
 	  {
-	    assert(!(count_watch[watch[lit].Pclause[j]]&1));
-	    count_watch[watch[lit].Pclause[j]] |= 1;
+	    assert(!(count_watch[clause]&1));
+	    count_watch[clause] |= 1;
 	  }
 	else
 	  {
-	    assert(!(count_watch[watch[lit].Pclause[j]]&2));
-	    count_watch[watch[lit].Pclause[j]] |= 2;
+	    assert(!(count_watch[clause]&2));
+	    count_watch[clause] |= 2;
 	  }
       }
   for (i = 1; i <= stack_clause_n; ++i)
@@ -5004,37 +10557,50 @@ check_consistency(void)
 
   for (i = 0, k = 0; i < stack_lit_n; i++)
     {
-      assert(SAT_lit_value(stack_lit_get(i)) == VAL_TRUE);
-      if (SAT_lit_reason(stack_lit_get(i)) == CLAUSE_UNDEF)
+      assert(SAT_lit_value_r(S, stack_lit_get(S, i)) == VAL_TRUE);
+      if (SAT_lit_reason(S, stack_lit_get(S, i)) == CLAUSE_UNDEF)
 	k++;
-      SAT_stack_var[SAT_lit_var(stack_lit_get(i))].misc = 1;
+      SAT_stack_var[SAT_lit_var(stack_lit_get(S, i))].misc = 1;
 #ifdef PROOF
       assert(SAT_proof ||
-	     SAT_lit_level(stack_lit_get(i)) > ROOT_LEVEL ||
-	     SAT_lit_seen(stack_lit_get(i)));
+	     SAT_lit_level_r(S, stack_lit_get(S, i)) > ROOT_LEVEL ||
+	     SAT_lit_seen(S, stack_lit_get(S, i)));
 #else
-      assert(SAT_lit_level(stack_lit_get(i)) > ROOT_LEVEL ||
-	     SAT_lit_seen(stack_lit_get(i)));
+      assert(SAT_lit_level_r(S, stack_lit_get(S, i)) > ROOT_LEVEL ||
+	     SAT_lit_seen(S, stack_lit_get(S, i)));
 #endif
     }
   assert (SAT_level == k + ROOT_LEVEL);
   for (var = 1; var <= SAT_stack_var_n; var++)
     assert (SAT_stack_var[var].misc || 
-	    (SAT_var_value(var) == VAL_UNDEF &&
+	    (SAT_var_value_r(S, var) == VAL_UNDEF &&
 	     SAT_stack_var[var].reason == CLAUSE_UNDEF));
   for (i = 0; i < stack_lit_n; i++)
-    SAT_stack_var[SAT_lit_var(stack_lit_get(i))].misc = 0;
-#if defined(BCLAUSE) || defined(BCLAUSE_LIGHT)
+    SAT_stack_var[SAT_lit_var(stack_lit_get(S, i))].misc = 0;
+#ifdef BCLAUSE
   for (i = 0; i < (SAT_stack_var_n + 1) << 1; i++)
     if (!bclause_lit[i].updated)
       assert(bclause_lit[i].n == bclause_lit[i].direct);
 #endif
+#ifdef BCLAUSE_LIGHT
+  for (i = 2; i < (SAT_stack_var_n + 1) << 1; i++)
+    for (j = 0; j < bclause_lit[i].n; j++)
+      {
+	TSclause * PSclause = stack_clause + bclause_lit[i].prop[j].clause;
+	assert(bclause_lit[i].prop[j].clause <= stack_clause_n);
+	assert(!PSclause->deleted && PSclause->n == 2);
+	assert(CLAUSE_LIT(PSclause)[0] == SAT_lit_neg(i) ||
+	       CLAUSE_LIT(PSclause)[1] == SAT_lit_neg(i));
+	assert(CLAUSE_LIT(PSclause)[0] == bclause_lit[i].prop[j].lit ||
+	       CLAUSE_LIT(PSclause)[1] == bclause_lit[i].prop[j].lit);
+      }
+#endif
 }
 
 /*--------------------------------------------------------------*/
 
 static void
-check_consistency_propagation(void)
+check_consistency_propagation(SAT_Tsolver * S)
 {
   unsigned i;
   for (i = 1; i <= stack_clause_n; ++i)
@@ -5044,7 +10610,7 @@ check_consistency_propagation(void)
       if (!PSclause->watched)
 	continue;
       for (j = 0; j < PSclause->n; j++)
-	switch (SAT_lit_value(PSclause->lit[j]))
+	switch (SAT_lit_value_r(S, CLAUSE_LIT(PSclause)[j]))
 	  {
 	  case VAL_FALSE: count_n++; break;
 	  case VAL_TRUE: count_p++; break;
@@ -5053,8 +10619,8 @@ check_consistency_propagation(void)
       assert (count_p > 0 || count_n + 1 < PSclause->n); /* otherwise prop */
       if (!count_p)
 	{
-	  assert (SAT_lit_value_undef(PSclause->lit[0]));
-	  assert (SAT_lit_value_undef(PSclause->lit[1]));
+	  assert (SAT_lit_value_undef(S, CLAUSE_LIT(PSclause)[0]));
+	  assert (SAT_lit_value_undef(S, CLAUSE_LIT(PSclause)[1]));
 	}
     }
 }
@@ -5062,20 +10628,20 @@ check_consistency_propagation(void)
 /*--------------------------------------------------------------*/
 
 static void
-print_clause(Tclause clause)
+print_clause(SAT_Tsolver * S, Tclause clause)
 {
   unsigned k;
   assert(clause <= stack_clause_n);
   fprintf(stderr, "%d : ", clause);
   for (k = 0; k < stack_clause[clause].n; k++)
-    fprintf(stderr, "%d ", stack_clause[clause].lit[k]);
+    fprintf(stderr, "%d ", CLAUSE_LIT(stack_clause + clause)[k]);
   fprintf(stderr, "\n");
 }
 
 /*--------------------------------------------------------------*/
 
 static void
-print_stack(void)
+print_stack(SAT_Tsolver * S)
 {
   static int count = 0;
   unsigned i, k;
@@ -5085,17 +10651,17 @@ print_stack(void)
 	continue;
       fprintf(stderr, "%d : ", i);
       for (k = 0; k < stack_clause[i].n; k++)
-	fprintf(stderr, "%d ", stack_clause[i].lit[k]);
+	fprintf(stderr, "%d ", CLAUSE_LIT(stack_clause + i)[k]);
       fprintf(stderr, "\n");
     }
 
   fprintf(stderr, "stack size %u (nb var %u)\n", stack_lit_n, SAT_stack_var_n);
   for (i = 0; i < stack_lit_n; i++)
-    if (SAT_lit_reason(stack_lit_get(i)) == CLAUSE_UNDEF)
-      fprintf(stderr, "[%d] ", stack_lit_get(i));
+    if (SAT_lit_reason(S, stack_lit_get(S, i)) == CLAUSE_UNDEF)
+      fprintf(stderr, "[%d] ", stack_lit_get(S, i));
     else
-      fprintf(stderr, "%d (%u) ", stack_lit_get(i),
-	      SAT_lit_reason(stack_lit_get(i)));
+      fprintf(stderr, "%d (%u) ", stack_lit_get(S, i),
+	      SAT_lit_reason(S, stack_lit_get(S, i)));
   fprintf(stderr, "\n");
   fprintf(stderr, "call %d\n", ++count);
 }
@@ -5103,20 +10669,13 @@ print_stack(void)
 /*--------------------------------------------------------------*/
 
 static void
-check_consistency_heap(void)
+check_consistency_heap(SAT_Tsolver * S)
 {
   /* check if all unassigned variables are in the heap */
   unsigned i;
-  unsigned count = 0;
-  for (i = 0; i < heap_var_n; ++i)
-    if (SAT_var_value(heap_var[i]) == VAL_UNDEF)
-      count++;
-  if (count + stack_lit_n != SAT_stack_var_n)
-    {
-      for (i = 1; i < SAT_stack_var_n; ++i)
-	assert(SAT_var_value(i) != VAL_UNDEF || heap_var_in(i));
-      assert (count + stack_lit_n == SAT_stack_var_n);
-    }
+  for (i = 1; i <= SAT_stack_var_n; ++i)
+    assert(SAT_var_value_r(S, i) != VAL_UNDEF || !SAT_var_decision(S, i) ||
+	   heap_var_in(S, i));
   for (i = 0; i < heap_var_n; ++i)
     assert(heap_index[heap_var[i]] == i);
   for (i = 0; i < heap_index_size; ++i)
@@ -5126,20 +10685,20 @@ check_consistency_heap(void)
 /*--------------------------------------------------------------*/
 
 static void
-check_consistency_final(void)
+check_consistency_final(SAT_Tsolver * S)
 {
   unsigned i, j, ok;
-  print_stack();
+  print_stack(S);
   for (i = 1; i <= stack_clause_n; ++i)
     {
       if (stack_clause[i].deleted)
 	continue;
       for (ok = 0, j = 0; !ok && j < stack_clause[i].n; ++j)
-	ok |= SAT_lit_value(stack_clause[i].lit[j]) == VAL_TRUE;
+	ok |= SAT_lit_value_r(S, CLAUSE_LIT(stack_clause + i)[j]) == VAL_TRUE;
       if (!ok)
 	{
 	  printf("unsatisfied clause found:");
-	  print_clause(i);
+	  print_clause(S, i);
 	  assert(0);
 	}
     }
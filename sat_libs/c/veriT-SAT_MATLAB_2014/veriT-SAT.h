@@ -3,6 +3,13 @@
 
    Each propositional variable is identified with a positive integer.
    Each clause is identified with a positive integer.
+
+   All the state of the solver is held in an instance (SAT_Tsolver).
+   Functions suffixed with _r take the instance as first argument, so
+   that independent instances may be used at the same time, e.g. on
+   different threads.  Functions without suffix, as well as the
+   variables SAT_literal_stack, SAT_level, SAT_status..., work on a
+   default instance, which is set up by SAT_init and released by SAT_done.
  */
 #ifndef SAT_H
 #define SAT_H
@@ -10,11 +17,12 @@
 #define SAT_SYM
 
 #include <stdbool.h>
+#include <stddef.h>
 
 typedef unsigned SAT_Tvar;    /**< var index into stack_var */
-typedef unsigned SAT_Tlit;    /**< lit is var<<1 or var<<+1 according to polarity */ 
-typedef unsigned SAT_Tclause; /**< clause index into stack_clause */ 
-typedef unsigned SAT_Tlevel;  /**< level type */ 
+typedef unsigned SAT_Tlit;    /**< lit is var<<1 or var<<+1 according to polarity */
+typedef unsigned SAT_Tclause; /**< clause index into stack_clause */
+typedef unsigned SAT_Tlevel;  /**< level type */
 
 typedef enum {
   SAT_STATUS_UNSAT = 0,
@@ -22,6 +30,12 @@ typedef enum {
   SAT_STATUS_UNDEF = 2
 } SAT_Tstatus;
 
+typedef enum {
+  SAT_RESTART_LUBY = 0,  /**< luby suite only (stable) */
+  SAT_RESTART_GLUE = 1,  /**< moving averages of glue only (focused) */
+  SAT_RESTART_MIXED = 2  /**< alternates focused and stable phases */
+} SAT_Trestart;
+
 #define SAT_VAL_FALSE 0
 #define SAT_VAL_TRUE 1
 #define SAT_VAL_UNDEF 2
@@ -33,71 +47,156 @@ typedef enum {
 typedef unsigned char SAT_Tvalue;
 
 /**
-   \brief array of literals assigned by the SAT solver
-   \remark it is the full model if status is SAT
-   \remark it is not relevant if status is UNSAT */
-extern SAT_Tlit *SAT_literal_stack;
-/**
-   \brief number of literals assigned by the SAT solver
-   \remark it should be the number of literals if status is SAT
-   \remark it is not relevant if status is UNSAT */
-extern unsigned  SAT_literal_stack_n;
-/**
-   \brief number of literals kept unmodified in the stack
-   \remark User should set it to SAT_literal_stack_n to reset it */
-extern unsigned  SAT_literal_stack_hold;
-/**
-   \brief number of unit literals in the stack
-   \remark these literals will be true in all subsequent partial models */
-extern unsigned  SAT_literal_stack_unit;
-/**
-   \brief pointer to first literal to propagate
-   \remark do not modify.  Just to keep track of hints, if call to
-   SAT_propagate() is required */
-extern unsigned  SAT_literal_stack_to_propagate;
+   \brief tunable parameters of an instance
+   \remark they may be modified at any time, but are best set before
+   adding variables (phase is used for new variables) */
+typedef struct SAT_Tparams
+{
+  unsigned seed;             /**< seed for pseudo-random choices */
+  unsigned random_freq;      /**< about one decision in random_freq is
+				random (0 for none) */
+  SAT_Trestart restart;      /**< restart policy */
+  unsigned restart_interval; /**< restart after luby(i) << restart_interval
+				conflicts in stable phases */
+  double var_decay;          /**< decay factor of variable activities */
+  SAT_Tvalue phase;          /**< initial polarity for decisions
+				(SAT_VAL_UNDEF for random) */
+  unsigned cube_depth;       /**< number of variables split upon in
+				SAT_solve_cubes (0 for automatic) */
+  bool preprocess;           /**< simplify clauses before the first
+				propagation (subsumption, variable
+				elimination), model values of eliminated
+				variables being computed back */
+} SAT_Tparams;
 
 /**
-   \brief get the decision level of the sat solver (basically, the number of
-   decisions) */
-extern SAT_Tlevel SAT_level;
+   \brief a solver instance
+   \remark its content is private to the solver, except for the first
+   fields, accessed through SAT_state */
+typedef struct SAT_Tsolver SAT_Tsolver;
+
 /**
-   \brief array of levels
-   \remark it is not relevant if status is UNSAT */
-extern SAT_Tlevel *SAT_level_stack;
+   \brief fields of a solver instance that are visible to the user
+   \remark every instance starts with these fields */
+typedef struct SAT_Tstate
+{
+  /**
+     \brief status of the sat solver */
+  SAT_Tstatus status;
+  /**
+     \brief tunable parameters, initialised to default values */
+  SAT_Tparams params;
+  /**
+     \brief get the decision level of the sat solver (basically, the number of
+     decisions) */
+  SAT_Tlevel level;
+  /**
+     \brief array of literals assigned by the SAT solver
+     \remark it is the full model if status is SAT
+     \remark it is not relevant if status is UNSAT */
+  SAT_Tlit * literal_stack;
+  /**
+     \brief number of literals assigned by the SAT solver
+     \remark it should be the number of literals if status is SAT
+     \remark it is not relevant if status is UNSAT */
+  unsigned literal_stack_n;
+  /**
+     \brief number of literals kept unmodified in the stack
+     \remark User should set it to SAT_literal_stack_n to reset it */
+  unsigned literal_stack_hold;
+  /**
+     \brief number of unit literals in the stack
+     \remark these literals will be true in all subsequent partial models */
+  unsigned literal_stack_unit;
+  /**
+     \brief pointer to first literal to propagate
+     \remark do not modify.  Just to keep track of hints, if call to
+     SAT_propagate() is required */
+  unsigned literal_stack_to_propagate;
+  /**
+     \brief array of levels
+     \remark it is not relevant if status is UNSAT */
+  SAT_Tlevel * level_stack;
+  /**
+     \brief number of levels kept unmodified in the stack
+     \remark User should set it to SAT_level to reset it */
+  unsigned level_stack_hold;
+#ifdef SAT_SYM
+  /**
+     \author Pascal Fontaine
+     \brief in case symmetry is used, once a unit clause about a variable
+     is deduced, unit clauses about all variables in the orbit are
+     automatically added.  This array stores the orbit. */
+  SAT_Tvar * var_orbit;
+#endif
+#ifdef PROOF
+  unsigned proof;
+#if defined(INSIDE_VERIT)
+  unsigned proof_stack_n;
+  SAT_Tlit * proof_stack_lit;
+  SAT_Tclause * proof_stack_clause;
+#endif
+#endif
+} SAT_Tstate;
+
 /**
-   \brief number of levels kept unmodified in the stack
-   \remark User should set it to SAT_level to reset it */
-extern unsigned  SAT_level_stack_hold;
+   \brief access the user-visible fields of a solver instance
+   \param S the instance */
+#define SAT_state(S) ((SAT_Tstate *) (S))
 
 /**
-   \brief status of the sat solver */
-extern SAT_Tstatus SAT_status;
+   \brief the instance used by all functions without _r suffix */
+extern SAT_Tsolver * SAT_default;
 
+#define SAT_literal_stack (SAT_state(SAT_default)->literal_stack)
+#define SAT_literal_stack_n (SAT_state(SAT_default)->literal_stack_n)
+#define SAT_literal_stack_hold (SAT_state(SAT_default)->literal_stack_hold)
+#define SAT_literal_stack_unit (SAT_state(SAT_default)->literal_stack_unit)
+#define SAT_literal_stack_to_propagate \
+  (SAT_state(SAT_default)->literal_stack_to_propagate)
+#define SAT_level (SAT_state(SAT_default)->level)
+#define SAT_level_stack (SAT_state(SAT_default)->level_stack)
+#define SAT_level_stack_hold (SAT_state(SAT_default)->level_stack_hold)
+#define SAT_status (SAT_state(SAT_default)->status)
+#ifdef SAT_SYM
+#define SAT_var_orbit (SAT_state(SAT_default)->var_orbit)
+#endif
+#define SAT_params (SAT_state(SAT_default)->params)
+
+/**
+   \brief creates a new solver instance
+   \return the instance, ready to receive variables and clauses */
+SAT_Tsolver * SAT_new(void);
+/**
+   \brief releases a solver instance and all its memory
+   \param S the instance */
+void        SAT_delete(SAT_Tsolver * S);
 
 /**
    \brief creates a new propositional variable
    \return the identifier of the variable (an unsigned int)
    \remark ensures that internal data structures are resized if necessary to
-   accomodate the variable 
+   accomodate the variable
 */
 SAT_Tvar    SAT_var_new(void);
+SAT_Tvar    SAT_var_new_r(SAT_Tsolver * S);
 
 void        SAT_var_new_id(unsigned id);
+void        SAT_var_new_id_r(SAT_Tsolver * S, unsigned id);
 SAT_Tvalue  SAT_var_value(SAT_Tvar var);
+SAT_Tvalue  SAT_var_value_r(SAT_Tsolver * S, SAT_Tvar var);
 SAT_Tlevel  SAT_var_level(SAT_Tvar var);
+SAT_Tlevel  SAT_var_level_r(SAT_Tsolver * S, SAT_Tvar var);
 void        SAT_var_block_decide(SAT_Tvar var);
+void        SAT_var_block_decide_r(SAT_Tsolver * S, SAT_Tvar var);
 void        SAT_var_unblock_decide(SAT_Tvar var);
+void        SAT_var_unblock_decide_r(SAT_Tsolver * S, SAT_Tvar var);
 
-#ifdef SAT_SYM
 /**
-   \author Pascal Fontaine
-   \brief in case symmetry is used, once a unit clause about a variable
-   is deduced, unit clauses about all variables in the orbit are automatically
-   added.  This array stores the orbit. */
-extern SAT_Tvar * SAT_var_orbit;
-#endif
-
+   \brief sets the polarity of the next decision on every variable
+   according to params.phase */
 void        SAT_phase_cache_set(void);
+void        SAT_phase_cache_set_r(SAT_Tsolver * S);
 
 /**
    \author Pascal Fontaine
@@ -127,12 +226,14 @@ void        SAT_phase_cache_set(void);
    \param lit the literal
    \return the value (VAL_FALSE, VAL_TRUE, or VAL_UNDEF) */
 SAT_Tvalue  SAT_lit_value(SAT_Tlit lit);
+SAT_Tvalue  SAT_lit_value_r(SAT_Tsolver * S, SAT_Tlit lit);
 /**
    \author Pascal Fontaine
    \brief get the literal level
    \param lit the literal
    \return the level at which literal has been assigned */
 SAT_Tlevel  SAT_lit_level(SAT_Tlit lit);
+SAT_Tlevel  SAT_lit_level_r(SAT_Tsolver * S, SAT_Tlit lit);
 
 /**
    \author Pascal Fontaine
@@ -144,6 +245,7 @@ SAT_Tlevel  SAT_lit_level(SAT_Tlit lit);
    \todo there may be a better solution */
 #ifdef PROOF
 void        SAT_sanitize_root_level(void);
+void        SAT_sanitize_root_level_r(SAT_Tsolver * S);
 #endif
 
 /**
@@ -155,6 +257,7 @@ void        SAT_sanitize_root_level(void);
    \remark returns CLAUSE_UNDEF if valid clause or problem already found unsat
    \return clause id or CLAUSE_UNDEF */
 SAT_Tclause SAT_clause_new(unsigned n, SAT_Tlit * lits);
+SAT_Tclause SAT_clause_new_r(SAT_Tsolver * S, unsigned n, SAT_Tlit * lits);
 /**
    \author Pascal Fontaine
    \brief adds clause in SAT
@@ -162,9 +265,11 @@ SAT_Tclause SAT_clause_new(unsigned n, SAT_Tlit * lits);
    \param lits an array of n literals
    \remark destructive for the array of literals
    \remark returns CLAUSE_UNDEF if valid clause or problem already found unsat
-   \return clause id or CLAUSE_UNDEF 
+   \return clause id or CLAUSE_UNDEF
    \remark just as above, but clause may be purged later */
 SAT_Tclause SAT_clause_new_conflict(unsigned n, SAT_Tlit * lits);
+SAT_Tclause SAT_clause_new_conflict_r(SAT_Tsolver * S,
+				      unsigned n, SAT_Tlit * lits);
 /**
    \author Pascal Fontaine
    \brief adds a clause as late explanation for a literal
@@ -179,54 +284,349 @@ SAT_Tclause SAT_clause_new_conflict(unsigned n, SAT_Tlit * lits);
    literals in clause
    \return clause id or CLAUSE_UNDEF */
 SAT_Tclause SAT_clause_new_lazy(unsigned n, SAT_Tlit * lit);
+SAT_Tclause SAT_clause_new_lazy_r(SAT_Tsolver * S, unsigned n, SAT_Tlit * lit);
+/**
+   \brief adds clauses in compressed sparse form: clause i is made of
+   entries start[i] to start[i + 1] - 1.  Entry k is a literal on variable
+   index[k] + 1, positive iff value[k] > 0, and skipped if value[k] == 0
+   \param n the number of clauses
+   \param start an array of n + 1 positions
+   \param index an array of variable indices, from 0
+   \param value an array of polarities
+   \remark variables are created as needed
+   \remark this is the layout (CSC) of a MATLAB sparse matrix with a clause
+   per column, i.e. the layout (CSR) of its transpose */
+void        SAT_clauses_load_csc(unsigned n, const size_t * start,
+				 const size_t * index, const double * value);
+void        SAT_clauses_load_csc_r(SAT_Tsolver * S, unsigned n,
+				   const size_t * start,
+				   const size_t * index, const double * value);
+/**
+   \brief adds the constraint that at most k of the literals are true
+   \param n the number of literals
+   \param lit an array of n literals, left to the caller
+   \param k the number of literals allowed to be true
+   \remark the constraint is propagated as such, and the clauses
+   explaining its propagations are only built if needed
+   \remark variables of constraints are not eliminated by preprocessing
+   \remark not supported with proofs
+   \pre literals are on distinct variables */
+void        SAT_card_new(unsigned n, const SAT_Tlit * lit, unsigned k);
+void        SAT_card_new_r(SAT_Tsolver * S, unsigned n, const SAT_Tlit * lit,
+			   unsigned k);
+/**
+   \brief adds the constraint that exactly one of the literals is true
+   \param n the number of literals
+   \param lit an array of n literals, left to the caller
+   \pre literals are on distinct variables */
+void        SAT_exactly_one(unsigned n, const SAT_Tlit * lit);
+void        SAT_exactly_one_r(SAT_Tsolver * S, unsigned n,
+			      const SAT_Tlit * lit);
+/**
+   \brief adds cardinality constraints in compressed sparse form, as
+   for SAT_clauses_load_csc: at most k[i] literals of constraint i
+   are true
+   \param n the number of constraints
+   \param start an array of n + 1 positions
+   \param index an array of variable indices, from 0
+   \param value an array of polarities
+   \param k an array of n bounds */
+void        SAT_cards_load_csc(unsigned n, const size_t * start,
+			       const size_t * index, const double * value,
+			       const unsigned * k);
+void        SAT_cards_load_csc_r(SAT_Tsolver * S, unsigned n,
+				 const size_t * start, const size_t * index,
+				 const double * value, const unsigned * k);
 
 void        SAT_push(void);
+void        SAT_push_r(SAT_Tsolver * S);
 void        SAT_pop(void);
+void        SAT_pop_r(SAT_Tsolver * S);
 
 /**
    \author Pascal Fontaine
    \brief propagates until a decision has to be done
    \return SAT_STATUS_SAT, SAT_STATUS_UNSAT, or SAT_STATUS_UNDEF */
 SAT_Tstatus SAT_propagate(void);
+SAT_Tstatus SAT_propagate_r(SAT_Tsolver * S);
 /**
    \author Pascal Fontaine
    \brief adds hint, i.e. propagated literal with lazy clause
    \remark may be applied repeatedly
    \remark lit is either true (discarded) or undefined but never false */
 void        SAT_hint(SAT_Tlit lit);
+void        SAT_hint_r(SAT_Tsolver * S, SAT_Tlit lit);
 /**
    \author Pascal Fontaine
    \brief performs a decision
    \pre SAT_propagate applied just before (no SAT_hint meantime)
    \return false iff there is nothing to decide (therefore SAT) */
 bool        SAT_decide(void);
+bool        SAT_decide_r(SAT_Tsolver * S);
 /**
    \author Pascal Fontaine
    \brief restart SAT solver */
 void        SAT_restart(void);
+void        SAT_restart_r(SAT_Tsolver * S);
 
 /**
    \author Pascal Fontaine
    \brief runs until a model is found or unsat
    \return SAT_STATUS_SAT, SAT_STATUS_UNSAT */
 SAT_Tstatus SAT_solve(void);
+SAT_Tstatus SAT_solve_r(SAT_Tsolver * S);
+/**
+   \brief runs until a model is found in which the given literals
+   (assumptions) are true, or until they are shown inconsistent with
+   the clauses
+   \param n the number of literals
+   \param lits an array of n literals
+   \return SAT_STATUS_SAT, SAT_STATUS_UNSAT
+   \remark the literals are only assumed for this call, and learnt
+   clauses are kept for the next ones
+   \remark on SAT_STATUS_UNSAT, the assumptions responsible are given by
+   SAT_assumptions_core.  None means the clauses alone are unsat */
+SAT_Tstatus SAT_solve_assuming(unsigned n, SAT_Tlit * lits);
+SAT_Tstatus SAT_solve_assuming_r(SAT_Tsolver * S, unsigned n, SAT_Tlit * lits);
+/**
+   \brief gets the assumptions of the final conflict of the last
+   SAT_solve_assuming, i.e. a subset of them inconsistent with the clauses
+   \param PPlit pointer to an array, reallocated to hold the literals
+   \param n set to the number of literals */
+void        SAT_assumptions_core(SAT_Tlit ** PPlit, unsigned *n);
+void        SAT_assumptions_core_r(SAT_Tsolver * S, SAT_Tlit ** PPlit,
+				   unsigned *n);
+/**
+   \brief runs nthreads diversified copies of the solver concurrently,
+   until one finds a model or proves unsat
+   \param nthreads the number of threads (the calling one included)
+   \return SAT_STATUS_SAT, SAT_STATUS_UNSAT
+   \remark copies differ by seed, restart policy and interval, var_decay,
+   and phase
+   \remark copies exchange short learnt clauses
+   \remark the answer (and model) is available in the instance, as
+   after SAT_solve
+   \remark same as SAT_solve if threads are not available */
+SAT_Tstatus SAT_solve_portfolio(unsigned nthreads);
+SAT_Tstatus SAT_solve_portfolio_r(SAT_Tsolver * S, unsigned nthreads);
+/**
+   \brief cube-and-conquer: splits the problem into cubes (conjunctions
+   of literals) and solves them concurrently on nthreads copies
+   \param nthreads the number of threads (the calling one included)
+   \return SAT_STATUS_SAT, SAT_STATUS_UNSAT
+   \remark cubes are chosen by lookahead over the most active variables,
+   up to depth params.cube_depth
+   \remark each copy solves its cubes as assumptions, and steals cubes
+   from others once it runs out
+   \remark the answer (and model) is available in the instance, as
+   after SAT_solve
+   \remark same as SAT_solve if threads are not available */
+SAT_Tstatus SAT_solve_cubes(unsigned nthreads);
+SAT_Tstatus SAT_solve_cubes_r(SAT_Tsolver * S, unsigned nthreads);
 
 /* It is counterproductive to work only on decided literals, since
    propagated literals may also be removed */
 #define SAT_MIN_USE_TAUTOLOGIES 1
 #define SAT_MIN_SKIP_PROPAGATED 2
 void        SAT_minimal_model(SAT_Tlit ** PPlit, unsigned *n, unsigned options);
+void        SAT_minimal_model_r(SAT_Tsolver * S, SAT_Tlit ** PPlit,
+				unsigned *n, unsigned options);
+
+/**
+   \brief function called on each model by SAT_models
+   \param S the instance, of which variable values are the model
+   \param data the pointer given to SAT_models
+   \return false to stop enumerating */
+typedef bool (*SAT_Tmodel_callback)(SAT_Tsolver * S, void * data);
+/**
+   \brief enumerates the models of the clauses
+   \param n the number of variables to project models on, 0 for none
+   \param var an array of n variables
+   \param max the maximal number of models, 0 for no limit
+   \param callback function called on each model, or NULL
+   \param data pointer given to callback
+   \return the number of models found
+   \remark with projection, models differ on the variables in var, and
+   other variables have the values of one of their extensions
+   \remark each model found is excluded by a clause added to the
+   instance.  Calling again enumerates the next models.  The instance
+   is unsat once all models have been found */
+unsigned long SAT_models(unsigned n, SAT_Tvar * var, unsigned long max,
+			 SAT_Tmodel_callback callback, void * data);
+unsigned long SAT_models_r(SAT_Tsolver * S, unsigned n, SAT_Tvar * var,
+			   unsigned long max,
+			   SAT_Tmodel_callback callback, void * data);
+/**
+   \brief computes the backbone, i.e. the literals true in every model
+   \param n the number of variables to consider, 0 for all
+   \param var an array of n variables
+   \param PPlit pointer to an array, reallocated to hold the literals of
+   the backbone on the variables considered, sorted
+   \param lit_n set to the number of literals
+   \return SAT_STATUS_SAT, SAT_STATUS_UNSAT if the clauses are unsat (and
+   no literal is given), or SAT_STATUS_UNDEF if interrupted
+   \remark literals of the backbone are added to the instance as units,
+   and learnt clauses are kept */
+SAT_Tstatus SAT_backbone(unsigned n, SAT_Tvar * var, SAT_Tlit ** PPlit,
+			 unsigned * lit_n);
+SAT_Tstatus SAT_backbone_r(SAT_Tsolver * S, unsigned n, SAT_Tvar * var,
+			   SAT_Tlit ** PPlit, unsigned * lit_n);
+
+/* options of SAT_mus */
+#define SAT_MUS_CORE 1        /* only a core, not minimized */
+#define SAT_MUS_QUICKXPLAIN 2 /* minimization by QuickXplain, rather than
+				 by deletion */
+/**
+   \brief finds a minimal subset of literals inconsistent with the
+   clauses, i.e. such that solving assuming them is unsat, but not
+   assuming any proper subset
+   \param n the number of literals
+   \param lit the literals, typically selectors of groups of clauses,
+   each clause of a group having the negation of its selector
+   \param PPlit pointer to an array, reallocated to hold the literals of
+   the subset (in no particular order)
+   \param lit_n set to the number of literals
+   \param options 0, or SAT_MUS_CORE or SAT_MUS_QUICKXPLAIN
+   \return SAT_STATUS_SAT if the literals are consistent with the
+   clauses (and no literal is given), SAT_STATUS_UNSAT, or
+   SAT_STATUS_UNDEF if interrupted
+   \remark no literal is given if the clauses alone are unsat
+   \remark with SAT_MUS_CORE, the subset is a core of the first solve,
+   shrinking by solving again is left to the caller
+   \remark clauses learnt are kept */
+SAT_Tstatus SAT_mus(unsigned n, SAT_Tlit * lit, SAT_Tlit ** PPlit,
+		    unsigned * lit_n, unsigned options);
+SAT_Tstatus SAT_mus_r(SAT_Tsolver * S, unsigned n, SAT_Tlit * lit,
+		      SAT_Tlit ** PPlit, unsigned * lit_n, unsigned options);
+
+/* options of SAT_maxsat */
+#define SAT_MAXSAT_LINEAR 1   /* linear SAT-UNSAT search only */
+/**
+   \brief finds a model of the clauses of least cost, the cost of a
+   model being the total weight of the soft literals it falsifies
+   \param n the number of soft literals
+   \param lit the soft literals, typically selectors of soft clauses,
+   each soft clause having the negation of its selector
+   \param weight their weights, the literals of weight 0 are ignored
+   \param cost set to the least cost, or to a lower bound if interrupted
+   \param options 0, or SAT_MAXSAT_LINEAR
+   \return SAT_STATUS_SAT, and the model of the instance is of least
+   cost, SAT_STATUS_UNSAT if the clauses are unsat, or SAT_STATUS_UNDEF
+   if interrupted
+   \remark the search is core-guided by default, and linear, i.e. by
+   models of decreasing cost, with SAT_MAXSAT_LINEAR
+   \remark counters of false soft literals are added, with variables and
+   clauses of their own, which do not constrain the others */
+SAT_Tstatus SAT_maxsat(unsigned n, SAT_Tlit * lit,
+		       const unsigned long * weight, unsigned long * cost,
+		       unsigned options);
+SAT_Tstatus SAT_maxsat_r(SAT_Tsolver * S, unsigned n, SAT_Tlit * lit,
+			 const unsigned long * weight, unsigned long * cost,
+			 unsigned options);
+/**
+   \brief weighted count of the models of the clauses satisfying the
+   given literals
+   \param weight the weight of each literal, indexed by literal (two per
+   variable, variable 0 included), or NULL for 1
+   \param n the number of literals
+   \param lit an array of n literals
+   \return the sum, over the models satisfying the literals, of the
+   product of the weights of their literals
+   \remark with weights p and 1 - p for the polarities of each variable,
+   this is the probability that the clauses and literals are satisfied
+   when each variable is true with probability p
+   \remark learnt clauses are kept, but no clause is added */
+double SAT_count(const double * weight, unsigned n, SAT_Tlit * lit);
+double SAT_count_r(SAT_Tsolver * S, const double * weight, unsigned n,
+		   SAT_Tlit * lit);
+
+/**
+   \brief circuit compiled from the clauses, as a decision-DNNF */
+typedef struct SAT_Tnnf SAT_Tnnf;
+/**
+   \brief compiles the clauses into a circuit
+   \return the circuit, to be deleted with SAT_nnf_delete
+   \remark the circuit answers the queries of SAT_count on the clauses
+   at the time of the call, for any weights, in time linear in its size.
+   Counting under literals is counting with the weights of their
+   negations set to 0
+   \remark learnt clauses are kept, but no clause is added */
+SAT_Tnnf * SAT_compile(void);
+SAT_Tnnf * SAT_compile_r(SAT_Tsolver * S);
+void       SAT_nnf_delete(SAT_Tnnf * nnf);
+/**
+   \brief the number of variables of the compiled clauses */
+unsigned   SAT_nnf_var_n(const SAT_Tnnf * nnf);
+/**
+   \brief the number of edges of the circuit, i.e. its size */
+unsigned   SAT_nnf_size(const SAT_Tnnf * nnf);
+/**
+   \brief weighted count of the models of the compiled clauses
+   \param weight the weight of each literal, as for SAT_count */
+double     SAT_nnf_count(const SAT_Tnnf * nnf, const double * weight);
+/**
+   \brief weighted counts of the models with each literal
+   \param weight the weight of each literal, as for SAT_count
+   \param marginal set to the weighted count of the models with each
+   literal, indexed by literal (2 * SAT_nnf_var_n(nnf) + 2 of them)
+   \return the weighted count of all models, so marginal[lit] divided by
+   this is the probability of lit */
+double     SAT_nnf_marginals(const SAT_Tnnf * nnf, const double * weight,
+			     double * marginal);
+/**
+   \brief writes the circuit to a binary file
+   \return false on error */
+bool       SAT_nnf_save(const SAT_Tnnf * nnf, const char * file);
+/**
+   \brief reads a circuit written by SAT_nnf_save
+   \return the circuit, or NULL if the file cannot be read or is not
+   a circuit */
+SAT_Tnnf * SAT_nnf_load(const char * file);
+/**
+   \brief draws models of the compiled clauses, with probability
+   proportional to their weight
+   \param weight the weight of each literal, as for SAT_count
+   \param sample_n the number of models to draw
+   \param sample set to the values (SAT_VAL_TRUE or SAT_VAL_FALSE) of
+   the SAT_nnf_var_n(nnf) variables in each model, one model after the
+   other
+   \param seed seed for pseudo-random choices, updated
+   \return sample_n, or 0 if the weighted count is 0 */
+unsigned   SAT_nnf_sample(const SAT_Tnnf * nnf, const double * weight,
+			  unsigned sample_n, SAT_Tvalue * sample,
+			  unsigned * seed);
+
+/**
+   \brief draws models of the clauses, near uniformly
+   \param n the number of variables sampled, 0 for all
+   \param var an array of n variables
+   \param sample_n the number of models to draw
+   \param sample set to the values (SAT_VAL_TRUE or SAT_VAL_FALSE) of
+   the variables sampled in each model, one model after the other
+   \return the number of models drawn, 0 if the clauses are unsat, and
+   less than sample_n only if cells of the right size are not found
+   \remark models are drawn among the distinct assignments of the
+   variables sampled, so with n variables, each of those is drawn about
+   as often as any other, whatever its number of models
+   \remark sampling is done on a copy of the clauses, using random xor
+   constraints, and the instance is left unchanged (but at root level).
+   Pseudo-random choices use params.seed */
+unsigned SAT_sample(unsigned n, SAT_Tvar * var, unsigned sample_n,
+		    SAT_Tvalue * sample);
+unsigned SAT_sample_r(SAT_Tsolver * S, unsigned n, SAT_Tvar * var,
+		      unsigned sample_n, SAT_Tvalue * sample);
 
 void        SAT_init(void);
 void        SAT_done(void);
 void        SAT_reset(void);
+void        SAT_reset_r(SAT_Tsolver * S);
 
 #ifdef PROOF
-extern unsigned SAT_proof;
+#define SAT_proof (SAT_state(SAT_default)->proof)
 #if defined(INSIDE_VERIT)
-extern unsigned SAT_proof_stack_n;
-extern SAT_Tlit *SAT_proof_stack_lit;
-extern SAT_Tclause *SAT_proof_stack_clause;
+#define SAT_proof_stack_n (SAT_state(SAT_default)->proof_stack_n)
+#define SAT_proof_stack_lit (SAT_state(SAT_default)->proof_stack_lit)
+#define SAT_proof_stack_clause (SAT_state(SAT_default)->proof_stack_clause)
 #endif
 #endif
 